@@ -5,8 +5,17 @@
 #include "PID.h"
 #include "Motor.h"
 #include "ArmJointController.h"
-
-const ArmJointController::t_jointConfig turnTableConfig = {
+#include "JointBank.h"
+#include "FirmwareUpdateService.h"
+#include "PIDTuningService.h"
+#include "LoopCaptureService.h"
+#include "TimeSyncService.h"
+#include "BoardStatusService.h"
+#include "CrashLogService.h"
+#include "CommandWatchdog.h"
+#include "IndependentWatchdog.h"
+
+constexpr ArmJointController::t_jointConfig turnTableConfig = {
         .motor = {
                 .pwmPin = MOTOR1,
                 .dirPin = MOTOR1_DIR,
@@ -48,7 +57,7 @@ const ArmJointController::t_jointConfig turnTableConfig = {
         .maxOutputMotorDutyCycle = 1.0f
 };
 
-const ArmJointController::t_jointConfig shoulderConfig = {
+constexpr ArmJointController::t_jointConfig shoulderConfig = {
         .motor = {
                 .pwmPin = MOTOR2,
                 .dirPin = MOTOR2_DIR,
@@ -90,7 +99,7 @@ const ArmJointController::t_jointConfig shoulderConfig = {
         .maxOutputMotorDutyCycle = 1.0f
 };
 
-const ArmJointController::t_jointConfig elbowConfig = {
+constexpr ArmJointController::t_jointConfig elbowConfig = {
         .motor = {
                 .pwmPin = MOTOR3,
                 .dirPin = MOTOR3_DIR,
@@ -132,26 +141,52 @@ const ArmJointController::t_jointConfig elbowConfig = {
         .maxOutputMotorDutyCycle = 1.0f
 };
 
+static_assert(ArmJointController::isValidConfig(turnTableConfig), "Turntable config out of range");
+static_assert(ArmJointController::isValidConfig(shoulderConfig), "Shoulder config out of range");
+static_assert(ArmJointController::isValidConfig(elbowConfig), "Elbow config out of range");
+
 Serial             pc(SERIAL_TX, SERIAL_RX, ROVER_DEFAULT_BAUD_RATE);
 CAN                can(CAN_RX, CAN_TX, ROVER_CANBUS_FREQUENCY);
 CANMsg             rxMsg;
 
+FirmwareUpdateService firmwareUpdateService(can, ROVER_ARM_LOWER_CANID);
+PIDTuningService      pidTuningService(can, ROVER_ARM_LOWER_CANID);
+LoopCaptureService    loopCaptureService(can, ROVER_ARM_LOWER_CANID);
+TimeSyncService       timeSyncService(can, ROVER_ARM_LOWER_CANID);
+BoardStatusService    boardStatusService(can, ROVER_ARM_LOWER_CANID);
+CrashLogService       crashLogService(can, ROVER_ARM_LOWER_CANID);
+CommandWatchdog       commandWatchdog(can, ROVER_ARM_LOWER_CANID);
+
 DigitalOut         ledErr(LED1);
 DigitalOut         ledCAN(LED4);
 
-ArmJointController turnTableController(turnTableConfig, ArmJointController::velocityPID);
-ArmJointController shoulderController(shoulderConfig, ArmJointController::velocityPID);
-ArmJointController elbowController(elbowConfig, ArmJointController::velocityPID);
+enum t_joint {
+    turnTable,
+    shoulder,
+    elbow,
 
-ArmJointController* p_armJointControllers[3];
+    jointCount
+};
+
+// Indexed by t_joint
+constexpr const ArmJointController::t_jointConfig *jointConfigs[jointCount] = {
+    &turnTableConfig,
+    &shoulderConfig,
+    &elbowConfig
+};
+
+JointBank<jointCount> joints(jointConfigs, ArmJointController::velocityPID);
 
 Timer              canSendTimer;
-Timer              canWatchDog;
 
-enum t_joint {
-    turnTable,
-    shoulder,
-    elbow
+// PID tuning targets, keep the numbering stable so saved tunings stay with their loop
+enum t_pidTuningTarget {
+    turnTableVelocityPID,
+    turnTablePositionPID,
+    shoulderVelocityPID,
+    shoulderPositionPID,
+    elbowVelocityPID,
+    elbowPositionPID
 };
 
 void printCANMsg(CANMessage& msg) {
@@ -182,16 +217,44 @@ enum armCommand {
 void initCAN() {
     can.filter(ROVER_ARM_LOWER_CANID, ROVER_CANID_FILTER_MASK, CANStandard);
 
+    // The SYNC broadcast is outside the board's ID range, it gets the second filter bank
+    can.filter(ROVER_CANID_SYNC, 0x7FF, CANStandard, 1);
+
     // for (int canHandle = firstCommand; canHandle <= lastCommand; canHandle++) {
     //     can.filter(RX_ID + canHandle, 0xFFF, CANStandard, canHandle);
     // }
 }
 
+void initPIDTuning() {
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(turnTableVelocityPID, joints.getVelocityPIDController(turnTable)));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(turnTablePositionPID, joints.getPositionPIDController(turnTable)));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(shoulderVelocityPID, joints.getVelocityPIDController(shoulder)));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(shoulderPositionPID, joints.getPositionPIDController(shoulder)));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(elbowVelocityPID, joints.getVelocityPIDController(elbow)));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(elbowPositionPID, joints.getPositionPIDController(elbow)));
+
+    pidTuningService.loadStoredTunings();
+}
+
+void initCommandWatchdog() {
+    // Watchdog axes are numbered like t_joint
+    for (unsigned int joint = 0; joint < jointCount; joint++) {
+        MBED_WARN_ON_ERROR(commandWatchdog.registerMotor(joint, joints.getMotor(joint)));
+    }
+}
+
+void initLoopCapture() {
+    // Capture targets are numbered like t_joint
+    for (unsigned int joint = 0; joint < jointCount; joint++) {
+        MBED_WARN_ON_ERROR(loopCaptureService.registerCapture(joint, joints.getCapture(joint)));
+    }
+}
+
 ArmJointController::t_jointControlMode handleSetControlMode(t_joint joint, CANMsg *p_newMsg) {
     ArmJointController::t_jointControlMode controlMode;
     *p_newMsg >> controlMode;
 
-    MBED_WARN_ON_ERROR(p_armJointControllers[joint]->setControlMode(controlMode));
+    MBED_WARN_ON_ERROR(joints.setControlMode(joint, controlMode));
 
     PRINT_INFO("Set joint %d control mode to %d\r\n", joint, controlMode);
 
@@ -202,17 +265,17 @@ float handleSetMotion(t_joint joint, CANMsg *p_newMsg) {
     float motionData = 0;
     *p_newMsg >> motionData;
 
-    ArmJointController::t_jointControlMode controlMode = p_armJointControllers[joint]->getControlMode();
+    ArmJointController::t_jointControlMode controlMode = joints.getControlMode(joint);
 
     switch (controlMode) {
         case ArmJointController::motorDutyCycle:
-            p_armJointControllers[joint]->setMotorDutyCycle(motionData);
+            joints.setMotorDutyCycle(joint, motionData);
             break;
         case ArmJointController::velocityPID:
-            p_armJointControllers[joint]->setVelocityDegreesPerSec(motionData);
+            joints.setVelocityDegreesPerSec(joint, motionData);
             break;
         case ArmJointController::positionPID:
-            p_armJointControllers[joint]->setAngleDegrees(motionData);
+            joints.setAngleDegrees(joint, motionData);
             break;
     }
 
@@ -256,14 +319,36 @@ void processCANMsg(CANMsg *p_newMsg) {
     }
 }
 
+// Each joint has a control mode and a motion command, in that order
+void feedCommandWatchdog(CANMsg *p_newMsg) {
+    if (p_newMsg->id >= firstCommand && p_newMsg->id <= lastCommand) {
+        commandWatchdog.commandReceived((p_newMsg->id - firstCommand) / 2);
+    }
+}
+
+// Stopped joints hold still, rather than carry on with their stale command once they are commanded again
+void holdStoppedJoints(uint8_t stoppedMask) {
+    for (unsigned int i = 0; i < jointCount; i++) {
+        if (stoppedMask & (1 << i)) {
+            MBED_WARN_ON_ERROR(joints.setControlMode(i, joints.getControlMode(i)));
+        }
+    }
+}
+
+void stopJoints() {
+    for (unsigned int i = 0; i < jointCount; i++) {
+        MBED_WARN_ON_ERROR(joints.setControlMode(i, ArmJointController::motorDutyCycle));
+    }
+}
+
 void sendJointAngles() {
 
     CANMsg txMsg(0);
     float angle = 0;
 
-    for (unsigned int i = 0; i < 3; i++) {
+    for (unsigned int i = 0; i < jointCount; i++) {
 
-        angle = p_armJointControllers[i]->getAngleDegrees();
+        angle = joints.getAngleDegrees(i);
 
 //        char arr[sizeof(angle)];
 //        memcpy(arr, &angle, sizeof(angle));
@@ -271,6 +356,7 @@ void sendJointAngles() {
         txMsg.clear();
         txMsg.id = ROVER_JETSON_START_CANID_MSG_ARM_LOWER + i;
         txMsg << angle;
+        timeSyncService.stamp(txMsg);
 
         MBED_ASSERT_WARN(can.write(txMsg));
 
@@ -279,38 +365,64 @@ void sendJointAngles() {
  
 int main(void)
 {
-    p_armJointControllers[turnTable] = &turnTableController;
-    p_armJointControllers[shoulder]  = &shoulderController;
-    p_armJointControllers[elbow]     = &elbowController;
-
     PRINT_INFO("Lower arm program Started\r\n\r\n");
 
     initCAN();
+    initPIDTuning();
+    initLoopCapture();
+    initCommandWatchdog();
 
-    turnTableController.setControlMode(ArmJointController::motorDutyCycle);
-    shoulderController.setControlMode(ArmJointController::motorDutyCycle);
-    elbowController.setControlMode(ArmJointController::motorDutyCycle);
+    stopJoints();
 
     canSendTimer.start();
-    canWatchDog.start();
+    commandWatchdog.start();
+    IndependentWatchdog::start(ROVER_IWDG_TIMEOUT_MS);
 
     while (1) {
 
+        IndependentWatchdog::kick();
+
         if (can.read(rxMsg)) {
-            canWatchDog.reset();
-            processCANMsg(&rxMsg);
+            uint32_t rxTimeUs = timeSyncService.getTimeUs();
+
+            bool wasUpdating = firmwareUpdateService.isUpdateInProgress();
+
+            if (firmwareUpdateService.handleCANMsg(rxMsg)) {
+                if (!wasUpdating && firmwareUpdateService.isUpdateInProgress()) {
+                    stopJoints();
+                }
+            }
+            else if (!timeSyncService.handleCANMsg(rxMsg, rxTimeUs) && !pidTuningService.handleCANMsg(rxMsg) &&
+                     !loopCaptureService.handleCANMsg(rxMsg) && !crashLogService.handleCANMsg(rxMsg)) {
+                timeSyncService.commandReceived(rxMsg, rxTimeUs);
+                feedCommandWatchdog(&rxMsg);
+                processCANMsg(&rxMsg);
+            }
+
             rxMsg.clear();
             ledCAN = !ledCAN;
         }
 
+        firmwareUpdateService.rebootIfRequested();
+
+        // Flash writes stall the control loop, so the joints stay stopped until the update is done
+        if (firmwareUpdateService.isUpdateInProgress()) {
+            continue;
+        }
+
         if (canSendTimer.read() > 0.1) {
             sendJointAngles();
             canSendTimer.reset();
         }
 
-        turnTableController.update();
-        shoulderController.update();
-        elbowController.update();
+        loopCaptureService.poll();
+        boardStatusService.poll();
+        crashLogService.poll();
+        holdStoppedJoints(commandWatchdog.poll());
+
+        joints.update();
+
+        timeSyncService.sendCommandAcks();
 
     }
 }
@@ -2,12 +2,20 @@
 #define ARM_CLAW_CONTROLLER_H
 
 /* Controller for the arm claw
+ *
+ * The config is referenced rather than copied, so it must outlive the
+ * controller. Declared constexpr it stays in flash, along with the separation
+ * table the compiler samples from its calibration.
  */
 
 #include "mbed.h"
 #include "Motor.h"
 #include "QEI.h"
+#include "QEIVelocityEstimator.h"
 #include "PID.h"
+#include "LoopCapture.h"
+#include "MicrosecondClock.h"
+#include "ClawSeparationTable.h"
 #include "PinNames.h"
 
 // CLASS
@@ -25,6 +33,9 @@ public:
         // Claw encoder config
         QEI::t_relativeEncoderConfig encoder;
 
+        // Encoder pulses to separation fit
+        ClawSeparationTable::t_calibration separation;
+
         // Limit switch pin
         PinName limitSwitchPin;
         float calibrationDutyCycle, calibrationTimeoutSeconds;
@@ -32,9 +43,15 @@ public:
         // PID config
         PID::t_pidConfig positionPID;
 
-        float minInputSeparationDistanceCm, maxInputSeparationDistanceCm;
+        float minInputSeparationDistanceMm, maxInputSeparationDistanceMm;
         float minOutputMotorDutyCycle, maxOutputMotorDutyCycle;
 
+        // Derived, leave out of the initialiser
+        ClawSeparationTable separationTable = ClawSeparationTable(separation);
+
+        // The position PID runs on encoder pulses, negated if the claw closes as they count up
+        float pulsesToPIDInput = separationTable.isDescending() ? -1.0f : 1.0f;
+
     } t_clawConfig;
 
     typedef enum t_controlMode {
@@ -43,7 +60,18 @@ public:
 
     } t_clawControlMode;
 
-    explicit ArmClawController(t_clawConfig armClawConfig, t_clawControlMode controlMode = motorDutyCycle);
+    explicit ArmClawController(const t_clawConfig &armClawConfig, t_clawControlMode controlMode = motorDutyCycle);
+
+    /** @return false if the separation fit never reaches 0 mm or turns back, a limit is out of range or a minimum is above its maximum
+     */
+    static constexpr bool isValidConfig(const t_clawConfig &config) {
+        return config.separation.maxPulses > 0 && config.separationTable.isMonotonic() &&
+               config.minInputSeparationDistanceMm < config.maxInputSeparationDistanceMm &&
+               config.minOutputMotorDutyCycle < config.maxOutputMotorDutyCycle &&
+               config.minOutputMotorDutyCycle >= -1.0f && config.maxOutputMotorDutyCycle <= 1.0f &&
+               config.calibrationDutyCycle > 0.0f && config.calibrationDutyCycle <= config.motor.limit &&
+               config.positionPID.interval > 0.0f;
+    }
 
     mbed_error_status_t setControlMode(t_clawControlMode controlMode);
 
@@ -59,6 +87,14 @@ public:
 
     float getSeparationDistanceCm();
 
+    float getVelocityEncoderPulsesPerSec();
+
+    PID &getPositionPIDController();
+
+    LoopCapture &getCapture();
+
+    Motor &getMotor();
+
     mbed_error_status_t runEndpointCalibration();
 
     void update();
@@ -69,19 +105,25 @@ private:
 
     float encoderPulsesToMm(int encoderPulses);
 
+    float encoderPulsesToPIDInput(int encoderPulses);
+
     t_clawControlMode m_controlMode;
-    t_clawConfig m_armClawConfig;
+    const t_clawConfig &m_armClawConfig;
 
     Motor m_motor;
     QEI m_encoder;
+    QEIVelocityEstimator m_velocityEstimator;
     DigitalIn m_limitSwitch;
 
     PID m_positionPIDController;
+    float m_setPointMm;
+
+    LoopCapture m_capture;
 
     float m_inversionMultiplier;
     bool m_encoderEndpointCalibrated;
 
-    Timer timer;
+    uint32_t m_lastUpdateUs;
 
 };
 
@@ -27,7 +27,7 @@ public:
 
     } t_armWristConfig;
 
-    explicit ArmWristController(t_armWristConfig armWristConfig, ArmJointController::t_jointControlMode controlMode = ArmJointController::motorDutyCycle);
+    explicit ArmWristController(const t_armWristConfig &armWristConfig, ArmJointController::t_jointControlMode controlMode = ArmJointController::motorDutyCycle);
 
     mbed_error_status_t setControlMode(ArmJointController::t_jointControlMode controlMode);
 
@@ -53,6 +53,10 @@ public:
 
     float getPitchAngleVelocityDegreesPerSec();
 
+    ArmJointController &getLeftJointController();
+
+    ArmJointController &getRightJointController();
+
     void update();
 
 private:
@@ -69,8 +73,6 @@ private:
     float m_rollVelocitiyDegreesPerSec, m_pitchVelocityDegreesPerSec;
     float m_rollAngleDegrees, m_pitchAngleDegrees;
 
-    Timer timer;
-
 };
 
 #endif // ARM_WRIST_CONTROLLER_H
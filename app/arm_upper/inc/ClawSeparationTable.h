@@ -0,0 +1,154 @@
+#ifndef CLAW_SEPARATION_TABLE_H
+#define CLAW_SEPARATION_TABLE_H
+
+/* Conversion between claw encoder pulses and claw separation.
+ *
+ * The separation is a cubic of the pulse count fitted during calibration.
+ * Rather than evaluating it (in emulated floating point) on every update, it
+ * is sampled at construction into a table of evenly spaced points, a power of
+ * two pulses apart, and interpolated linearly with integer math. The same
+ * table converts a separation back to pulses, so the position loop can run on
+ * the raw encoder count. Constructed constexpr, the sampling is done by the
+ * compiler and the table sits in flash.
+ *
+ * The calibration endpoint is the claw fully open, the end of travel is where
+ * the cubic reaches 0 mm. The cubic must be monotonic in between. No mbed
+ * dependencies.
+ */
+
+#include <stdint.h>
+
+#define CLAW_SEPARATION_TABLE_SEGMENTS 32
+#define CLAW_SEPARATION_TABLE_MAX_PULSES  (1 << 20)  // Search limit for the closed claw
+#define CLAW_SEPARATION_TABLE_SEARCH_STEP 256
+
+class ClawSeparationTable {
+
+public:
+
+    typedef struct {
+        // Separation in mm = a + b * pulses + c * pulses^2 + d * pulses^3
+        float a, b, c, d;
+
+        // Derived, leave out of the initialiser. Pulse count from the calibration endpoint
+        // (open) to the claw closed, where the fit reaches 0 mm; 0 if it never does
+        int32_t maxPulses = closedPulses(a, b, c, d);
+
+    } t_calibration;
+
+    /** @return First pulse count at which the cubic reaches 0 mm, 0 if it does not before CLAW_SEPARATION_TABLE_MAX_PULSES
+     */
+    static constexpr int32_t closedPulses(float a, float b, float c, float d) {
+        int32_t low = 0, high = CLAW_SEPARATION_TABLE_SEARCH_STEP;
+
+        if (separationMm(a, b, c, d, low) <= 0.0f) {
+            return 0;
+        }
+
+        // Step out to the first crossing, the cubic may come back up beyond it
+        while (separationMm(a, b, c, d, high) > 0.0f) {
+            if (high >= CLAW_SEPARATION_TABLE_MAX_PULSES) {
+                return 0;
+            }
+
+            low   = high;
+            high += CLAW_SEPARATION_TABLE_SEARCH_STEP;
+        }
+
+        // The fit is positive at low and not at high
+        while (high - low > 1) {
+            int32_t middle = low + (high - low) / 2;
+
+            if (separationMm(a, b, c, d, middle) > 0.0f) {
+                low = middle;
+            }
+            else {
+                high = middle;
+            }
+        }
+
+        return high;
+    }
+
+    explicit constexpr ClawSeparationTable(const t_calibration &calibration) :
+            m_maxPulses(calibration.maxPulses), m_stepShift(0), m_micrometres(), m_endMicrometres(0) {
+
+        // Smallest power of two step that covers the whole travel
+        while (((int32_t)CLAW_SEPARATION_TABLE_SEGMENTS << m_stepShift) < calibration.maxPulses) {
+            m_stepShift++;
+        }
+
+        for (uint8_t i = 0; i <= CLAW_SEPARATION_TABLE_SEGMENTS; i++) {
+            // Points after the one closing the last segment repeat it, the cubic may turn back there
+            if (i > 0 && ((int32_t)(i - 1) << m_stepShift) >= m_maxPulses) {
+                m_micrometres[i] = m_micrometres[i - 1];
+                continue;
+            }
+
+            float mm = separationMm(calibration.a, calibration.b, calibration.c, calibration.d, (int32_t)i << m_stepShift);
+
+            m_micrometres[i] = (int32_t)(mm * 1000.0f + (mm < 0.0f ? -0.5f : 0.5f));
+        }
+
+        m_endMicrometres = pulsesToMicrometres(m_maxPulses);
+    }
+
+    /** @return Separation in micrometres, pulses outside of the calibrated range are clamped
+     */
+    constexpr int32_t pulsesToMicrometres(int32_t pulses) const {
+        if (pulses <= 0) {
+            return m_micrometres[0];
+        }
+
+        if (pulses > m_maxPulses) {
+            pulses = m_maxPulses;
+        }
+
+        uint32_t index = (uint32_t)pulses >> m_stepShift;
+
+        if (index >= CLAW_SEPARATION_TABLE_SEGMENTS) {
+            return m_micrometres[CLAW_SEPARATION_TABLE_SEGMENTS];
+        }
+
+        int32_t fraction = pulses - (int32_t)(index << m_stepShift);
+        int32_t delta = m_micrometres[index + 1] - m_micrometres[index];
+
+        return m_micrometres[index] + (int32_t)(((int64_t)delta * fraction) >> m_stepShift);
+    }
+
+    /** @return Pulse count closest to a separation, clamped to the calibrated range
+     */
+    int32_t micrometresToPulses(int32_t micrometres) const;
+
+    /** @return true if the separation shrinks as the pulse count grows
+     */
+    constexpr bool isDescending(void) const {
+        return m_endMicrometres < m_micrometres[0];
+    }
+
+    /** @return false if the cubic turns back within the calibrated range
+     */
+    constexpr bool isMonotonic(void) const {
+        for (uint8_t i = 0; i < CLAW_SEPARATION_TABLE_SEGMENTS; i++) {
+            if (isDescending() ? m_micrometres[i + 1] > m_micrometres[i] : m_micrometres[i + 1] < m_micrometres[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+
+    static constexpr float separationMm(float a, float b, float c, float d, int32_t pulses) {
+        return a + pulses * (b + pulses * (c + pulses * d));
+    }
+
+    int32_t m_maxPulses;
+    uint8_t m_stepShift;
+    int32_t m_micrometres[CLAW_SEPARATION_TABLE_SEGMENTS + 1];
+    int32_t m_endMicrometres;
+
+};
+
+#endif // CLAW_SEPARATION_TABLE_H
@@ -3,18 +3,18 @@
 
 #include "ArmClawController.h"
 
-const float k_PulsesToCmA = 121;
-const float k_PulsesToCmB = -9.35E-05;
-const float k_PulsesToCmC = -1.11E-07;
-const float k_PulsesToCmD = 1.08E-12;
-
-ArmClawController::ArmClawController(ArmClawController::t_clawConfig armClawConfig, ArmClawController::t_clawControlMode controlMode) :
-         m_controlMode(controlMode), m_armClawConfig(armClawConfig), m_motor(armClawConfig.motor), m_encoder(armClawConfig.encoder), m_limitSwitch(armClawConfig.limitSwitchPin),
-         m_positionPIDController(armClawConfig.positionPID.P, armClawConfig.positionPID.I, armClawConfig.positionPID.D, armClawConfig.positionPID.interval) {
+ArmClawController::ArmClawController(const ArmClawController::t_clawConfig &armClawConfig, ArmClawController::t_clawControlMode controlMode) :
+         m_controlMode(controlMode), m_armClawConfig(armClawConfig), m_motor(armClawConfig.motor), m_encoder(armClawConfig.encoder), m_velocityEstimator(m_encoder), m_limitSwitch(armClawConfig.limitSwitchPin),
+         m_positionPIDController(armClawConfig.positionPID.P, armClawConfig.positionPID.I, armClawConfig.positionPID.D, armClawConfig.positionPID.interval),
+         m_capture(0.01f) { // 0.01 mm per LSB
 
     m_encoderEndpointCalibrated = false;
+    m_setPointMm = 0.0f;
+
     initializePIDController();
-    timer.start();
+
+    MicrosecondClock::init();
+    m_lastUpdateUs = MicrosecondClock::read();
 
 }
 
@@ -39,7 +39,7 @@ mbed_error_status_t ArmClawController::setControlMode(ArmClawController::t_clawC
     m_controlMode = controlMode;
     m_motor.setDutyCycle(0.0f);
 
-    timer.reset();
+    m_lastUpdateUs = MicrosecondClock::read();
 
     return MBED_SUCCESS;
 }
@@ -65,14 +65,17 @@ mbed_error_status_t ArmClawController::setSeparationDistanceMm(float separationD
         return MBED_ERROR_INVALID_OPERATION;
     }
 
-    if (getSeparationDistanceCm() < m_armClawConfig.minInputSeparationDistanceCm) {
-        separationDistanceMm = m_armClawConfig.minInputSeparationDistanceCm;
+    if (separationDistanceMm < m_armClawConfig.minInputSeparationDistanceMm) {
+        separationDistanceMm = m_armClawConfig.minInputSeparationDistanceMm;
     }
-    else if (getSeparationDistanceCm() > m_armClawConfig.maxInputSeparationDistanceCm) {
-        separationDistanceMm = m_armClawConfig.maxInputSeparationDistanceCm;
+    else if (separationDistanceMm > m_armClawConfig.maxInputSeparationDistanceMm) {
+        separationDistanceMm = m_armClawConfig.maxInputSeparationDistanceMm;
     }
 
-    m_positionPIDController.setSetPoint(separationDistanceMm);
+    m_setPointMm = separationDistanceMm;
+
+    int setPointPulses = m_armClawConfig.separationTable.micrometresToPulses((int32_t)(separationDistanceMm * 1000.0f));
+    m_positionPIDController.setSetPoint(encoderPulsesToPIDInput(setPointPulses));
 
     return MBED_SUCCESS;
 }
@@ -86,7 +89,11 @@ ArmClawController::t_clawControlMode ArmClawController::getControlMode() {
 }
 
 float ArmClawController::encoderPulsesToMm(int encoderPulses) {
-    return k_PulsesToCmA + k_PulsesToCmB * encoderPulses + k_PulsesToCmC * pow(encoderPulses, 2) + k_PulsesToCmD * pow(encoderPulses, 3);
+    return m_armClawConfig.separationTable.pulsesToMicrometres(encoderPulses) * 0.001f;
+}
+
+float ArmClawController::encoderPulsesToPIDInput(int encoderPulses) {
+    return m_armClawConfig.pulsesToPIDInput * encoderPulses;
 }
 
 float ArmClawController::getSeparationDistanceMm() {
@@ -97,9 +104,26 @@ float ArmClawController::getSeparationDistanceCm() {
     return getSeparationDistanceMm();
 }
 
+float ArmClawController::getVelocityEncoderPulsesPerSec() {
+    return m_velocityEstimator.getPulsesPerSecond();
+}
+
+PID &ArmClawController::getPositionPIDController() {
+    return m_positionPIDController;
+}
+
+LoopCapture &ArmClawController::getCapture() {
+    return m_capture;
+}
+
+Motor &ArmClawController::getMotor() {
+    return m_motor;
+}
+
 void ArmClawController::update() {
-    float interval = timer.read();
-    timer.reset();
+    uint32_t intervalUs = MicrosecondClock::lap(m_lastUpdateUs);
+
+    m_velocityEstimator.update();
 
     switch (m_controlMode) {
         case motorDutyCycle:
@@ -107,20 +131,32 @@ void ArmClawController::update() {
                 setMotorDutyCycle(0.0f);
             }
 
+            m_capture.recordOpenLoop(getSeparationDistanceMm(), m_motor.getDutyCycle(), intervalUs);
+
             break;
 
-        case positionPID:
-            m_positionPIDController.setInterval(interval);
-            m_positionPIDController.setProcessValue(getSeparationDistanceMm());
+        case positionPID: {
+            int encoderPulses = m_encoder.getPulses();
+
+            m_positionPIDController.setIntervalUs(intervalUs);
+            m_positionPIDController.setProcessValue(encoderPulsesToPIDInput(encoderPulses));
             m_motor.setDutyCycle(m_positionPIDController.compute());
 
+            m_capture.record(m_setPointMm, encoderPulsesToMm(encoderPulses), m_motor.getDutyCycle(), intervalUs);
+
             break;
+        }
     }
 }
 
 void ArmClawController::initializePIDController() {
-    // Configure position PID
-    m_positionPIDController.setInputLimits(m_armClawConfig.minInputSeparationDistanceCm, m_armClawConfig.maxInputSeparationDistanceCm);
+    // Configure position PID on the pulse counts of the separation limits
+    const ClawSeparationTable &separationTable = m_armClawConfig.separationTable;
+
+    float minInput = encoderPulsesToPIDInput(separationTable.micrometresToPulses((int32_t)(m_armClawConfig.minInputSeparationDistanceMm * 1000.0f)));
+    float maxInput = encoderPulsesToPIDInput(separationTable.micrometresToPulses((int32_t)(m_armClawConfig.maxInputSeparationDistanceMm * 1000.0f)));
+
+    m_positionPIDController.setInputLimits(minInput, maxInput);
     m_positionPIDController.setOutputLimits(m_armClawConfig.minOutputMotorDutyCycle, m_armClawConfig.maxOutputMotorDutyCycle);
     m_positionPIDController.setBias(m_armClawConfig.positionPID.bias);
     m_positionPIDController.setMode(PID_AUTO_MODE);
@@ -133,10 +169,11 @@ mbed_error_status_t ArmClawController::runEndpointCalibration() {
     MBED_WARN_AND_RETURN_STATUS_ON_ERROR(setControlMode(motorDutyCycle));
     MBED_WARN_AND_RETURN_STATUS_ON_ERROR(setMotorDutyCycle(m_armClawConfig.calibrationDutyCycle));
 
-    timer.reset();
+    uint32_t calibrationTimeoutUs = (uint32_t)(m_armClawConfig.calibrationTimeoutSeconds * 1000000.0f);
+    uint32_t calibrationStartUs = MicrosecondClock::read();
 
     while (m_limitSwitch.read() == 0) {
-        if (timer.read() > m_armClawConfig.calibrationTimeoutSeconds) {
+        if (MicrosecondClock::elapsedSince(calibrationStartUs) > calibrationTimeoutUs) {
             return MBED_ERROR_TIME_OUT;
         }
     }
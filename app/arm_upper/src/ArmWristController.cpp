@@ -1,6 +1,6 @@
 #include "ArmWristController.h"
 
-ArmWristController::ArmWristController(t_armWristConfig armWristConfig, ArmJointController::t_jointControlMode controlMode) :
+ArmWristController::ArmWristController(const t_armWristConfig &armWristConfig, ArmJointController::t_jointControlMode controlMode) :
         m_controlMode(controlMode), m_leftJointController(armWristConfig.leftJointConfig, controlMode),
         m_rightJointController(armWristConfig.rightJointConfig, controlMode) {
 
@@ -77,6 +77,14 @@ float ArmWristController::getPitchAngleDegrees() {
     return (m_leftJointController.getAngleDegrees() + m_rightJointController.getAngleDegrees()) / 2.0f;
 }
 
+ArmJointController &ArmWristController::getLeftJointController() {
+    return m_leftJointController;
+}
+
+ArmJointController &ArmWristController::getRightJointController() {
+    return m_rightJointController;
+}
+
 void ArmWristController::update() {
     m_leftJointController.update();
     m_rightJointController.update();
@@ -0,0 +1,41 @@
+/* Conversion between claw encoder pulses and claw separation.
+ */
+
+#include "ClawSeparationTable.h"
+
+int32_t ClawSeparationTable::micrometresToPulses(int32_t micrometres) const {
+    // Search on a rising copy of the table
+    int32_t sign = isDescending() ? -1 : 1;
+    int32_t target = sign * micrometres;
+
+    if (target <= sign * m_micrometres[0]) {
+        return 0;
+    }
+
+    if (target >= sign * m_endMicrometres) {
+        return m_maxPulses;
+    }
+
+    uint8_t low = 0, high = CLAW_SEPARATION_TABLE_SEGMENTS;
+
+    while (high - low > 1) {
+        uint8_t middle = (low + high) / 2;
+
+        if (sign * m_micrometres[middle] <= target) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    int32_t delta = sign * (m_micrometres[high] - m_micrometres[low]);
+    int32_t offset = target - sign * m_micrometres[low];
+    int32_t pulses = (int32_t)low << m_stepShift;
+
+    if (delta > 0) {
+        pulses += (int32_t)((((int64_t)offset << m_stepShift) + delta / 2) / delta);
+    }
+
+    return pulses;
+}
@@ -7,8 +7,16 @@
 #include "ArmJointController.h"
 #include "ArmWristController.h"
 #include "ArmClawController.h"
-
-const ArmWristController::t_armWristConfig wristConfig = {
+#include "FirmwareUpdateService.h"
+#include "PIDTuningService.h"
+#include "LoopCaptureService.h"
+#include "TimeSyncService.h"
+#include "BoardStatusService.h"
+#include "CrashLogService.h"
+#include "CommandWatchdog.h"
+#include "IndependentWatchdog.h"
+
+constexpr ArmWristController::t_armWristConfig wristConfig = {
         .leftJointConfig = {
                 .motor = {
                         .pwmPin = MOTOR1,
@@ -96,7 +104,7 @@ const ArmWristController::t_armWristConfig wristConfig = {
         .leftToRightMotorBias = 0.0f
 };
 
-const ArmClawController::t_clawConfig clawConfig = {
+constexpr ArmClawController::t_clawConfig clawConfig = {
         .motor = {
                 .pwmPin   = MOTOR3,
                 .dirPin   = MOTOR3_DIR,
@@ -115,6 +123,13 @@ const ArmClawController::t_clawConfig clawConfig = {
                 .inverted = false
         },
 
+        .separation = {
+                .a = 121.0f,
+                .b = -9.35E-05f,
+                .c = -1.11E-07f,
+                .d = 1.08E-12f
+        },
+
         .limitSwitchPin = LIM_3B,
 
         .calibrationDutyCycle = 0.2f,
@@ -129,19 +144,31 @@ const ArmClawController::t_clawConfig clawConfig = {
                 .interval = 0.05f
         },
 
-        .minInputSeparationDistanceCm = 0.0f,
-        .maxInputSeparationDistanceCm = 120.0f,
+        .minInputSeparationDistanceMm = 0.0f,
+        .maxInputSeparationDistanceMm = 120.0f,
 
         .minOutputMotorDutyCycle = -1.0f,
         .maxOutputMotorDutyCycle = 1.0f
 
 };
 
+static_assert(ArmJointController::isValidConfig(wristConfig.leftJointConfig), "Left wrist config out of range");
+static_assert(ArmJointController::isValidConfig(wristConfig.rightJointConfig), "Right wrist config out of range");
+static_assert(ArmClawController::isValidConfig(clawConfig), "Claw config out of range, or its separation fit turns back");
+
 
 Serial             pc(SERIAL_TX, SERIAL_RX, ROVER_DEFAULT_BAUD_RATE);
 CAN                can(CAN_RX, CAN_TX, ROVER_CANBUS_FREQUENCY);
 CANMsg             rxMsg;
 
+FirmwareUpdateService firmwareUpdateService(can, ROVER_ARM_UPPER_CANID);
+PIDTuningService      pidTuningService(can, ROVER_ARM_UPPER_CANID);
+LoopCaptureService    loopCaptureService(can, ROVER_ARM_UPPER_CANID);
+TimeSyncService       timeSyncService(can, ROVER_ARM_UPPER_CANID);
+BoardStatusService    boardStatusService(can, ROVER_ARM_UPPER_CANID);
+CrashLogService       crashLogService(can, ROVER_ARM_UPPER_CANID);
+CommandWatchdog       commandWatchdog(can, ROVER_ARM_UPPER_CANID);
+
 DigitalOut         ledErr(LED1);
 DigitalOut         ledCAN(LED4);
 
@@ -174,6 +201,27 @@ enum armCommand {
 
 };
 
+// PID tuning targets, keep the numbering stable so saved tunings stay with their loop
+enum t_pidTuningTarget {
+    wristLeftVelocityPID,
+    wristLeftPositionPID,
+    wristRightVelocityPID,
+    wristRightPositionPID,
+    clawPositionPID
+};
+
+enum t_captureTarget {
+    wristLeftCapture,
+    wristRightCapture,
+    clawCapture
+};
+
+// Pitch and roll both drive the two wrist motors, so the wrist is a single axis
+enum t_watchdogAxis {
+    wristAxis,
+    clawAxis
+};
+
 enum jetsonFeedback {
     wristPitchDegrees = ROVER_JETSON_START_CANID_MSG_ARM_UPPER,
     wristRollDegrees,
@@ -182,6 +230,34 @@ enum jetsonFeedback {
 
 void initCAN() {
     can.filter(ROVER_ARM_UPPER_CANID, ROVER_CANID_FILTER_MASK, CANStandard);
+
+    // The SYNC broadcast is outside the board's ID range, it gets the second filter bank
+    can.filter(ROVER_CANID_SYNC, 0x7FF, CANStandard, 1);
+}
+
+void initPIDTuning() {
+    ArmJointController &leftJoint  = wristController.getLeftJointController();
+    ArmJointController &rightJoint = wristController.getRightJointController();
+
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(wristLeftVelocityPID, leftJoint.getVelocityPIDController()));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(wristLeftPositionPID, leftJoint.getPositionPIDController()));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(wristRightVelocityPID, rightJoint.getVelocityPIDController()));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(wristRightPositionPID, rightJoint.getPositionPIDController()));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(clawPositionPID, clawController.getPositionPIDController()));
+
+    pidTuningService.loadStoredTunings();
+}
+
+void initLoopCapture() {
+    MBED_WARN_ON_ERROR(loopCaptureService.registerCapture(wristLeftCapture, wristController.getLeftJointController().getCapture()));
+    MBED_WARN_ON_ERROR(loopCaptureService.registerCapture(wristRightCapture, wristController.getRightJointController().getCapture()));
+    MBED_WARN_ON_ERROR(loopCaptureService.registerCapture(clawCapture, clawController.getCapture()));
+}
+
+void initCommandWatchdog() {
+    MBED_WARN_ON_ERROR(commandWatchdog.registerMotor(wristAxis, wristController.getLeftJointController().getMotor()));
+    MBED_WARN_ON_ERROR(commandWatchdog.registerMotor(wristAxis, wristController.getRightJointController().getMotor()));
+    MBED_WARN_ON_ERROR(commandWatchdog.registerMotor(clawAxis, clawController.getMotor()));
 }
 
 ArmJointController::t_jointControlMode handleSetWristControlMode(CANMsg *p_newMsg) {
@@ -309,6 +385,43 @@ void processCANMsg(CANMsg *p_newMsg) {
     }
 }
 
+void feedCommandWatchdog(CANMsg *p_newMsg) {
+    switch (p_newMsg->id) {
+
+        case setWristControlMode:
+        case setWristPitchMotion:
+        case setWristRollMotion:
+            commandWatchdog.commandReceived(wristAxis);
+            break;
+
+        case setClawControlMode:
+        case setClawMotion:
+            commandWatchdog.commandReceived(clawAxis);
+            break;
+    }
+}
+
+// Stopped axes hold still, rather than carry on with their stale command once they are commanded again
+void holdStoppedAxes(uint8_t stoppedMask) {
+    if (stoppedMask & (1 << wristAxis)) {
+        MBED_WARN_ON_ERROR(wristController.setControlMode(wristController.getControlMode()));
+    }
+
+    if (stoppedMask & (1 << clawAxis)) {
+        if (clawController.getControlMode() == ArmClawController::positionPID) {
+            MBED_WARN_ON_ERROR(clawController.setSeparationDistanceCm(clawController.getSeparationDistanceCm()));
+        }
+        else {
+            MBED_WARN_ON_ERROR(clawController.setMotorDutyCycle(0.0f));
+        }
+    }
+}
+
+void stopMotors() {
+    MBED_WARN_ON_ERROR(wristController.setControlMode(ArmJointController::motorDutyCycle));
+    MBED_WARN_ON_ERROR(clawController.setControlMode(ArmClawController::motorDutyCycle));
+}
+
 void sendJetsonInfo() {
 
     CANMsg txMsg(0);
@@ -316,16 +429,19 @@ void sendJetsonInfo() {
     txMsg.clear();
     txMsg.id = wristPitchDegrees;
     txMsg << wristController.getPitchAngleDegrees();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg));
 
     txMsg.clear();
     txMsg.id = wristRollDegrees;
     txMsg << wristController.getRollAngleDegrees();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg));
 
     txMsg.clear();
     txMsg.id = clawSeparationDistanceCm;
     txMsg << clawController.getSeparationDistanceCm();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg));
 
 }
@@ -335,6 +451,9 @@ int main(void)
     PRINT_INFO("Upper arm program Started\r\n\r\n");
 
     initCAN();
+    initPIDTuning();
+    initLoopCapture();
+    initCommandWatchdog();
     canSendTimer.start();
 
     wristController.setControlMode(ArmJointController::motorDutyCycle);
@@ -342,22 +461,55 @@ int main(void)
 
 //    MBED_WARN_ON_ERROR(clawController.runEndpointCalibration());
 
+    commandWatchdog.start();
+    IndependentWatchdog::start(ROVER_IWDG_TIMEOUT_MS);
+
     while (1) {
 
+        IndependentWatchdog::kick();
+
         if (can.read(rxMsg)) {
-            processCANMsg(&rxMsg);
+            uint32_t rxTimeUs = timeSyncService.getTimeUs();
+            bool wasUpdating = firmwareUpdateService.isUpdateInProgress();
+
+            if (firmwareUpdateService.handleCANMsg(rxMsg)) {
+                if (!wasUpdating && firmwareUpdateService.isUpdateInProgress()) {
+                    stopMotors();
+                }
+            }
+            else if (!timeSyncService.handleCANMsg(rxMsg, rxTimeUs) && !pidTuningService.handleCANMsg(rxMsg) &&
+                     !loopCaptureService.handleCANMsg(rxMsg) && !crashLogService.handleCANMsg(rxMsg)) {
+                timeSyncService.commandReceived(rxMsg, rxTimeUs);
+                feedCommandWatchdog(&rxMsg);
+                processCANMsg(&rxMsg);
+            }
+
             rxMsg.clear();
             ledCAN = !ledCAN;
         }
 
+        firmwareUpdateService.rebootIfRequested();
+
+        // Flash writes stall the control loop, so the motors stay stopped until the update is done
+        if (firmwareUpdateService.isUpdateInProgress()) {
+            continue;
+        }
+
         if (canSendTimer.read() > 0.1) {
             sendJetsonInfo();
             canSendTimer.reset();
         }
 
+        loopCaptureService.poll();
+        boardStatusService.poll();
+        crashLogService.poll();
+        holdStoppedAxes(commandWatchdog.poll());
+
         wristController.update();
         clawController.update();
 
+        timeSyncService.sendCommandAcks();
+
     }
 }
 
@@ -0,0 +1,131 @@
+/* Resident CAN bootloader
+ *
+ * Build with: make APP=bootloader BOARD=<board>, then flash once with an ST-Link.
+ * Apps are built with BOOTLOADER=1 and can from then on be updated over CAN
+ * (see tools/can_uploader).
+ *
+ * On reset the bootloader finishes any install left pending by an update,
+ * checks the active image against the boot record and starts it. If there is
+ * no valid image, or the host talks to the bootloader within the first
+ * ROVER_BOOTLOADER_WINDOW_MS after reset, it stays and serves updates itself.
+ *
+ * An IWDG started by the app keeps running through the reset that ends an
+ * update, so the bootloader kicks it for as long as it runs.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "BootRecord.h"
+#include "FirmwareInstaller.h"
+#include "FirmwareUpdateService.h"
+#include "FlashIAPStorage.h"
+#include "IndependentWatchdog.h"
+
+// CAN ID to serve updates on until an update has recorded the board's ID
+#ifndef ROVER_BOOTLOADER_CANID
+#if defined(ROVERBOARD_SAFETY_PINMAP)
+#define ROVER_BOOTLOADER_CANID ROVER_SAFETY_CANID
+#elif defined(ROVERBOARD_SCIENCE_PINMAP)
+#define ROVER_BOOTLOADER_CANID ROVER_SCIENCE_CANID
+#else
+#define ROVER_BOOTLOADER_CANID ROVER_ARM_LOWER_CANID // Build with BOOTLOADER_CANID=0x400 for the upper arm board
+#endif
+#endif
+
+#define ROVER_BOOTLOADER_WINDOW_MS 200
+
+#define RAM_START           0x20000000
+#define RAM_SIZE            0x8000
+#define VECTOR_TABLE_SIZE   (NVIC_NUM_VECTORS * sizeof(uint32_t))
+
+CAN                 can(CAN_RX, CAN_TX, ROVER_CANBUS_FREQUENCY);
+CANMessage          rxMsg;
+
+DigitalOut          ledErr(LED1);
+DigitalOut          ledCAN(LED4);
+
+FlashIAPStorage     storage;
+BootRecord          bootRecord(storage);
+FirmwareInstaller   installer(storage, bootRecord);
+
+Timer               windowTimer;
+
+// An image flashed directly with an ST-Link has no boot record, only check it looks startable
+bool isVectorTablePlausible(void) {
+    const uint32_t *p_vectors = reinterpret_cast<const uint32_t *>(ROVER_FLASH_APP_START);
+
+    return p_vectors[0] > RAM_START && p_vectors[0] <= RAM_START + RAM_SIZE &&
+           p_vectors[1] > ROVER_FLASH_APP_START && p_vectors[1] < ROVER_FLASH_APP_START + ROVER_FLASH_APP_SIZE;
+}
+
+void startApplication(void) {
+    const uint32_t *p_vectors = reinterpret_cast<const uint32_t *>(ROVER_FLASH_APP_START);
+
+    __disable_irq();
+
+    // Hand the app the reset state it expects
+    HAL_RCC_DeInit();
+    HAL_DeInit();
+
+    SysTick->CTRL = 0;
+    NVIC->ICER[0] = 0xFFFFFFFF;
+    NVIC->ICPR[0] = 0xFFFFFFFF;
+    SCB->ICSR     = SCB_ICSR_PENDSTCLR_Msk;
+
+    // The Cortex-M0 has no VTOR, so the app vectors are served from SRAM mapped at 0x00000000
+    memcpy(reinterpret_cast<void *>(RAM_START), p_vectors, VECTOR_TABLE_SIZE);
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    SYSCFG->CFGR1 |= SYSCFG_CFGR1_MEM_MODE;
+
+    void (*p_resetHandler)(void) = reinterpret_cast<void (*)(void)>(p_vectors[1]);
+
+    __set_MSP(p_vectors[0]);
+    __enable_irq();
+
+    p_resetHandler();
+}
+
+int main(void)
+{
+    BootRecord::t_record record;
+
+    IndependentWatchdog::kick();
+
+    bool imageValid = installer.prepareBoot(record);
+
+    if (!imageValid && record.state == BootRecord::noImage) {
+        imageValid = isVectorTablePlausible();
+    }
+
+    uint32_t boardCanId = ROVER_BOOTLOADER_CANID;
+
+    if (record.state != BootRecord::noImage &&
+        record.boardCanId >= ROVER_SAFETY_CANID && record.boardCanId <= ROVER_ARM_UPPER_CANID) {
+        boardCanId = record.boardCanId;
+    }
+
+    static FirmwareUpdateService firmwareUpdateService(can, boardCanId);
+
+    can.filter(boardCanId, ROVER_CANID_FILTER_MASK, CANStandard);
+
+    bool hostConnected = false;
+    windowTimer.start();
+
+    while (1) {
+
+        IndependentWatchdog::kick();
+
+        if (can.read(rxMsg) && firmwareUpdateService.handleCANMsg(rxMsg)) {
+            hostConnected = true;
+            ledCAN = !ledCAN;
+        }
+
+        firmwareUpdateService.rebootIfRequested();
+
+        if (imageValid && !hostConnected && windowTimer.read_ms() > ROVER_BOOTLOADER_WINDOW_MS) {
+            startApplication();
+        }
+
+        ledErr = !imageValid;
+    }
+}
@@ -1,20 +1,34 @@
 #include "mbed.h"
 #include "rover_config.h"
 #include "CANMsg.h"
+#include "FirmwareUpdateService.h"
+#include "CurrentSampler.h"
+#include "PowerMonitor.h"
+#include "BoardStatusService.h"
+#include "CrashLogService.h"
 
 const unsigned int  RX_ID = ROVER_SAFETY_CANID; 
-const unsigned int  TX_ID = ROVER_JETSON_CANID + 30; 
+const unsigned int  CURRENT_TX_ID = ROVER_JETSON_START_CANID_MSG_SAFETY;     // One per sensor, see PowerMonitor.h
+const unsigned int  ENERGY_TX_ID = ROVER_JETSON_START_CANID_MSG_SAFETY + 3;
 const unsigned int  CAN_MASK = ROVER_CANID_FILTER_MASK;
 
 I2C 				i2c(I2C_SDA, I2C_SCL);
 Serial              pc(SERIAL_TX, SERIAL_RX, ROVER_DEFAULT_BAUD_RATE);
 CAN                 can(CAN_RX, CAN_TX, ROVER_CANBUS_FREQUENCY);
 CANMsg              txMsg;
+CANMsg              rxMsg;
 
 DigitalOut          ledErr(LED1);
 DigitalOut			ledI2C(LED3);
 DigitalOut          ledCAN(LED4);
 
+FirmwareUpdateService firmwareUpdateService(can, RX_ID);
+BoardStatusService  boardStatusService(can, RX_ID);
+CrashLogService     crashLogService(can, RX_ID);
+CurrentSampler      currentSampler(i2c);
+PowerMonitor        powerMonitor(can, currentSampler, ROVER_CANID_SAFETY_FAULT, CURRENT_TX_ID, ENERGY_TX_ID);
+Timer               printTimer;
+
 //Sensor Address Indices
 enum {
 	sensor_100A1 = 0, 
@@ -24,11 +38,8 @@ enum {
 
 const int ADC_address[3] = {0x54 << 1, 0x50 << 1, 0x61 << 1};
  
-#define TOTAL_SAMPLE 10
-char adc_sample[2]; 
-float raw_adc_sum = 0.0;
-float raw_adc[3];
-float current[3];
+#define SAMPLE_PERIOD_US	10000	// Currents are sent at 100 Hz
+#define PRINT_PERIOD_MS		1000
 
 // Specfic variables for 100A sensor
 const float lowerV_100A = 0.314; //lowerV and upperV is the voltage after signal has been amplified
@@ -46,6 +57,18 @@ const float bitsPerVolt_30A = 255/5;
 const int bitRange_30A = round((upperV_30A - lowerV_30A) * bitsPerVolt_30A);
 const float iConversion_30A = bitRange_30A/ampRange_30A;
 
+// Trip at 90 % of the sensor's range, past its full scale a sensor saturates and can't see the current rise
+const float tripAmps_100A = 0.9f * ampRange_100A;
+const float tripAmps_30A = 0.9f * ampRange_30A;
+
+// I2t is off (limit 0) until the continuous ratings of the rails' wiring and fuses are known
+const float ratedAmps_100A = 0;
+const unsigned int i2tLimit_100A = 0;
+const float ratedAmps_30A = 0;
+const unsigned int i2tLimit_30A = 0;
+
+const unsigned int batteryMillivolts = 24000; // Nominal, the board does not measure the voltage
+
 void initCAN() {
     can.filter(RX_ID, ROVER_CANID_FILTER_MASK, CANStandard);
 
@@ -54,52 +77,68 @@ void initCAN() {
     // }
 }
 
+void initPowerMonitor() {
+	RailMonitor::t_config config;
+	config.nominalMillivolts = batteryMillivolts;
+
+	config.microampsPerCode = 1e6 / iConversion_100A;
+	config.tripMilliamps = tripAmps_100A * 1000;
+	config.ratedMilliamps = ratedAmps_100A * 1000;
+	config.i2tLimit = i2tLimit_100A;
+	config.zeroCode = 246;
+
+	config.offsetMilliamps = -16500;
+	MBED_WARN_ON_ERROR(powerMonitor.addRail(sensor_100A1, config));
+	config.offsetMilliamps = -1000;
+	MBED_WARN_ON_ERROR(powerMonitor.addRail(sensor_100A2, config));
+
+	config.microampsPerCode = 1e6 / iConversion_30A;
+	config.tripMilliamps = tripAmps_30A * 1000;
+	config.ratedMilliamps = ratedAmps_30A * 1000;
+	config.i2tLimit = i2tLimit_30A;
+	config.zeroCode = bitRange_30A;
+	config.offsetMilliamps = 0;
+	MBED_WARN_ON_ERROR(powerMonitor.addRail(sensor_30A, config));
+}
+
 int main() {
 	pc.printf("Program Started\r\n\r\n");
 	
-	i2c.frequency(100000);
     initCAN();
 	ledI2C = 1;
-	ledCAN = 1;
+
+	for (int i = 0; i < 3; i++) {
+		MBED_WARN_ON_ERROR(currentSampler.addSensor(i, ADC_address[i]));
+	}
+	initPowerMonitor();
+	currentSampler.start(SAMPLE_PERIOD_US);
+	printTimer.start();
 
     while(1) {
-		raw_adc_sum = 0.0;
-		
-		// Take multiple samples of each sensor
-		for(int i = 0; i < 3; i++) {			
-			for (int j = 0; j < TOTAL_SAMPLE; j++) { 
-				i2c.read(ADC_address[i], adc_sample, 2, false);
-				raw_adc_sum = raw_adc_sum + ((adc_sample[0] << 4) + (adc_sample[1] >> 4));
-				ledI2C = !ledI2C;
-			}
-			raw_adc[i] = raw_adc_sum / TOTAL_SAMPLE;
-			if (i == sensor_100A1) {
-				//current[i] = ((bitRange_100A - raw_adc[i])/iConversion_100A);
-				current[i] = ((246 - raw_adc[i])/iConversion_100A) - 16.5;
-			}
-			else if(i == sensor_100A2) {
-				current[i] = ((246 - raw_adc[i])/iConversion_100A) - 1;
-			}
-			else {
-				current[i] = ((bitRange_30A - raw_adc[i])/iConversion_30A);
-			}
-			pc.printf("Address: %d\tCurrent Sensor %d: %f\r\n", ADC_address[i] >> 1, i, current[i]);
-			
-			// Send current data over CAN
-			uint8_t data = round(current[i] * 100); // Convert current data to int 
-			CANMsg txMsg(TX_ID + i);
-			txMsg << data;
-			ledCAN = !ledCAN;
-
-			if(can.write(txMsg)) {
-				pc.printf("Sucessful CAN transmission\r\n");
-			}
-			else {
-				pc.printf("Error in CAN transmission\r\n");
-				ledErr = 1;
+		// Faults are sent right after the sample that raised them
+		powerMonitor.poll();
+
+		if (printTimer.read_ms() >= PRINT_PERIOD_MS) {
+			printTimer.reset();
+			ledI2C = !ledI2C;
+
+			for(int i = 0; i < 3; i++) {
+				pc.printf("Address: %d\tCurrent Sensor %d: %d mA\t(%d samples, %d errors)\r\n", ADC_address[i] >> 1, i,
+				          powerMonitor.getMilliamps(i), currentSampler.getSampleCount(i), currentSampler.getErrorCount(i));
 			}
 		}
-		
-		wait(1);
+
+		// Serve firmware updates and crash log reads between samples
+		if (can.read(rxMsg) && !firmwareUpdateService.handleCANMsg(rxMsg)) {
+			crashLogService.handleCANMsg(rxMsg);
+		}
+		firmwareUpdateService.rebootIfRequested();
+		boardStatusService.poll();
+		crashLogService.poll();
+
+		// Woken by the next sensor read, CAN frames are picked up at the latest one read later
+		if (!firmwareUpdateService.isUpdateInProgress()) {
+			sleep();
+		}
     }
 }
@@ -19,15 +19,17 @@ class AugerController {
 
         } t_augerConfig;
         
-        AugerController( t_augerConfig controllerConfig );
+        AugerController( const t_augerConfig &controllerConfig );
                          
         mbed_error_status_t setMotorDutyCycle(float percent);
 
         float getDutyCycle(void);
 
+        Motor& getMotor(void);
+
     private:
 
-        t_augerConfig m_augerConfig;
+        const t_augerConfig &m_augerConfig;
         Motor m_motor;
 };
 
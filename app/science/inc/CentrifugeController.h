@@ -1,14 +1,23 @@
 #ifndef CENTRIFUGE_CONTROLLER_H
 #define CENTRIFUGE_CONTROLLER_H
 /* Controller for the Centrifuge/Turntable
+ *
+ * The config is referenced rather than copied, so it must outlive the
+ * controller; declare it constexpr to keep it in flash and have the compiler
+ * work out its derived fields.
  */
 
 #include "mbed.h"
 #include "Motor.h"
 #include "QEI.h"
+#include "QEIVelocityEstimator.h"
 #include "PID.h"
+#include "LoopCapture.h"
+#include "MicrosecondClock.h"
 #include "PinNames.h"
 
+#define CENTRIFUGE_TUBE_COUNT 12
+
 class CentrifugeController {
 
     public:
@@ -23,7 +32,7 @@ class CentrifugeController {
 
             // Limit switch
             PinName limitSwitchPin;
-            float   limitSwitchOffset;
+            int     limitSwitchOffset;      // Pulses from the limit switch to tube 0
             float   calibrationDutyCycle;
             float   calibrationTimeoutSeconds;
             float   spinningDutyCycle;
@@ -35,6 +44,9 @@ class CentrifugeController {
             float           PIDOutputMotorMinDutyCycle;
             float           PIDOutputMotorMaxDutyCycle;
 
+            // Derived, leave out of the initialiser
+            int             encoderDirection = encoder.inverted ? -1 : 1;
+
         } t_centrifugeConfig;
 
         // Methods of control
@@ -43,13 +55,23 @@ class CentrifugeController {
             positionPID
         } t_centrifugeControlMode;
 
-        explicit CentrifugeController( t_centrifugeConfig centrifugeConfig,
+        explicit CentrifugeController( const t_centrifugeConfig &centrifugeConfig,
                                        t_centrifugeControlMode controlMode = motorDutyCycle );
 
+        // False if the tubes do not fit the revolution, or a duty cycle is beyond the motor limit
+        static constexpr bool isValidConfig( const t_centrifugeConfig &config ) {
+            return config.maxEncoderPulsePerRev >= CENTRIFUGE_TUBE_COUNT && config.maxEncoderPulsePerRev < ( 1 << 24 ) &&
+                   config.limitSwitchOffset >= 0 && config.limitSwitchOffset < (int)config.maxEncoderPulsePerRev &&
+                   config.spinningDutyCycle <= config.motor.limit && config.calibrationDutyCycle <= config.motor.limit &&
+                   config.PIDOutputMotorMinDutyCycle < config.PIDOutputMotorMaxDutyCycle &&
+                   config.PIDOutputMotorMinDutyCycle >= -config.motor.limit && config.PIDOutputMotorMaxDutyCycle <= config.motor.limit &&
+                   config.positionPID.interval > 0.0f;
+        }
+
         mbed_error_status_t setControlMode( t_centrifugeControlMode control );
         mbed_error_status_t setMotorDutyCycle(float dutyCycle);
         mbed_error_status_t setSpinning(bool spin);
-        mbed_error_status_t setTubePosition( unsigned int tube_num ); // Range of [0-11]
+        mbed_error_status_t setTubePosition( unsigned int tube_num ); // Range of [0-11], reached the short way round
 
         mbed_error_status_t runEndpointCalibration();
 
@@ -58,27 +80,38 @@ class CentrifugeController {
         bool isSpinning();
 
         unsigned int    getTestTubeIndex(); // Return the test tube # that is currently under the auger
-        float           getEncoderPulses(); // Return the # of encoder pulses within a single revolution
+        int             getEncoderPulses(); // Return the # of encoder pulses within a single revolution
+        float           getVelocityEncoderPulsesPerSec(); // Return the rotor speed, updated by update()
         float           getDutyCycle();
+        PID&            getPositionPIDController();
+        LoopCapture&    getCapture();
+        Motor&          getMotor();
         void            update();
 
     private:
 
         void initializePID( void );
 
+        int wrapPulses( int pulses );       // Position within [0, maxEncoderPulsePerRev)
+        int getTubePulses( unsigned int tube_num );
+
         t_centrifugeControlMode m_centrifugeControlMode;
-        t_centrifugeConfig      m_centrifugeConfig;
+        const t_centrifugeConfig &m_centrifugeConfig;
 
         Motor       m_motor;
         QEI         m_encoder;
+        QEIVelocityEstimator m_velocityEstimator;
         DigitalIn   m_limitSwitch;
 
         PID m_positionPIDController;
 
-        int m_encoderInversionMultiplier;
+        LoopCapture m_capture;
+
         bool m_isSpinning;
 
-        Timer timer;
+        int m_targetPulses;
+
+        uint32_t m_lastUpdateUs;
 
 };
 
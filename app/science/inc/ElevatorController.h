@@ -1,11 +1,16 @@
 #ifndef ELEVATOR_CONTROLLER_H
 #define ELEVATOR_CONTROLLER_H
 // Controller for the Elevator moving the Auger
+// The config is referenced rather than copied, so it must outlive the controller; declare it constexpr
+// to keep it in flash and have the compiler work out its derived fields
 
 #include "mbed.h"
 #include "Motor.h"
 #include "QEI.h"
+#include "QEIVelocityEstimator.h"
 #include "PID.h"
+#include "LoopCapture.h"
+#include "MicrosecondClock.h"
 #include "PinNames.h"
 
 class ElevatorController{
@@ -30,12 +35,16 @@ class ElevatorController{
             PID::t_pidConfig positionPID;
 
             // PID Configuration
-            unsigned int    maxEncoderPulses; // Should be an int
-            unsigned int    maxDistanceCm; // Should be an int
+            float           maxDistanceCm;
             float           centimetresPerPulse; // Unit is cm/pulse
             float           PIDOutputMotorMinDutyCycle;
             float           PIDOutputMotorMaxDutyCycle;
 
+            // Derived, leave out of the initialiser
+            int32_t         maxEncoderPulses    = (int32_t)( maxDistanceCm / centimetresPerPulse + 0.5f );
+            float           pulsesPerCentimetre = 1.0f / centimetresPerPulse;
+            int             encoderDirection    = encoder.inverted ? -1 : 1;
+
         } t_elevatorConfig;
 
         // Methods of control
@@ -45,9 +54,18 @@ class ElevatorController{
 
         } t_elevatorControlMode;
 
-        ElevatorController( t_elevatorConfig        controllerConfig,
+        ElevatorController( const t_elevatorConfig  &controllerConfig,
                             t_elevatorControlMode   controlMode = motorDutyCycle );
 
+        // False if a limit is out of range or the travel does not fit the PID and capture scaling
+        static constexpr bool isValidConfig( const t_elevatorConfig &config ) {
+            return config.maxDistanceCm > 0.0f && config.centimetresPerPulse > 0.0f &&
+                   config.maxEncoderPulses > 0 && config.maxEncoderPulses < ( 1 << 24 ) && // Exact as a float
+                   config.PIDOutputMotorMinDutyCycle < config.PIDOutputMotorMaxDutyCycle &&
+                   config.PIDOutputMotorMinDutyCycle >= -1.0f && config.PIDOutputMotorMaxDutyCycle <= 1.0f &&
+                   config.calibrationDutyCycle != 0.0f && config.positionPID.interval > 0.0f;
+        }
+
         mbed_error_status_t setControlMode( t_elevatorControlMode controlMode );
         mbed_error_status_t setMotorDutyCycle(float dutyCycle);
         mbed_error_status_t setPositionInCm(float centimeters);
@@ -57,7 +75,11 @@ class ElevatorController{
         t_elevatorControlMode getControlMode() const;
 
         int  getPositionEncoderPulses(); // Return encoder value
+        float getVelocityEncoderPulsesPerSec(); // Return encoder speed, updated by update()
         int  getPositionCm(); // Return encoder transformed value into cm
+        PID& getPositionPIDController();
+        LoopCapture& getCapture();
+        Motor& getMotor();
         void update();
 
     private:
@@ -65,17 +87,18 @@ class ElevatorController{
         void initializePID( void );
         
         t_elevatorControlMode   m_elevatorControlMode;
-        t_elevatorConfig        m_elevatorConfig;
+        const t_elevatorConfig  &m_elevatorConfig;
         DigitalIn               m_limitSwitchTop;
         DigitalIn               m_limitSwitchBottom;
     
         Motor   m_motor;
         QEI     m_encoder;
+        QEIVelocityEstimator m_velocityEstimator;
         PID     m_positionPIDController;
 
-        int   m_encoderInversionMultiplier;
+        LoopCapture m_capture;
 
-        Timer   timer;
+        uint32_t m_lastUpdateUs;
 };
 
 #endif // ELEVATOR_CONTROLLER_H
\ No newline at end of file
@@ -1,28 +1,31 @@
 #ifndef MOISTURE_SENSOR_H
 #define MOISTURE_SENSOR_H
-// Controller for the Auger
+// Soil moisture probe, sampled in the background by the board's AdcScanner
 
 #include "mbed.h"
 #include "PinNames.h"
+#include "AdcScanner.h"
 
 class MoistureSensor {
 
 public:
 
-    MoistureSensor(PinName dataPin, PinName powerPin);
+    MoistureSensor(AdcScanner &adcScanner, PinName dataPin, PinName powerPin);
 
     void powerOn(void);
 
+    // Latest oversampled reading, only meaningful once the probe has been powered for a few ms
     float readPercentage(void);
 
     void powerOff(void);
 
 private:
 
-    AnalogIn m_analogIn;
+    AdcScanner &m_adcScanner;
+    int m_adcIndex;
     DigitalOut m_power;
 
 };
 
 
-#endif // MOISTURE_SENSOR_H
\ No newline at end of file
+#endif // MOISTURE_SENSOR_H
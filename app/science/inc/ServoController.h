@@ -4,6 +4,7 @@
 
 #include "mbed.h"
 #include "Servo.h"
+#include "DeferredEventQueue.h"
 #include "PinNames.h"
 
 class ServoController {
@@ -18,7 +19,7 @@ class ServoController {
 
         } t_servoConfig;
         
-        ServoController(t_servoConfig servoConfig);
+        ServoController(const t_servoConfig &servoConfig);
                          
         void setFunnelUp(void);
         void setFunnelDown(void);
@@ -27,15 +28,17 @@ class ServoController {
 
     private:
 
-        t_servoConfig m_servoConfig;
+        const t_servoConfig &m_servoConfig;
 
         Servo m_funnelServo;
 
-        Ticker m_ticker;
+        Timeout m_timeout;
 
         bool m_isFunnelOpen;
 
         void setFunnelRest(void);
+        void funnelTimeout(void);
+        static void funnelRest(void *p_servoController, uint32_t arg);
 };
 
 
@@ -7,7 +7,7 @@
 #include "PID.h"
 #include "PinNames.h"
 
-AugerController::AugerController( AugerController::t_augerConfig controllerConfig )
+AugerController::AugerController( const AugerController::t_augerConfig &controllerConfig )
 :   m_augerConfig( controllerConfig ),
     m_motor( controllerConfig.motor )
 {}
@@ -21,3 +21,7 @@ mbed_error_status_t AugerController::setMotorDutyCycle(float percent)
 float AugerController::getDutyCycle(void) {
     return m_motor.getDutyCycle();
 }
+
+Motor& AugerController::getMotor(void) {
+    return m_motor;
+}
@@ -2,27 +2,24 @@
 
 #include "CentrifugeController.h"
 
-CentrifugeController::CentrifugeController( CentrifugeController::t_centrifugeConfig        centrifugeConfig,
+CentrifugeController::CentrifugeController( const CentrifugeController::t_centrifugeConfig  &centrifugeConfig,
                                             CentrifugeController::t_centrifugeControlMode   controlMode ):
     m_centrifugeControlMode( controlMode ),
     m_centrifugeConfig( centrifugeConfig ),
     m_motor( centrifugeConfig.motor ),
     m_encoder( centrifugeConfig.encoder ),
+    m_velocityEstimator( m_encoder ),
     m_limitSwitch(centrifugeConfig.limitSwitchPin ),
-    m_positionPIDController( centrifugeConfig.positionPID.P, centrifugeConfig.positionPID.I, centrifugeConfig.positionPID.D, centrifugeConfig.positionPID.interval )
+    m_positionPIDController( centrifugeConfig.positionPID.P, centrifugeConfig.positionPID.I, centrifugeConfig.positionPID.D, centrifugeConfig.positionPID.interval ),
+    m_capture( centrifugeConfig.maxEncoderPulsePerRev / 16384.0f ) // One revolution spans half the 16 bit range
 {
-
-    if (centrifugeConfig.encoder.inverted) {
-        m_encoderInversionMultiplier = -1;
-    }
-    else {
-        m_encoderInversionMultiplier = 1;
-    }
-
     m_isSpinning = false;
+    m_targetPulses = getTubePulses(0);
 
     initializePID();
-    timer.start();
+
+    MicrosecondClock::init();
+    m_lastUpdateUs = MicrosecondClock::read();
 }
 
 CentrifugeController::t_centrifugeControlMode CentrifugeController::getControlMode()
@@ -30,16 +27,41 @@ CentrifugeController::t_centrifugeControlMode CentrifugeController::getControlMo
     return m_centrifugeControlMode;
 }
 
-// Get the current test tube # that is under the auger - note, this rounds down
+// Get the current test tube # that is under the auger, the closest one if between two
 unsigned int CentrifugeController::getTestTubeIndex()
 {
-    return static_cast<int>( getEncoderPulses() / m_centrifugeConfig.maxEncoderPulsePerRev * 11.9f );
+    int pulsesPerRev = m_centrifugeConfig.maxEncoderPulsePerRev;
+    int pulsesFromTube0 = wrapPulses( getEncoderPulses() - m_centrifugeConfig.limitSwitchOffset );
+
+    return ( ( pulsesFromTube0 * CENTRIFUGE_TUBE_COUNT + pulsesPerRev / 2 ) / pulsesPerRev ) % CENTRIFUGE_TUBE_COUNT;
 }
 
 // Get the current encoder value
-float CentrifugeController::getEncoderPulses()
+int CentrifugeController::getEncoderPulses()
+{
+    return wrapPulses( m_centrifugeConfig.encoderDirection * m_encoder.getPulses() );
+}
+
+float CentrifugeController::getVelocityEncoderPulsesPerSec()
+{
+    return m_centrifugeConfig.encoderDirection * m_velocityEstimator.getPulsesPerSecond();
+}
+
+int CentrifugeController::wrapPulses( int pulses )
 {
-    return m_encoderInversionMultiplier * fmodf(m_encoder.getPulses(), m_centrifugeConfig.maxEncoderPulsePerRev);
+    int pulsesPerRev = m_centrifugeConfig.maxEncoderPulsePerRev;
+
+    pulses %= pulsesPerRev;
+
+    return pulses < 0 ? pulses + pulsesPerRev : pulses;
+}
+
+// Centre of a tube, rounded to the closest pulse
+int CentrifugeController::getTubePulses( unsigned int tube_num )
+{
+    int pulsesPerRev = m_centrifugeConfig.maxEncoderPulsePerRev;
+
+    return wrapPulses( ( (int)tube_num * pulsesPerRev + CENTRIFUGE_TUBE_COUNT / 2 ) / CENTRIFUGE_TUBE_COUNT + m_centrifugeConfig.limitSwitchOffset );
 }
 
 mbed_error_status_t CentrifugeController::setControlMode(CentrifugeController::t_centrifugeControlMode controlMode)
@@ -61,7 +83,7 @@ mbed_error_status_t CentrifugeController::setControlMode(CentrifugeController::t
             return MBED_ERROR_CODE_INVALID_ARGUMENT;
     }
 
-    timer.reset();
+    m_lastUpdateUs = MicrosecondClock::read();
 
     return MBED_SUCCESS;
 }
@@ -84,20 +106,20 @@ mbed_error_status_t CentrifugeController::setTubePosition( unsigned int tube_num
         setControlMode(positionPID);
     }
 
-    // Might shift the placement by one test tube due to rounding when fetching current tube #
-    if( tube_num > 11 ){
-        tube_num = 11;
+    if( tube_num >= CENTRIFUGE_TUBE_COUNT ){
+        tube_num = CENTRIFUGE_TUBE_COUNT - 1;
     }
 
-    m_positionPIDController.setSetPoint( (tube_num / 12.0f * m_centrifugeConfig.maxEncoderPulsePerRev) + m_centrifugeConfig.limitSwitchOffset );
+    m_targetPulses = getTubePulses( tube_num );
 
     return MBED_SUCCESS;
 }
 
 void CentrifugeController::update()
 {
-    float interval = timer.read();
-    timer.reset();
+    uint32_t intervalUs = MicrosecondClock::lap(m_lastUpdateUs);
+
+    m_velocityEstimator.update();
 
     switch( m_centrifugeControlMode ) {
 
@@ -108,22 +130,37 @@ void CentrifugeController::update()
                 m_motor.setDutyCycle(0.0f);
             }
 
+            m_capture.recordOpenLoop( getEncoderPulses(), m_motor.getDutyCycle(), intervalUs );
+
             break;
 
         case positionPID:
+        {
+            int encoderPulses = getEncoderPulses();
+            int pulsesPerRev  = m_centrifugeConfig.maxEncoderPulsePerRev;
+
+            // Signed distance to the target the short way round, across the index if needed
+            int pulsesToTarget = wrapPulses( m_targetPulses - encoderPulses + pulsesPerRev / 2 ) - pulsesPerRev / 2;
 
-            m_positionPIDController.setInterval( interval );
-            m_positionPIDController.setProcessValue( getEncoderPulses() );
+            m_positionPIDController.setIntervalUs( intervalUs );
+            m_positionPIDController.setProcessValue( -pulsesToTarget );
             m_motor.setDutyCycle(m_positionPIDController.compute());
 
+            m_capture.record( m_targetPulses, encoderPulses, m_motor.getDutyCycle(), intervalUs );
+
             break;
+        }
     }
 }
 
 void CentrifugeController::initializePID( void ) 
 {
-    // Input limits are encoder pulses
-    m_positionPIDController.setInputLimits( 0 , m_centrifugeConfig.maxEncoderPulsePerRev );
+    // The loop runs on the pulses left to the target, which it drives to 0. The span
+    // is still one revolution so the tuning is the same as on absolute positions
+    int halfRev = m_centrifugeConfig.maxEncoderPulsePerRev / 2;
+
+    m_positionPIDController.setInputLimits( -halfRev, m_centrifugeConfig.maxEncoderPulsePerRev - halfRev );
+    m_positionPIDController.setSetPoint( 0 );
     m_positionPIDController.setOutputLimits( m_centrifugeConfig.PIDOutputMotorMinDutyCycle, m_centrifugeConfig.PIDOutputMotorMaxDutyCycle );
     m_positionPIDController.setBias( m_centrifugeConfig.positionPID.bias );
     m_positionPIDController.setDeadZoneError( 0.02 );
@@ -137,10 +174,11 @@ mbed_error_status_t CentrifugeController::runEndpointCalibration() {
     setControlMode( motorDutyCycle );
     setMotorDutyCycle(m_centrifugeConfig.calibrationDutyCycle);
 
-    timer.reset();
+    uint32_t calibrationTimeoutUs = (uint32_t)(m_centrifugeConfig.calibrationTimeoutSeconds * 1000000.0f);
+    uint32_t calibrationStartUs = MicrosecondClock::read();
 
     while ( m_limitSwitch.read() != 0 ) {
-        if ( timer.read() > m_centrifugeConfig.calibrationTimeoutSeconds ) {
+        if ( MicrosecondClock::elapsedSince(calibrationStartUs) > calibrationTimeoutUs ) {
             setMotorDutyCycle(0.0f);
             setControlMode(prevControlMode);
             return MBED_ERROR_TIME_OUT;
@@ -180,3 +218,15 @@ bool CentrifugeController::isSpinning() {
 float CentrifugeController::getDutyCycle() {
     return m_motor.getDutyCycle();
 }
+
+PID& CentrifugeController::getPositionPIDController() {
+    return m_positionPIDController;
+}
+
+LoopCapture& CentrifugeController::getCapture() {
+    return m_capture;
+}
+
+Motor& CentrifugeController::getMotor() {
+    return m_motor;
+}
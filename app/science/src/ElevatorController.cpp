@@ -6,25 +6,22 @@
 #include "ElevatorController.h"
 #include "../inc/ElevatorController.h"
 
-ElevatorController::ElevatorController( ElevatorController::t_elevatorConfig        controllerConfig,
+ElevatorController::ElevatorController( const ElevatorController::t_elevatorConfig  &controllerConfig,
                                         ElevatorController::t_elevatorControlMode   controlMode )
 :   m_elevatorControlMode( controlMode ),
     m_elevatorConfig( controllerConfig ),
     m_motor( controllerConfig.motor.pwmPin, controllerConfig.motor.dirPin, controllerConfig.motor.inverted ),
     m_encoder( controllerConfig.encoder ),
+    m_velocityEstimator( m_encoder ),
     m_limitSwitchTop( controllerConfig.limitSwitchTop),
     m_limitSwitchBottom( controllerConfig.limitSwitchBottom),
-    m_positionPIDController( controllerConfig.positionPID.P, controllerConfig.positionPID.I, controllerConfig.positionPID.D, controllerConfig.positionPID.interval )
+    m_positionPIDController( controllerConfig.positionPID.P, controllerConfig.positionPID.I, controllerConfig.positionPID.D, controllerConfig.positionPID.interval ),
+    m_capture( controllerConfig.maxEncoderPulses / 32000.0f ) // Full travel fits the 16 bit range
 {
-    if (controllerConfig.encoder.inverted) {
-        m_encoderInversionMultiplier = -1;
-    }
-    else {
-        m_encoderInversionMultiplier = 1;
-    }
-
     initializePID();
-    timer.start();
+
+    MicrosecondClock::init();
+    m_lastUpdateUs = MicrosecondClock::read();
 }
 
 ElevatorController::t_elevatorControlMode ElevatorController::getControlMode() const
@@ -35,7 +32,12 @@ ElevatorController::t_elevatorControlMode ElevatorController::getControlMode() c
 // Get position as encoder pulse count
 int ElevatorController::getPositionEncoderPulses()
 {
-    return m_encoderInversionMultiplier * m_encoder.getPulses();
+    return m_elevatorConfig.encoderDirection * m_encoder.getPulses();
+}
+
+float ElevatorController::getVelocityEncoderPulsesPerSec()
+{
+    return m_elevatorConfig.encoderDirection * m_velocityEstimator.getPulsesPerSecond();
 }
 
 int ElevatorController::getPositionCm()
@@ -43,6 +45,21 @@ int ElevatorController::getPositionCm()
     return getPositionEncoderPulses() * m_elevatorConfig.centimetresPerPulse;
 }
 
+PID& ElevatorController::getPositionPIDController()
+{
+    return m_positionPIDController;
+}
+
+LoopCapture& ElevatorController::getCapture()
+{
+    return m_capture;
+}
+
+Motor& ElevatorController::getMotor()
+{
+    return m_motor;
+}
+
 mbed_error_status_t ElevatorController::setControlMode( t_elevatorControlMode controlMode )
 {
     switch (controlMode) {
@@ -62,7 +79,7 @@ mbed_error_status_t ElevatorController::setControlMode( t_elevatorControlMode co
             return MBED_ERROR_CODE_INVALID_ARGUMENT;
     }
 
-    timer.reset();
+    m_lastUpdateUs = MicrosecondClock::read();
 
     return MBED_SUCCESS;
 }
@@ -94,17 +111,18 @@ mbed_error_status_t ElevatorController::setPositionInCm(float centimeters)
         return MBED_ERROR_INVALID_OPERATION;
     }
 
-    fmin(fmax(0.0, centimeters), m_elevatorConfig.maxDistanceCm);
+    centimeters = min(max(centimeters, 0.0f), m_elevatorConfig.maxDistanceCm);
 
     // Convert cm distance into encoder value
-    m_positionPIDController.setSetPoint( centimeters / m_elevatorConfig.centimetresPerPulse);
+    m_positionPIDController.setSetPoint( centimeters * m_elevatorConfig.pulsesPerCentimetre );
     return MBED_SUCCESS;
 }
 
 
 void ElevatorController::update() {
-    float interval = timer.read();
-    timer.reset();
+    uint32_t intervalUs = MicrosecondClock::lap(m_lastUpdateUs);
+
+    m_velocityEstimator.update();
 
     switch (m_elevatorControlMode) {
 
@@ -117,13 +135,21 @@ void ElevatorController::update() {
                 pc.printf("Motor limit hit with speed %din update loop, set motor speed to 0\r\n",
                           m_motor.getDutyCycle());
             }
+
+            m_capture.recordOpenLoop( getPositionEncoderPulses(), m_motor.getDutyCycle(), intervalUs );
             break;
 
         case positionPID:
-            m_positionPIDController.setInterval( interval );
-            m_positionPIDController.setProcessValue( getPositionEncoderPulses() );
+        {
+            int encoderPulses = getPositionEncoderPulses();
+
+            m_positionPIDController.setIntervalUs( intervalUs );
+            m_positionPIDController.setProcessValue( encoderPulses );
             m_motor.setDutyCycle(m_positionPIDController.compute());
+
+            m_capture.record( m_positionPIDController.getSetPoint(), encoderPulses, m_motor.getDutyCycle(), intervalUs );
             break;
+        }
     }
 }
 
@@ -143,10 +169,11 @@ mbed_error_status_t ElevatorController::runEndpointCalibration() {
     MBED_WARN_AND_RETURN_STATUS_ON_ERROR( setControlMode( motorDutyCycle ) );
     MBED_WARN_AND_RETURN_STATUS_ON_ERROR( setMotorDutyCycle(m_elevatorConfig.calibrationDutyCycle) );
 
-    timer.reset();
+    uint32_t calibrationTimeoutUs = (uint32_t)(m_elevatorConfig.calibrationTimeoutSeconds * 1000000.0f);
+    uint32_t calibrationStartUs = MicrosecondClock::read();
 
     while ( m_limitSwitchTop.read() != 0 ) {
-        if ( timer.read() > m_elevatorConfig.calibrationTimeoutSeconds ) {
+        if ( MicrosecondClock::elapsedSince(calibrationStartUs) > calibrationTimeoutUs ) {
             setControlMode(prevControlMode);
             return MBED_ERROR_TIME_OUT;
         }
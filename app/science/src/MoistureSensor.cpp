@@ -1,14 +1,17 @@
-
 #include "MoistureSensor.h"
 
-MoistureSensor::MoistureSensor(PinName dataPin, PinName powerPin) : m_analogIn(dataPin), m_power(powerPin) {}
+MoistureSensor::MoistureSensor(AdcScanner &adcScanner, PinName dataPin, PinName powerPin) :
+    m_adcScanner(adcScanner), m_adcIndex(adcScanner.addPin(dataPin)), m_power(powerPin) {
+
+    MBED_ASSERT_WARN(m_adcIndex >= 0);
+}
 
 void MoistureSensor::powerOn() {
     m_power = 1;
 }
 
 float MoistureSensor::readPercentage() {
-    return m_analogIn.read();
+    return m_adcScanner.read(m_adcIndex);
 }
 
 void MoistureSensor::powerOff() {
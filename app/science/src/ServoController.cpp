@@ -5,7 +5,7 @@
 #include "Servo.h"
 #include "PinNames.h"
 
-ServoController::ServoController(ServoController::t_servoConfig servoConfig) :
+ServoController::ServoController(const ServoController::t_servoConfig &servoConfig) :
     m_servoConfig(servoConfig), m_funnelServo(servoConfig.funnelServoPin) {
 
     m_isFunnelOpen = false;
@@ -13,18 +13,26 @@ ServoController::ServoController(ServoController::t_servoConfig servoConfig) :
 
 void ServoController::setFunnelRest() {
     m_funnelServo = m_servoConfig.funnelRestPos;
-    m_ticker.detach();
+}
+
+void ServoController::funnelTimeout() {
+    // Only the timing is done in the interrupt, the servo is written from the event queue
+    DeferredEventQueue::getShared().post(&ServoController::funnelRest, this);
+}
+
+void ServoController::funnelRest(void *p_servoController, uint32_t arg) {
+    static_cast<ServoController *>(p_servoController)->setFunnelRest();
 }
 
 void ServoController::setFunnelUp() {
     m_funnelServo = m_servoConfig.funnelUpPos;
-    m_ticker.attach(callback(this, &ServoController::setFunnelRest), 1.0);
+    m_timeout.attach(callback(this, &ServoController::funnelTimeout), 1.0);
     m_isFunnelOpen = false;
 }
 
 void ServoController::setFunnelDown() {
     m_funnelServo = m_servoConfig.funnelDownPos;
-    m_ticker.attach(callback(this, &ServoController::setFunnelRest), 1.0);
+    m_timeout.attach(callback(this, &ServoController::funnelTimeout), 1.0);
     m_isFunnelOpen = true;
 }
 
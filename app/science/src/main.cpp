@@ -9,8 +9,17 @@
 #include "ElevatorController.h"
 #include "ServoController.h"
 #include "MoistureSensor.h"
-
-const AugerController::t_augerConfig augerConfig = {
+#include "FirmwareUpdateService.h"
+#include "PIDTuningService.h"
+#include "LoopCaptureService.h"
+#include "TimeSyncService.h"
+#include "BoardStatusService.h"
+#include "CrashLogService.h"
+#include "CommandWatchdog.h"
+#include "IndependentWatchdog.h"
+#include "AdcScanner.h"
+
+constexpr AugerController::t_augerConfig augerConfig = {
         .motor = {
                 .pwmPin = MOTOR_A,
                 .dirPin = MOTOR_A_DIR,
@@ -20,7 +29,7 @@ const AugerController::t_augerConfig augerConfig = {
         }
 };
 
-const CentrifugeController::t_centrifugeConfig centrifugeConfig = {
+constexpr CentrifugeController::t_centrifugeConfig centrifugeConfig = {
         .motor = {
                 .pwmPin = MOTOR_C,
                 .dirPin = MOTOR_C_DIR,
@@ -39,7 +48,7 @@ const CentrifugeController::t_centrifugeConfig centrifugeConfig = {
         },
 
         .limitSwitchPin = C_LS,
-        .limitSwitchOffset = 70.0f,
+        .limitSwitchOffset = 70,
 
         .calibrationDutyCycle = 0.25f,
         .calibrationTimeoutSeconds = 7.0f,
@@ -58,7 +67,7 @@ const CentrifugeController::t_centrifugeConfig centrifugeConfig = {
         .PIDOutputMotorMaxDutyCycle = 0.3f
 };
 
-const ElevatorController::t_elevatorConfig elevatorConfig = {
+constexpr ElevatorController::t_elevatorConfig elevatorConfig = {
 
         .motor = {
                 .pwmPin = MOTOR_E,
@@ -91,25 +100,35 @@ const ElevatorController::t_elevatorConfig elevatorConfig = {
                 .interval = 0.1f
         },
 
-        .maxEncoderPulses = 467352, // Gotten from maxDistanceCm / centimetresPerPulse
-        .maxDistanceCm = 16, // 6.5 inch range distance
+        .maxDistanceCm = 16.51f, // 6.5 inch range distance, 467352 pulses
         .centimetresPerPulse = 0.00003532669f, // Unit is cm/pulse
         .PIDOutputMotorMinDutyCycle = -0.5f,
         .PIDOutputMotorMaxDutyCycle = 0.8f
 };
 
-const ServoController::t_servoConfig servoConfig {
+constexpr ServoController::t_servoConfig servoConfig {
     .funnelServoPin = SERVO_F,
     .funnelUpPos = 0.8,
     .funnelRestPos = 0.53,
     .funnelDownPos = 0.2
 };
 
+static_assert(CentrifugeController::isValidConfig(centrifugeConfig), "Centrifuge config out of range");
+static_assert(ElevatorController::isValidConfig(elevatorConfig), "Elevator config out of range");
+
 Serial                  pc(SERIAL_TX, SERIAL_RX, ROVER_DEFAULT_BAUD_RATE);
 CAN                     can(CAN_RX, CAN_TX, ROVER_CANBUS_FREQUENCY);
 CANMsg                  rxMsg;
 CANMsg                  txMsg;
 
+FirmwareUpdateService   firmwareUpdateService(can, ROVER_SCIENCE_CANID);
+PIDTuningService        pidTuningService(can, ROVER_SCIENCE_CANID);
+LoopCaptureService      loopCaptureService(can, ROVER_SCIENCE_CANID);
+TimeSyncService         timeSyncService(can, ROVER_SCIENCE_CANID);
+BoardStatusService      boardStatusService(can, ROVER_SCIENCE_CANID);
+CrashLogService         crashLogService(can, ROVER_SCIENCE_CANID);
+CommandWatchdog         commandWatchdog(can, ROVER_SCIENCE_CANID);
+
 DigitalOut              ledErr(LED1);
 DigitalOut              ledCAN(LED4);
 
@@ -118,7 +137,8 @@ CentrifugeController    centrifugeController( centrifugeConfig );
 ElevatorController      elevatorController( elevatorConfig );
 ServoController         servoController( servoConfig );
 
-MoistureSensor          moistureSensor(MOIST_DATA, MOIST_PWR);
+AdcScanner              adcScanner;
+MoistureSensor          moistureSensor(adcScanner, MOIST_DATA, MOIST_PWR);
 
 Timer                   canSendTimer;
 
@@ -146,6 +166,24 @@ enum scienceCommand {
     setProbeDeployed
 };
 
+// PID tuning targets, keep the numbering stable so saved tunings stay with their loop
+enum t_pidTuningTarget {
+    elevatorPositionPID,
+    centrifugePositionPID
+};
+
+enum t_captureTarget {
+    elevatorCapture,
+    centrifugeCapture
+};
+
+// The funnel servo holds its position by itself and is not watched
+enum t_watchdogAxis {
+    elevatorAxis,
+    augerAxis,
+    centrifugeAxis
+};
+
 enum jetsonFeedback {
 
     augerHeight = ROVER_JETSON_START_CANID_MSG_SCIENCE,
@@ -161,6 +199,35 @@ enum jetsonFeedback {
 
 void initCAN() {
     can.filter(ROVER_SCIENCE_CANID, ROVER_CANID_FILTER_MASK, CANStandard);
+
+    // The SYNC broadcast is outside the board's ID range, it gets the second filter bank
+    can.filter(ROVER_CANID_SYNC, 0x7FF, CANStandard, 1);
+}
+
+void initPIDTuning() {
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(elevatorPositionPID, elevatorController.getPositionPIDController()));
+    MBED_WARN_ON_ERROR(pidTuningService.registerPID(centrifugePositionPID, centrifugeController.getPositionPIDController()));
+
+    pidTuningService.loadStoredTunings();
+}
+
+void initADC() {
+    // Internal channels for the supply correction and the board temperature
+    adcScanner.addInternal(AdcScanner::channelTemperature);
+    adcScanner.addInternal(AdcScanner::channelVrefint);
+
+    MBED_WARN_ON_ERROR(adcScanner.start());
+}
+
+void initLoopCapture() {
+    MBED_WARN_ON_ERROR(loopCaptureService.registerCapture(elevatorCapture, elevatorController.getCapture()));
+    MBED_WARN_ON_ERROR(loopCaptureService.registerCapture(centrifugeCapture, centrifugeController.getCapture()));
+}
+
+void initCommandWatchdog() {
+    MBED_WARN_ON_ERROR(commandWatchdog.registerMotor(elevatorAxis, elevatorController.getMotor()));
+    MBED_WARN_ON_ERROR(commandWatchdog.registerMotor(augerAxis, augerController.getMotor()));
+    MBED_WARN_ON_ERROR(commandWatchdog.registerMotor(centrifugeAxis, centrifugeController.getMotor()));
 }
 
 ElevatorController::t_elevatorControlMode handleSetElevatorControlMode(CANMsg *p_newMsg) {
@@ -302,22 +369,68 @@ void processCANMsg(CANMsg *p_newMsg) {
     }
 }
 
+void feedCommandWatchdog(CANMsg *p_newMsg) {
+    switch (p_newMsg->id) {
+
+        case setElevatorControlMode:
+        case setElevatorMotion:
+            commandWatchdog.commandReceived(elevatorAxis);
+            break;
+
+        case setAugerDutyCycle:
+            commandWatchdog.commandReceived(augerAxis);
+            break;
+
+        case setCentrifugeControlMode:
+        case setCentrifugeDutyCycle:
+        case setCentrifugeSpinning:
+        case setCentrifugePosition:
+            commandWatchdog.commandReceived(centrifugeAxis);
+            break;
+    }
+}
+
+// Stopped axes hold still, rather than carry on with their stale command once they are commanded again
+void holdStoppedAxes(uint8_t stoppedMask) {
+    if (stoppedMask & (1 << elevatorAxis)) {
+        MBED_WARN_ON_ERROR(elevatorController.setControlMode(elevatorController.getControlMode()));
+    }
+
+    if (stoppedMask & (1 << augerAxis)) {
+        MBED_WARN_ON_ERROR(augerController.setMotorDutyCycle(0.0f));
+    }
+
+    // Re-entering position control would send it back to the first tube, so it is left stopped instead
+    if (stoppedMask & (1 << centrifugeAxis)) {
+        MBED_WARN_ON_ERROR(centrifugeController.setSpinning(false));
+    }
+}
+
+void stopMotors() {
+    MBED_WARN_ON_ERROR(augerController.setMotorDutyCycle(0.0f));
+    MBED_WARN_ON_ERROR(centrifugeController.setControlMode(CentrifugeController::motorDutyCycle));
+    MBED_WARN_ON_ERROR(elevatorController.setControlMode(ElevatorController::motorDutyCycle));
+}
+
 void sendJetsonInfoA() {
     CANMsg txMsg(0);
 
     txMsg.clear();
     txMsg.id = augerHeight;
     txMsg << elevatorController.getPositionCm();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg) == true);
 
     txMsg.clear();
     txMsg.id = augerSpeed;
     txMsg << augerController.getDutyCycle();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg) == true);
 
     txMsg.clear();
     txMsg.id = centrifugeSpinning;
     txMsg << centrifugeController.isSpinning();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg) == true);
 }
 
@@ -327,16 +440,19 @@ void sendJetsonInfoB() {
     txMsg.clear();
     txMsg.id = centrifugeSpeed;
     txMsg << centrifugeController.getDutyCycle();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg) == true);
 
     txMsg.clear();
     txMsg.id = centrifugePosition;
     txMsg << centrifugeController.getTestTubeIndex();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg) == true);
 
     txMsg.clear();
     txMsg.id = funnelStatus;
     txMsg << servoController.isFunnelOpen();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg) == true);
 
     moistureSensor.powerOn();
@@ -348,6 +464,7 @@ void sendJetsonInfoC() {
     txMsg.clear();
     txMsg.id = moisture;
     txMsg << moistureSensor.readPercentage();
+    timeSyncService.stamp(txMsg);
     MBED_ASSERT_WARN(can.write(txMsg) == true);
     moistureSensor.powerOff();
 }
@@ -357,6 +474,10 @@ int main(void)
     pc.printf("Program Started\r\n\r\n");
 
     initCAN();
+    initPIDTuning();
+    initLoopCapture();
+    initADC();
+    initCommandWatchdog();
 
     servoController.setFunnelUp();
     elevatorController.runEndpointCalibration();
@@ -364,16 +485,43 @@ int main(void)
 
     canSendTimer.start();
 
+    // Not before the calibrations, they block for as long as their timeouts
+    commandWatchdog.start();
+    IndependentWatchdog::start(ROVER_IWDG_TIMEOUT_MS);
+
     int sendCANSwitch = 0;
 
     while (1) {
 
+        IndependentWatchdog::kick();
+
         if (can.read(rxMsg)) {
-            processCANMsg(&rxMsg);
+            uint32_t rxTimeUs = timeSyncService.getTimeUs();
+            bool wasUpdating = firmwareUpdateService.isUpdateInProgress();
+
+            if (firmwareUpdateService.handleCANMsg(rxMsg)) {
+                if (!wasUpdating && firmwareUpdateService.isUpdateInProgress()) {
+                    stopMotors();
+                }
+            }
+            else if (!timeSyncService.handleCANMsg(rxMsg, rxTimeUs) && !pidTuningService.handleCANMsg(rxMsg) &&
+                     !loopCaptureService.handleCANMsg(rxMsg) && !crashLogService.handleCANMsg(rxMsg)) {
+                timeSyncService.commandReceived(rxMsg, rxTimeUs);
+                feedCommandWatchdog(&rxMsg);
+                processCANMsg(&rxMsg);
+            }
+
             rxMsg.clear();
             ledCAN = !ledCAN;
         }
 
+        firmwareUpdateService.rebootIfRequested();
+
+        // Flash writes stall the control loop, so the motors stay stopped until the update is done
+        if (firmwareUpdateService.isUpdateInProgress()) {
+            continue;
+        }
+
         if (canSendTimer.read() > 0.1) {
 
             switch (sendCANSwitch) {
@@ -394,8 +542,15 @@ int main(void)
             canSendTimer.reset();
         }
 
+        loopCaptureService.poll();
+        boardStatusService.poll();
+        crashLogService.poll();
+        holdStoppedAxes(commandWatchdog.poll());
+
         elevatorController.update();
         centrifugeController.update();
 
+        timeSyncService.sendCommandAcks();
+
     }
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+/* Per-edge cost of InterruptIn and DirectInterruptIn
+ *
+ * Edges are raised in software through EXTI->SWIER, so no signal needs to be
+ * wired to the pins. Each pass triggers the line a few thousand times and
+ * subtracts the time of the same loop without an interrupt. The maximum edge
+ * rate is the one at which the CPU would do nothing but serve edges.
+ *
+ * Not run on a board yet, so there are no before and after numbers for the
+ * direct binding. Record them here once it has been.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "DirectInterruptIn.h"
+
+#define EDGES_PER_PASS  10000
+
+// Pins with no other use on any of the boards, on the EXTI4_15 interrupt like most encoder inputs
+#define INTERRUPT_IN_PIN        PC_11
+#define DIRECT_INTERRUPT_IN_PIN PC_12
+
+Serial pc(SERIAL_TX, SERIAL_RX, ROVER_DEFAULT_BAUD_RATE);
+DigitalOut led(LED1);
+
+InterruptIn interruptIn(INTERRUPT_IN_PIN);
+DirectInterruptIn directInterruptIn(DIRECT_INTERRUPT_IN_PIN);
+
+volatile uint32_t edgeCount;
+volatile uint32_t dummyRegister;
+
+void countEdge(void) {
+    edgeCount++;
+}
+
+void countDirectEdge(void *p_context, int level) {
+    edgeCount++;
+}
+
+// Time of EDGES_PER_PASS writes to a register
+uint32_t timeWritesUs(volatile uint32_t *p_register, uint32_t value) {
+    Timer timer;
+    timer.start();
+
+    for (uint32_t i = 0; i < EDGES_PER_PASS; i++) {
+        *p_register = value;
+    }
+
+    return timer.read_us();
+}
+
+void report(const char *name, uint32_t lineMask, uint32_t baselineUs) {
+    edgeCount = 0;
+
+    uint32_t elapsedUs = timeWritesUs(&EXTI->SWIER, lineMask);
+    uint32_t perEdgeNs = (elapsedUs - baselineUs) * 1000 / EDGES_PER_PASS;
+
+    pc.printf("%-18s %5lu ns per edge (%lu cycles), max %6lu edges/s, %lu/%u edges seen\r\n", name, perEdgeNs,
+              perEdgeNs * (SystemCoreClock / 1000000) / 1000, perEdgeNs ? 1000000000 / perEdgeNs : 0, edgeCount,
+              EDGES_PER_PASS);
+}
+
+int main() {
+    interruptIn.rise(&countEdge);
+    interruptIn.fall(&countEdge);
+    MBED_WARN_ON_ERROR(directInterruptIn.attach(&countDirectEdge, NULL, true, true));
+
+    while (true) {
+        uint32_t baselineUs = timeWritesUs(&dummyRegister, 1);
+
+        report("InterruptIn", 1 << STM_PIN(INTERRUPT_IN_PIN), baselineUs);
+        report("DirectInterruptIn", 1 << STM_PIN(DIRECT_INTERRUPT_IN_PIN), baselineUs);
+        pc.printf("\r\n");
+
+        led = !led;
+        wait(1.0);
+    }
+}
@@ -1,21 +1,55 @@
 #include "mbed.h"
 #include "neopixel.h"
+#include "PixelAnimator.h"
 
 #ifdef NUCLEO_PINMAP 
-neopixel neo(PA_5, 10);
+neopixel neo(PA_7, 10);     // SPI1 MOSI
 #else 
 neopixel neo(PB_5, 13);
 #endif
 
+PixelAnimator animator(neo);
+Timer tickTimer;
+
 const int DELAY_TIME_S = 1;
+const int ANIMATION_TICK_MS = 20;
+const int ANIMATION_TIME_TICKS = 3000 / ANIMATION_TICK_MS;
 
 int main(void) {
+	neo.showColor(255, 0, 0);
+	wait(DELAY_TIME_S);
+	neo.showColor(0, 255, 0);
+	wait(DELAY_TIME_S);
+	neo.showColor(255, 127, 80);
+	wait(DELAY_TIME_S);
+
+	tickTimer.start();
+	unsigned int ticks = 0;
+
+	// Each animation for a few seconds, the loop itself never waits on the strip
 	while (1) {
-		neo.showColor(255, 0, 0);
-		wait(DELAY_TIME_S);
-		neo.showColor(0, 255, 0);
-		wait(DELAY_TIME_S);
-		neo.showColor(255, 127, 80);
-		wait(DELAY_TIME_S);
+		if (tickTimer.read_ms() < ANIMATION_TICK_MS) {
+			continue;
+		}
+		tickTimer.reset();
+
+		unsigned int animation = ticks / ANIMATION_TIME_TICKS % 4;
+		unsigned int elapsed = ticks % ANIMATION_TIME_TICKS;
+		ticks++;
+
+		if (animation == 0 && elapsed == 0) {
+			animator.blink(255, 0, 0, 10, 10);
+		}
+		else if (animation == 1 && elapsed == 0) {
+			animator.fade(0, 0, 255, 100);
+		}
+		else if (animation == 2 && elapsed == 0) {
+			animator.chase(0, 255, 0, 4, 3);
+		}
+		else if (animation == 3) {
+			animator.progress(255, 127, 80, elapsed, ANIMATION_TIME_TICKS);
+		}
+
+		animator.tick();
 	}
 }
\ No newline at end of file
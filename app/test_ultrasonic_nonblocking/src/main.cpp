@@ -50,7 +50,7 @@ ultrasonic          sonarObject1(ULTRA_TRIG_1, ULTRA_ECHO_1, UPDATE_INTERVAL, TI
 ultrasonic          sonarObject2(ULTRA_TRIG_2, ULTRA_ECHO_2, UPDATE_INTERVAL, TIMEOUT, &dist);
 #else
 ultrasonic sonarObject1(D7, D8, UPDATE_INTERVAL, TIMEOUT, &dist);
-ultrasonic sonarObject2(D9, D10, UPDATE_INTERVAL, TIMEOUT, &dist);
+ultrasonic sonarObject2(D5, D4, UPDATE_INTERVAL, TIMEOUT, &dist);
 #endif
 
 // main() runs in its own thread in the OS
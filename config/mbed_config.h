@@ -34,9 +34,16 @@
     printf(__VA_ARGS__);                    \
 }                                           \
 
+// Warnings are also kept in the crash log (CrashLog.h)
+#ifdef __cplusplus
+extern "C"
+#endif
+void crash_log_warning(int status);
+
 #define MBED_WARN_ON_ERROR(functionCall) {                                                      \
     mbed_error_status_t result = functionCall;                                                  \
     if (result != MBED_SUCCESS) {                                                               \
+        crash_log_warning(result);                                                              \
         PRINT_WARNING("Operation '%s' failed with status code %d \r\n", #functionCall, result); \
     }                                                                                           \
 }                                                                                               \
@@ -44,6 +51,7 @@
 #define MBED_WARN_AND_RETURN_STATUS_ON_ERROR(functionCall) {                                    \
     mbed_error_status_t result = functionCall;                                                  \
     if (result != MBED_SUCCESS) {                                                               \
+        crash_log_warning(result);                                                              \
         PRINT_WARNING("Operation '%s' failed with status code %d \r\n", #functionCall, result); \
         return result;                                                                          \
     }                                                                                           \
@@ -51,6 +59,7 @@
 
 #define MBED_ASSERT_WARN(assertion) {                           \
     if ((assertion) == false) {                                 \
+        crash_log_warning(0);                                   \
         PRINT_WARNING("Failed assertion: %s\r\n", #assertion);  \
     }                                                           \
 }                                                               \
@@ -73,6 +82,7 @@
 #define MBED_CONF_PLATFORM_STDIO_FLUSH_AT_EXIT              1                                       // set by library:platform
 #define MBED_CONF_TARGET_LPUART_CLOCK_SOURCE                USE_LPUART_CLK_LSE|USE_LPUART_CLK_PCLK1 // set by target:FAMILY_STM32
 #define MBED_CONF_TARGET_LSE_AVAILABLE                      1                                       // set by target:FAMILY_STM32
+#define MBED_HEAP_STATS_ENABLED                             1                                       // heap usage for MemoryMonitor
 
 #define __CORTEX_M0
 #define CMSIS_VECTAB_VIRTUAL
@@ -16,8 +16,49 @@
 #define ROVER_JETSON_START_CANID_MSG_ARM_UPPER  0x503
 #define ROVER_JETSON_START_CANID_MSG_SCIENCE    0x510
 #define ROVER_JETSON_START_CANID_MSG_SAFETY     0x530
+#define ROVER_CANID_SYNC                        0x080  // Jetson time broadcast to every board (TimeSyncProtocol.h)
+#define ROVER_CANID_SAFETY_FAULT                0x010  // Overcurrent faults, above every other frame in priority (PowerMonitor.h)
+
+// System service commands, offset from the board CAN ID (0xF0 - 0xFF of every board are reserved)
+#define ROVER_CANID_SYS_FIRMWARE_CMD            0x0F0
+#define ROVER_CANID_SYS_FIRMWARE_DATA           0x0F1
+#define ROVER_CANID_SYS_PARAM_CMD               0x0F2
+#define ROVER_CANID_SYS_CAPTURE_CMD             0x0F3
+#define ROVER_CANID_SYS_CRASH_CMD               0x0F5 // Crash record kept across resets (CrashLogProtocol.h)
+
+// System service replies, offset from the board's reply base in the Jetson range (32 IDs per board)
+#define ROVER_JETSON_SYS_REPLY_CANID(boardCanId) (0x580 + ((((boardCanId) >> 8) - 1) << 5))
+#define ROVER_SYS_REPLY_FIRMWARE                0x00
+#define ROVER_SYS_REPLY_PARAM                   0x01
+#define ROVER_SYS_REPLY_CAPTURE                 0x02
+#define ROVER_SYS_REPLY_CAPTURE_DATA            0x03
+#define ROVER_SYS_REPLY_COMMAND_ACK             0x05
+#define ROVER_SYS_REPLY_STATUS                  0x06 // Memory usage, once a second (BoardStatusProtocol.h)
+#define ROVER_SYS_REPLY_WARNING                 0x07
+#define ROVER_SYS_REPLY_CRASH                   0x08
+#define ROVER_SYS_REPLY_CRASH_DATA              0x09
+#define ROVER_SYS_REPLY_WATCHDOG                0x0A // Axes stopped for stale commands (CommandWatchdog.h)
+
+// Flash layout (STM32F091RC: 256 KB in 2 KB pages)
+#define ROVER_FLASH_BASE                        0x08000000
+#define ROVER_FLASH_PAGE_SIZE                   0x800
+#define ROVER_FLASH_BOOTLOADER_START            0x08000000 // Resident CAN bootloader
+#define ROVER_FLASH_BOOTLOADER_SIZE             0x8000     // 32 KB
+#define ROVER_FLASH_BOOT_RECORD_START           0x08008000 // Two pages, written alternately
+#define ROVER_FLASH_BOOT_RECORD_SIZE            0x1000
+#define ROVER_FLASH_APP_START                   0x08009000 // Active application image
+#define ROVER_FLASH_APP_SIZE                    0x1B000    // 108 KB
+#define ROVER_FLASH_STAGING_START               0x08024000 // Inactive slot that updates are received into
+#define ROVER_FLASH_STAGING_SIZE                0x1B000    // 108 KB
+#define ROVER_FLASH_PARAM_STORE_START           0x0803F000 // Stored PID tunings, two pages written alternately
+#define ROVER_FLASH_PARAM_STORE_SIZE            0x1000
+
+// RAM layout (32 KB, the first 0xC0 bytes hold the relocated vector table), must match the linker script
+#define ROVER_RAM_NOINIT_START                  0x20007E00 // Kept across resets and never initialised (CrashLog.h)
+#define ROVER_RAM_NOINIT_SIZE                   0x200      // The stack starts below it
 
 // Controls
 #define ROVER_MOTOR_PWM_FREQ_HZ 1000    // 1 kHz
+#define ROVER_IWDG_TIMEOUT_MS   500     // Main loop hang before a reset, +-33% (IndependentWatchdog.h)
 
-#endif // ROVER_CONFIG_H
\ No newline at end of file
+#endif // ROVER_CONFIG_H
@@ -31,7 +31,11 @@
 #include "cmsis_nvic.h"
 
 #define NVIC_RAM_VECTOR_ADDRESS   (0x20000000)  // Vectors positioned at start of RAM
+#if defined(MBED_APP_START)
+#define NVIC_FLASH_VECTOR_ADDRESS MBED_APP_START // Image linked behind a bootloader
+#else
 #define NVIC_FLASH_VECTOR_ADDRESS (0x08000000)  // Initial vector position in flash
+#endif
 
 void NVIC_SetVector(IRQn_Type IRQn, uint32_t vector) {
     int i;
@@ -33,6 +33,7 @@
 #include "pinmap.h"
 #include "mbed_error.h"
 #include "gpio_irq_device.h"
+#include "gpio_irq_direct.h"
 
 #define EDGE_NONE (0)
 #define EDGE_RISE (1)
@@ -73,8 +74,47 @@ static gpio_channel_t channels[CHANNEL_NUM] = {
 #endif
 };
 
+// Lines bound with gpio_irq_direct_bind, served before the InterruptIn pins
+typedef struct direct_line {
+    gpio_irq_direct_handler handler;
+    void *context;
+    GPIO_TypeDef *gpio;
+    uint32_t pin;
+} direct_line_t;
+
+static direct_line_t direct_lines[16];
+static uint32_t direct_line_mask[CHANNEL_NUM];  // Bound lines of each IRQ
+static uint32_t irq_line_mask[CHANNEL_NUM];     // All the lines of each IRQ
+
+// Returns 1 if the interrupt was only for bound lines
+static int handle_direct_interrupt_in(uint32_t irq_index)
+{
+    uint32_t pending = EXTI->PR & direct_line_mask[irq_index];
+
+    if (pending == 0) {
+        return 0;
+    }
+
+    EXTI->PR = pending;
+
+    for (uint32_t line = 0; pending != 0; line++) {
+        if (pending & (1 << line)) {
+            direct_line_t *direct_line = &direct_lines[line];
+            pending &= ~(1 << line);
+
+            direct_line->handler(direct_line->context, (direct_line->gpio->IDR & direct_line->pin) != 0);
+        }
+    }
+
+    return (EXTI->PR & irq_line_mask[irq_index] & ~direct_line_mask[irq_index]) == 0;
+}
+
 static void handle_interrupt_in(uint32_t irq_index, uint32_t max_num_pin_line)
 {
+    if (direct_line_mask[irq_index] != 0 && handle_direct_interrupt_in(irq_index)) {
+        return;
+    }
+
     gpio_channel_t *gpio_channel = &channels[irq_index];
     uint32_t gpio_idx;
 
@@ -122,7 +162,11 @@ static void handle_interrupt_in(uint32_t irq_index, uint32_t max_num_pin_line)
             }
         }
     }
-    error("Unexpected Spurious interrupt, index %d\r\n", irq_index);
+    // A bound line's edge can come in between reading and clearing its flag, leaving
+    // the IRQ pending for an edge that was already served
+    if (direct_line_mask[irq_index] == 0) {
+        error("Unexpected Spurious interrupt, index %d\r\n", irq_index);
+    }
 }
 
 
@@ -263,6 +307,110 @@ int gpio_irq_init(gpio_irq_t *obj, PinName pin, gpio_irq_handler handler, uint32
     return 0;
 }
 
+static uint32_t get_irq_vector(uint32_t irq_index)
+{
+    switch (irq_index) {
+#ifdef EXTI_IRQ0_NUM_LINES
+        case 0:
+            return (uint32_t)&gpio_irq0;
+#endif
+#ifdef EXTI_IRQ1_NUM_LINES
+        case 1:
+            return (uint32_t)&gpio_irq1;
+#endif
+#ifdef EXTI_IRQ2_NUM_LINES
+        case 2:
+            return (uint32_t)&gpio_irq2;
+#endif
+#ifdef EXTI_IRQ3_NUM_LINES
+        case 3:
+            return (uint32_t)&gpio_irq3;
+#endif
+#ifdef EXTI_IRQ4_NUM_LINES
+        case 4:
+            return (uint32_t)&gpio_irq4;
+#endif
+#ifdef EXTI_IRQ5_NUM_LINES
+        case 5:
+            return (uint32_t)&gpio_irq5;
+#endif
+#ifdef EXTI_IRQ6_NUM_LINES
+        case 6:
+            return (uint32_t)&gpio_irq6;
+#endif
+        default:
+            return 0;
+    }
+}
+
+int gpio_irq_direct_bind(PinName pin, gpio_irq_direct_handler handler, void *context, int rise, int fall)
+{
+    if (pin == NC || handler == NULL) {
+        return -1;
+    }
+
+    uint32_t port_index = STM_PORT(pin);
+    uint32_t pin_index  = STM_PIN(pin);
+    uint32_t irq_index  = pin_lines_desc[pin_index].irq_index;
+    uint32_t vector     = get_irq_vector(irq_index);
+
+    if (vector == 0 || direct_lines[pin_index].handler != NULL ||
+        (channels[irq_index].pin_mask & (1 << pin_lines_desc[pin_index].gpio_idx))) {
+        return -1;
+    }
+
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+
+    for (uint32_t line = 0; line < 16; line++) {
+        if (pin_lines_desc[line].irq_index == irq_index) {
+            irq_line_mask[irq_index] |= 1 << line;
+        }
+    }
+
+    direct_lines[pin_index].gpio    = Set_GPIO_Clock(port_index);
+    direct_lines[pin_index].pin     = 1 << pin_index;
+    direct_lines[pin_index].context = context;
+    direct_lines[pin_index].handler = handler;
+
+    uint32_t temp = SYSCFG->EXTICR[pin_index >> 2];
+    CLEAR_BIT(temp, (0x0FU) << (4U * (pin_index & 0x03U)));
+    SET_BIT(temp, port_index << (4U * (pin_index & 0x03U)));
+    SYSCFG->EXTICR[pin_index >> 2] = temp;
+
+    if (rise) {
+        LL_EXTI_EnableRisingTrig_0_31(1 << pin_index);
+    }
+    if (fall) {
+        LL_EXTI_EnableFallingTrig_0_31(1 << pin_index);
+    }
+
+    __HAL_GPIO_EXTI_CLEAR_FLAG(1 << pin_index);
+    direct_line_mask[irq_index] |= 1 << pin_index;
+    LL_EXTI_EnableIT_0_31(1 << pin_index);
+
+    NVIC_SetVector(pin_lines_desc[pin_index].irq_n, vector);
+    NVIC_EnableIRQ(pin_lines_desc[pin_index].irq_n);
+
+    return 0;
+}
+
+void gpio_irq_direct_unbind(PinName pin)
+{
+    if (pin == NC) {
+        return;
+    }
+
+    uint32_t pin_index = STM_PIN(pin);
+    uint32_t irq_index = pin_lines_desc[pin_index].irq_index;
+
+    LL_EXTI_DisableIT_0_31(1 << pin_index);
+    LL_EXTI_DisableRisingTrig_0_31(1 << pin_index);
+    LL_EXTI_DisableFallingTrig_0_31(1 << pin_index);
+
+    direct_line_mask[irq_index] &= ~(1 << pin_index);
+    direct_lines[pin_index].handler = NULL;
+}
+
 void gpio_irq_free(gpio_irq_t *obj)
 {
     uint32_t gpio_idx = pin_lines_desc[STM_PIN(obj->pin)].gpio_idx;
@@ -0,0 +1,39 @@
+/* EXTI lines bound straight to a handler
+ *
+ * A bound line is served at the top of the EXTI interrupt, before the
+ * InterruptIn dispatch: its handler is called with the context it was bound
+ * with and the pin level read right after the flag is cleared, without the
+ * scan of registered pins or the edge lookup. The pin must already be an
+ * input. Lines without a bound handler keep going to InterruptIn, but one
+ * line (pin number) can only be used by one of the two.
+ */
+#ifndef MBED_GPIO_IRQ_DIRECT_H
+#define MBED_GPIO_IRQ_DIRECT_H
+
+#include "PinNames.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*gpio_irq_direct_handler)(void *context, int level);
+
+/** Bind a handler to the EXTI line of a pin and enable it
+ * @param pin     The GPIO pin name
+ * @param handler Called from the interrupt on every selected edge
+ * @param context Passed back to the handler
+ * @param rise    Interrupt on rising edges
+ * @param fall    Interrupt on falling edges
+ * @return -1 if pin is NC or its line is already bound, 0 otherwise
+ */
+int gpio_irq_direct_bind(PinName pin, gpio_irq_direct_handler handler, void *context, int rise, int fall);
+
+/** Disable the EXTI line of a pin and release it
+ */
+void gpio_irq_direct_unbind(PinName pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef ADC_SCANNER_H
+#define ADC_SCANNER_H
+
+/* Background acquisition of every analog input of the board.
+ *
+ * The ADC converts its channels in a continuous scan and DMA1 channel 1
+ * copies the conversions into a circular buffer. Each half of the buffer is
+ * summed into per-channel accumulators by the DMA interrupt, and every
+ * ADC_SCANNER_OVERSAMPLING scans the sums become the channel results: 256
+ * conversions decimated to a 16 bit value, 4 bits more resolution and 16x less
+ * noise than a single conversion. A result is read in constant time and never
+ * waits for a conversion.
+ *
+ * Conversions take 21 us at the longest sample time, so with three inputs a
+ * new result comes every 16 ms. The scanner owns the ADC, AnalogIn must not be
+ * used alongside it.
+ */
+
+#include "mbed.h"
+
+#define ADC_SCANNER_MAX_CHANNELS    8
+#define ADC_SCANNER_OVERSAMPLING    256
+#define ADC_SCANNER_BUFFER_SCANS    32      // Scans summed per DMA interrupt, times 2
+
+class AdcScanner {
+
+public:
+
+    typedef enum {
+        channelTemperature = 16,
+        channelVrefint     = 17
+    } t_internalChannel;
+
+    AdcScanner();
+
+    /** Add an analog pin, before start()
+     *
+     * @return Index of the input, -1 if it cannot be added
+     */
+    int addPin(PinName pin);
+
+    /** Add the MCU temperature sensor or the internal reference, before start()
+     */
+    int addInternal(t_internalChannel channel);
+
+    /** Start the continuous conversions
+     */
+    mbed_error_status_t start(void);
+
+    /** @return Latest oversampled result, 0 - 0xFFFF like AnalogIn::read_u16()
+     */
+    uint16_t read_u16(int index);
+
+    /** @return Latest oversampled result, 0.0 - 1.0 like AnalogIn::read()
+     */
+    float read(int index);
+
+    /** @return Latest result in millivolts, corrected for the supply if the internal reference was added
+     */
+    uint32_t readMillivolts(int index);
+
+    /** @return MCU temperature in degrees C, needs both internal channels
+     */
+    float readMcuTemperature(void);
+
+    /** @return Number of results produced per input since start()
+     */
+    uint32_t getResultCount(void);
+
+private:
+
+    static void dmaIrqHandler(void);
+    void accumulate(const uint16_t *p_samples);
+    int addChannel(uint8_t channel);
+    int findChannel(uint8_t channel);
+
+    static AdcScanner *s_p_instance;
+
+    uint8_t m_channels[ADC_SCANNER_MAX_CHANNELS];   // In the order added
+    uint8_t m_slots[ADC_SCANNER_MAX_CHANNELS];      // Position of each in a scan
+    uint8_t m_channelCount;
+    bool m_isRunning;
+
+    uint16_t *m_p_buffer;
+    uint32_t m_sums[ADC_SCANNER_MAX_CHANNELS];      // By scan position
+    uint32_t m_scans;
+    volatile uint16_t m_results[ADC_SCANNER_MAX_CHANNELS];
+    volatile uint32_t m_resultCount;
+
+};
+
+#endif // ADC_SCANNER_H
@@ -0,0 +1,201 @@
+/* Background acquisition of every analog input of the board.
+ */
+
+#include "AdcScanner.h"
+#include "pinmap.h"
+#include "PeripheralPins.h"
+
+#define SAMPLE_TIME         0x7     // 239.5 ADC clocks, the sensors are high impedance
+#define RESULT_SHIFT        4       // 256 12 bit conversions summed to 20 bits, kept as 16
+#define ADC_FULL_SCALE      0xFFFF
+#define VREFINT_CAL         (*(const uint16_t *)0x1FFFF7BA)     // At 3.3 V, 12 bit
+#define TS_CAL1             (*(const uint16_t *)0x1FFFF7B8)     // At 30 C
+#define TS_CAL2             (*(const uint16_t *)0x1FFFF7C2)     // At 110 C
+#define CAL_MILLIVOLTS      3300
+
+AdcScanner *AdcScanner::s_p_instance = NULL;
+
+AdcScanner::AdcScanner() :
+        m_channelCount(0), m_isRunning(false), m_p_buffer(NULL), m_scans(0), m_resultCount(0) {
+
+    memset(m_sums, 0, sizeof(m_sums));
+    memset((void *)m_results, 0, sizeof(m_results));
+}
+
+int AdcScanner::addPin(PinName pin) {
+    if (pinmap_peripheral(pin, PinMap_ADC) != ADC_1) {
+        return -1;
+    }
+
+    int index = addChannel(STM_PIN_CHANNEL(pinmap_function(pin, PinMap_ADC)));
+
+    if (index >= 0) {
+        pinmap_pinout(pin, PinMap_ADC);
+    }
+
+    return index;
+}
+
+int AdcScanner::addInternal(t_internalChannel channel) {
+    return addChannel(channel);
+}
+
+mbed_error_status_t AdcScanner::start(void) {
+    if (m_isRunning || m_channelCount == 0 || s_p_instance != NULL) {
+        return MBED_ERROR_INVALID_OPERATION;
+    }
+
+    // The ADC converts the selected channels lowest first
+    uint32_t channelMask = 0;
+
+    for (uint8_t i = 0; i < m_channelCount; i++) {
+        channelMask |= 1 << m_channels[i];
+    }
+
+    for (uint8_t i = 0; i < m_channelCount; i++) {
+        m_slots[i] = __builtin_popcount(channelMask & ((1 << m_channels[i]) - 1));
+    }
+
+    m_p_buffer   = new uint16_t[2 * ADC_SCANNER_BUFFER_SCANS * m_channelCount];
+    s_p_instance = this;
+    m_isRunning  = true;
+
+    RCC->APB2ENR |= RCC_APB2ENR_ADCEN;
+    RCC->AHBENR  |= RCC_AHBENR_DMA1EN;
+
+    // PCLK / 4, 12 MHz, calibrated while disabled
+    ADC1->CR &= ~ADC_CR_ADEN;
+    ADC1->CFGR2 = ADC_CFGR2_CKMODE_1;
+    ADC1->CR |= ADC_CR_ADCAL;
+    while (ADC1->CR & ADC_CR_ADCAL) {}
+
+    if (channelMask & (1 << channelTemperature)) {
+        ADC->CCR |= ADC_CCR_TSEN;
+    }
+    if (channelMask & (1 << channelVrefint)) {
+        ADC->CCR |= ADC_CCR_VREFEN;
+    }
+
+    ADC1->CFGR1  = ADC_CFGR1_CONT | ADC_CFGR1_DMAEN | ADC_CFGR1_DMACFG | ADC_CFGR1_OVRMOD;
+    ADC1->SMPR   = SAMPLE_TIME;
+    ADC1->CHSELR = channelMask;
+
+    // Halfwords from the data register into the circular buffer, an interrupt at each half
+    DMA1->CSELR = (DMA1->CSELR & ~DMA_CSELR_C1S) | DMA1_CSELR_CH1_ADC;
+    DMA1_Channel1->CCR   = 0;
+    DMA1_Channel1->CPAR  = (uint32_t)&ADC1->DR;
+    DMA1_Channel1->CMAR  = (uint32_t)m_p_buffer;
+    DMA1_Channel1->CNDTR = 2 * ADC_SCANNER_BUFFER_SCANS * m_channelCount;
+    DMA1_Channel1->CCR   = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 | DMA_CCR_HTIE |
+                           DMA_CCR_TCIE | DMA_CCR_EN;
+
+    NVIC_SetVector(DMA1_Ch1_IRQn, (uint32_t)&AdcScanner::dmaIrqHandler);
+    NVIC_EnableIRQ(DMA1_Ch1_IRQn);
+
+    ADC1->ISR = ADC_ISR_ADRDY;
+    ADC1->CR |= ADC_CR_ADEN;
+    while (!(ADC1->ISR & ADC_ISR_ADRDY)) {}
+
+    ADC1->CR |= ADC_CR_ADSTART;
+
+    return MBED_SUCCESS;
+}
+
+uint16_t AdcScanner::read_u16(int index) {
+    if (index < 0 || index >= m_channelCount) {
+        return 0;
+    }
+
+    return m_results[m_slots[index]];
+}
+
+float AdcScanner::read(int index) {
+    return read_u16(index) / (float)ADC_FULL_SCALE;
+}
+
+uint32_t AdcScanner::readMillivolts(int index) {
+    uint32_t supplyMillivolts = CAL_MILLIVOLTS;
+    int vrefint = findChannel(channelVrefint);
+
+    if (vrefint >= 0 && read_u16(vrefint) > 0) {
+        supplyMillivolts = (uint32_t)CAL_MILLIVOLTS * (VREFINT_CAL << RESULT_SHIFT) / read_u16(vrefint);
+    }
+
+    return (uint32_t)read_u16(index) * supplyMillivolts / ADC_FULL_SCALE;
+}
+
+float AdcScanner::readMcuTemperature(void) {
+    int temperature = findChannel(channelTemperature);
+
+    if (temperature < 0) {
+        return 0.0f;
+    }
+
+    // The calibration values were taken with a 3.3 V supply
+    float atCalSupply = readMillivolts(temperature) * 4095.0f / CAL_MILLIVOLTS;
+
+    return 30.0f + (atCalSupply - TS_CAL1) * (110.0f - 30.0f) / (TS_CAL2 - TS_CAL1);
+}
+
+uint32_t AdcScanner::getResultCount(void) {
+    return m_resultCount;
+}
+
+void AdcScanner::dmaIrqHandler(void) {
+    AdcScanner *p_scanner = s_p_instance;
+    uint32_t isr = DMA1->ISR;
+    uint32_t halfSize = ADC_SCANNER_BUFFER_SCANS * p_scanner->m_channelCount;
+
+    DMA1->IFCR = DMA_IFCR_CGIF1;
+
+    if (isr & DMA_ISR_HTIF1) {
+        p_scanner->accumulate(p_scanner->m_p_buffer);
+    }
+    if (isr & DMA_ISR_TCIF1) {
+        p_scanner->accumulate(p_scanner->m_p_buffer + halfSize);
+    }
+}
+
+// Interrupt context
+void AdcScanner::accumulate(const uint16_t *p_samples) {
+    for (uint32_t scan = 0; scan < ADC_SCANNER_BUFFER_SCANS; scan++) {
+        for (uint8_t slot = 0; slot < m_channelCount; slot++) {
+            m_sums[slot] += *p_samples++;
+        }
+    }
+
+    m_scans += ADC_SCANNER_BUFFER_SCANS;
+
+    if (m_scans < ADC_SCANNER_OVERSAMPLING) {
+        return;
+    }
+
+    for (uint8_t slot = 0; slot < m_channelCount; slot++) {
+        m_results[slot] = m_sums[slot] >> RESULT_SHIFT;
+        m_sums[slot]    = 0;
+    }
+
+    m_scans = 0;
+    m_resultCount++;
+}
+
+int AdcScanner::addChannel(uint8_t channel) {
+    MBED_ASSERT_WARN(!m_isRunning);
+
+    if (m_isRunning || m_channelCount >= ADC_SCANNER_MAX_CHANNELS || findChannel(channel) >= 0) {
+        return -1;
+    }
+
+    m_channels[m_channelCount] = channel;
+    return m_channelCount++;
+}
+
+int AdcScanner::findChannel(uint8_t channel) {
+    for (uint8_t i = 0; i < m_channelCount; i++) {
+        if (m_channels[i] == channel) {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -2,12 +2,19 @@
 #define ARM_JOINT_CONTROLLER_H
 
 /* Controller for the arm base, shoulder and elbow
+ *
+ * The config is referenced rather than copied, so it must outlive the
+ * controller. Declared constexpr it stays in flash, its derived fields are
+ * worked out by the compiler and it can be checked with isValidConfig() in a
+ * static_assert.
  */
 
 #include "mbed.h"
 #include "Motor.h"
 #include "PwmIn.h"
 #include "PID.h"
+#include "LoopCapture.h"
+#include "MicrosecondClock.h"
 #include "PinNames.h"
 
 // CLASS
@@ -34,6 +41,9 @@ public:
         float minInputVelocityDegPerSec, maxInputVelocityDegPerSec;
         float minOutputMotorDutyCycle, maxOutputMotorDutyCycle;
 
+        // Derived, leave out of the initialiser
+        float degreesPerDutyCycle = encoder.inverted ? -360.0f : 360.0f;
+
     } t_jointConfig;
 
     typedef enum t_controlMode {
@@ -43,7 +53,51 @@ public:
 
     } t_jointControlMode;
 
-    explicit ArmJointController(t_jointConfig armJointConfig, t_jointControlMode controlMode = motorDutyCycle);
+    explicit ArmJointController(const t_jointConfig &armJointConfig, t_jointControlMode controlMode = motorDutyCycle);
+
+    /** @return false if a limit is out of range or a minimum is above its maximum
+     */
+    static constexpr bool isValidConfig(const t_jointConfig &config) {
+        return config.encoder.zeroAngleDutyCycle > 0.0f && config.encoder.zeroAngleDutyCycle < 1.0f &&
+               config.encoder.minAngleDegrees < config.encoder.maxAngleDegrees &&
+               config.encoder.minAngleDegrees >= -180.0f && config.encoder.maxAngleDegrees <= 180.0f &&
+               config.minInputVelocityDegPerSec < config.maxInputVelocityDegPerSec &&
+               config.minOutputMotorDutyCycle < config.maxOutputMotorDutyCycle &&
+               config.minOutputMotorDutyCycle >= -1.0f && config.maxOutputMotorDutyCycle <= 1.0f &&
+               config.velocityPID.interval > 0.0f && config.positionPID.interval > 0.0f;
+    }
+
+    // Control law of a joint, shared with JointBank
+
+    static float toAngleDegrees(const t_jointConfig &config, float encoderDutyCycle);
+
+    /** @return dutyCycle, or 0 if it would drive into a pressed limit switch
+     */
+    static float limitDutyCycle(float dutyCycle, bool isAtMin, bool isAtMax);
+
+    /** @return velocityDegreesPerSec, or 0 if it would drive past a limit switch or angle limit
+     */
+    static float limitVelocity(const t_jointConfig &config, float velocityDegreesPerSec, float angleDegrees,
+                               bool isAtMin, bool isAtMax);
+
+    static float limitAngle(const t_jointConfig &config, float angleDegrees);
+
+    static void initializePIDControllers(const t_jointConfig &config, PID &velocityPIDController, PID &positionPIDController);
+
+    /** Reset the PID a control mode starts with
+     *
+     * @return MBED_ERROR_INVALID_ARGUMENT for an unknown control mode
+     */
+    static mbed_error_status_t resetPIDController(t_jointControlMode controlMode, PID &velocityPIDController, PID &positionPIDController);
+
+    /** @return Motor duty cycle, 0 with the PID held reset while the set point is 0
+     */
+    static float computeVelocityPID(PID &velocityPIDController, float velocityDegreesPerSec, uint32_t intervalUs);
+
+    static float computePositionPID(PID &positionPIDController, float angleDegrees, uint32_t intervalUs);
+
+    static void recordCapture(LoopCapture &capture, t_jointControlMode controlMode, PID &velocityPIDController, PID &positionPIDController,
+                              float processValue, float dutyCycle, uint32_t intervalUs);
 
     mbed_error_status_t setControlMode(t_jointControlMode controlMode);
 
@@ -61,14 +115,20 @@ public:
 
     float getAngleVelocityDegreesPerSec();
 
+    PID &getVelocityPIDController();
+
+    PID &getPositionPIDController();
+
+    LoopCapture &getCapture();
+
+    Motor &getMotor();
+
     void update();
 
 private:
 
-    void initializePIDControllers(void);
-
     t_jointControlMode m_controlMode;
-    t_jointConfig m_armJointConfig;
+    const t_jointConfig &m_armJointConfig;
 
     Motor m_motor;
     PwmIn m_encoder;
@@ -77,9 +137,9 @@ private:
     PID m_velocityPIDController;
     PID m_positionPIDController;
 
-    float m_encoderInversionMultiplier;
+    LoopCapture m_capture;
 
-    Timer timer;
+    uint32_t m_lastUpdateUs;
 
 };
 
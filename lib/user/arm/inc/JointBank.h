@@ -0,0 +1,316 @@
+#ifndef JOINT_BANK_H
+#define JOINT_BANK_H
+
+/* Controller for a bank of arm joints updated together
+ *
+ * Does the work of one ArmJointController per joint, with the state of every
+ * joint kept side by side in arrays. update() reads the clock once, so every
+ * joint's PID sees the same interval, samples all the encoders, runs all the
+ * PIDs and only then writes the motors, back to back.
+ *
+ * The joints take the same configs as ArmJointController, and follow its
+ * control law. The configs are referenced rather than copied, so they must
+ * outlive the bank; declare them constexpr.
+ */
+
+#include "mbed.h"
+#include "Motor.h"
+#include "PwmIn.h"
+#include "PID.h"
+#include "LoopCapture.h"
+#include "MicrosecondClock.h"
+#include "ArmJointController.h"
+#include <algorithm>
+#include <utility>
+
+// CLASS
+
+template <size_t N>
+class JointBank {
+
+public:
+
+    // TYPES
+
+    typedef ArmJointController::t_jointConfig t_jointConfig;
+    typedef ArmJointController::t_jointControlMode t_jointControlMode;
+
+    /**
+     * @param p_configs Config of each joint, the joint index is the position in the array
+     */
+    explicit JointBank(const t_jointConfig *const (&p_configs)[N], t_jointControlMode controlMode = ArmJointController::motorDutyCycle);
+
+    // Joints are numbered from 0, a joint past the end of the bank is an invalid argument
+
+    mbed_error_status_t setControlMode(size_t joint, t_jointControlMode controlMode);
+
+    /** Applied to the motor straight away, so a stop does not wait for the next update()
+     */
+    mbed_error_status_t setMotorDutyCycle(size_t joint, float dutyCycle);
+
+    mbed_error_status_t setVelocityDegreesPerSec(size_t joint, float velocityDegreesPerSec);
+
+    mbed_error_status_t setAngleDegrees(size_t joint, float angleDegrees);
+
+    t_jointControlMode getControlMode(size_t joint);
+
+    float getMotorDutyCycle(size_t joint);
+
+    float getAngleDegrees(size_t joint);
+
+    float getAngleVelocityDegreesPerSec(size_t joint);
+
+    PID &getVelocityPIDController(size_t joint);
+
+    PID &getPositionPIDController(size_t joint);
+
+    LoopCapture &getCapture(size_t joint);
+
+    Motor &getMotor(size_t joint);
+
+    /** Update every joint on one timestamp
+     */
+    void update(void);
+
+private:
+
+    template <size_t... I>
+    JointBank(const t_jointConfig *const (&p_configs)[N], t_jointControlMode controlMode, std::index_sequence<I...>);
+
+    const t_jointConfig *m_p_configs[N];
+
+    Motor m_motors[N];
+    PwmIn m_encoders[N];
+    DigitalIn m_limSwitchMin[N], m_limSwitchMax[N];
+
+    PID m_velocityPIDControllers[N];
+    PID m_positionPIDControllers[N];
+
+    LoopCapture m_captures[N];
+
+    t_jointControlMode m_controlModes[N];
+
+    // Commanded in motorDutyCycle mode, computed by the PIDs otherwise
+    float m_dutyCycles[N];
+
+    // Sampled by update(), degrees or degrees per second depending on the control mode
+    float m_processValues[N];
+
+    uint32_t m_lastUpdateUs;
+
+};
+
+template <size_t N>
+JointBank<N>::JointBank(const t_jointConfig *const (&p_configs)[N], t_jointControlMode controlMode) :
+        JointBank(p_configs, controlMode, std::make_index_sequence<N>()) {}
+
+template <size_t N>
+template <size_t... I>
+JointBank<N>::JointBank(const t_jointConfig *const (&p_configs)[N], t_jointControlMode controlMode, std::index_sequence<I...>) :
+        m_p_configs{ p_configs[I]... },
+        m_motors{ { p_configs[I]->motor.pwmPin, p_configs[I]->motor.dirPin, p_configs[I]->motor.inverted }... },
+        m_encoders{ { p_configs[I]->encoder.pwmPin }... },
+        m_limSwitchMin{ { p_configs[I]->limSwitchMinPin }... },
+        m_limSwitchMax{ { p_configs[I]->limSwitchMaxPin }... },
+        m_velocityPIDControllers{ { p_configs[I]->velocityPID.P, p_configs[I]->velocityPID.I, p_configs[I]->velocityPID.D, p_configs[I]->velocityPID.interval }... },
+        m_positionPIDControllers{ { p_configs[I]->positionPID.P, p_configs[I]->positionPID.I, p_configs[I]->positionPID.D, p_configs[I]->positionPID.interval }... },
+        m_captures{ LoopCapture(((void)I, 0.01f))... } { // 0.01 degrees or degrees per second per LSB
+
+    for (size_t i = 0; i < N; i++) {
+        m_controlModes[i] = controlMode;
+        m_dutyCycles[i]   = 0.0f;
+        m_processValues[i] = 0.0f;
+
+        ArmJointController::initializePIDControllers(*m_p_configs[i], m_velocityPIDControllers[i], m_positionPIDControllers[i]);
+    }
+
+    MicrosecondClock::init();
+    m_lastUpdateUs = MicrosecondClock::read();
+}
+
+template <size_t N>
+typename JointBank<N>::t_jointControlMode JointBank<N>::getControlMode(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return m_controlModes[joint];
+}
+
+template <size_t N>
+float JointBank<N>::getAngleDegrees(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return ArmJointController::toAngleDegrees(*m_p_configs[joint], m_encoders[joint].avgDutyCycle());
+}
+
+template <size_t N>
+float JointBank<N>::getAngleVelocityDegreesPerSec(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return m_p_configs[joint]->degreesPerDutyCycle * m_encoders[joint].avgDutyCycleVelocity();
+}
+
+template <size_t N>
+mbed_error_status_t JointBank<N>::setControlMode(size_t joint, t_jointControlMode controlMode) {
+    if (joint >= N) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    mbed_error_status_t status = ArmJointController::resetPIDController(controlMode, m_velocityPIDControllers[joint],
+                                                                         m_positionPIDControllers[joint]);
+
+    if (status != MBED_SUCCESS) {
+        return status;
+    }
+
+    m_controlModes[joint] = controlMode;
+
+    switch (controlMode) {
+        case ArmJointController::motorDutyCycle:
+            MBED_WARN_ON_ERROR(setMotorDutyCycle(joint, 0.0f));
+            break;
+
+        case ArmJointController::velocityPID:
+            MBED_WARN_ON_ERROR(setVelocityDegreesPerSec(joint, 0.0f));
+            break;
+
+        case ArmJointController::positionPID:
+            MBED_WARN_ON_ERROR(setAngleDegrees(joint, getAngleDegrees(joint)));
+            break;
+    }
+
+    return MBED_SUCCESS;
+}
+
+template <size_t N>
+mbed_error_status_t JointBank<N>::setMotorDutyCycle(size_t joint, float dutyCycle) {
+    if (joint >= N) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (m_controlModes[joint] != ArmJointController::motorDutyCycle) {
+        return MBED_ERROR_INVALID_OPERATION;
+    }
+
+    m_dutyCycles[joint] = ArmJointController::limitDutyCycle(dutyCycle, m_limSwitchMin[joint] == 0, m_limSwitchMax[joint] == 0);
+    m_motors[joint].setDutyCycle(m_dutyCycles[joint]);
+
+    return MBED_SUCCESS;
+}
+
+template <size_t N>
+mbed_error_status_t JointBank<N>::setVelocityDegreesPerSec(size_t joint, float velocityDegreesPerSec) {
+    if (joint >= N) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (m_controlModes[joint] != ArmJointController::velocityPID) {
+        return MBED_ERROR_INVALID_OPERATION;
+    }
+
+    m_velocityPIDControllers[joint].setSetPoint(ArmJointController::limitVelocity(*m_p_configs[joint], velocityDegreesPerSec,
+            getAngleDegrees(joint), m_limSwitchMin[joint] == 0, m_limSwitchMax[joint] == 0));
+
+    return MBED_SUCCESS;
+}
+
+template <size_t N>
+mbed_error_status_t JointBank<N>::setAngleDegrees(size_t joint, float angleDegrees) {
+    if (joint >= N) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (m_controlModes[joint] != ArmJointController::positionPID) {
+        return MBED_ERROR_INVALID_OPERATION;
+    }
+
+    m_positionPIDControllers[joint].setSetPoint(ArmJointController::limitAngle(*m_p_configs[joint], angleDegrees));
+
+    return MBED_SUCCESS;
+}
+
+template <size_t N>
+void JointBank<N>::update(void) {
+    uint32_t intervalUs = MicrosecondClock::lap(m_lastUpdateUs);
+
+    // Sample every joint before driving any of them
+    for (size_t i = 0; i < N; i++) {
+        switch (m_controlModes[i]) {
+            case ArmJointController::motorDutyCycle:
+                m_dutyCycles[i] = ArmJointController::limitDutyCycle(m_dutyCycles[i], m_limSwitchMin[i] == 0, m_limSwitchMax[i] == 0);
+                m_processValues[i] = getAngleDegrees(i);
+                break;
+
+            case ArmJointController::velocityPID:
+                m_processValues[i] = getAngleVelocityDegreesPerSec(i);
+                break;
+
+            case ArmJointController::positionPID:
+                m_processValues[i] = getAngleDegrees(i);
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < N; i++) {
+        switch (m_controlModes[i]) {
+            case ArmJointController::motorDutyCycle:
+                break;
+
+            case ArmJointController::velocityPID:
+                m_dutyCycles[i] = ArmJointController::computeVelocityPID(m_velocityPIDControllers[i], m_processValues[i], intervalUs);
+                break;
+
+            case ArmJointController::positionPID:
+                m_dutyCycles[i] = ArmJointController::computePositionPID(m_positionPIDControllers[i], m_processValues[i], intervalUs);
+                break;
+        }
+    }
+
+    int32_t rawDutyCycles[N];
+
+    for (size_t i = 0; i < N; i++) {
+        rawDutyCycles[i] = (int32_t)(max(min(m_dutyCycles[i], 1.0f), -1.0f) * MOTOR_DUTY_CYCLE_FULL_SCALE);
+    }
+
+    // Only the register writes are left, keep an interrupt from splitting them
+    core_util_critical_section_enter();
+
+    for (size_t i = 0; i < N; i++) {
+        m_motors[i].setDutyCycleRaw(rawDutyCycles[i]);
+    }
+
+    core_util_critical_section_exit();
+
+    for (size_t i = 0; i < N; i++) {
+        ArmJointController::recordCapture(m_captures[i], m_controlModes[i], m_velocityPIDControllers[i], m_positionPIDControllers[i],
+                                          m_processValues[i], m_motors[i].getDutyCycle(), intervalUs);
+    }
+}
+
+template <size_t N>
+float JointBank<N>::getMotorDutyCycle(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return m_motors[joint].getDutyCycle();
+}
+
+template <size_t N>
+PID &JointBank<N>::getVelocityPIDController(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return m_velocityPIDControllers[joint];
+}
+
+template <size_t N>
+PID &JointBank<N>::getPositionPIDController(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return m_positionPIDControllers[joint];
+}
+
+template <size_t N>
+LoopCapture &JointBank<N>::getCapture(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return m_captures[joint];
+}
+
+template <size_t N>
+Motor &JointBank<N>::getMotor(size_t joint) {
+    MBED_ASSERT(joint < N);
+    return m_motors[joint];
+}
+
+#endif // JOINT_BANK_H
@@ -5,25 +5,119 @@
 #include "Motor.h"
 #include "PwmIn.h"
 #include "PID.h"
+#include "LoopCapture.h"
+#include "MicrosecondClock.h"
 #include "PinNames.h"
 #include "ArmJointController.h"
+#include <algorithm>
 
-ArmJointController::ArmJointController(t_jointConfig armJointConfig, t_jointControlMode controlMode) :
+ArmJointController::ArmJointController(const t_jointConfig &armJointConfig, t_jointControlMode controlMode) :
         m_controlMode(controlMode), m_armJointConfig(armJointConfig), m_motor(armJointConfig.motor.pwmPin, armJointConfig.motor.dirPin,
         armJointConfig.motor.inverted), m_encoder(armJointConfig.encoder.pwmPin), m_limSwitchMin(armJointConfig.limSwitchMinPin), m_limSwitchMax(armJointConfig.limSwitchMaxPin),
         m_velocityPIDController(armJointConfig.velocityPID.P, armJointConfig.velocityPID.I, armJointConfig.velocityPID.D, armJointConfig.velocityPID.interval),
-        m_positionPIDController(armJointConfig.positionPID.P, armJointConfig.positionPID.I, armJointConfig.positionPID.D, armJointConfig.positionPID.interval) {
+        m_positionPIDController(armJointConfig.positionPID.P, armJointConfig.positionPID.I, armJointConfig.positionPID.D, armJointConfig.positionPID.interval),
+        m_capture(0.01f) { // 0.01 degrees or degrees per second per LSB
 
-    if (armJointConfig.encoder.inverted) {
-        m_encoderInversionMultiplier = -1;
+    initializePIDControllers(m_armJointConfig, m_velocityPIDController, m_positionPIDController);
+
+    MicrosecondClock::init();
+    m_lastUpdateUs = MicrosecondClock::read();
+
+}
+
+float ArmJointController::toAngleDegrees(const t_jointConfig &config, float encoderDutyCycle) {
+    return config.degreesPerDutyCycle * (encoderDutyCycle - config.encoder.zeroAngleDutyCycle);
+}
+
+float ArmJointController::limitDutyCycle(float dutyCycle, bool isAtMin, bool isAtMax) {
+    if ((isAtMin && dutyCycle < 0.0f) || (isAtMax && dutyCycle > 0.0f)) {
+        return 0.0f;
+    }
+
+    return dutyCycle;
+}
+
+float ArmJointController::limitVelocity(const t_jointConfig &config, float velocityDegreesPerSec, float angleDegrees,
+                                        bool isAtMin, bool isAtMax) {
+    return limitDutyCycle(velocityDegreesPerSec, isAtMin || angleDegrees <= config.encoder.minAngleDegrees,
+                          isAtMax || angleDegrees >= config.encoder.maxAngleDegrees);
+}
+
+float ArmJointController::limitAngle(const t_jointConfig &config, float angleDegrees) {
+    return min(max(angleDegrees, config.encoder.minAngleDegrees), config.encoder.maxAngleDegrees);
+}
+
+void ArmJointController::initializePIDControllers(const t_jointConfig &config, PID &velocityPIDController, PID &positionPIDController) {
+
+    // Configure velocity PID
+    velocityPIDController.setInputLimits(config.minInputVelocityDegPerSec, config.maxInputVelocityDegPerSec);
+    velocityPIDController.setOutputLimits(config.minOutputMotorDutyCycle, config.maxOutputMotorDutyCycle);
+    velocityPIDController.setBias(config.velocityPID.bias);
+    velocityPIDController.setMode(PID_AUTO_MODE);
+    velocityPIDController.setDeadZoneError(0.05);
+
+    // Configure position PID
+    positionPIDController.setInputLimits(config.encoder.minAngleDegrees, config.encoder.maxAngleDegrees);
+    positionPIDController.setOutputLimits(config.minOutputMotorDutyCycle, config.maxOutputMotorDutyCycle);
+    positionPIDController.setBias(config.positionPID.bias);
+    positionPIDController.setMode(PID_AUTO_MODE);
+    positionPIDController.setDeadZoneError(0.01);
+}
+
+mbed_error_status_t ArmJointController::resetPIDController(t_jointControlMode controlMode, PID &velocityPIDController, PID &positionPIDController) {
+    switch (controlMode) {
+        case motorDutyCycle:
+            break;
+
+        case velocityPID:
+            velocityPIDController.reset();
+            break;
+
+        case positionPID:
+            positionPIDController.reset();
+            break;
+
+        default:
+            return MBED_ERROR_INVALID_ARGUMENT;
     }
-    else {
-        m_encoderInversionMultiplier = 1;
+
+    return MBED_SUCCESS;
+}
+
+float ArmJointController::computeVelocityPID(PID &velocityPIDController, float velocityDegreesPerSec, uint32_t intervalUs) {
+    if (velocityPIDController.getSetPoint() == 0.0f) {
+        velocityPIDController.reset();
+        return 0.0f;
     }
 
-    initializePIDControllers();
-    timer.start();
+    velocityPIDController.setIntervalUs(intervalUs);
+    velocityPIDController.setProcessValue(velocityDegreesPerSec);
+
+    return velocityPIDController.compute();
+}
+
+float ArmJointController::computePositionPID(PID &positionPIDController, float angleDegrees, uint32_t intervalUs) {
+    positionPIDController.setIntervalUs(intervalUs);
+    positionPIDController.setProcessValue(angleDegrees);
 
+    return positionPIDController.compute();
+}
+
+void ArmJointController::recordCapture(LoopCapture &capture, t_jointControlMode controlMode, PID &velocityPIDController, PID &positionPIDController,
+                                       float processValue, float dutyCycle, uint32_t intervalUs) {
+    switch (controlMode) {
+        case motorDutyCycle:
+            capture.recordOpenLoop(processValue, dutyCycle, intervalUs);
+            break;
+
+        case velocityPID:
+            capture.record(velocityPIDController.getSetPoint(), processValue, dutyCycle, intervalUs);
+            break;
+
+        case positionPID:
+            capture.record(positionPIDController.getSetPoint(), processValue, dutyCycle, intervalUs);
+            break;
+    }
 }
 
 ArmJointController::t_jointControlMode ArmJointController::getControlMode() {
@@ -31,39 +125,37 @@ ArmJointController::t_jointControlMode ArmJointController::getControlMode() {
 }
 
 float ArmJointController::getAngleDegrees() {
-    return m_encoderInversionMultiplier * 360.0f * (m_encoder.avgDutyCycle() - m_armJointConfig.encoder.zeroAngleDutyCycle);
+    return toAngleDegrees(m_armJointConfig, m_encoder.avgDutyCycle());
 }
 
 float ArmJointController::getAngleVelocityDegreesPerSec() {
-    return m_encoderInversionMultiplier * 360.0f * m_encoder.avgDutyCycleVelocity();
+    return m_armJointConfig.degreesPerDutyCycle * m_encoder.avgDutyCycleVelocity();
 }
 
 mbed_error_status_t ArmJointController::setControlMode(t_jointControlMode controlMode) {
+    mbed_error_status_t status = resetPIDController(controlMode, m_velocityPIDController, m_positionPIDController);
 
-    switch (controlMode) {
+    if (status != MBED_SUCCESS) {
+        return status;
+    }
 
+    m_controlMode = controlMode;
+
+    switch (controlMode) {
         case motorDutyCycle:
-            m_controlMode = motorDutyCycle;
             MBED_WARN_ON_ERROR(setMotorDutyCycle(0.0f));
             break;
 
         case velocityPID:
-            m_velocityPIDController.reset();
-            m_controlMode = velocityPID;
             MBED_WARN_ON_ERROR(setVelocityDegreesPerSec(0.0f));
             break;
 
         case positionPID:
-            m_positionPIDController.reset();
-            m_controlMode = positionPID;
             MBED_WARN_ON_ERROR(setAngleDegrees(getAngleDegrees()));
             break;
-
-        default:
-            return MBED_ERROR_INVALID_ARGUMENT;
     }
 
-    timer.reset();
+    m_lastUpdateUs = MicrosecondClock::read();
 
     return MBED_SUCCESS;
 }
@@ -73,12 +165,7 @@ mbed_error_status_t ArmJointController::setMotorDutyCycle(float dutyCycle) {
         return MBED_ERROR_INVALID_OPERATION;
     }
 
-    if ((m_limSwitchMin == 0 && dutyCycle < 0.0f) ||
-        (m_limSwitchMax == 0 && dutyCycle > 0.0f)) {
-        dutyCycle = 0.0f;
-    }
-
-    m_motor.setDutyCycle(dutyCycle);
+    m_motor.setDutyCycle(limitDutyCycle(dutyCycle, m_limSwitchMin == 0, m_limSwitchMax == 0));
 
     return MBED_SUCCESS;
 }
@@ -88,12 +175,8 @@ mbed_error_status_t ArmJointController::setVelocityDegreesPerSec(float velocityD
         return MBED_ERROR_INVALID_OPERATION;
     }
 
-    if (((m_limSwitchMin == 0 || getAngleDegrees() <= m_armJointConfig.encoder.minAngleDegrees) && velocityDegreesPerSec < 0.0f) ||
-        ((m_limSwitchMax == 0 || getAngleDegrees() >= m_armJointConfig.encoder.maxAngleDegrees) && velocityDegreesPerSec > 0.0f)) {
-        velocityDegreesPerSec = 0.0f;
-    }
-
-    m_velocityPIDController.setSetPoint(velocityDegreesPerSec);
+    m_velocityPIDController.setSetPoint(limitVelocity(m_armJointConfig, velocityDegreesPerSec, getAngleDegrees(),
+                                                      m_limSwitchMin == 0, m_limSwitchMax == 0));
 
     return MBED_SUCCESS;
 }
@@ -103,72 +186,58 @@ mbed_error_status_t ArmJointController::setAngleDegrees(float angleDegrees) {
         return MBED_ERROR_INVALID_OPERATION;
     }
 
-    if (angleDegrees <= m_armJointConfig.encoder.minAngleDegrees) {
-        angleDegrees = m_armJointConfig.encoder.minAngleDegrees;
-    }
-    else if (angleDegrees >= m_armJointConfig.encoder.maxAngleDegrees) {
-        angleDegrees = m_armJointConfig.encoder.maxAngleDegrees;
-    }
-
-    m_positionPIDController.setSetPoint(angleDegrees);
+    m_positionPIDController.setSetPoint(limitAngle(m_armJointConfig, angleDegrees));
 
     return MBED_SUCCESS;
 }
 
 void ArmJointController::update() {
-    float interval = timer.read();
-    timer.reset();
+    uint32_t intervalUs = MicrosecondClock::lap(m_lastUpdateUs);
+    float processValue = 0.0f;
 
     switch (m_controlMode) {
-        case motorDutyCycle:
-            if ((m_limSwitchMin == 0 && m_motor.getDutyCycle() < 0.0f) ||
-                (m_limSwitchMax == 0 && m_motor.getDutyCycle() > 0.0f)) {
+        case motorDutyCycle: {
+            float dutyCycle = m_motor.getDutyCycle();
+
+            if (limitDutyCycle(dutyCycle, m_limSwitchMin == 0, m_limSwitchMax == 0) != dutyCycle) {
                 m_motor.setDutyCycle(0.0f);
             }
 
+            processValue = getAngleDegrees();
             break;
+        }
 
         case velocityPID:
-
-            if (m_velocityPIDController.getSetPoint() == 0.0f) {
-                m_velocityPIDController.reset();
-                m_motor.setDutyCycle(0.0f);
-            }
-            else {
-                m_velocityPIDController.setInterval(interval);
-                m_velocityPIDController.setProcessValue(getAngleVelocityDegreesPerSec());
-                m_motor.setDutyCycle(m_velocityPIDController.compute());
-            }
-
+            processValue = getAngleVelocityDegreesPerSec();
+            m_motor.setDutyCycle(computeVelocityPID(m_velocityPIDController, processValue, intervalUs));
             break;
 
         case positionPID:
-            m_positionPIDController.setInterval(interval);
-            m_positionPIDController.setProcessValue(getAngleDegrees());
-            m_motor.setDutyCycle(m_positionPIDController.compute());
-
+            processValue = getAngleDegrees();
+            m_motor.setDutyCycle(computePositionPID(m_positionPIDController, processValue, intervalUs));
             break;
     }
+
+    recordCapture(m_capture, m_controlMode, m_velocityPIDController, m_positionPIDController, processValue,
+                  m_motor.getDutyCycle(), intervalUs);
 }
 
-void ArmJointController::initializePIDControllers(void) {
+float ArmJointController::getMotorDutyCycle() {
+    return m_motor.getDutyCycle();
+}
 
-    // Configure velocity PID
-    m_velocityPIDController.setInputLimits(m_armJointConfig.minInputVelocityDegPerSec, m_armJointConfig.maxInputVelocityDegPerSec);
-    m_velocityPIDController.setOutputLimits(m_armJointConfig.minOutputMotorDutyCycle, m_armJointConfig.maxOutputMotorDutyCycle);
-    m_velocityPIDController.setBias(m_armJointConfig.velocityPID.bias);
-    m_velocityPIDController.setMode(PID_AUTO_MODE);
-    m_velocityPIDController.setDeadZoneError(0.05);
+PID &ArmJointController::getVelocityPIDController() {
+    return m_velocityPIDController;
+}
 
-    // Configure position PID
-    m_positionPIDController.setInputLimits(m_armJointConfig.encoder.minAngleDegrees, m_armJointConfig.encoder.maxAngleDegrees);
-    m_positionPIDController.setOutputLimits(m_armJointConfig.minOutputMotorDutyCycle, m_armJointConfig.maxOutputMotorDutyCycle);
-    m_positionPIDController.setBias(m_armJointConfig.positionPID.bias);
-    m_positionPIDController.setMode(PID_AUTO_MODE);
-    m_velocityPIDController.setDeadZoneError(0.01);
+PID &ArmJointController::getPositionPIDController() {
+    return m_positionPIDController;
 }
 
-float ArmJointController::getMotorDutyCycle() {
-    return m_motor.getDutyCycle();
+LoopCapture &ArmJointController::getCapture() {
+    return m_capture;
 }
 
+Motor &ArmJointController::getMotor() {
+    return m_motor;
+}
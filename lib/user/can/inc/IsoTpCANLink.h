@@ -0,0 +1,47 @@
+#ifndef ISO_TP_CAN_LINK_H
+#define ISO_TP_CAN_LINK_H
+
+/* ISO-TP link (see IsoTpLink.h) running on the board's CAN peripheral.
+ *
+ * Frames are only written into free transmit mailboxes, a transfer that finds
+ * them full continues on the next poll(), so large payloads never hold up the
+ * main loop.
+ */
+
+#include "mbed.h"
+#include "IsoTpLink.h"
+
+class IsoTpCANLink : public IsoTpLink::FrameSink {
+
+public:
+
+    IsoTpCANLink(CAN &can, uint32_t txId, uint32_t rxId, uint8_t blockSize = 0, uint32_t separationTimeUs = 0);
+
+    /** Start sending a payload, the buffer must stay untouched until isSending() is false
+     *
+     * @return false if a transmission is in progress or the payload is too large
+     */
+    bool send(const uint8_t *payload, uint16_t size);
+
+    /** Handle a message if it belongs to the link
+     *
+     * @return true if the message was consumed
+     */
+    bool handleCANMsg(CANMessage &msg);
+
+    /** Send the next frames of a transfer in progress, call every main loop iteration
+     */
+    void poll(void);
+
+    IsoTpLink &getLink(void);
+
+    virtual bool sendFrame(uint32_t id, const uint8_t *data, uint8_t len);
+
+private:
+
+    CAN &m_can;
+    IsoTpLink m_link;
+
+};
+
+#endif // ISO_TP_CAN_LINK_H
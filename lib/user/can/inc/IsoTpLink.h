@@ -0,0 +1,182 @@
+#ifndef ISO_TP_LINK_H
+#define ISO_TP_LINK_H
+
+/* Segmented transfer of payloads larger than a CAN frame, after ISO 15765-2 (ISO-TP).
+ *
+ * A payload of up to 7 bytes goes out as a single frame. Longer payloads (up
+ * to 4095 bytes) start with a first frame carrying the length, then the
+ * receiver answers with a flow control frame giving the number of consecutive
+ * frames it accepts before the next flow control (block size, 0 for all) and
+ * the minimum gap between them (separation time). Consecutive frames carry 7
+ * bytes each and a 4 bit sequence number.
+ *
+ *   Single frame        [0x0L, data x L]
+ *   First frame         [0x1H, L, data x 6]            12 bit length, H:L
+ *   Consecutive frame   [0x2S, data x 7]               S counts 1..15, 0..15, ...
+ *   Flow control        [0x3F, block size, STmin]      F: 0 continue, 1 wait, 2 overflow
+ *
+ * The link has no mbed dependencies and is shared with the Jetson tools, the
+ * board wraps it in IsoTpCANLink. Payloads are never copied: a transmission
+ * reads from the caller's buffer and received data is written straight into
+ * the buffer given to setReceiveBuffer(). A link carries one transfer in each
+ * direction at a time, on a pair of CAN IDs.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ISO_TP_MAX_PAYLOAD          4095
+#define ISO_TP_TIMEOUT_US           1000000 // N_Bs / N_Cr, waiting for a flow control or consecutive frame
+
+class IsoTpLink {
+
+public:
+
+    /** Sends frames for the link, implemented on top of the CAN peripheral or a host socket
+     */
+    class FrameSink {
+
+    public:
+
+        virtual ~FrameSink() {}
+
+        /** Queue a frame for transmission
+         *
+         * @return false if it could not be queued, it is retried on the next poll
+         */
+        virtual bool sendFrame(uint32_t id, const uint8_t *data, uint8_t len) = 0;
+
+    };
+
+    typedef enum {
+        resultIdle,
+        resultInProgress,
+        resultComplete,
+        resultTimeout,          // No flow control or consecutive frame in time
+        resultOverflow,         // Receiver has no room for the payload
+        resultSequenceError     // A consecutive frame was lost
+
+    } t_result;
+
+    /**
+     * @param blockSize Consecutive frames this end accepts between flow controls, 0 for no limit
+     * @param separationTimeUs Gap this end needs between consecutive frames, rounded up to
+     *                         100 us steps below 1 ms and to 1 ms steps up to 127 ms
+     */
+    IsoTpLink(FrameSink &sink, uint32_t txId, uint32_t rxId, uint8_t blockSize = 0, uint32_t separationTimeUs = 0);
+
+    /** Start sending a payload, the buffer must stay untouched until isSending() is false
+     *
+     * @return false if a transmission is in progress or the payload is too large
+     */
+    bool send(const uint8_t *payload, uint16_t size, uint32_t nowUs);
+
+    /** Give the buffer the next received payload is written to
+     */
+    void setReceiveBuffer(uint8_t *buffer, uint16_t capacity);
+
+    /** Handle a received frame
+     *
+     * @return true if the frame belongs to the link
+     */
+    bool handleFrame(uint32_t id, const uint8_t *data, uint8_t len, uint32_t nowUs);
+
+    /** Send pending frames and check timeouts, call whenever the link may have work to do
+     */
+    void poll(uint32_t nowUs);
+
+    bool isSending(void);
+    t_result getSendResult(void);
+
+    /** @return true once a payload has been received, until releaseReceived() is called
+     */
+    bool hasReceived(void);
+    uint16_t getReceivedSize(void);
+    t_result getReceiveResult(void);
+
+    /** Hand the receive buffer back to the link for the next payload
+     */
+    void releaseReceived(void);
+
+    /** Time at which poll() has more frames to send, for hosts that sleep in between
+     */
+    uint32_t getNextSendUs(void);
+
+    uint32_t getTxId(void);
+    uint32_t getRxId(void);
+
+private:
+
+    typedef enum {
+        pciSingle      = 0x00,
+        pciFirst       = 0x10,
+        pciConsecutive = 0x20,
+        pciFlowControl = 0x30
+
+    } t_pci;
+
+    typedef enum {
+        flowContinue = 0,
+        flowWait     = 1,
+        flowOverflow = 2
+
+    } t_flowStatus;
+
+    typedef enum {
+        txIdle,
+        txSendSingle,
+        txSendFirst,
+        txWaitFlowControl,
+        txSendConsecutive
+
+    } t_txState;
+
+    typedef enum {
+        rxIdle,
+        rxReceiving,
+        rxComplete
+
+    } t_rxState;
+
+    void handleFlowControl(const uint8_t *data, uint8_t len, uint32_t nowUs);
+    void handleSingle(const uint8_t *data, uint8_t len);
+    void handleFirst(const uint8_t *data, uint8_t len, uint32_t nowUs);
+    void handleConsecutive(const uint8_t *data, uint8_t len, uint32_t nowUs);
+
+    void pollSend(uint32_t nowUs);
+    void queueFlowControl(t_flowStatus status);
+    bool sendFlowControl(void);
+    void finishSend(t_result result);
+
+    static uint8_t encodeSeparationTime(uint32_t separationTimeUs);
+    static uint32_t decodeSeparationTime(uint8_t separationTime);
+    static bool isDue(uint32_t deadlineUs, uint32_t nowUs);
+
+    FrameSink &m_sink;
+    uint32_t m_txId, m_rxId;
+    uint8_t m_blockSize, m_separationTime;
+
+    // Transmission
+    t_txState m_txState;
+    t_result m_txResult;
+    const uint8_t *m_p_txPayload;
+    uint16_t m_txSize, m_txOffset;
+    uint8_t m_txSequence;
+    uint8_t m_txBlockSize, m_txBlockCount;
+    uint32_t m_txSeparationUs;
+    uint32_t m_txNextUs, m_txDeadlineUs;
+
+    // Reception
+    t_rxState m_rxState;
+    t_result m_rxResult;
+    uint8_t *m_p_rxBuffer;
+    uint16_t m_rxCapacity, m_rxSize, m_rxOffset;
+    uint8_t m_rxSequence, m_rxBlockCount;
+    uint32_t m_rxDeadlineUs;
+
+    bool m_isFlowControlPending;
+    t_flowStatus m_pendingFlowStatus;
+
+};
+
+#endif // ISO_TP_LINK_H
@@ -0,0 +1,33 @@
+/* ISO-TP link running on the board's CAN peripheral.
+ */
+
+#include "IsoTpCANLink.h"
+
+IsoTpCANLink::IsoTpCANLink(CAN &can, uint32_t txId, uint32_t rxId, uint8_t blockSize, uint32_t separationTimeUs) :
+        m_can(can), m_link(*this, txId, rxId, blockSize, separationTimeUs) {}
+
+bool IsoTpCANLink::send(const uint8_t *payload, uint16_t size) {
+    return m_link.send(payload, size, us_ticker_read());
+}
+
+bool IsoTpCANLink::handleCANMsg(CANMessage &msg) {
+    if (msg.format != CANStandard || msg.type != CANData) {
+        return false;
+    }
+
+    return m_link.handleFrame(msg.id, msg.data, msg.len, us_ticker_read());
+}
+
+void IsoTpCANLink::poll(void) {
+    m_link.poll(us_ticker_read());
+}
+
+IsoTpLink &IsoTpCANLink::getLink(void) {
+    return m_link;
+}
+
+bool IsoTpCANLink::sendFrame(uint32_t id, const uint8_t *data, uint8_t len) {
+    CANMessage msg(id, reinterpret_cast<const char *>(data), len);
+
+    return m_can.write(msg) == 1;
+}
@@ -0,0 +1,359 @@
+/* Segmented transfer of payloads larger than a CAN frame, after ISO 15765-2 (ISO-TP).
+ */
+
+#include <string.h>
+#include "IsoTpLink.h"
+
+#define FRAME_SIZE              8
+#define SINGLE_FRAME_PAYLOAD    7
+#define FIRST_FRAME_PAYLOAD     6
+#define CONSECUTIVE_PAYLOAD     7
+#define FLOW_CONTROL_SIZE       3
+
+#define MAX_SEPARATION_MS       127
+#define SEPARATION_US_BASE      0xF0 // 0xF1 - 0xF9 are 100 - 900 us
+
+IsoTpLink::IsoTpLink(FrameSink &sink, uint32_t txId, uint32_t rxId, uint8_t blockSize, uint32_t separationTimeUs) :
+        m_sink(sink), m_txId(txId), m_rxId(rxId), m_blockSize(blockSize),
+        m_separationTime(encodeSeparationTime(separationTimeUs)),
+        m_txState(txIdle), m_txResult(resultIdle), m_p_txPayload(NULL), m_txSize(0), m_txOffset(0), m_txSequence(0),
+        m_txBlockSize(0), m_txBlockCount(0), m_txSeparationUs(0), m_txNextUs(0), m_txDeadlineUs(0),
+        m_rxState(rxIdle), m_rxResult(resultIdle), m_p_rxBuffer(NULL), m_rxCapacity(0), m_rxSize(0), m_rxOffset(0),
+        m_rxSequence(0), m_rxBlockCount(0), m_rxDeadlineUs(0),
+        m_isFlowControlPending(false), m_pendingFlowStatus(flowContinue) {}
+
+bool IsoTpLink::send(const uint8_t *payload, uint16_t size, uint32_t nowUs) {
+    if (m_txState != txIdle || size > ISO_TP_MAX_PAYLOAD || (payload == NULL && size > 0)) {
+        return false;
+    }
+
+    m_p_txPayload = payload;
+    m_txSize      = size;
+    m_txOffset    = 0;
+    m_txResult    = resultInProgress;
+    m_txState     = size <= SINGLE_FRAME_PAYLOAD ? txSendSingle : txSendFirst;
+
+    pollSend(nowUs);
+
+    return true;
+}
+
+void IsoTpLink::setReceiveBuffer(uint8_t *buffer, uint16_t capacity) {
+    m_p_rxBuffer = buffer;
+    m_rxCapacity = capacity;
+    m_rxState    = rxIdle;
+    m_rxResult   = resultIdle;
+}
+
+bool IsoTpLink::handleFrame(uint32_t id, const uint8_t *data, uint8_t len, uint32_t nowUs) {
+    if (id != m_rxId || len == 0) {
+        return false;
+    }
+
+    switch (data[0] & 0xF0) {
+        case pciSingle:
+            handleSingle(data, len);
+            break;
+
+        case pciFirst:
+            handleFirst(data, len, nowUs);
+            break;
+
+        case pciConsecutive:
+            handleConsecutive(data, len, nowUs);
+            break;
+
+        case pciFlowControl:
+            handleFlowControl(data, len, nowUs);
+            break;
+
+        default:
+            break;
+    }
+
+    return true;
+}
+
+void IsoTpLink::poll(uint32_t nowUs) {
+    if (m_isFlowControlPending && sendFlowControl()) {
+        m_isFlowControlPending = false;
+    }
+
+    pollSend(nowUs);
+
+    if (m_rxState == rxReceiving && isDue(m_rxDeadlineUs, nowUs)) {
+        m_rxState  = rxIdle;
+        m_rxResult = resultTimeout;
+    }
+}
+
+bool IsoTpLink::isSending(void) {
+    return m_txState != txIdle;
+}
+
+IsoTpLink::t_result IsoTpLink::getSendResult(void) {
+    return m_txResult;
+}
+
+bool IsoTpLink::hasReceived(void) {
+    return m_rxState == rxComplete;
+}
+
+uint16_t IsoTpLink::getReceivedSize(void) {
+    return m_rxState == rxComplete ? m_rxSize : 0;
+}
+
+IsoTpLink::t_result IsoTpLink::getReceiveResult(void) {
+    return m_rxResult;
+}
+
+void IsoTpLink::releaseReceived(void) {
+    if (m_rxState == rxComplete) {
+        m_rxState  = rxIdle;
+        m_rxResult = resultIdle;
+    }
+}
+
+uint32_t IsoTpLink::getNextSendUs(void) {
+    return m_txNextUs;
+}
+
+uint32_t IsoTpLink::getTxId(void) {
+    return m_txId;
+}
+
+uint32_t IsoTpLink::getRxId(void) {
+    return m_rxId;
+}
+
+void IsoTpLink::handleFlowControl(const uint8_t *data, uint8_t len, uint32_t nowUs) {
+    if (m_txState != txWaitFlowControl || len < FLOW_CONTROL_SIZE) {
+        return;
+    }
+
+    switch (data[0] & 0x0F) {
+        case flowContinue:
+            m_txBlockSize    = data[1];
+            m_txBlockCount   = 0;
+            m_txSeparationUs = decodeSeparationTime(data[2]);
+            m_txNextUs       = nowUs;
+            m_txState        = txSendConsecutive;
+
+            pollSend(nowUs);
+            break;
+
+        case flowWait:
+            m_txDeadlineUs = nowUs + ISO_TP_TIMEOUT_US;
+            break;
+
+        case flowOverflow:
+            finishSend(resultOverflow);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void IsoTpLink::handleSingle(const uint8_t *data, uint8_t len) {
+    uint8_t size = data[0] & 0x0F;
+
+    // The caller still owns the last payload
+    if (size == 0 || size > len - 1 || m_rxState == rxComplete) {
+        return;
+    }
+
+    if (m_p_rxBuffer == NULL || size > m_rxCapacity) {
+        m_rxState  = rxIdle;
+        m_rxResult = resultOverflow;
+        return;
+    }
+
+    memcpy(m_p_rxBuffer, &data[1], size);
+
+    m_rxSize   = size;
+    m_rxState  = rxComplete;
+    m_rxResult = resultComplete;
+}
+
+void IsoTpLink::handleFirst(const uint8_t *data, uint8_t len, uint32_t nowUs) {
+    uint16_t size = ((data[0] & 0x0F) << 8) | data[1];
+
+    if (len < FRAME_SIZE || size <= SINGLE_FRAME_PAYLOAD) {
+        return;
+    }
+
+    if (m_rxState == rxComplete) {
+        queueFlowControl(flowOverflow);
+        return;
+    }
+
+    if (m_p_rxBuffer == NULL || size > m_rxCapacity) {
+        m_rxState  = rxIdle;
+        m_rxResult = resultOverflow;
+        queueFlowControl(flowOverflow);
+        return;
+    }
+
+    // A first frame also restarts a reception in progress, as the sender gave up on it
+    memcpy(m_p_rxBuffer, &data[2], FIRST_FRAME_PAYLOAD);
+
+    m_rxSize       = size;
+    m_rxOffset     = FIRST_FRAME_PAYLOAD;
+    m_rxSequence   = 1;
+    m_rxBlockCount = 0;
+    m_rxDeadlineUs = nowUs + ISO_TP_TIMEOUT_US;
+    m_rxState      = rxReceiving;
+    m_rxResult     = resultInProgress;
+
+    queueFlowControl(flowContinue);
+}
+
+void IsoTpLink::handleConsecutive(const uint8_t *data, uint8_t len, uint32_t nowUs) {
+    if (m_rxState != rxReceiving) {
+        return;
+    }
+
+    uint16_t chunk = m_rxSize - m_rxOffset;
+    if (chunk > CONSECUTIVE_PAYLOAD) {
+        chunk = CONSECUTIVE_PAYLOAD;
+    }
+
+    if ((data[0] & 0x0F) != m_rxSequence || len - 1 < chunk) {
+        m_rxState  = rxIdle;
+        m_rxResult = resultSequenceError;
+        return;
+    }
+
+    memcpy(m_p_rxBuffer + m_rxOffset, &data[1], chunk);
+
+    m_rxOffset    += chunk;
+    m_rxSequence   = (m_rxSequence + 1) & 0x0F;
+    m_rxDeadlineUs = nowUs + ISO_TP_TIMEOUT_US;
+
+    if (m_rxOffset >= m_rxSize) {
+        m_rxState  = rxComplete;
+        m_rxResult = resultComplete;
+    }
+    else if (m_blockSize != 0 && ++m_rxBlockCount >= m_blockSize) {
+        m_rxBlockCount = 0;
+        queueFlowControl(flowContinue);
+    }
+}
+
+void IsoTpLink::pollSend(uint32_t nowUs) {
+    uint8_t frame[FRAME_SIZE];
+
+    switch (m_txState) {
+        case txSendSingle:
+            frame[0] = pciSingle | m_txSize;
+            memcpy(&frame[1], m_p_txPayload, m_txSize);
+
+            if (m_sink.sendFrame(m_txId, frame, m_txSize + 1)) {
+                finishSend(resultComplete);
+            }
+            break;
+
+        case txSendFirst:
+            frame[0] = pciFirst | (m_txSize >> 8);
+            frame[1] = m_txSize & 0xFF;
+            memcpy(&frame[2], m_p_txPayload, FIRST_FRAME_PAYLOAD);
+
+            if (m_sink.sendFrame(m_txId, frame, FRAME_SIZE)) {
+                m_txOffset     = FIRST_FRAME_PAYLOAD;
+                m_txSequence   = 1;
+                m_txDeadlineUs = nowUs + ISO_TP_TIMEOUT_US;
+                m_txState      = txWaitFlowControl;
+            }
+            break;
+
+        case txWaitFlowControl:
+            if (isDue(m_txDeadlineUs, nowUs)) {
+                finishSend(resultTimeout);
+            }
+            break;
+
+        case txSendConsecutive:
+            // Without a separation time frames go out until the transmit mailboxes are full
+            while (isDue(m_txNextUs, nowUs)) {
+                uint16_t chunk = m_txSize - m_txOffset;
+                if (chunk > CONSECUTIVE_PAYLOAD) {
+                    chunk = CONSECUTIVE_PAYLOAD;
+                }
+
+                frame[0] = pciConsecutive | m_txSequence;
+                memcpy(&frame[1], m_p_txPayload + m_txOffset, chunk);
+
+                if (!m_sink.sendFrame(m_txId, frame, chunk + 1)) {
+                    break;
+                }
+
+                m_txOffset  += chunk;
+                m_txSequence = (m_txSequence + 1) & 0x0F;
+                m_txNextUs   = nowUs + m_txSeparationUs;
+
+                if (m_txOffset >= m_txSize) {
+                    finishSend(resultComplete);
+                    break;
+                }
+
+                if (m_txBlockSize != 0 && ++m_txBlockCount >= m_txBlockSize) {
+                    m_txDeadlineUs = nowUs + ISO_TP_TIMEOUT_US;
+                    m_txState      = txWaitFlowControl;
+                    break;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void IsoTpLink::queueFlowControl(t_flowStatus status) {
+    m_pendingFlowStatus    = status;
+    m_isFlowControlPending = !sendFlowControl();
+}
+
+bool IsoTpLink::sendFlowControl(void) {
+    uint8_t frame[FLOW_CONTROL_SIZE] = {(uint8_t)(pciFlowControl | m_pendingFlowStatus), m_blockSize, m_separationTime};
+
+    return m_sink.sendFrame(m_txId, frame, sizeof(frame));
+}
+
+void IsoTpLink::finishSend(t_result result) {
+    m_p_txPayload = NULL;
+    m_txResult    = result;
+    m_txState     = txIdle;
+}
+
+uint8_t IsoTpLink::encodeSeparationTime(uint32_t separationTimeUs) {
+    if (separationTimeUs == 0) {
+        return 0;
+    }
+
+    if (separationTimeUs <= 900) {
+        return SEPARATION_US_BASE + (separationTimeUs + 99) / 100;
+    }
+
+    uint32_t separationTimeMs = (separationTimeUs + 999) / 1000;
+
+    return separationTimeMs < MAX_SEPARATION_MS ? separationTimeMs : MAX_SEPARATION_MS;
+}
+
+uint32_t IsoTpLink::decodeSeparationTime(uint8_t separationTime) {
+    if (separationTime <= MAX_SEPARATION_MS) {
+        return separationTime * 1000;
+    }
+
+    if (separationTime > SEPARATION_US_BASE && separationTime <= SEPARATION_US_BASE + 9) {
+        return (separationTime - SEPARATION_US_BASE) * 100;
+    }
+
+    // Reserved values mean the longest separation time
+    return MAX_SEPARATION_MS * 1000;
+}
+
+bool IsoTpLink::isDue(uint32_t deadlineUs, uint32_t nowUs) {
+    return (int32_t)(nowUs - deadlineUs) >= 0;
+}
@@ -0,0 +1,100 @@
+#ifndef LOOP_CAPTURE_H
+#define LOOP_CAPTURE_H
+
+/* Records the state of a control loop at its full update rate.
+ *
+ * Each controller owns a LoopCapture and feeds it from update(). Samples are
+ * kept as 16 bit fixed point in a single static ring shared by every capture
+ * of the board: 2 KB once per board (LOOP_CAPTURE_SAMPLES of 8 bytes), plus
+ * about 40 bytes of state in each controller that owns a capture. Only one
+ * capture holds the ring, and arming one releases any other. While armed the
+ * ring keeps the most recent samples, so a capture holds preTriggerSamples
+ * from before the trigger and fills the rest after it.
+ */
+
+#include <stdint.h>
+#include "LoopCaptureProtocol.h"
+
+#ifndef LOOP_CAPTURE_SAMPLES
+#define LOOP_CAPTURE_SAMPLES 256    // Power of two, 8 bytes each
+#endif
+
+class LoopCapture {
+
+public:
+
+    /**
+     * @param valueScale Set point and process value units per LSB, sized so the loop's input range fits in 16 bits
+     */
+    explicit LoopCapture(float valueScale);
+
+    /** Start recording into the shared ring, releasing any other capture
+     *
+     * @param decimation Record every decimation-th update, 1 for every update
+     * @return false if the arguments are out of range
+     */
+    bool arm(LoopCaptureProtocol::t_trigger trigger, uint16_t preTriggerSamples, uint8_t decimation);
+
+    /** Trigger an armed capture now
+     */
+    void trigger(void);
+
+    /** Stop recording and give up the ring
+     */
+    void release(void);
+
+    /** Record a closed loop update
+     */
+    void record(float setPoint, float processValue, float output, uint32_t intervalUs);
+
+    /** Record an open loop update, the set point channel holds the commanded duty cycle
+     */
+    void recordOpenLoop(float processValue, float output, uint32_t intervalUs);
+
+    LoopCaptureProtocol::t_state getState(void);
+
+    float getValueScale(void);
+
+    bool isOpenLoop(void);
+
+    /** Number of samples held, in order from the oldest
+     */
+    uint16_t getSampleCount(void);
+
+    /** Index of the first sample recorded after the trigger
+     */
+    uint16_t getTriggerIndex(void);
+
+    const LoopCaptureProtocol::t_sample &getSample(uint16_t index);
+
+    /** Capture currently holding the ring, NULL if none
+     */
+    static LoopCapture *getActiveCapture(void);
+
+private:
+
+    void store(int16_t setPoint, int16_t processValue, int16_t output, bool changed, uint32_t intervalUs);
+
+    static int16_t toFixed(float value, float inverseScale);
+
+    static LoopCaptureProtocol::t_sample s_samples[LOOP_CAPTURE_SAMPLES];
+    static LoopCapture *s_p_active;
+
+    float m_valueScale, m_inverseValueScale;
+
+    LoopCaptureProtocol::t_state m_state;
+    LoopCaptureProtocol::t_trigger m_trigger;
+    bool m_isOpenLoop;
+
+    uint16_t m_preTriggerSamples;
+    uint8_t m_decimation, m_decimationCount;
+    uint32_t m_decimatedIntervalUs;
+
+    bool m_hasLastSetPoint;
+    int16_t m_lastSetPoint;
+
+    uint32_t m_written, m_triggeredAt;
+
+};
+
+#endif // LOOP_CAPTURE_H
@@ -0,0 +1,79 @@
+#ifndef LOOP_CAPTURE_PROTOCOL_H
+#define LOOP_CAPTURE_PROTOCOL_H
+
+/* CAN protocol for capturing control loop traces (see LoopCapture.h).
+ *
+ * Every controller a board exposes is a numbered target (see the app mains).
+ * Only one target can be captured at a time, since all captures share one
+ * sample buffer. A capture is armed, records while the joint moves and is
+ * dumped afterwards, so the bus carries nothing extra during the motion.
+ *
+ * Command frames (board ID + ROVER_CANID_SYS_CAPTURE_CMD), byte 0 is the opcode.
+ * Replies go to the board's reply base + ROVER_SYS_REPLY_CAPTURE:
+ *   Arm      [op, target, trigger, decimation, preTrigger(u16)]  -> [op, status, target]
+ *   Trigger  [op]                                               -> [op, status, target]
+ *   Status   [op]                                   -> [op, status, target, state, samples(u16), triggerIndex(u16)]
+ *   Describe [op]                                   -> [op, status, target, flags, valueScale(float)]
+ *   Dump     [op, 0, first(u16), count(u16)]        -> [op, status, target, 0, first(u16), count(u16)]
+ *   Release  [op]                                               -> [op, status, target]
+ *
+ * After a Dump reply the samples follow in order on the reply base +
+ * ROVER_SYS_REPLY_CAPTURE_DATA, one t_sample per frame. The set point and
+ * process value are value * valueScale, the output is a Q15 duty cycle.
+ * Multi byte fields are little endian.
+ */
+
+#include <stdint.h>
+
+class LoopCaptureProtocol {
+
+public:
+
+    typedef enum t_opcode {
+        opArm      = 0x01,
+        opTrigger  = 0x02,
+        opStatus   = 0x03,
+        opDescribe = 0x04,
+        opDump     = 0x05,
+        opRelease  = 0x06
+
+    } t_opcode;
+
+    typedef enum t_trigger {
+        triggerNow              = 0x00,
+        triggerOnSetPointChange = 0x01,  // In open loop modes, on a change of the commanded duty cycle
+        triggerManual           = 0x02   // On a Trigger command
+
+    } t_trigger;
+
+    typedef enum t_state {
+        stateIdle      = 0x00,
+        stateArmed     = 0x01,  // Recording pre trigger samples, waiting for the trigger
+        stateTriggered = 0x02,
+        stateComplete  = 0x03
+
+    } t_state;
+
+    typedef enum t_flags {
+        flagOpenLoop = 0x01     // Set point channel holds the commanded duty cycle (Q15)
+
+    } t_flags;
+
+    typedef enum t_status {
+        statusOk          = 0x00,
+        statusBadState    = 0x01,
+        statusBadArgument = 0x02
+
+    } t_status;
+
+    typedef struct {
+        int16_t setPoint;
+        int16_t processValue;
+        int16_t output;
+        uint16_t intervalUs;
+
+    } t_sample;
+
+};
+
+#endif // LOOP_CAPTURE_PROTOCOL_H
@@ -0,0 +1,52 @@
+#ifndef LOOP_CAPTURE_SERVICE_H
+#define LOOP_CAPTURE_SERVICE_H
+
+/* Arms the loop captures of a board over CAN and dumps them once complete
+ * (see LoopCaptureProtocol.h).
+ *
+ * A dump is sent from poll() a few frames at a time, only into free transmit
+ * mailboxes, so it never holds up the control loop.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "LoopCapture.h"
+#include "LoopCaptureProtocol.h"
+
+#define LOOP_CAPTURE_MAX_TARGETS 4
+
+class LoopCaptureService {
+
+public:
+
+    LoopCaptureService(CAN &can, uint32_t boardCanId);
+
+    /** Expose a controller's capture as a numbered target
+     */
+    mbed_error_status_t registerCapture(uint8_t target, LoopCapture &capture);
+
+    /** Handle a message if it belongs to the capture service
+     *
+     * @return true if the message was consumed
+     */
+    bool handleCANMsg(CANMessage &msg);
+
+    /** Send the next frames of a dump in progress, call every main loop iteration
+     */
+    void poll(void);
+
+private:
+
+    LoopCaptureProtocol::t_status handleCommand(const CANMessage &msg, CANMessage &reply);
+    uint8_t getActiveTarget(void);
+
+    CAN &m_can;
+    uint32_t m_boardCanId;
+
+    LoopCapture *m_p_captures[LOOP_CAPTURE_MAX_TARGETS];
+
+    uint16_t m_dumpNext, m_dumpEnd;
+
+};
+
+#endif // LOOP_CAPTURE_SERVICE_H
@@ -0,0 +1,162 @@
+/* Records the state of a control loop at its full update rate.
+ */
+
+#include <stddef.h>
+#include "LoopCapture.h"
+
+#define FIXED_MAX           32767.0f
+#define Q15_INVERSE_SCALE   32767.0f
+
+LoopCaptureProtocol::t_sample LoopCapture::s_samples[LOOP_CAPTURE_SAMPLES];
+LoopCapture *LoopCapture::s_p_active = NULL;
+
+LoopCapture::LoopCapture(float valueScale) :
+        m_valueScale(valueScale), m_inverseValueScale(1.0f / valueScale),
+        m_state(LoopCaptureProtocol::stateIdle), m_trigger(LoopCaptureProtocol::triggerNow), m_isOpenLoop(false),
+        m_preTriggerSamples(0), m_decimation(1), m_decimationCount(0), m_decimatedIntervalUs(0),
+        m_hasLastSetPoint(false), m_lastSetPoint(0), m_written(0), m_triggeredAt(0) {}
+
+bool LoopCapture::arm(LoopCaptureProtocol::t_trigger trigger, uint16_t preTriggerSamples, uint8_t decimation) {
+    if (trigger > LoopCaptureProtocol::triggerManual || preTriggerSamples >= LOOP_CAPTURE_SAMPLES || decimation == 0) {
+        return false;
+    }
+
+    if (s_p_active != NULL && s_p_active != this) {
+        s_p_active->release();
+    }
+
+    m_trigger                  = trigger;
+    m_preTriggerSamples        = trigger == LoopCaptureProtocol::triggerNow ? 0 : preTriggerSamples;
+    m_decimation               = decimation;
+    m_decimationCount          = 0;
+    m_decimatedIntervalUs      = 0;
+    m_hasLastSetPoint          = false;
+    m_written                  = 0;
+    m_triggeredAt              = 0;
+
+    m_state = trigger == LoopCaptureProtocol::triggerNow ? LoopCaptureProtocol::stateTriggered : LoopCaptureProtocol::stateArmed;
+    s_p_active = this;
+
+    return true;
+}
+
+void LoopCapture::trigger(void) {
+    if (m_state == LoopCaptureProtocol::stateArmed) {
+        m_triggeredAt = m_written;
+        m_state = LoopCaptureProtocol::stateTriggered;
+    }
+}
+
+void LoopCapture::release(void) {
+    m_state = LoopCaptureProtocol::stateIdle;
+
+    if (s_p_active == this) {
+        s_p_active = NULL;
+    }
+}
+
+void LoopCapture::record(float setPoint, float processValue, float output, uint32_t intervalUs) {
+    if (s_p_active != this) {
+        return;
+    }
+
+    int16_t fixedSetPoint = toFixed(setPoint, m_inverseValueScale);
+
+    m_isOpenLoop = false;
+    store(fixedSetPoint, toFixed(processValue, m_inverseValueScale), toFixed(output, Q15_INVERSE_SCALE),
+          m_hasLastSetPoint && fixedSetPoint != m_lastSetPoint, intervalUs);
+}
+
+void LoopCapture::recordOpenLoop(float processValue, float output, uint32_t intervalUs) {
+    if (s_p_active != this) {
+        return;
+    }
+
+    int16_t fixedOutput = toFixed(output, Q15_INVERSE_SCALE);
+
+    m_isOpenLoop = true;
+    store(fixedOutput, toFixed(processValue, m_inverseValueScale), fixedOutput,
+          m_hasLastSetPoint && fixedOutput != m_lastSetPoint, intervalUs);
+}
+
+LoopCaptureProtocol::t_state LoopCapture::getState(void) {
+    return m_state;
+}
+
+float LoopCapture::getValueScale(void) {
+    return m_valueScale;
+}
+
+bool LoopCapture::isOpenLoop(void) {
+    return m_isOpenLoop;
+}
+
+uint16_t LoopCapture::getSampleCount(void) {
+    return m_written < LOOP_CAPTURE_SAMPLES ? m_written : LOOP_CAPTURE_SAMPLES;
+}
+
+uint16_t LoopCapture::getTriggerIndex(void) {
+    if (m_state != LoopCaptureProtocol::stateTriggered && m_state != LoopCaptureProtocol::stateComplete) {
+        return getSampleCount();
+    }
+
+    return m_triggeredAt - (m_written - getSampleCount());
+}
+
+const LoopCaptureProtocol::t_sample &LoopCapture::getSample(uint16_t index) {
+    return s_samples[(m_written - getSampleCount() + index) % LOOP_CAPTURE_SAMPLES];
+}
+
+LoopCapture *LoopCapture::getActiveCapture(void) {
+    return s_p_active;
+}
+
+void LoopCapture::store(int16_t setPoint, int16_t processValue, int16_t output, bool changed, uint32_t intervalUs) {
+    if (m_state != LoopCaptureProtocol::stateArmed && m_state != LoopCaptureProtocol::stateTriggered) {
+        return;
+    }
+
+    // The trigger is checked on every update, only storing is decimated
+    if (m_state == LoopCaptureProtocol::stateArmed && changed &&
+        m_trigger == LoopCaptureProtocol::triggerOnSetPointChange) {
+        m_triggeredAt = m_written;
+        m_state = LoopCaptureProtocol::stateTriggered;
+    }
+
+    m_lastSetPoint    = setPoint;
+    m_hasLastSetPoint = true;
+
+    m_decimatedIntervalUs += intervalUs;
+
+    if (++m_decimationCount < m_decimation) {
+        return;
+    }
+
+    LoopCaptureProtocol::t_sample &sample = s_samples[m_written % LOOP_CAPTURE_SAMPLES];
+    sample.setPoint     = setPoint;
+    sample.processValue = processValue;
+    sample.output       = output;
+    sample.intervalUs   = m_decimatedIntervalUs < 65535 ? (uint16_t)m_decimatedIntervalUs : 65535;
+
+    m_decimationCount     = 0;
+    m_decimatedIntervalUs = 0;
+    m_written++;
+
+    if (m_state == LoopCaptureProtocol::stateTriggered &&
+        m_written - m_triggeredAt >= (uint32_t)(LOOP_CAPTURE_SAMPLES - m_preTriggerSamples)) {
+        m_state = LoopCaptureProtocol::stateComplete;
+    }
+}
+
+int16_t LoopCapture::toFixed(float value, float inverseScale) {
+    float scaled = value * inverseScale;
+
+    if (scaled >= FIXED_MAX) {
+        return (int16_t)FIXED_MAX;
+    }
+    else if (scaled <= -FIXED_MAX) {
+        return (int16_t)-FIXED_MAX;
+    }
+
+    return (int16_t)(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f);
+}
@@ -0,0 +1,168 @@
+/* Arms the loop captures of a board over CAN and dumps them once complete.
+ */
+
+#include "LoopCaptureService.h"
+
+#define NO_TARGET 0xFF
+
+LoopCaptureService::LoopCaptureService(CAN &can, uint32_t boardCanId) :
+        m_can(can), m_boardCanId(boardCanId), m_dumpNext(0), m_dumpEnd(0) {
+    memset(m_p_captures, 0, sizeof(m_p_captures));
+}
+
+mbed_error_status_t LoopCaptureService::registerCapture(uint8_t target, LoopCapture &capture) {
+    if (target >= LOOP_CAPTURE_MAX_TARGETS || m_p_captures[target] != NULL) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    m_p_captures[target] = &capture;
+
+    return MBED_SUCCESS;
+}
+
+bool LoopCaptureService::handleCANMsg(CANMessage &msg) {
+    if (msg.id != m_boardCanId + ROVER_CANID_SYS_CAPTURE_CMD || msg.len == 0) {
+        return false;
+    }
+
+    CANMessage reply;
+
+    reply.data[1] = handleCommand(msg, reply);
+    reply.data[0] = msg.data[0];
+    reply.data[2] = getActiveTarget();
+
+    reply.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_CAPTURE;
+    reply.len = 8;
+    MBED_ASSERT_WARN(m_can.write(reply) == true);
+
+    return true;
+}
+
+void LoopCaptureService::poll(void) {
+    LoopCapture *p_capture = LoopCapture::getActiveCapture();
+
+    if (m_dumpNext >= m_dumpEnd || p_capture == NULL) {
+        return;
+    }
+
+    CANMessage frame;
+    frame.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_CAPTURE_DATA;
+    frame.len = sizeof(LoopCaptureProtocol::t_sample);
+
+    // Stop as soon as the mailboxes are full, the rest goes out on the next iterations
+    while (m_dumpNext < m_dumpEnd) {
+        memcpy(frame.data, &p_capture->getSample(m_dumpNext), sizeof(LoopCaptureProtocol::t_sample));
+
+        if (!m_can.write(frame)) {
+            break;
+        }
+
+        m_dumpNext++;
+    }
+}
+
+LoopCaptureProtocol::t_status LoopCaptureService::handleCommand(const CANMessage &msg, CANMessage &reply) {
+    LoopCapture *p_capture = LoopCapture::getActiveCapture();
+
+    switch (msg.data[0]) {
+        case LoopCaptureProtocol::opArm: {
+            uint8_t target = msg.data[1];
+            uint16_t preTriggerSamples = msg.data[4] | (msg.data[5] << 8);
+
+            if (msg.len < 6 || target >= LOOP_CAPTURE_MAX_TARGETS || m_p_captures[target] == NULL) {
+                return LoopCaptureProtocol::statusBadArgument;
+            }
+
+            // Arming reuses the ring, so a dump in progress is dropped
+            m_dumpNext = m_dumpEnd = 0;
+
+            if (!m_p_captures[target]->arm((LoopCaptureProtocol::t_trigger)msg.data[2], preTriggerSamples, msg.data[3])) {
+                return LoopCaptureProtocol::statusBadArgument;
+            }
+
+            return LoopCaptureProtocol::statusOk;
+        }
+
+        case LoopCaptureProtocol::opTrigger:
+            if (p_capture == NULL || p_capture->getState() != LoopCaptureProtocol::stateArmed) {
+                return LoopCaptureProtocol::statusBadState;
+            }
+
+            p_capture->trigger();
+            return LoopCaptureProtocol::statusOk;
+
+        case LoopCaptureProtocol::opStatus: {
+            if (p_capture == NULL) {
+                reply.data[3] = LoopCaptureProtocol::stateIdle;
+                return LoopCaptureProtocol::statusOk;
+            }
+
+            uint16_t samples      = p_capture->getSampleCount();
+            uint16_t triggerIndex = p_capture->getTriggerIndex();
+
+            reply.data[3] = p_capture->getState();
+            memcpy(&reply.data[4], &samples, sizeof(samples));
+            memcpy(&reply.data[6], &triggerIndex, sizeof(triggerIndex));
+            return LoopCaptureProtocol::statusOk;
+        }
+
+        case LoopCaptureProtocol::opDescribe: {
+            if (p_capture == NULL) {
+                return LoopCaptureProtocol::statusBadState;
+            }
+
+            float valueScale = p_capture->getValueScale();
+
+            reply.data[3] = p_capture->isOpenLoop() ? LoopCaptureProtocol::flagOpenLoop : 0;
+            memcpy(&reply.data[4], &valueScale, sizeof(valueScale));
+            return LoopCaptureProtocol::statusOk;
+        }
+
+        case LoopCaptureProtocol::opDump: {
+            uint16_t first = msg.data[2] | (msg.data[3] << 8);
+            uint16_t count = msg.data[4] | (msg.data[5] << 8);
+
+            if (p_capture == NULL || p_capture->getState() != LoopCaptureProtocol::stateComplete) {
+                return LoopCaptureProtocol::statusBadState;
+            }
+
+            if (msg.len < 6 || first > p_capture->getSampleCount()) {
+                return LoopCaptureProtocol::statusBadArgument;
+            }
+
+            if (count > p_capture->getSampleCount() - first) {
+                count = p_capture->getSampleCount() - first;
+            }
+
+            m_dumpNext = first;
+            m_dumpEnd  = first + count;
+
+            memcpy(&reply.data[4], &first, sizeof(first));
+            memcpy(&reply.data[6], &count, sizeof(count));
+            return LoopCaptureProtocol::statusOk;
+        }
+
+        case LoopCaptureProtocol::opRelease:
+            if (p_capture != NULL) {
+                p_capture->release();
+            }
+
+            m_dumpNext = m_dumpEnd = 0;
+            return LoopCaptureProtocol::statusOk;
+
+        default:
+            return LoopCaptureProtocol::statusBadArgument;
+    }
+}
+
+uint8_t LoopCaptureService::getActiveTarget(void) {
+    LoopCapture *p_capture = LoopCapture::getActiveCapture();
+
+    for (uint8_t target = 0; target < LOOP_CAPTURE_MAX_TARGETS; target++) {
+        if (p_capture != NULL && m_p_captures[target] == p_capture) {
+            return target;
+        }
+    }
+
+    return NO_TARGET;
+}
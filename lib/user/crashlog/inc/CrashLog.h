@@ -0,0 +1,66 @@
+#ifndef CRASH_LOG_H
+#define CRASH_LOG_H
+
+/* Record of the last crash, kept across the reset that follows it.
+ *
+ * A HardFault, mbed_error(), error() or a failed MBED_ASSERT (through
+ * mbed_die()) no longer halts the board: the fault registers and the last
+ * CRASH_LOG_EVENTS warnings are latched into a RAM section the startup code
+ * never initialises, and the board resets. Latching copies a few hundred bytes
+ * with interrupts masked and writes nothing to flash (an erase stalls the
+ * core for tens of milliseconds), so a crash costs well under 100 us before
+ * the reset. The record survives any reset but a power loss, which is told
+ * apart by RCC_CSR on the next boot. A watchdog reset latches a record on that
+ * boot, with only the events known.
+ *
+ * Events are every MBED_WARN_ON_ERROR, MBED_ASSERT_WARN and mbed_warning(),
+ * from any context, with the address they were reported from.
+ */
+
+#include "mbed.h"
+#include "CrashLogProtocol.h"
+
+class CrashLog {
+
+public:
+
+    /** Read and clear the reset flags, latch a watchdog reset and restart the event log
+     *
+     * Called by the first logged event if nothing has yet, safe to call any number of times
+     */
+    static void init(void);
+
+    /** Add an event to the log, from any context
+     */
+    static void logEvent(int32_t status, uint32_t value, uint32_t address);
+
+    /** Store the registers and events of a crash, from the fault handlers
+     */
+    static void latch(CrashLogProtocol::t_cause cause, int32_t errorStatus, uint32_t errorValue,
+                      uint32_t pc, uint32_t lr, uint32_t xpsr, uint32_t sp);
+
+    /** Latch a crash and reset
+     */
+    static void crash(CrashLogProtocol::t_cause cause, int32_t errorStatus, uint32_t errorValue,
+                      uint32_t pc, uint32_t lr, uint32_t xpsr, uint32_t sp);
+
+    /** @return Last crash, NULL if none is held
+     */
+    static const CrashLogProtocol::t_record *getRecord(void);
+
+    /** Forget the crash held
+     */
+    static void clear(void);
+
+    /** @return RCC_CSR flags of the reset the board started from (CrashLogProtocol::t_resetFlag)
+     */
+    static uint8_t getResetFlags(void);
+
+private:
+
+    static bool s_isInitialised;
+    static uint8_t s_resetFlags;
+
+};
+
+#endif // CRASH_LOG_H
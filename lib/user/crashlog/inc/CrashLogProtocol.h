@@ -0,0 +1,90 @@
+#ifndef CRASH_LOG_PROTOCOL_H
+#define CRASH_LOG_PROTOCOL_H
+
+/* CAN protocol for reading the crash record a board keeps across resets (see CrashLog.h).
+ *
+ * Command frames (board ID + ROVER_CANID_SYS_CRASH_CMD), byte 0 is the opcode.
+ * Replies go to the board's reply base + ROVER_SYS_REPLY_CRASH:
+ *   Summary  [op]      -> [op, status, resetFlags, cause, crashCount(u16), eventCount, frames]
+ *   Read     [op]      -> [op, status, frames]
+ *   Clear    [op]      -> [op, status]
+ *
+ * The board also sends a Summary on its own after a reset that left a record.
+ * After a Read reply the t_record follows on the reply base +
+ * ROVER_SYS_REPLY_CRASH_DATA, 8 bytes per frame. resetFlags describe the reset
+ * the board last started from, the record the last crash before it. Status is
+ * statusNoRecord, with cause causeNone, while no record is held. Multi byte
+ * fields are little endian.
+ */
+
+#include <stdint.h>
+
+#define CRASH_LOG_EVENTS    8       // Power of two
+
+class CrashLogProtocol {
+
+public:
+
+    typedef enum t_opcode {
+        opSummary = 0x01,
+        opRead    = 0x02,
+        opClear   = 0x03
+
+    } t_opcode;
+
+    typedef enum t_status {
+        statusOk          = 0x00,
+        statusNoRecord    = 0x01,
+        statusBadArgument = 0x02
+
+    } t_status;
+
+    typedef enum t_cause {
+        causeNone       = 0x00,
+        causeHardFault  = 0x01,     // pc, lr, xpsr and sp from the stacked exception frame
+        causeFatalError = 0x02,     // mbed_error(), pc is its caller
+        causeDie        = 0x03,     // error() or a failed MBED_ASSERT, pc is the return address of mbed_die()
+        causeWatchdog   = 0x04      // Only the events are known
+
+    } t_cause;
+
+    // RCC_CSR reset flags, shifted down to bit 0
+    typedef enum t_resetFlag {
+        resetOptionByteLoad      = 0x01,
+        resetPin                 = 0x02,
+        resetPowerOn             = 0x04,
+        resetSoftware            = 0x08,
+        resetIndependentWatchdog = 0x10,
+        resetWindowWatchdog      = 0x20,
+        resetLowPower            = 0x40
+
+    } t_resetFlag;
+
+    // A warning or error reported before the crash
+    typedef struct {
+        uint32_t address;           // Where it was reported from
+        int32_t status;             // mbed_error_status_t, 0 for a failed MBED_ASSERT_WARN
+        uint32_t value;
+        uint32_t timeUs;            // MicrosecondClock
+
+    } t_event;
+
+    typedef struct {
+        uint8_t cause;
+        uint8_t eventCount;
+        uint16_t crashCount;        // Since the last power on or Clear
+        int32_t errorStatus;
+        uint32_t pc, lr;
+        uint32_t xpsr, sp;
+        uint32_t errorValue;
+        uint32_t timeUs;
+        t_event events[CRASH_LOG_EVENTS];   // Oldest first, eventCount of them are valid
+
+    } t_record;
+
+    static const uint8_t frameSize  = 8;
+    static const uint8_t frameCount = sizeof(t_record) / frameSize;
+
+};
+
+#endif // CRASH_LOG_PROTOCOL_H
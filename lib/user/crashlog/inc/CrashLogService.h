@@ -0,0 +1,45 @@
+#ifndef CRASH_LOG_SERVICE_H
+#define CRASH_LOG_SERVICE_H
+
+/* Reads and clears the crash record of a board over CAN (see CrashLogProtocol.h).
+ *
+ * A record left by the previous reset is announced with a Summary from the
+ * first poll() that can send it, so a crash in the field shows up in the
+ * Jetson's logs without anyone asking. A Read is sent from poll() a few
+ * frames at a time, only into free transmit mailboxes.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "CrashLog.h"
+#include "CrashLogProtocol.h"
+
+class CrashLogService {
+
+public:
+
+    CrashLogService(CAN &can, uint32_t boardCanId);
+
+    /** Handle a message if it belongs to the crash log service
+     *
+     * @return true if the message was consumed
+     */
+    bool handleCANMsg(CANMessage &msg);
+
+    /** Send the announcement and the next frames of a read in progress, call every main loop iteration
+     */
+    void poll(void);
+
+private:
+
+    void fillSummary(CANMessage &reply);
+
+    CAN &m_can;
+    uint32_t m_boardCanId;
+
+    bool m_isSummaryPending;
+    uint8_t m_readNext, m_readEnd;
+
+};
+
+#endif // CRASH_LOG_SERVICE_H
@@ -0,0 +1,210 @@
+/* Record of the last crash, kept across the reset that follows it.
+ */
+
+#include "CrashLog.h"
+#include "MicrosecondClock.h"
+#include "rover_config.h"
+
+#define RECORD_MAGIC    0x43525348 // "CRSH"
+#define LOG_MAGIC       0x4C4F4753 // "LOGS"
+#define EVENT_MASK      (CRASH_LOG_EVENTS - 1)
+
+#if (CRASH_LOG_EVENTS & EVENT_MASK) != 0
+#error "CRASH_LOG_EVENTS must be a power of two"
+#endif
+
+typedef struct {
+    // Latched by a crash, valid while the magic and checksum match
+    uint32_t recordMagic;
+    uint32_t recordChecksum;
+    CrashLogProtocol::t_record record;
+
+    // Events of the current run, kept here so a watchdog reset does not lose them
+    uint32_t logMagic;
+    uint32_t logCount;      // Events ever logged, the slot is the count modulo the size
+    CrashLogProtocol::t_event log[CRASH_LOG_EVENTS];
+
+} t_store;
+
+MBED_STATIC_ASSERT(sizeof(t_store) <= ROVER_RAM_NOINIT_SIZE, "Crash log does not fit in the no-init RAM");
+MBED_STATIC_ASSERT(sizeof(CrashLogProtocol::t_record) % CrashLogProtocol::frameSize == 0, "Crash record must fill whole frames");
+
+static t_store s_store __attribute__((section(".noinit")));
+
+bool CrashLog::s_isInitialised = false;
+uint8_t CrashLog::s_resetFlags = 0;
+
+static uint32_t computeChecksum(const CrashLogProtocol::t_record &record) {
+    const uint32_t *p_word = reinterpret_cast<const uint32_t *>(&record);
+    uint32_t checksum = RECORD_MAGIC;
+
+    for (uint32_t i = 0; i < sizeof(record) / sizeof(uint32_t); i++) {
+        checksum = ((checksum << 5) | (checksum >> 27)) ^ p_word[i];
+    }
+
+    return checksum;
+}
+
+static bool isRecordValid(void) {
+    return s_store.recordMagic == RECORD_MAGIC && s_store.recordChecksum == computeChecksum(s_store.record);
+}
+
+static void errorHook(const mbed_error_ctx *p_context) {
+    CrashLog::logEvent(p_context->error_status, p_context->error_value, p_context->error_address);
+}
+
+void CrashLog::init(void) {
+    if (s_isInitialised) {
+        return;
+    }
+
+    s_isInitialised = true;
+
+    s_resetFlags = (uint8_t)(RCC->CSR >> RCC_CSR_OBLRSTF_Pos);
+    RCC->CSR |= RCC_CSR_RMVF;
+
+    // The RAM did not hold through a power loss, whatever is there is noise
+    if (s_resetFlags & CrashLogProtocol::resetPowerOn) {
+        s_store.recordMagic = 0;
+        s_store.logMagic    = 0;
+    }
+    else if (s_resetFlags & (CrashLogProtocol::resetIndependentWatchdog | CrashLogProtocol::resetWindowWatchdog)) {
+        latch(CrashLogProtocol::causeWatchdog, 0, 0, 0, 0, 0, 0);
+    }
+
+    s_store.logCount = 0;
+    s_store.logMagic = LOG_MAGIC;
+
+    mbed_set_error_hook(errorHook);
+}
+
+void CrashLog::logEvent(int32_t status, uint32_t value, uint32_t address) {
+    init();
+
+    uint32_t timeUs = MicrosecondClock::read();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    CrashLogProtocol::t_event &event = s_store.log[s_store.logCount & EVENT_MASK];
+    event.address = address;
+    event.status  = status;
+    event.value   = value;
+    event.timeUs  = timeUs;
+
+    s_store.logCount++;
+
+    __set_PRIMASK(primask);
+}
+
+void CrashLog::latch(CrashLogProtocol::t_cause cause, int32_t errorStatus, uint32_t errorValue,
+                     uint32_t pc, uint32_t lr, uint32_t xpsr, uint32_t sp) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    CrashLogProtocol::t_record &record = s_store.record;
+    uint16_t crashCount = isRecordValid() ? record.crashCount : 0;
+
+    record.cause       = cause;
+    record.crashCount  = crashCount < 0xFFFF ? crashCount + 1 : crashCount;
+    record.errorStatus = errorStatus;
+    record.errorValue  = errorValue;
+    record.pc          = pc;
+    record.lr          = lr;
+    record.xpsr        = xpsr;
+    record.sp          = sp;
+    record.timeUs      = cause == CrashLogProtocol::causeWatchdog ? 0 : MicrosecondClock::read();
+
+    uint32_t count = s_store.logMagic == LOG_MAGIC ? s_store.logCount : 0;
+    uint32_t kept  = count < CRASH_LOG_EVENTS ? count : CRASH_LOG_EVENTS;
+
+    for (uint32_t i = 0; i < CRASH_LOG_EVENTS; i++) {
+        if (i < kept) {
+            record.events[i] = s_store.log[(count - kept + i) & EVENT_MASK];
+        }
+        else {
+            memset(&record.events[i], 0, sizeof(CrashLogProtocol::t_event));
+        }
+    }
+
+    record.eventCount = kept;
+
+    s_store.recordChecksum = computeChecksum(record);
+    s_store.recordMagic    = RECORD_MAGIC;
+
+    __set_PRIMASK(primask);
+}
+
+void CrashLog::crash(CrashLogProtocol::t_cause cause, int32_t errorStatus, uint32_t errorValue,
+                     uint32_t pc, uint32_t lr, uint32_t xpsr, uint32_t sp) {
+    __disable_irq();
+
+    // Latches a watchdog reset from before first, if nothing has yet
+    init();
+    latch(cause, errorStatus, errorValue, pc, lr, xpsr, sp);
+
+    NVIC_SystemReset();
+}
+
+const CrashLogProtocol::t_record *CrashLog::getRecord(void) {
+    init();
+
+    return isRecordValid() ? &s_store.record : NULL;
+}
+
+void CrashLog::clear(void) {
+    s_store.recordMagic = 0;
+}
+
+uint8_t CrashLog::getResetFlags(void) {
+    init();
+
+    return s_resetFlags;
+}
+
+// Warnings of the macros in mbed_config.h
+extern "C" void crash_log_warning(int status) {
+    CrashLog::logEvent(status, 0, (uint32_t)MBED_CALLER_ADDR());
+}
+
+// Replace the weak mbed versions, which halt the board
+extern "C" mbed_error_status_t mbed_error(mbed_error_status_t error_status, const char *error_msg, unsigned int error_value,
+                                          const char *filename, int line_number) {
+    uint32_t caller = (uint32_t)MBED_CALLER_ADDR();
+
+    CrashLog::logEvent(error_status, error_value, caller);
+    CrashLog::crash(CrashLogProtocol::causeFatalError, error_status, error_value, caller, 0, __get_xPSR(), __get_MSP());
+
+    return MBED_ERROR_FAILED_OPERATION;
+}
+
+extern "C" void mbed_die(void) {
+    CrashLog::crash(CrashLogProtocol::causeDie, 0, 0, (uint32_t)MBED_CALLER_ADDR(), 0, __get_xPSR(), __get_MSP());
+
+    while (1) {}
+}
+
+extern "C" __attribute__((used)) void crash_log_hard_fault(const uint32_t *p_frame) {
+    uint32_t address = (uint32_t)p_frame;
+
+    // r0-r3, r12, lr, pc, xpsr, unless the stack pointer itself was the fault
+    if ((address & 3) == 0 && address >= SRAM_BASE && address <= ROVER_RAM_NOINIT_START - 8 * sizeof(uint32_t)) {
+        CrashLog::crash(CrashLogProtocol::causeHardFault, 0, 0, p_frame[6], p_frame[5], p_frame[7], address);
+    }
+
+    CrashLog::crash(CrashLogProtocol::causeHardFault, 0, 0, 0, 0, 0, address);
+}
+
+extern "C" __attribute__((naked)) void HardFault_Handler(void) {
+    // Pass the exception frame on the stack it was pushed to, bit 2 of EXC_RETURN
+    __asm volatile(
+        "movs r0, #4                \n"
+        "mov  r1, lr                \n"
+        "tst  r0, r1                \n"
+        "mrs  r0, msp               \n"
+        "beq  1f                    \n"
+        "mrs  r0, psp               \n"
+        "1:                         \n"
+        "bl   crash_log_hard_fault  \n"
+    );
+}
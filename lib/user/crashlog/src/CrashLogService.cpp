@@ -0,0 +1,116 @@
+/* Reads and clears the crash record of a board over CAN.
+ */
+
+#include "CrashLogService.h"
+
+CrashLogService::CrashLogService(CAN &can, uint32_t boardCanId) :
+        m_can(can), m_boardCanId(boardCanId), m_readNext(0), m_readEnd(0) {
+    CrashLog::init();
+
+    m_isSummaryPending = CrashLog::getRecord() != NULL;
+}
+
+bool CrashLogService::handleCANMsg(CANMessage &msg) {
+    if (msg.id != m_boardCanId + ROVER_CANID_SYS_CRASH_CMD || msg.len == 0) {
+        return false;
+    }
+
+    const CrashLogProtocol::t_record *p_record = CrashLog::getRecord();
+
+    CANMessage reply;
+    memset(reply.data, 0, sizeof(reply.data));
+
+    reply.id      = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_CRASH;
+    reply.len     = 2;
+    reply.data[0] = msg.data[0];
+    reply.data[1] = p_record != NULL ? CrashLogProtocol::statusOk : CrashLogProtocol::statusNoRecord;
+
+    switch (msg.data[0]) {
+        case CrashLogProtocol::opSummary:
+            fillSummary(reply);
+            break;
+
+        case CrashLogProtocol::opRead:
+            // Restarts a read in progress
+            m_readNext = 0;
+            m_readEnd  = p_record != NULL ? CrashLogProtocol::frameCount : 0;
+
+            reply.data[2] = m_readEnd;
+            reply.len     = 3;
+            break;
+
+        case CrashLogProtocol::opClear:
+            CrashLog::clear();
+            m_readNext = m_readEnd = 0;
+            m_isSummaryPending = false;
+
+            reply.data[1] = CrashLogProtocol::statusOk;
+            break;
+
+        default:
+            reply.data[1] = CrashLogProtocol::statusBadArgument;
+            break;
+    }
+
+    MBED_ASSERT_WARN(m_can.write(reply) == true);
+
+    return true;
+}
+
+void CrashLogService::poll(void) {
+    if (m_isSummaryPending) {
+        CANMessage summary;
+        memset(summary.data, 0, sizeof(summary.data));
+
+        summary.id      = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_CRASH;
+        summary.data[0] = CrashLogProtocol::opSummary;
+        summary.data[1] = CrashLogProtocol::statusOk;
+        fillSummary(summary);
+
+        // Retried until the bus takes it
+        if (!m_can.write(summary)) {
+            return;
+        }
+
+        m_isSummaryPending = false;
+    }
+
+    const CrashLogProtocol::t_record *p_record = CrashLog::getRecord();
+
+    if (m_readNext >= m_readEnd || p_record == NULL) {
+        return;
+    }
+
+    const uint8_t *p_data = reinterpret_cast<const uint8_t *>(p_record);
+
+    CANMessage frame;
+    frame.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_CRASH_DATA;
+    frame.len = CrashLogProtocol::frameSize;
+
+    // Stop as soon as the mailboxes are full, the rest goes out on the next iterations
+    while (m_readNext < m_readEnd) {
+        memcpy(frame.data, &p_data[m_readNext * CrashLogProtocol::frameSize], CrashLogProtocol::frameSize);
+
+        if (!m_can.write(frame)) {
+            break;
+        }
+
+        m_readNext++;
+    }
+}
+
+void CrashLogService::fillSummary(CANMessage &reply) {
+    const CrashLogProtocol::t_record *p_record = CrashLog::getRecord();
+
+    reply.data[2] = CrashLog::getResetFlags();
+    reply.len     = 8;
+
+    if (p_record == NULL) {
+        return;
+    }
+
+    reply.data[3] = p_record->cause;
+    memcpy(&reply.data[4], &p_record->crashCount, sizeof(p_record->crashCount));
+    reply.data[6] = p_record->eventCount;
+    reply.data[7] = CrashLogProtocol::frameCount;
+}
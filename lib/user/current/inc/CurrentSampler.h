@@ -0,0 +1,92 @@
+#ifndef CURRENT_SAMPLER_H
+#define CURRENT_SAMPLER_H
+
+/* Samples a set of I2C current sensor ADCs in the background.
+ *
+ * Reads of the sensors are chained through the asynchronous I2C API: the
+ * completion interrupt of a read accumulates its result and starts the read
+ * of the next sensor, so the bus is kept busy at 400 kHz without the main loop
+ * taking part. Every period the accumulators are turned into the mean ADC
+ * code of each sensor, which the app converts to amps. Between interrupts the
+ * CPU is free to sleep.
+ *
+ * A code is read as 12 bits left aligned in two bytes, the first byte and
+ * the top half of the second. The safety board's zero codes and scales were
+ * calibrated against this decode, so it must not change without them.
+ */
+
+#include "mbed.h"
+
+#define CURRENT_SAMPLER_MAX_SENSORS 4
+#define CURRENT_SAMPLER_I2C_HZ      400000
+
+class CurrentSampler {
+
+public:
+
+    CurrentSampler(I2C &i2c);
+
+    /** Add a sensor, before start()
+     *
+     * @param address 8 bit I2C address
+     */
+    mbed_error_status_t addSensor(uint8_t index, int address);
+
+    /** Start sampling, new averages are ready every periodUs
+     */
+    void start(uint32_t periodUs);
+
+    void stop(void);
+
+    /** Call a function with every sample, in interrupt context
+     */
+    void attachSample(Callback<void(uint8_t, uint16_t)> onSample);
+
+    /** @return true once per period, when new averages are ready
+     */
+    bool hasNewAverages(void);
+
+    /** @return Mean ADC code of a sensor over the last period
+     */
+    float getAverage(uint8_t index);
+
+    /** @return Reads of a sensor averaged over the last period, 0 if it did not answer
+     */
+    uint16_t getSampleCount(uint8_t index);
+
+    /** @return Failed reads of a sensor since start()
+     */
+    uint32_t getErrorCount(uint8_t index);
+
+private:
+
+    typedef struct {
+        int address;
+        uint32_t sum;
+        uint16_t count;
+        float average;
+        uint16_t averageCount;
+        uint32_t errors;
+
+    } t_sensor;
+
+    void startRead(void);
+    void onRead(int event);
+    void publish(void);
+
+    I2C &m_i2c;
+    Ticker m_ticker;
+    Callback<void(uint8_t, uint16_t)> m_onSample;
+
+    t_sensor m_sensors[CURRENT_SAMPLER_MAX_SENSORS];
+    uint8_t m_sensorCount;
+    uint8_t m_current;
+    char m_rxData[2];
+
+    volatile bool m_isRunning;
+    volatile bool m_isReading;
+    volatile bool m_hasNewAverages;
+
+};
+
+#endif // CURRENT_SAMPLER_H
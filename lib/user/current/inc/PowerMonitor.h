@@ -0,0 +1,67 @@
+#ifndef POWER_MONITOR_H
+#define POWER_MONITOR_H
+
+/* Watches the current of every rail of the safety board and reports it.
+ *
+ * Every sample of the CurrentSampler goes through the rail's RailMonitor in
+ * the sampler's interrupt. A newly raised fault is sent by the next poll(),
+ * right after the interrupt wakes the main loop, on the fault ID, which wins
+ * arbitration over every other frame of the rover. Frames (little endian):
+ *
+ *   faultCanId          rail, faults (RailMonitor::t_fault), int16 current in
+ *                       10 mA, uint8 I2t budget used in %
+ *   currentCanId + rail int16 mean current in 10 mA, faults, I2t %, every
+ *                       sampler period
+ *   energyCanId + rail  int32 charge in mC, int32 energy in J, every
+ *                       POWER_MONITOR_ENERGY_PERIODS sampler periods, as
+ *                       the transmit mailboxes free up
+ *
+ * Charge and energy count from power up.
+ */
+
+#include "mbed.h"
+#include "CurrentSampler.h"
+#include "RailMonitor.h"
+
+#define POWER_MONITOR_ENERGY_PERIODS 100
+
+class PowerMonitor {
+
+public:
+
+    PowerMonitor(CAN &can, CurrentSampler &sampler, uint32_t faultCanId, uint32_t currentCanId, uint32_t energyCanId);
+
+    /** Set the limits and calibration of the rail measured by a sampler sensor, before the sampler starts
+     */
+    mbed_error_status_t addRail(uint8_t index, const RailMonitor::t_config &config);
+
+    /** Send faults as soon as they are raised and the periodic reports, call every main loop iteration
+     */
+    void poll(void);
+
+    /** @return Mean current of a rail over the last sampler period
+     */
+    int32_t getMilliamps(uint8_t index);
+
+private:
+
+    void onSample(uint8_t index, uint16_t code);
+    void sendFault(uint8_t index);
+    void sendReports(void);
+    void sendEnergy(uint8_t index);
+
+    CAN &m_can;
+    CurrentSampler &m_sampler;
+    uint32_t m_faultCanId, m_currentCanId, m_energyCanId;
+
+    RailMonitor m_rails[CURRENT_SAMPLER_MAX_SENSORS];
+    int32_t m_milliamps[CURRENT_SAMPLER_MAX_SENSORS];
+    uint8_t m_railCount;
+
+    volatile uint8_t m_pendingFaults;   // One bit per rail
+    uint8_t m_pendingEnergy;
+    uint32_t m_periods;
+
+};
+
+#endif // POWER_MONITOR_H
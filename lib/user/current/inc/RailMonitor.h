@@ -0,0 +1,92 @@
+#ifndef RAIL_MONITOR_H
+#define RAIL_MONITOR_H
+
+/* Overcurrent detection and charge counting for one power rail.
+ *
+ * Every ADC sample is converted to milliamps and checked against two limits:
+ * an instant trip current, and an I2t budget that fills while the current is
+ * above the rail's continuous rating and drains below it, the way a slow fuse
+ * heats up. Both faults clear well short of where they were raised, so a rail
+ * sitting at a limit raises its fault once rather than on every other sample. The same samples are integrated into the charge drawn from the
+ * battery, the energy is that charge at the rail's nominal voltage since there
+ * is no voltage sensing.
+ *
+ * Integer only so it can run on every sample in interrupt context. No mbed
+ * dependencies.
+ */
+
+#include <stdint.h>
+
+#define RAIL_MONITOR_MAX_GAP_US         100000  // Longer gaps between samples (sensor not answering) are not integrated
+#define RAIL_MONITOR_TRIP_CLEAR_PERCENT 90      // An instant fault clears below this share of the trip current
+
+class RailMonitor {
+
+public:
+
+    typedef struct {
+        int32_t zeroCode;               // Current is offsetMilliamps at this ADC code
+        int32_t microampsPerCode;       // Current change per code below zeroCode
+        int32_t offsetMilliamps;
+        int32_t tripMilliamps;          // Instant fault above this, 0 to disable
+        int32_t ratedMilliamps;         // I2t builds up above this
+        uint32_t i2tLimit;              // A^2 s above the rating before a fault, 0 to disable
+        uint32_t nominalMillivolts;
+
+    } t_config;
+
+    typedef enum {
+        faultInstant = 0x01,
+        faultI2t     = 0x02
+    } t_fault;
+
+    RailMonitor();
+
+    void configure(const t_config &config);
+
+    /** Convert and check a sample
+     *
+     * @return Faults raised by this sample
+     */
+    uint8_t addSample(uint16_t code, uint32_t timeUs);
+
+    /** @return Current of the last sample
+     */
+    int32_t getMilliamps(void);
+
+    /** @return Mean current since the last call, the last sample's if there were none
+     */
+    int32_t takeAverageMilliamps(void);
+
+    /** @return Faults currently active
+     */
+    uint8_t getFaults(void);
+
+    /** @return I2t budget used, saturated at 255 %
+     */
+    uint8_t getI2tPercent(void);
+
+    int32_t getChargeMillicoulombs(void);
+
+    int32_t getEnergyJoules(void);
+
+private:
+
+    t_config m_config;
+    int64_t m_i2tLimit;                 // mA^2 ms
+
+    int32_t m_milliamps;
+    int64_t m_sumMilliamps;
+    uint32_t m_sampleCount;
+
+    uint32_t m_lastSampleUs;
+    bool m_hasSample;
+
+    int64_t m_i2t;                      // mA^2 ms
+    int64_t m_chargeMilliampMicroseconds;
+
+    uint8_t m_faults;
+
+};
+
+#endif // RAIL_MONITOR_H
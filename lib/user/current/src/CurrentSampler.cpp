@@ -0,0 +1,132 @@
+/* Samples a set of I2C current sensor ADCs in the background.
+ */
+
+#include "CurrentSampler.h"
+
+CurrentSampler::CurrentSampler(I2C &i2c) :
+        m_i2c(i2c), m_sensorCount(0), m_current(0), m_isRunning(false), m_isReading(false), m_hasNewAverages(false) {}
+
+mbed_error_status_t CurrentSampler::addSensor(uint8_t index, int address) {
+    MBED_ASSERT_WARN(!m_isRunning);
+
+    if (index >= CURRENT_SAMPLER_MAX_SENSORS || m_isRunning) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    t_sensor &sensor = m_sensors[index];
+    memset(&sensor, 0, sizeof(sensor));
+    sensor.address = address;
+
+    if (index >= m_sensorCount) {
+        m_sensorCount = index + 1;
+    }
+
+    return MBED_SUCCESS;
+}
+
+void CurrentSampler::start(uint32_t periodUs) {
+    if (m_isRunning || m_sensorCount == 0) {
+        return;
+    }
+
+    m_i2c.frequency(CURRENT_SAMPLER_I2C_HZ);
+
+    m_isRunning = true;
+    m_current   = 0;
+    m_ticker.attach_us(callback(this, &CurrentSampler::publish), periodUs);
+
+    startRead();
+}
+
+void CurrentSampler::stop(void) {
+    m_ticker.detach();
+    m_isRunning = false;
+
+    // The read in progress completes on its own and starts nothing more
+}
+
+void CurrentSampler::attachSample(Callback<void(uint8_t, uint16_t)> onSample) {
+    m_onSample = onSample;
+}
+
+bool CurrentSampler::hasNewAverages(void) {
+    if (!m_hasNewAverages) {
+        return false;
+    }
+
+    m_hasNewAverages = false;
+    return true;
+}
+
+float CurrentSampler::getAverage(uint8_t index) {
+    return index < m_sensorCount ? m_sensors[index].average : 0.0f;
+}
+
+uint16_t CurrentSampler::getSampleCount(uint8_t index) {
+    return index < m_sensorCount ? m_sensors[index].averageCount : 0;
+}
+
+uint32_t CurrentSampler::getErrorCount(uint8_t index) {
+    return index < m_sensorCount ? m_sensors[index].errors : 0;
+}
+
+void CurrentSampler::startRead(void) {
+    m_isReading = m_i2c.transfer(m_sensors[m_current].address, NULL, 0, m_rxData, sizeof(m_rxData),
+                                 callback(this, &CurrentSampler::onRead), I2C_EVENT_ALL) == 0;
+}
+
+// Interrupt context
+void CurrentSampler::onRead(int event) {
+    t_sensor &sensor = m_sensors[m_current];
+
+    // publish() may interrupt this
+    core_util_critical_section_enter();
+
+    bool isComplete = event & I2C_EVENT_TRANSFER_COMPLETE;
+    uint16_t code = ((uint8_t)m_rxData[0] << 4) + ((uint8_t)m_rxData[1] >> 4);
+
+    if (isComplete) {
+        sensor.sum += code;
+        sensor.count++;
+    }
+    else {
+        sensor.errors++;
+    }
+
+    core_util_critical_section_exit();
+
+    if (isComplete && m_onSample) {
+        m_onSample(m_current, code);
+    }
+
+    if (m_isRunning) {
+        m_current = (m_current + 1) % m_sensorCount;
+        startRead();
+    }
+    else {
+        m_isReading = false;
+    }
+}
+
+// Interrupt context
+void CurrentSampler::publish(void) {
+    core_util_critical_section_enter();
+
+    for (uint8_t i = 0; i < m_sensorCount; i++) {
+        t_sensor &sensor = m_sensors[i];
+
+        sensor.average      = sensor.count > 0 ? (float)sensor.sum / sensor.count : 0.0f;
+        sensor.averageCount = sensor.count;
+        sensor.sum          = 0;
+        sensor.count        = 0;
+    }
+
+    core_util_critical_section_exit();
+
+    m_hasNewAverages = true;
+
+    // A read that could not be started (the bus was busy) would have stopped the chain
+    if (m_isRunning && !m_isReading) {
+        startRead();
+    }
+}
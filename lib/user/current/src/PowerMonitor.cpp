@@ -0,0 +1,135 @@
+/* Watches the current of every rail of the safety board and reports it.
+ */
+
+#include "PowerMonitor.h"
+
+#define FAULT_FRAME_SIZE    5
+#define CURRENT_FRAME_SIZE  4
+#define ENERGY_FRAME_SIZE   8
+
+PowerMonitor::PowerMonitor(CAN &can, CurrentSampler &sampler, uint32_t faultCanId, uint32_t currentCanId,
+                           uint32_t energyCanId) :
+        m_can(can), m_sampler(sampler), m_faultCanId(faultCanId), m_currentCanId(currentCanId),
+        m_energyCanId(energyCanId), m_railCount(0), m_pendingFaults(0), m_pendingEnergy(0), m_periods(0) {
+
+    memset(m_milliamps, 0, sizeof(m_milliamps));
+    m_sampler.attachSample(callback(this, &PowerMonitor::onSample));
+}
+
+mbed_error_status_t PowerMonitor::addRail(uint8_t index, const RailMonitor::t_config &config) {
+    if (index >= CURRENT_SAMPLER_MAX_SENSORS) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    core_util_critical_section_enter();
+    m_rails[index].configure(config);
+    core_util_critical_section_exit();
+
+    if (index >= m_railCount) {
+        m_railCount = index + 1;
+    }
+
+    return MBED_SUCCESS;
+}
+
+void PowerMonitor::poll(void) {
+    // Faults first, a fault that finds the mailboxes full is retried on the next call
+    for (uint8_t i = 0; i < m_railCount; i++) {
+        if (m_pendingFaults & (1 << i)) {
+            sendFault(i);
+        }
+    }
+
+    if (m_sampler.hasNewAverages()) {
+        sendReports();
+    }
+
+    for (uint8_t i = 0; i < m_railCount; i++) {
+        if (m_pendingEnergy & (1 << i)) {
+            sendEnergy(i);
+        }
+    }
+}
+
+int32_t PowerMonitor::getMilliamps(uint8_t index) {
+    return index < m_railCount ? m_milliamps[index] : 0;
+}
+
+// Interrupt context
+void PowerMonitor::onSample(uint8_t index, uint16_t code) {
+    if (index >= m_railCount) {
+        return;
+    }
+
+    if (m_rails[index].addSample(code, ticker_read(get_us_ticker_data()))) {
+        m_pendingFaults |= 1 << index;
+    }
+}
+
+void PowerMonitor::sendFault(uint8_t index) {
+    CANMessage msg;
+    msg.id  = m_faultCanId;
+    msg.len = FAULT_FRAME_SIZE;
+
+    core_util_critical_section_enter();
+    RailMonitor &rail = m_rails[index];
+    int16_t centiamps = rail.getMilliamps() / 10;
+    msg.data[1] = rail.getFaults();
+    msg.data[4] = rail.getI2tPercent();
+    core_util_critical_section_exit();
+
+    msg.data[0] = index;
+    memcpy(&msg.data[2], &centiamps, sizeof(centiamps));
+
+    if (m_can.write(msg)) {
+        core_util_critical_section_enter();
+        m_pendingFaults &= ~(1 << index);
+        core_util_critical_section_exit();
+    }
+}
+
+void PowerMonitor::sendReports(void) {
+    // Energy frames go out after the currents, the mailboxes are full until then
+    if (++m_periods % POWER_MONITOR_ENERGY_PERIODS == 0) {
+        m_pendingEnergy = (1 << m_railCount) - 1;
+    }
+
+    for (uint8_t i = 0; i < m_railCount; i++) {
+        CANMessage msg;
+
+        core_util_critical_section_enter();
+        RailMonitor &rail = m_rails[i];
+        m_milliamps[i] = rail.takeAverageMilliamps();
+        msg.data[2] = rail.getFaults();
+        msg.data[3] = rail.getI2tPercent();
+        core_util_critical_section_exit();
+
+        int16_t centiamps = m_milliamps[i] / 10;
+
+        msg.id  = m_currentCanId + i;
+        msg.len = CURRENT_FRAME_SIZE;
+        memcpy(&msg.data[0], &centiamps, sizeof(centiamps));
+
+        // The next period's frame replaces a lost one
+        m_can.write(msg);
+    }
+}
+
+void PowerMonitor::sendEnergy(uint8_t index) {
+    CANMessage msg;
+    int32_t chargeMillicoulombs, energyJoules;
+
+    core_util_critical_section_enter();
+    chargeMillicoulombs = m_rails[index].getChargeMillicoulombs();
+    energyJoules        = m_rails[index].getEnergyJoules();
+    core_util_critical_section_exit();
+
+    msg.id  = m_energyCanId + index;
+    msg.len = ENERGY_FRAME_SIZE;
+    memcpy(&msg.data[0], &chargeMillicoulombs, sizeof(chargeMillicoulombs));
+    memcpy(&msg.data[4], &energyJoules, sizeof(energyJoules));
+
+    if (m_can.write(msg)) {
+        m_pendingEnergy &= ~(1 << index);
+    }
+}
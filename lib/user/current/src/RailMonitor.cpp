@@ -0,0 +1,114 @@
+/* Overcurrent detection and charge counting for one power rail.
+ */
+
+#include <string.h>
+#include "RailMonitor.h"
+
+#define MILLIAMP_SQUARED_MS_PER_AMP_SQUARED_S   1000000000LL
+
+RailMonitor::RailMonitor() {
+    t_config config;
+    memset(&config, 0, sizeof(config));
+    configure(config);
+}
+
+void RailMonitor::configure(const t_config &config) {
+    m_config   = config;
+    m_i2tLimit = config.i2tLimit * MILLIAMP_SQUARED_MS_PER_AMP_SQUARED_S;
+
+    m_milliamps                  = 0;
+    m_sumMilliamps               = 0;
+    m_sampleCount                = 0;
+    m_lastSampleUs               = 0;
+    m_hasSample                  = false;
+    m_i2t                        = 0;
+    m_chargeMilliampMicroseconds = 0;
+    m_faults                     = 0;
+}
+
+uint8_t RailMonitor::addSample(uint16_t code, uint32_t timeUs) {
+    m_milliamps = (int32_t)((int64_t)(m_config.zeroCode - code) * m_config.microampsPerCode / 1000) +
+                  m_config.offsetMilliamps;
+
+    m_sumMilliamps += m_milliamps;
+    m_sampleCount++;
+
+    uint32_t gapUs = m_hasSample ? timeUs - m_lastSampleUs : 0;
+    m_lastSampleUs = timeUs;
+    m_hasSample    = true;
+
+    if (gapUs > RAIL_MONITOR_MAX_GAP_US) {
+        gapUs = 0;
+    }
+
+    m_chargeMilliampMicroseconds += (int64_t)m_milliamps * gapUs;
+
+    // The budget fills with the heat above the rating and drains with the cooling below it
+    if (m_i2tLimit > 0) {
+        int64_t excess = (int64_t)m_milliamps * m_milliamps - (int64_t)m_config.ratedMilliamps * m_config.ratedMilliamps;
+        m_i2t += excess * gapUs / 1000;
+
+        if (m_i2t < 0) {
+            m_i2t = 0;
+        }
+    }
+
+    uint8_t faults = 0;
+
+    // Cleared below a lower current, so a rail hovering at the trip doesn't flood the bus with faults
+    int32_t clearMilliamps = (int32_t)((int64_t)m_config.tripMilliamps * RAIL_MONITOR_TRIP_CLEAR_PERCENT / 100);
+
+    if (m_config.tripMilliamps > 0 &&
+        (m_milliamps > m_config.tripMilliamps || ((m_faults & faultInstant) && m_milliamps > clearMilliamps))) {
+        faults |= faultInstant;
+    }
+
+    // Cleared once half the budget is back, so a rail at its limit doesn't flap
+    if (m_i2tLimit > 0 && (m_i2t >= m_i2tLimit || ((m_faults & faultI2t) && m_i2t >= m_i2tLimit / 2))) {
+        faults |= faultI2t;
+    }
+
+    uint8_t raised = faults & ~m_faults;
+    m_faults = faults;
+
+    return raised;
+}
+
+int32_t RailMonitor::getMilliamps(void) {
+    return m_milliamps;
+}
+
+int32_t RailMonitor::takeAverageMilliamps(void) {
+    if (m_sampleCount == 0) {
+        return m_milliamps;
+    }
+
+    int32_t average = (int32_t)(m_sumMilliamps / m_sampleCount);
+
+    m_sumMilliamps = 0;
+    m_sampleCount  = 0;
+
+    return average;
+}
+
+uint8_t RailMonitor::getFaults(void) {
+    return m_faults;
+}
+
+uint8_t RailMonitor::getI2tPercent(void) {
+    if (m_i2tLimit == 0) {
+        return 0;
+    }
+
+    int64_t percent = m_i2t * 100 / m_i2tLimit;
+    return percent > 255 ? 255 : (uint8_t)percent;
+}
+
+int32_t RailMonitor::getChargeMillicoulombs(void) {
+    return (int32_t)(m_chargeMilliampMicroseconds / 1000000);
+}
+
+int32_t RailMonitor::getEnergyJoules(void) {
+    // mA us * mV = 1e-12 J
+    return (int32_t)(m_chargeMilliampMicroseconds / 1000000 * m_config.nominalMillivolts / 1000000);
+}
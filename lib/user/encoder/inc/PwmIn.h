@@ -28,13 +28,15 @@
 #endif
 
 #include "mbed.h"
+#include "DirectInterruptIn.h"
+#include "MicrosecondClock.h"
+#include "DeferredEventQueue.h"
 
 /** PwmIn class to read PWM inputs
  * 
- * Uses InterruptIn to measure the changes on the input
- * and record the time they occur
- *
- * @note uses InterruptIn, so not available on p19/p20
+ * Uses DirectInterruptIn to measure the changes on the input
+ * and record the time they occur on the microsecond clock, the
+ * averages are updated from the shared DeferredEventQueue
  */
 class PwmIn {
 
@@ -50,7 +52,7 @@ public:
 
     /** Create a PwmIn with a specified number of pulses to average
      *
-     * @param pwmSense           The pwm input pin (must support InterruptIn)
+     * @param pwmSense           The pwm input pin, with its EXTI line free
      * @param numSamplesToAverage The number of PWM measurements to sum before averaging
      */ 
     PwmIn(PinName pwmSense, int numSamplesToAverage = PWM_IN_DEFAULT_NUM_SAMPLES_TO_AVERAGE);
@@ -101,24 +103,32 @@ public:
 
 protected:
     
-    InterruptIn _pwmSense;
-    Timer _timer;
+    DirectInterruptIn _pwmSense;
 
-    float _pulseWidth, _period;
-    float _avgPulseWidth, _avgPeriod, _avgDutyCycle, _prevAvgDutyCycle, _avgDutyCycleVelocity;
+    uint32_t _pulseWidthUs, _periodUs, _riseUs;
+    float _avgDutyCycle, _prevAvgDutyCycle, _avgDutyCycleVelocity;
     
     int _sampleCount;
     int _numSamplesToAverage; 
 
-    float * _p_pulseWidthSamples;
-    float * _p_periodSamples;
+    uint32_t * _p_pulseWidthSamplesUs;
+    uint32_t * _p_periodSamplesUs;
+
+    uint32_t _pulseWidthSampleSumUs;
+    uint32_t _periodSampleSumUs;
 
-    float _pulseWidthSampleSum;
-    float _periodSampleSum;
+    // Sums at the last fall, and the falls seen before and since the last average
+    uint32_t _fallPulseWidthSumUs, _fallPeriodSumUs;
+    volatile uint32_t _fallCount;
+    uint32_t _averagedFallCount;
+    volatile bool _isAveragePending;
 
     void rise();
     void fall();
-    float movingAvg(float * p_samples, float * p_sampleSum, float newSample, int newIndex);
+    void updateAverages();
+    static void edge(void *p_pwmIn, int level);
+    static void average(void *p_pwmIn, uint32_t arg);
+    static void movingSum(uint32_t * p_samples, uint32_t * p_sampleSum, uint32_t newSample, int newIndex);
 
 };
 
@@ -130,6 +130,8 @@
  * Includes
  */
 #include "mbed.h"
+#include "DirectInterruptIn.h"
+#include "MicrosecondClock.h"
 
 /**
  * Defines
@@ -186,7 +188,7 @@ public:
      */
     QEI(PinName channelA, PinName channelB, PinName index, int pulsesPerRev, Encoding encoding = X2_ENCODING);
 
-    QEI(QEI::t_relativeEncoderConfig);
+    QEI(const QEI::t_relativeEncoderConfig &encoderConfig);
 
     QEI();
 
@@ -220,6 +222,17 @@ public:
      */
     int getRevolutions(void);
 
+    /**
+     * Read the pulse count along with the time of the edge that last changed it.
+     *
+     * This count is not cleared by reset(), so a velocity can be taken across
+     * a reset of the position.
+     *
+     * @param pulses     Pulses counted since construction.
+     * @param edgeTimeUs MicrosecondClock time of the last counted edge.
+     */
+    void getEdgeSnapshot(int &pulses, uint32_t &edgeTimeUs);
+
 private:
 
     /**
@@ -227,10 +240,10 @@ private:
      *
      * Called on every rising/falling edge of channels A/B.
      *
-     * Reads the state of the channels and determines whether a pulse forward
+     * Determines from the state of the channels whether a pulse forward
      * or backward has occured, updating the count appropriately.
      */
-    void encode(void);
+    void encode(int chanA, int chanB);
 
     /**
      * Called on every rising edge of channel index to update revolution
@@ -238,11 +251,19 @@ private:
      */
     void index(void);
 
+    /**
+     * Interrupt handlers bound to the channels, with the level of the
+     * channel that changed.
+     */
+    static void channelAEdge(void *p_qei, int level);
+    static void channelBEdge(void *p_qei, int level);
+    static void indexEdge(void *p_qei, int level);
+
     Encoding encoding_;
 
-    InterruptIn channelA_;
-    InterruptIn channelB_;
-    InterruptIn index_;
+    DirectInterruptIn channelA_;
+    DirectInterruptIn channelB_;
+    DirectInterruptIn index_;
 
     int          pulsesPerRev_;
     int          prevState_;
@@ -251,6 +272,9 @@ private:
     volatile int pulses_;
     volatile int revolutions_;
 
+    volatile int      totalPulses_;
+    volatile uint32_t edgeTimeUs_;
+
 };
 
 #endif /* QEI_H */
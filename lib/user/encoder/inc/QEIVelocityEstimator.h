@@ -0,0 +1,56 @@
+#ifndef QEI_VELOCITY_ESTIMATOR_H
+#define QEI_VELOCITY_ESTIMATOR_H
+
+/* Speed of a QEI axis by the M/T method.
+ *
+ * Every update divides the pulses counted since the previous update by the
+ * time between the last edges of the two updates, taken from the timestamps
+ * QEI records in its edge interrupt. At speed this averages many edges over
+ * the control period, like counting pulses, and at a crawl it times the single
+ * edge period instead of rounding it to 0 or 1 pulse per period. Neither end
+ * is quantised by the update rate.
+ *
+ * When no edge came since the last update, the speed can be no higher than
+ * one pulse over the time since the last edge, and it decays along that bound
+ * until the axis is considered stopped.
+ */
+
+#include "mbed.h"
+#include "QEI.h"
+
+#define QEI_VELOCITY_DEFAULT_STOP_TIMEOUT_US 250000
+
+class QEIVelocityEstimator {
+
+public:
+
+    /** @param stopTimeoutUs Without an edge for this long the axis is stopped
+     */
+    explicit QEIVelocityEstimator(QEI &encoder, uint32_t stopTimeoutUs = QEI_VELOCITY_DEFAULT_STOP_TIMEOUT_US);
+
+    /** Take a new measurement, call once per control period
+     */
+    void update(void);
+
+    /** Restart the estimation from a stopped axis
+     */
+    void reset(void);
+
+    /** @return Speed measured on the last update, in encoder pulses per second
+     */
+    float getPulsesPerSecond(void);
+
+private:
+
+    QEI &m_encoder;
+    uint32_t m_stopTimeoutUs;
+
+    bool m_isStarted;
+    int m_prevPulses;
+    uint32_t m_prevEdgeUs;
+
+    float m_pulsesPerSecond;
+
+};
+
+#endif // QEI_VELOCITY_ESTIMATOR_H
@@ -22,48 +22,57 @@
 
 #include "PwmIn.h"
 
-PwmIn::PwmIn(PinName pwmSense, int numSamplesToAverage) : _pwmSense(pwmSense), _numSamplesToAverage(numSamplesToAverage) {
-    _pwmSense.rise(callback(this, &PwmIn::rise));
-    _pwmSense.fall(callback(this, &PwmIn::fall));
+#define US_PER_SECOND 1000000.0f
 
-    _period = 0.0;
-    _pulseWidth = 0.0;
-    _periodSampleSum = 0.0;
-    _pulseWidthSampleSum = 0.0;
+PwmIn::PwmIn(PinName pwmSense, int numSamplesToAverage) : _pwmSense(pwmSense), _numSamplesToAverage(numSamplesToAverage) {
+    _pulseWidthUs = 0;
+    _periodUs = 0;
+    _periodSampleSumUs = 0;
+    _pulseWidthSampleSumUs = 0;
+    _fallPulseWidthSumUs = 0;
+    _fallPeriodSumUs = 0;
     _sampleCount = 0;
+    _fallCount = 0;
+    _averagedFallCount = 0;
+    _isAveragePending = false;
     _avgDutyCycle = 0;
     _prevAvgDutyCycle = 0;
     _avgDutyCycleVelocity = 0;
 
-    _p_periodSamples = new float[_numSamplesToAverage]();
-    _p_pulseWidthSamples = new float[_numSamplesToAverage]();
+    _p_periodSamplesUs = new uint32_t[_numSamplesToAverage]();
+    _p_pulseWidthSamplesUs = new uint32_t[_numSamplesToAverage]();
+
+    MicrosecondClock::init();
+    _riseUs = MicrosecondClock::read();
 
-    _timer.start();
+    MBED_WARN_ON_ERROR(_pwmSense.attach(&PwmIn::edge, this, true, true));
 }
 
 PwmIn::~PwmIn() {
-    delete [] _p_pulseWidthSamples;
-    delete [] _p_periodSamples;
+    _pwmSense.detach();
+    DeferredEventQueue::getShared().cancel(this);
+    delete [] _p_pulseWidthSamplesUs;
+    delete [] _p_periodSamplesUs;
 }
 
 float PwmIn::period() {
-    return _period;
+    return _periodUs / US_PER_SECOND;
 }
 
 float PwmIn::avgPeriod() {
-    return _avgPeriod;
+    return _periodSampleSumUs / (US_PER_SECOND * _numSamplesToAverage);
 }
 
 float PwmIn::pulseWidth() {
-    return _pulseWidth;
+    return _pulseWidthUs / US_PER_SECOND;
 }
 
 float PwmIn::avgPulseWidth() {
-    return _avgPulseWidth;
+    return _pulseWidthSampleSumUs / (US_PER_SECOND * _numSamplesToAverage);
 }
 
 float PwmIn::dutyCycle() {
-    return _pulseWidth / _period;
+    return (float)_pulseWidthUs / (float)_periodUs;
 }
 
 float PwmIn::avgDutyCycle() {
@@ -74,32 +83,74 @@ float PwmIn::avgDutyCycleVelocity() {
     return _avgDutyCycleVelocity;
 }
 
+void PwmIn::edge(void *p_pwmIn, int level) {
+    if (level) {
+        static_cast<PwmIn *>(p_pwmIn)->rise();
+    }
+    else {
+        static_cast<PwmIn *>(p_pwmIn)->fall();
+    }
+}
+
+void PwmIn::average(void *p_pwmIn, uint32_t arg) {
+    static_cast<PwmIn *>(p_pwmIn)->updateAverages();
+}
+
 void PwmIn::rise() {
-    _period = _timer.read();
-    _timer.reset();
+    uint32_t nowUs = MicrosecondClock::read();
 
-    _avgPeriod = PwmIn::movingAvg(_p_periodSamples, &_periodSampleSum, _period, _sampleCount);
+    _periodUs = nowUs - _riseUs;
+    _riseUs = nowUs;
+
+    PwmIn::movingSum(_p_periodSamplesUs, &_periodSampleSumUs, _periodUs, _sampleCount);
 }
 
 void PwmIn::fall() {
-    _pulseWidth = _timer.read();
+    _pulseWidthUs = MicrosecondClock::read() - _riseUs;
 
-    _avgPulseWidth = PwmIn::movingAvg(_p_pulseWidthSamples, &_pulseWidthSampleSum, _pulseWidth, _sampleCount);
-    _avgDutyCycle = _avgPulseWidth / _avgPeriod;
-    _avgDutyCycleVelocity = (_avgDutyCycle - _prevAvgDutyCycle) / _avgPeriod;
-    _prevAvgDutyCycle = _avgDutyCycle;
+    PwmIn::movingSum(_p_pulseWidthSamplesUs, &_pulseWidthSampleSumUs, _pulseWidthUs, _sampleCount);
+
+    _fallPulseWidthSumUs = _pulseWidthSampleSumUs;
+    _fallPeriodSumUs = _periodSampleSumUs;
+    _fallCount++;
 
     _sampleCount++;
 
     if (_sampleCount >= _numSamplesToAverage) {
         _sampleCount = 0;
     }
+
+    // The floating point averages are left to the event queue, one pending update covers any number of falls
+    if (!_isAveragePending) {
+        _isAveragePending = DeferredEventQueue::getShared().post(&PwmIn::average, this);
+    }
+}
+
+void PwmIn::updateAverages() {
+    core_util_critical_section_enter();
+
+    uint32_t pulseWidthSumUs = _fallPulseWidthSumUs;
+    uint32_t periodSumUs = _fallPeriodSumUs;
+    uint32_t fallCount = _fallCount;
+    _isAveragePending = false;
+
+    core_util_critical_section_exit();
+
+    uint32_t falls = fallCount - _averagedFallCount;
+    _averagedFallCount = fallCount;
+
+    if (periodSumUs == 0 || falls == 0) {
+        return;
+    }
+
+    // Both sums hold the same number of samples, so their ratio is the ratio of the averages
+    _avgDutyCycle = (float)pulseWidthSumUs / (float)periodSumUs;
+    _avgDutyCycleVelocity = (_avgDutyCycle - _prevAvgDutyCycle) * (_numSamplesToAverage * US_PER_SECOND) / ((float)periodSumUs * falls);
+    _prevAvgDutyCycle = _avgDutyCycle;
 }
 
-float PwmIn::movingAvg(float * p_samples, float * p_sampleSum, float newSample, int newIndex) {
+void PwmIn::movingSum(uint32_t * p_samples, uint32_t * p_sampleSum, uint32_t newSample, int newIndex) {
     *p_sampleSum -= p_samples[newIndex];
     p_samples[newIndex] = newSample;
     *p_sampleSum += p_samples[newIndex];
-
-    return *p_sampleSum / (float) _numSamplesToAverage;
 }
@@ -137,9 +137,13 @@ QEI::QEI(PinName channelA,
 
     pulses_       = 0;
     revolutions_  = 0;
+    totalPulses_  = 0;
+    edgeTimeUs_   = 0;
     pulsesPerRev_ = pulsesPerRev;
     encoding_     = encoding;
 
+    MicrosecondClock::init();
+
     //Workout what the current state is.
     int chanA = channelA_.read();
     int chanB = channelB_.read();
@@ -151,22 +155,20 @@ QEI::QEI(PinName channelA,
     //X2 encoding uses interrupts on only channel A.
     //X4 encoding uses interrupts on      channel A,
     //and on channel B.
-    channelA_.rise(callback(this, &QEI::encode));
-    channelA_.fall(callback(this, &QEI::encode));
+    MBED_WARN_ON_ERROR(channelA_.attach(&QEI::channelAEdge, this, true, true));
 
     //If we're using X4 encoding, then attach interrupts to channel B too.
     if (encoding == X4_ENCODING) {
-        channelB_.rise(callback(this, &QEI::encode));
-        channelB_.fall(callback(this, &QEI::encode));
+        MBED_WARN_ON_ERROR(channelB_.attach(&QEI::channelBEdge, this, true, true));
     }
     //Index is optional.
     if (index !=  NC) {
-        index_.rise(callback(this, &QEI::index));
+        MBED_WARN_ON_ERROR(index_.attach(&QEI::indexEdge, this, true, false));
     }
 
 }
 
-QEI::QEI(QEI::t_relativeEncoderConfig encoderConfig) :
+QEI::QEI(const QEI::t_relativeEncoderConfig &encoderConfig) :
     QEI(encoderConfig.channelAPin, encoderConfig.channelBPin, encoderConfig.indexPin,
     encoderConfig.pulsesPerRevolution, encoderConfig.encoding) {}
 
@@ -195,6 +197,15 @@ int QEI::getRevolutions(void) {
 
 }
 
+void QEI::getEdgeSnapshot(int &pulses, uint32_t &edgeTimeUs) {
+
+    core_util_critical_section_enter();
+    pulses     = totalPulses_;
+    edgeTimeUs = edgeTimeUs_;
+    core_util_critical_section_exit();
+
+}
+
 // +-------------+
 // | X2 Encoding |
 // +-------------+
@@ -239,11 +250,33 @@ int QEI::getRevolutions(void) {
 // We might enter an invalid state for a number of reasons which are hard to
 // predict - if this is the case, it is generally safe to ignore it, update
 // the state and carry on, with the error correcting itself shortly after.
-void QEI::encode(void) {
+void QEI::channelAEdge(void *p_qei, int level) {
+
+    QEI *p_encoder = static_cast<QEI *>(p_qei);
+    p_encoder->encode(level, p_encoder->channelB_.read());
+
+}
+
+void QEI::channelBEdge(void *p_qei, int level) {
+
+    QEI *p_encoder = static_cast<QEI *>(p_qei);
+    p_encoder->encode(p_encoder->channelA_.read(), level);
+
+}
+
+void QEI::indexEdge(void *p_qei, int level) {
+
+    static_cast<QEI *>(p_qei)->index();
+
+}
+
+void QEI::encode(int chanA, int chanB) {
+
+    //Timestamp the edge before anything else for the velocity estimate.
+    uint32_t timeUs = MicrosecondClock::read();
+    int prevPulses  = pulses_;
 
     int change = 0;
-    int chanA  = channelA_.read();
-    int chanB  = channelB_.read();
 
     //2-bit state.
     currState_ = (chanA << 1) | (chanB);
@@ -284,6 +317,11 @@ void QEI::encode(void) {
 
     prevState_ = currState_;
 
+    if (pulses_ != prevPulses) {
+        totalPulses_ += pulses_ - prevPulses;
+        edgeTimeUs_   = timeUs;
+    }
+
 }
 
 void QEI::index(void) {
@@ -0,0 +1,72 @@
+/* Speed of a QEI axis by the M/T method.
+ */
+
+#include "QEIVelocityEstimator.h"
+
+QEIVelocityEstimator::QEIVelocityEstimator(QEI &encoder, uint32_t stopTimeoutUs) :
+        m_encoder(encoder), m_stopTimeoutUs(stopTimeoutUs) {
+    reset();
+}
+
+void QEIVelocityEstimator::update(void) {
+    int pulses;
+    uint32_t edgeUs;
+
+    m_encoder.getEdgeSnapshot(pulses, edgeUs);
+    uint32_t nowUs = MicrosecondClock::read();
+
+    if (!m_isStarted) {
+        m_isStarted  = true;
+        m_prevPulses = pulses;
+        m_prevEdgeUs = nowUs - m_stopTimeoutUs;
+        return;
+    }
+
+    int deltaPulses = pulses - m_prevPulses;
+
+    if (deltaPulses != 0) {
+        uint32_t deltaUs = edgeUs - m_prevEdgeUs;
+
+        if (deltaUs > 0) {
+            m_pulsesPerSecond = deltaPulses * 1e6f / deltaUs;
+        }
+
+        m_prevPulses = pulses;
+        m_prevEdgeUs = edgeUs;
+        return;
+    }
+
+    uint32_t sinceEdgeUs = nowUs - m_prevEdgeUs;
+
+    // The first edge after a stop is timed from here, not from when the axis stopped
+    if (sinceEdgeUs >= m_stopTimeoutUs) {
+        m_pulsesPerSecond = 0.0f;
+        m_prevEdgeUs = nowUs - m_stopTimeoutUs;
+        return;
+    }
+
+    if (sinceEdgeUs == 0) {
+        return;
+    }
+
+    // An edge right now would be the fastest the axis can have gone
+    float maxPulsesPerSecond = 1e6f / sinceEdgeUs;
+
+    if (m_pulsesPerSecond > maxPulsesPerSecond) {
+        m_pulsesPerSecond = maxPulsesPerSecond;
+    }
+    else if (m_pulsesPerSecond < -maxPulsesPerSecond) {
+        m_pulsesPerSecond = -maxPulsesPerSecond;
+    }
+}
+
+void QEIVelocityEstimator::reset(void) {
+    m_isStarted       = false;
+    m_prevPulses      = 0;
+    m_prevEdgeUs      = 0;
+    m_pulsesPerSecond = 0.0f;
+}
+
+float QEIVelocityEstimator::getPulsesPerSecond(void) {
+    return m_pulsesPerSecond;
+}
@@ -0,0 +1,93 @@
+#ifndef DEFERRED_EVENT_QUEUE_H
+#define DEFERRED_EVENT_QUEUE_H
+
+/* Calls posted from interrupts and run later, outside of them.
+ *
+ * An interrupt does the time critical part of its work (reading a capture,
+ * counting an edge, firing a trigger) and posts the rest, a function with a
+ * context pointer and an argument, to a queue. Posting copies the event into
+ * a fixed ring in constant time and never allocates. The Cortex-M0 has no
+ * exclusive load/store, so a post masks interrupts for the few stores it
+ * takes to fill a slot; the consumer side takes no lock at all.
+ *
+ * The shared queue is run by PendSV at the lowest priority, as soon as no
+ * other interrupt is active, so deferred work still preempts the main loop
+ * (and sees the same data it did in the interrupt) but never delays an
+ * encoder edge. Other queues are run by whoever calls dispatch(), typically
+ * the main loop. A queue must only ever be dispatched from one context.
+ */
+
+#include "mbed.h"
+
+#define DEFERRED_EVENT_QUEUE_SIZE   32      // Power of two
+
+class DeferredEventQueue {
+
+public:
+
+    typedef void (*t_handler)(void *p_context, uint32_t arg);
+
+    typedef struct {
+        uint32_t pending, maxPending;
+        uint32_t posted, dropped, dispatched;
+        uint32_t maxLatencyUs;              // From a post to its handler being called
+
+    } t_stats;
+
+    DeferredEventQueue();
+
+    /** Queue a call, from any context
+     *
+     * @return false if the queue is full, the event is dropped and counted
+     */
+    bool post(t_handler handler, void *p_context, uint32_t arg = 0);
+
+    /** Forget the pending events of a context, before it is destroyed
+     */
+    void cancel(void *p_context);
+
+    /** Run every pending event, including those posted while running
+     *
+     * @return Number of events run
+     */
+    uint32_t dispatch(void);
+
+    uint32_t getPendingCount(void);
+
+    void getStats(t_stats &stats);
+
+    /** Restart the maximums and counts, pending events are kept
+     */
+    void resetStats(void);
+
+    /** @return Queue run by PendSV, built before any other static object
+     */
+    static DeferredEventQueue &getShared(void);
+
+private:
+
+    explicit DeferredEventQueue(bool isPendSVDispatched);
+
+    typedef struct {
+        t_handler handler;
+        void *p_context;
+        uint32_t arg;
+        uint32_t postedUs;
+
+    } t_event;
+
+    t_event m_events[DEFERRED_EVENT_QUEUE_SIZE];
+
+    // Free running, the slot is the index modulo the size
+    volatile uint32_t m_head, m_tail;
+
+    bool m_isPendSVDispatched;
+
+    volatile uint32_t m_maxPending, m_posted, m_dropped;
+    uint32_t m_dispatched, m_maxLatencyUs;
+
+    static DeferredEventQueue s_shared;
+
+};
+
+#endif // DEFERRED_EVENT_QUEUE_H
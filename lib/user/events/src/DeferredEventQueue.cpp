@@ -0,0 +1,144 @@
+/* Calls posted from interrupts and run later, outside of them.
+ */
+
+#include "DeferredEventQueue.h"
+#include "MicrosecondClock.h"
+
+#define SLOT_MASK   (DEFERRED_EVENT_QUEUE_SIZE - 1)
+
+#if (DEFERRED_EVENT_QUEUE_SIZE & SLOT_MASK) != 0
+#error "DEFERRED_EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+// Ahead of every other static object, whose interrupts can post to it before main
+DeferredEventQueue DeferredEventQueue::s_shared __attribute__((init_priority(101))) (true);
+
+DeferredEventQueue::DeferredEventQueue() :
+        DeferredEventQueue(false) {}
+
+DeferredEventQueue::DeferredEventQueue(bool isPendSVDispatched) :
+        m_head(0), m_tail(0), m_isPendSVDispatched(isPendSVDispatched) {
+    MicrosecondClock::init();
+    resetStats();
+
+    if (m_isPendSVDispatched) {
+        // Below every interrupt, mbed leaves them all at the highest priority
+        NVIC_SetPriority(PendSV_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+    }
+}
+
+bool DeferredEventQueue::post(DeferredEventQueue::t_handler handler, void *p_context, uint32_t arg) {
+    uint32_t postedUs = MicrosecondClock::read();
+
+    // Not core_util_critical_section_enter(), this runs in every interrupt that defers work
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t head    = m_head;
+    uint32_t pending = head - m_tail;
+
+    if (pending >= DEFERRED_EVENT_QUEUE_SIZE) {
+        m_dropped++;
+        __set_PRIMASK(primask);
+        return false;
+    }
+
+    t_event &event = m_events[head & SLOT_MASK];
+    event.handler   = handler;
+    event.p_context = p_context;
+    event.arg       = arg;
+    event.postedUs  = postedUs;
+
+    m_head = head + 1;
+    m_posted++;
+
+    if (pending + 1 > m_maxPending) {
+        m_maxPending = pending + 1;
+    }
+
+    __set_PRIMASK(primask);
+
+    if (m_isPendSVDispatched) {
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+
+    return true;
+}
+
+void DeferredEventQueue::cancel(void *p_context) {
+    core_util_critical_section_enter();
+
+    for (uint32_t i = m_tail; i != m_head; i++) {
+        if (m_events[i & SLOT_MASK].p_context == p_context) {
+            m_events[i & SLOT_MASK].handler = NULL;
+        }
+    }
+
+    core_util_critical_section_exit();
+}
+
+uint32_t DeferredEventQueue::dispatch(void) {
+    uint32_t count = 0;
+
+    while (m_tail != m_head) {
+        uint32_t tail = m_tail;
+
+        // Copied out first, the slot can be reused as soon as the tail moves on
+        t_event event = m_events[tail & SLOT_MASK];
+        m_tail = tail + 1;
+
+        if (event.handler == NULL) {
+            continue;
+        }
+
+        uint32_t latencyUs = MicrosecondClock::read() - event.postedUs;
+
+        if (latencyUs > m_maxLatencyUs) {
+            m_maxLatencyUs = latencyUs;
+        }
+
+        event.handler(event.p_context, event.arg);
+        count++;
+    }
+
+    m_dispatched += count;
+
+    return count;
+}
+
+uint32_t DeferredEventQueue::getPendingCount(void) {
+    return m_head - m_tail;
+}
+
+void DeferredEventQueue::getStats(DeferredEventQueue::t_stats &stats) {
+    core_util_critical_section_enter();
+
+    stats.pending      = m_head - m_tail;
+    stats.maxPending   = m_maxPending;
+    stats.posted       = m_posted;
+    stats.dropped      = m_dropped;
+    stats.dispatched   = m_dispatched;
+    stats.maxLatencyUs = m_maxLatencyUs;
+
+    core_util_critical_section_exit();
+}
+
+void DeferredEventQueue::resetStats(void) {
+    core_util_critical_section_enter();
+
+    m_maxPending   = 0;
+    m_posted       = 0;
+    m_dropped      = 0;
+    m_dispatched   = 0;
+    m_maxLatencyUs = 0;
+
+    core_util_critical_section_exit();
+}
+
+DeferredEventQueue &DeferredEventQueue::getShared(void) {
+    return s_shared;
+}
+
+extern "C" void PendSV_Handler(void) {
+    DeferredEventQueue::getShared().dispatch();
+}
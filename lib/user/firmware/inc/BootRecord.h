@@ -0,0 +1,66 @@
+#ifndef BOOT_RECORD_H
+#define BOOT_RECORD_H
+
+/* Boot record shared between the resident bootloader and the application.
+ *
+ * The record lives in two flash pages that are written alternately. Every write
+ * goes to the page not holding the newest record and carries an incremented
+ * sequence number, so a power loss during a write always leaves the previous
+ * record intact. Writing the record is the single commit point of an update.
+ */
+
+#include <stdint.h>
+#include "rover_config.h"
+#include "FirmwareStorage.h"
+
+#define BOOT_RECORD_MAGIC 0x55575254 // "UWRT"
+
+class BootRecord {
+
+public:
+
+    typedef enum t_bootState {
+        noImage        = 0x00,
+        imageInstalled = 0xA5,  // Active slot holds imageSize bytes with imageCrc
+        installPending = 0x5A   // Staging slot holds a verified image to copy into the active slot
+
+    } t_bootState;
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t state;
+        uint32_t imageSize;
+        uint32_t imageCrc;
+        uint32_t boardCanId;
+        uint32_t recordCrc;
+
+    } t_record;
+
+    explicit BootRecord(FirmwareStorage &storage, uint32_t startAddress = ROVER_FLASH_BOOT_RECORD_START);
+
+    /** Load the newest valid record
+     *
+     * @return false if neither page holds a valid record
+     */
+    bool load(t_record &record);
+
+    /** Store a record in the older page, sequence and CRC are filled in
+     *
+     * @return 0 on success
+     */
+    int store(t_record &record);
+
+private:
+
+    const t_record *findNewest();
+    const t_record *pageRecord(uint32_t page);
+    bool isValid(const t_record *p_record);
+    uint32_t computeCrc(const t_record *p_record);
+
+    FirmwareStorage &m_storage;
+    uint32_t m_startAddress;
+
+};
+
+#endif // BOOT_RECORD_H
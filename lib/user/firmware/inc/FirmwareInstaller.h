@@ -0,0 +1,47 @@
+#ifndef FIRMWARE_INSTALLER_H
+#define FIRMWARE_INSTALLER_H
+
+/* Moves a verified image from the staging slot into the active slot.
+ *
+ * The STM32F091 has a single flash bank with no hardware bank swap, so the
+ * "switch" is done by the bootloader: it copies the staging slot over the
+ * active slot page by page and only then commits the boot record. Pages that
+ * already match are skipped, so an interrupted copy simply resumes on the next
+ * reset and the install record stays pending until the active image verifies.
+ */
+
+#include <stdint.h>
+#include "FirmwareStorage.h"
+#include "BootRecord.h"
+
+class FirmwareInstaller {
+
+public:
+
+    FirmwareInstaller(FirmwareStorage &storage, BootRecord &bootRecord);
+
+    /** Finish any pending install and check the active image
+     *
+     * @param record Filled with the current boot record
+     * @return true if the active slot holds a valid image that can be started
+     */
+    bool prepareBoot(BootRecord::t_record &record);
+
+    /** Check size bytes at address against a CRC-32
+     */
+    bool isImageValid(uint32_t address, uint32_t size, uint32_t crc);
+
+    /** Copy whole pages from one slot to another, skipping pages that already match
+     *
+     * @return 0 on success
+     */
+    int copyPages(uint32_t sourceAddress, uint32_t destinationAddress, uint32_t size);
+
+private:
+
+    FirmwareStorage &m_storage;
+    BootRecord &m_bootRecord;
+
+};
+
+#endif // FIRMWARE_INSTALLER_H
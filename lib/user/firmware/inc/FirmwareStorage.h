@@ -0,0 +1,45 @@
+#ifndef FIRMWARE_STORAGE_H
+#define FIRMWARE_STORAGE_H
+
+/* Flash access used by the firmware updater, boot record and installer.
+ * Kept free of mbed so the same update logic can run against a simulated
+ * flash on the host (see tools/can_uploader).
+ */
+
+#include <stdint.h>
+
+class FirmwareStorage {
+
+public:
+
+    virtual ~FirmwareStorage() {}
+
+    /** Erase the flash page containing address
+     *
+     * @return 0 on success
+     */
+    virtual int erasePage(uint32_t address) = 0;
+
+    /** Program size bytes (multiple of 4) to an erased, word aligned address
+     *
+     * @return 0 on success
+     */
+    virtual int program(uint32_t address, const void *data, uint32_t size) = 0;
+
+    /** Get a read pointer to the memory mapped flash at address
+     */
+    virtual const uint8_t *data(uint32_t address) = 0;
+
+    /** Compute the CRC-32 (IEEE 802.3, as MbedCRC POLY_32BIT_ANSI) of a buffer
+     *
+     * @param buffer RAM or memory mapped flash to checksum
+     */
+    virtual uint32_t crc32(const void *buffer, uint32_t size) = 0;
+
+    /** Size of an erasable flash page in bytes
+     */
+    virtual uint32_t getPageSize() = 0;
+
+};
+
+#endif // FIRMWARE_STORAGE_H
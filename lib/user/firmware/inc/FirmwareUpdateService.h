@@ -0,0 +1,54 @@
+#ifndef FIRMWARE_UPDATE_SERVICE_H
+#define FIRMWARE_UPDATE_SERVICE_H
+
+/* Receives firmware updates over CAN while an app is running.
+ *
+ * The image is written to the staging slot and handed to the bootloader on
+ * the next reset. Updates are only accepted when the app was linked to run
+ * behind the bootloader (make BOOTLOADER=1), since otherwise the app itself
+ * occupies the flash the update would be written to.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "FlashIAPStorage.h"
+#include "FirmwareUpdater.h"
+
+#if defined(ROVER_BOOTLOADER) || (defined(MBED_APP_START) && MBED_APP_START == ROVER_FLASH_APP_START)
+#define ROVER_FIRMWARE_UPDATE_ENABLED 1
+#else
+#define ROVER_FIRMWARE_UPDATE_ENABLED 0
+#endif
+
+class FirmwareUpdateService {
+
+public:
+
+    FirmwareUpdateService(CAN &can, uint32_t boardCanId);
+
+    /** Handle a message if it belongs to the firmware update service
+     *
+     * @return true if the message was consumed
+     */
+    bool handleCANMsg(CANMessage &msg);
+
+    /** Actuators should be held still while an update is in progress,
+     * flash writes stall the CPU for several milliseconds at a time
+     */
+    bool isUpdateInProgress(void);
+
+    /** Reset into the bootloader once the host has asked for it
+     */
+    void rebootIfRequested(void);
+
+private:
+
+    CAN &m_can;
+    uint32_t m_boardCanId;
+
+    FlashIAPStorage m_storage;
+    FirmwareUpdater m_updater;
+
+};
+
+#endif // FIRMWARE_UPDATE_SERVICE_H
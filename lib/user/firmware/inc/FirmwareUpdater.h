@@ -0,0 +1,131 @@
+#ifndef FIRMWARE_UPDATER_H
+#define FIRMWARE_UPDATER_H
+
+/* CAN firmware update protocol.
+ *
+ * Receives an image into the staging slot one flash page at a time. The host
+ * opens a page (erasing it), streams it in 7 byte data frames and closes it
+ * with the CRC of the full page. In delta mode the host first asks for the CRC
+ * of each active page and only sends the ones that differ; Finish copies every
+ * page that was not sent from the active slot before verifying the whole image.
+ * A verified image is handed to the bootloader by writing an install record.
+ *
+ * Command frames (board ID + ROVER_CANID_SYS_FIRMWARE_CMD), byte 0 is the opcode:
+ *   Begin      [op, mode, windowFrames(u16), imageSize(u32)]
+ *   PageDigest [op, page]                  -> [op, status, page, 0, crc(u32)]
+ *   PageStart  [op, page]                  -> [op, status, page]
+ *   PageEnd    [op, page, 0, 0, crc(u32)]  -> [op, status, page, 0, crc(u32)]
+ *   Finish     [op, 0, 0, 0, crc(u32)]     -> [op, status, page(u16)]
+ *   Reboot, Abort                          -> [op, status]
+ *   Status                                 -> [op, status, state, 0, pagesReceived(u32)]
+ *
+ * Data frames (board ID + ROVER_CANID_SYS_FIRMWARE_DATA) are [seq, 7 bytes] and
+ * are acknowledged with [DataAck, status, framesReceived(u16)] once every
+ * windowFrames frames, after the window has been written to flash. The host
+ * must wait for the acknowledgement, since flash writes stall the CPU and the
+ * CAN receive FIFO only holds 3 frames. Multi byte fields are little endian.
+ */
+
+#include <stdint.h>
+#include "FirmwareStorage.h"
+
+#define FIRMWARE_UPDATER_FRAME_PAYLOAD  7
+#define FIRMWARE_UPDATER_BUFFER_SIZE    128
+#define FIRMWARE_UPDATER_MAX_WINDOW     (FIRMWARE_UPDATER_BUFFER_SIZE / FIRMWARE_UPDATER_FRAME_PAYLOAD - 1)
+#define FIRMWARE_UPDATER_MAX_PAGES      64
+
+class FirmwareUpdater {
+
+public:
+
+    typedef enum t_opcode {
+        opBegin      = 0x01,
+        opPageDigest = 0x02,
+        opPageStart  = 0x03,
+        opPageEnd    = 0x04,
+        opFinish     = 0x05,
+        opReboot     = 0x06,
+        opAbort      = 0x07,
+        opStatus     = 0x08,
+        opDataAck    = 0x80
+
+    } t_opcode;
+
+    typedef enum t_status {
+        statusOk           = 0x00,
+        statusBadState     = 0x01,
+        statusBadArgument  = 0x02,
+        statusFlashError   = 0x03,
+        statusCrcMismatch  = 0x04,
+        statusSequenceError = 0x05,
+        statusMissingPages = 0x06
+
+    } t_status;
+
+    typedef enum t_mode {
+        modeFull  = 0x00,   // Every page of the image is sent
+        modeDelta = 0x01    // Pages not sent are taken from the active image
+
+    } t_mode;
+
+    typedef enum t_state {
+        stateIdle,
+        stateReceiving,
+        statePageOpen,
+        stateComplete
+
+    } t_state;
+
+    FirmwareUpdater(FirmwareStorage &storage, uint32_t boardCanId);
+
+    /** Handle a command frame
+     *
+     * @param reply     Buffer of 8 bytes for the reply frame
+     * @param replyLen  Set to the reply length, 0 if there is nothing to send
+     */
+    void handleCommand(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen);
+
+    /** Handle a data frame, replies are window acknowledgements or sequence errors
+     */
+    void handleData(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen);
+
+    bool isUpdateInProgress(void);
+    bool isRebootRequested(void);
+
+    t_state getState(void);
+
+private:
+
+    void begin(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen);
+    void pageDigest(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen);
+    void pageStart(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen);
+    void pageEnd(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen);
+    void finish(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen);
+
+    int flushBuffer(bool padToWord);
+    uint32_t getPageCount(void);
+    uint32_t getPagesReceived(void);
+
+    FirmwareStorage &m_storage;
+    uint32_t m_boardCanId;
+
+    t_state m_state;
+    t_mode m_mode;
+    bool m_rebootRequested;
+
+    uint32_t m_imageSize;
+    uint16_t m_windowFrames;
+    uint64_t m_pagesReceived;
+
+    uint8_t  m_page;
+    uint32_t m_pageOffset;          // Bytes of the open page already written to flash
+    uint16_t m_framesReceived;      // Frames accepted for the open page
+    uint16_t m_framesSinceAck;
+    bool     m_sequenceErrorSent;
+
+    uint8_t  m_buffer[FIRMWARE_UPDATER_BUFFER_SIZE];
+    uint32_t m_bufferLen;
+
+};
+
+#endif // FIRMWARE_UPDATER_H
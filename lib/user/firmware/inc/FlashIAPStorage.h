@@ -0,0 +1,31 @@
+#ifndef FLASH_IAP_STORAGE_H
+#define FLASH_IAP_STORAGE_H
+
+/* Firmware storage on the internal flash of the board, checksummed by the
+ * hardware CRC unit through MbedCRC.
+ */
+
+#include "mbed.h"
+#include "FirmwareStorage.h"
+
+class FlashIAPStorage : public FirmwareStorage {
+
+public:
+
+    FlashIAPStorage();
+    virtual ~FlashIAPStorage();
+
+    virtual int erasePage(uint32_t address);
+    virtual int program(uint32_t address, const void *data, uint32_t size);
+    virtual const uint8_t *data(uint32_t address);
+    virtual uint32_t crc32(const void *buffer, uint32_t size);
+    virtual uint32_t getPageSize();
+
+private:
+
+    FlashIAP m_flash;
+    MbedCRC<POLY_32BIT_ANSI, 32> m_crc;
+
+};
+
+#endif // FLASH_IAP_STORAGE_H
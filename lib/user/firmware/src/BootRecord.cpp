@@ -0,0 +1,71 @@
+/* Boot record shared between the resident bootloader and the application.
+ */
+
+#include <stddef.h>
+#include "BootRecord.h"
+
+BootRecord::BootRecord(FirmwareStorage &storage, uint32_t startAddress) :
+        m_storage(storage), m_startAddress(startAddress) {}
+
+bool BootRecord::load(t_record &record) {
+    const t_record *p_newest = findNewest();
+
+    if (p_newest == NULL) {
+        return false;
+    }
+
+    record = *p_newest;
+    return true;
+}
+
+int BootRecord::store(t_record &record) {
+    const t_record *p_newest = findNewest();
+    uint32_t address = m_startAddress;
+
+    if (p_newest != NULL) {
+        record.sequence = p_newest->sequence + 1;
+
+        // Never overwrite the page holding the current record
+        if (p_newest == pageRecord(0)) {
+            address = m_startAddress + m_storage.getPageSize();
+        }
+    }
+    else {
+        record.sequence = 1;
+    }
+
+    record.magic     = BOOT_RECORD_MAGIC;
+    record.recordCrc = computeCrc(&record);
+
+    if (m_storage.erasePage(address) != 0) {
+        return -1;
+    }
+
+    return m_storage.program(address, &record, sizeof(t_record));
+}
+
+const BootRecord::t_record *BootRecord::findNewest() {
+    const t_record *p_first  = pageRecord(0);
+    const t_record *p_second = pageRecord(1);
+
+    bool firstValid  = isValid(p_first);
+    bool secondValid = isValid(p_second);
+
+    if (firstValid && (!secondValid || (int32_t)(p_first->sequence - p_second->sequence) > 0)) {
+        return p_first;
+    }
+
+    return secondValid ? p_second : NULL;
+}
+
+const BootRecord::t_record *BootRecord::pageRecord(uint32_t page) {
+    return reinterpret_cast<const t_record *>(m_storage.data(m_startAddress + page * m_storage.getPageSize()));
+}
+
+bool BootRecord::isValid(const t_record *p_record) {
+    return p_record->magic == BOOT_RECORD_MAGIC && p_record->recordCrc == computeCrc(p_record);
+}
+
+uint32_t BootRecord::computeCrc(const t_record *p_record) {
+    return m_storage.crc32(p_record, offsetof(t_record, recordCrc));
+}
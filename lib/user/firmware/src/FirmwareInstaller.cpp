@@ -0,0 +1,71 @@
+/* Moves a verified image from the staging slot into the active slot.
+ */
+
+#include <string.h>
+#include "rover_config.h"
+#include "FirmwareInstaller.h"
+#include "IndependentWatchdog.h"
+
+FirmwareInstaller::FirmwareInstaller(FirmwareStorage &storage, BootRecord &bootRecord) :
+        m_storage(storage), m_bootRecord(bootRecord) {}
+
+bool FirmwareInstaller::prepareBoot(BootRecord::t_record &record) {
+
+    if (!m_bootRecord.load(record)) {
+        record.state = BootRecord::noImage;
+        return false;
+    }
+
+    if (record.state == BootRecord::installPending) {
+
+        // Staging must still hold the image that was verified before the record was written
+        if (!isImageValid(ROVER_FLASH_STAGING_START, record.imageSize, record.imageCrc)) {
+            return false;
+        }
+
+        if (copyPages(ROVER_FLASH_STAGING_START, ROVER_FLASH_APP_START, record.imageSize) != 0 ||
+            !isImageValid(ROVER_FLASH_APP_START, record.imageSize, record.imageCrc)) {
+            return false;
+        }
+
+        record.state = BootRecord::imageInstalled;
+
+        if (m_bootRecord.store(record) != 0) {
+            return false;
+        }
+    }
+
+    return record.state == BootRecord::imageInstalled &&
+           isImageValid(ROVER_FLASH_APP_START, record.imageSize, record.imageCrc);
+}
+
+bool FirmwareInstaller::isImageValid(uint32_t address, uint32_t size, uint32_t crc) {
+    if (size == 0 || size > ROVER_FLASH_APP_SIZE) {
+        return false;
+    }
+
+    return m_storage.crc32(m_storage.data(address), size) == crc;
+}
+
+int FirmwareInstaller::copyPages(uint32_t sourceAddress, uint32_t destinationAddress, uint32_t size) {
+    uint32_t pageSize = m_storage.getPageSize();
+
+    for (uint32_t offset = 0; offset < size; offset += pageSize) {
+        // Tens of ms per page, a whole image outlasts the watchdog
+        IndependentWatchdog::kick();
+
+        const uint8_t *p_source      = m_storage.data(sourceAddress + offset);
+        const uint8_t *p_destination = m_storage.data(destinationAddress + offset);
+
+        if (memcmp(p_source, p_destination, pageSize) == 0) {
+            continue;
+        }
+
+        if (m_storage.erasePage(destinationAddress + offset) != 0 ||
+            m_storage.program(destinationAddress + offset, p_source, pageSize) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+/* Receives firmware updates over CAN while an app is running.
+ */
+
+#include "FirmwareUpdateService.h"
+
+FirmwareUpdateService::FirmwareUpdateService(CAN &can, uint32_t boardCanId) :
+        m_can(can), m_boardCanId(boardCanId), m_updater(m_storage, boardCanId) {}
+
+bool FirmwareUpdateService::handleCANMsg(CANMessage &msg) {
+
+    bool isCommand = msg.id == m_boardCanId + ROVER_CANID_SYS_FIRMWARE_CMD;
+    bool isData    = msg.id == m_boardCanId + ROVER_CANID_SYS_FIRMWARE_DATA;
+
+    if (!isCommand && !isData) {
+        return false;
+    }
+
+    CANMessage reply;
+    uint8_t replyLen = 0;
+
+#if ROVER_FIRMWARE_UPDATE_ENABLED
+    if (isCommand) {
+        m_updater.handleCommand(msg.data, msg.len, reply.data, replyLen);
+    }
+    else {
+        m_updater.handleData(msg.data, msg.len, reply.data, replyLen);
+    }
+#else
+    if (isCommand && msg.len > 0) {
+        reply.data[0] = msg.data[0];
+        reply.data[1] = FirmwareUpdater::statusBadState;
+        replyLen = 2;
+    }
+#endif
+
+    if (replyLen > 0) {
+        reply.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_FIRMWARE;
+        reply.len = replyLen;
+        MBED_ASSERT_WARN(m_can.write(reply) == true);
+    }
+
+    return true;
+}
+
+bool FirmwareUpdateService::isUpdateInProgress(void) {
+    return m_updater.isUpdateInProgress();
+}
+
+void FirmwareUpdateService::rebootIfRequested(void) {
+    if (m_updater.isRebootRequested()) {
+        // Let the reply frame leave the mailbox before resetting
+        wait_ms(5);
+        NVIC_SystemReset();
+    }
+}
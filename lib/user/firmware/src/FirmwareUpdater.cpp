@@ -0,0 +1,356 @@
+/* CAN firmware update protocol.
+ */
+
+#include <string.h>
+#include "rover_config.h"
+#include "BootRecord.h"
+#include "FirmwareInstaller.h"
+#include "FirmwareUpdater.h"
+
+static uint16_t readU16(const uint8_t *p_data) {
+    return (uint16_t)(p_data[0] | (p_data[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t *p_data) {
+    return (uint32_t)p_data[0] | ((uint32_t)p_data[1] << 8) | ((uint32_t)p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+static void writeU16(uint8_t *p_data, uint16_t value) {
+    p_data[0] = (uint8_t)value;
+    p_data[1] = (uint8_t)(value >> 8);
+}
+
+static void writeU32(uint8_t *p_data, uint32_t value) {
+    writeU16(p_data, (uint16_t)value);
+    writeU16(p_data + 2, (uint16_t)(value >> 16));
+}
+
+FirmwareUpdater::FirmwareUpdater(FirmwareStorage &storage, uint32_t boardCanId) :
+        m_storage(storage), m_boardCanId(boardCanId), m_state(stateIdle), m_mode(modeFull),
+        m_rebootRequested(false), m_imageSize(0), m_windowFrames(1), m_pagesReceived(0),
+        m_page(0), m_pageOffset(0), m_framesReceived(0), m_framesSinceAck(0),
+        m_sequenceErrorSent(false), m_bufferLen(0) {}
+
+void FirmwareUpdater::handleCommand(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen) {
+
+    replyLen = 0;
+
+    if (len < 1) {
+        return;
+    }
+
+    reply[0] = data[0];
+    reply[1] = statusOk;
+    replyLen = 2;
+
+    switch (data[0]) {
+
+        case opBegin:
+            begin(data, len, reply, replyLen);
+            break;
+
+        case opPageDigest:
+            pageDigest(data, len, reply, replyLen);
+            break;
+
+        case opPageStart:
+            pageStart(data, len, reply, replyLen);
+            break;
+
+        case opPageEnd:
+            pageEnd(data, len, reply, replyLen);
+            break;
+
+        case opFinish:
+            finish(data, len, reply, replyLen);
+            break;
+
+        case opReboot:
+            m_rebootRequested = true;
+            break;
+
+        case opAbort:
+            m_state = stateIdle;
+            break;
+
+        case opStatus:
+            reply[2] = (uint8_t)m_state;
+            reply[3] = 0;
+            writeU32(&reply[4], getPagesReceived());
+            replyLen = 8;
+            break;
+
+        default:
+            reply[1] = statusBadArgument;
+            break;
+    }
+}
+
+void FirmwareUpdater::handleData(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen) {
+
+    replyLen = 0;
+
+    if (m_state != statePageOpen || len < 2) {
+        return;
+    }
+
+    reply[0] = opDataAck;
+
+    // Drop out of order frames and report once where the host has to resume a new window from
+    if (data[0] != (uint8_t)m_framesReceived) {
+        if (!m_sequenceErrorSent) {
+            m_framesSinceAck = 0;
+            reply[1] = (flushBuffer(false) == 0) ? statusSequenceError : statusFlashError;
+            writeU16(&reply[2], m_framesReceived);
+            replyLen = 4;
+            m_sequenceErrorSent = true;
+        }
+        return;
+    }
+
+    m_sequenceErrorSent = false;
+
+    uint32_t payloadLen = len - 1;
+    uint32_t pageSize   = m_storage.getPageSize();
+
+    if (m_pageOffset + m_bufferLen + payloadLen > pageSize) {
+        payloadLen = pageSize - (m_pageOffset + m_bufferLen);
+    }
+
+    memcpy(&m_buffer[m_bufferLen], &data[1], payloadLen);
+    m_bufferLen += payloadLen;
+    m_framesReceived++;
+
+    if (++m_framesSinceAck < m_windowFrames) {
+        return;
+    }
+
+    m_framesSinceAck = 0;
+
+    reply[1] = (flushBuffer(false) == 0) ? statusOk : statusFlashError;
+    writeU16(&reply[2], m_framesReceived);
+    replyLen = 4;
+}
+
+bool FirmwareUpdater::isUpdateInProgress(void) {
+    return m_state == stateReceiving || m_state == statePageOpen;
+}
+
+bool FirmwareUpdater::isRebootRequested(void) {
+    return m_rebootRequested;
+}
+
+FirmwareUpdater::t_state FirmwareUpdater::getState(void) {
+    return m_state;
+}
+
+void FirmwareUpdater::begin(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen) {
+
+    if (len < 8) {
+        reply[1] = statusBadArgument;
+        return;
+    }
+
+    uint16_t windowFrames = readU16(&data[2]);
+    uint32_t imageSize    = readU32(&data[4]);
+
+    if (data[1] > modeDelta || windowFrames == 0 || windowFrames > FIRMWARE_UPDATER_MAX_WINDOW ||
+        imageSize == 0 || imageSize > ROVER_FLASH_STAGING_SIZE) {
+        reply[1] = statusBadArgument;
+        return;
+    }
+
+    m_mode          = (t_mode)data[1];
+    m_windowFrames  = windowFrames;
+    m_imageSize     = imageSize;
+    m_pagesReceived = 0;
+    m_state         = stateReceiving;
+}
+
+void FirmwareUpdater::pageDigest(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen) {
+
+    uint32_t pageSize = m_storage.getPageSize();
+
+    if (len < 2 || data[1] >= ROVER_FLASH_APP_SIZE / pageSize) {
+        reply[1] = statusBadArgument;
+        return;
+    }
+
+    reply[2] = data[1];
+    reply[3] = 0;
+    writeU32(&reply[4], m_storage.crc32(m_storage.data(ROVER_FLASH_APP_START + data[1] * pageSize), pageSize));
+    replyLen = 8;
+}
+
+void FirmwareUpdater::pageStart(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen) {
+
+    if (m_state != stateReceiving && m_state != statePageOpen) {
+        reply[1] = statusBadState;
+        return;
+    }
+
+    if (len < 2 || data[1] >= getPageCount()) {
+        reply[1] = statusBadArgument;
+        return;
+    }
+
+    reply[2] = data[1];
+    replyLen = 3;
+
+    m_page              = data[1];
+    m_pageOffset        = 0;
+    m_framesReceived    = 0;
+    m_framesSinceAck    = 0;
+    m_sequenceErrorSent = false;
+    m_bufferLen         = 0;
+    m_pagesReceived    &= ~((uint64_t)1 << m_page);
+
+    if (m_storage.erasePage(ROVER_FLASH_STAGING_START + m_page * m_storage.getPageSize()) != 0) {
+        reply[1] = statusFlashError;
+        m_state  = stateReceiving;
+        return;
+    }
+
+    m_state = statePageOpen;
+}
+
+void FirmwareUpdater::pageEnd(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen) {
+
+    if (m_state != statePageOpen) {
+        reply[1] = statusBadState;
+        return;
+    }
+
+    if (len < 8 || data[1] != m_page) {
+        reply[1] = statusBadArgument;
+        return;
+    }
+
+    m_state = stateReceiving;
+
+    if (flushBuffer(true) != 0) {
+        reply[1] = statusFlashError;
+        return;
+    }
+
+    uint32_t pageSize = m_storage.getPageSize();
+    uint32_t crc      = m_storage.crc32(m_storage.data(ROVER_FLASH_STAGING_START + m_page * pageSize), pageSize);
+
+    reply[2] = m_page;
+    reply[3] = 0;
+    writeU32(&reply[4], crc);
+    replyLen = 8;
+
+    if (crc != readU32(&data[4])) {
+        reply[1] = statusCrcMismatch;
+        return;
+    }
+
+    m_pagesReceived |= (uint64_t)1 << m_page;
+}
+
+void FirmwareUpdater::finish(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t &replyLen) {
+
+    if (m_state != stateReceiving) {
+        reply[1] = statusBadState;
+        return;
+    }
+
+    if (len < 8) {
+        reply[1] = statusBadArgument;
+        return;
+    }
+
+    uint32_t pageSize = m_storage.getPageSize();
+
+    BootRecord bootRecord(m_storage);
+    FirmwareInstaller installer(m_storage, bootRecord);
+
+    writeU16(&reply[2], 0);
+    replyLen = 4;
+
+    for (uint32_t page = 0; page < getPageCount(); page++) {
+
+        if (m_pagesReceived & ((uint64_t)1 << page)) {
+            continue;
+        }
+
+        if (m_mode != modeDelta) {
+            reply[1] = statusMissingPages;
+            writeU16(&reply[2], (uint16_t)page);
+            return;
+        }
+
+        // Staging usually still holds the previous update, so most pages already match
+        if (installer.copyPages(ROVER_FLASH_APP_START + page * pageSize, ROVER_FLASH_STAGING_START + page * pageSize, pageSize) != 0) {
+            reply[1] = statusFlashError;
+            writeU16(&reply[2], (uint16_t)page);
+            return;
+        }
+
+        m_pagesReceived |= (uint64_t)1 << page;
+    }
+
+    uint32_t imageCrc = readU32(&data[4]);
+
+    if (m_storage.crc32(m_storage.data(ROVER_FLASH_STAGING_START), m_imageSize) != imageCrc) {
+        reply[1] = statusCrcMismatch;
+        return;
+    }
+
+    BootRecord::t_record record;
+
+    record.state      = BootRecord::installPending;
+    record.imageSize  = m_imageSize;
+    record.imageCrc   = imageCrc;
+    record.boardCanId = m_boardCanId;
+
+    if (bootRecord.store(record) != 0) {
+        reply[1] = statusFlashError;
+        return;
+    }
+
+    m_state = stateComplete;
+}
+
+int FirmwareUpdater::flushBuffer(bool padToWord) {
+
+    uint32_t writeLen = m_bufferLen & ~3UL;
+
+    if (padToWord && writeLen != m_bufferLen) {
+        memset(&m_buffer[m_bufferLen], 0xFF, 4 - (m_bufferLen & 3));
+        writeLen = m_bufferLen = writeLen + 4;
+    }
+
+    if (writeLen == 0) {
+        return 0;
+    }
+
+    uint32_t address = ROVER_FLASH_STAGING_START + m_page * m_storage.getPageSize() + m_pageOffset;
+
+    if (m_storage.program(address, m_buffer, writeLen) != 0) {
+        return -1;
+    }
+
+    // Keep the unaligned tail for the next window
+    m_bufferLen  -= writeLen;
+    m_pageOffset += writeLen;
+    memmove(m_buffer, &m_buffer[writeLen], m_bufferLen);
+
+    return 0;
+}
+
+uint32_t FirmwareUpdater::getPageCount(void) {
+    uint32_t pageSize = m_storage.getPageSize();
+    return (m_imageSize + pageSize - 1) / pageSize;
+}
+
+uint32_t FirmwareUpdater::getPagesReceived(void) {
+    uint32_t count = 0;
+
+    for (uint64_t pages = m_pagesReceived; pages != 0; pages &= pages - 1) {
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,36 @@
+/* Firmware storage on the internal flash of the board.
+ */
+
+#include "rover_config.h"
+#include "FlashIAPStorage.h"
+
+FlashIAPStorage::FlashIAPStorage() {
+    m_flash.init();
+}
+
+FlashIAPStorage::~FlashIAPStorage() {
+    m_flash.deinit();
+}
+
+int FlashIAPStorage::erasePage(uint32_t address) {
+    uint32_t pageSize = m_flash.get_sector_size(address);
+    return m_flash.erase(address - (address % pageSize), pageSize);
+}
+
+int FlashIAPStorage::program(uint32_t address, const void *data, uint32_t size) {
+    return m_flash.program(data, address, size);
+}
+
+const uint8_t *FlashIAPStorage::data(uint32_t address) {
+    return reinterpret_cast<const uint8_t *>(address);
+}
+
+uint32_t FlashIAPStorage::crc32(const void *buffer, uint32_t size) {
+    uint32_t crc = 0;
+    m_crc.compute(const_cast<void *>(buffer), size, &crc);
+    return crc;
+}
+
+uint32_t FlashIAPStorage::getPageSize() {
+    return m_flash.get_sector_size(ROVER_FLASH_STAGING_START);
+}
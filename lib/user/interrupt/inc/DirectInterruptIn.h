@@ -0,0 +1,51 @@
+#ifndef DIRECT_INTERRUPT_IN_H
+#define DIRECT_INTERRUPT_IN_H
+
+/* Digital input with its edge interrupt bound straight to a function.
+ *
+ * InterruptIn goes through the generic EXTI dispatch on every edge: a scan of
+ * the registered pins, an edge lookup from the trigger configuration, then
+ * two levels of callbacks. Here the EXTI line calls a plain function with a
+ * context pointer and the pin level (see gpio_irq_direct.h), meant for
+ * encoders seeing tens of thousands of edges a second. The time this saves
+ * per edge has not been measured on a board yet; app/test_exti_latency
+ * measures it.
+ *
+ * As with InterruptIn, pins with the same number on different ports share an
+ * EXTI line and can't both have interrupts.
+ */
+
+#include "mbed.h"
+#include "gpio_irq_direct.h"
+
+class DirectInterruptIn {
+
+public:
+
+    /** @param level Pin level read right after the edge
+     */
+    typedef void (*t_handler)(void *p_context, int level);
+
+    explicit DirectInterruptIn(PinName pin, PinMode mode = PullNone);
+
+    ~DirectInterruptIn();
+
+    /** Call a function from the interrupt on the selected edges
+     *
+     * @return MBED_ERROR_ALREADY_IN_USE if the pin's EXTI line is taken
+     */
+    mbed_error_status_t attach(t_handler handler, void *p_context, bool rise, bool fall);
+
+    void detach(void);
+
+    int read(void);
+
+private:
+
+    DigitalIn m_input;
+    PinName m_pin;
+    bool m_isAttached;
+
+};
+
+#endif // DIRECT_INTERRUPT_IN_H
@@ -0,0 +1,34 @@
+/* Digital input with its edge interrupt bound straight to a function.
+ */
+
+#include "DirectInterruptIn.h"
+
+DirectInterruptIn::DirectInterruptIn(PinName pin, PinMode mode) :
+        m_input(pin, mode), m_pin(pin), m_isAttached(false) {}
+
+DirectInterruptIn::~DirectInterruptIn() {
+    detach();
+}
+
+mbed_error_status_t DirectInterruptIn::attach(DirectInterruptIn::t_handler handler, void *p_context, bool rise, bool fall) {
+    detach();
+
+    if (gpio_irq_direct_bind(m_pin, handler, p_context, rise, fall) != 0) {
+        return MBED_ERROR_ALREADY_IN_USE;
+    }
+
+    m_isAttached = true;
+
+    return MBED_SUCCESS;
+}
+
+void DirectInterruptIn::detach(void) {
+    if (m_isAttached) {
+        gpio_irq_direct_unbind(m_pin);
+        m_isAttached = false;
+    }
+}
+
+int DirectInterruptIn::read(void) {
+    return m_input.read();
+}
@@ -26,37 +26,73 @@
 #ifndef MOTOR_DEFAULT_FREQUENCY_HZ
 #define MOTOR_DEFAULT_FREQUENCY_HZ 1000 // 1 kHz
 #endif
+
+#define MOTOR_CENTRE_ALIGNED_FREQUENCY_HZ 20000 // 20 kHz, above hearing with 1200 steps of duty cycle
+#define MOTOR_DEFAULT_DEAD_TIME_NS        500
+
+#define MOTOR_DUTY_CYCLE_FULL_SCALE 32768 // Raw duty cycle of a full speed motor
  
 #include "mbed.h"
  
 /** Interface to control a standard DC motor 
  *
  * with an H-bridge using a PwmOut and 2 DigitalOuts
+ *
+ * The PwmOut only sets the timer up. Speed changes are a single write to the
+ * channel's compare register, which the timer loads at the start of the next
+ * PWM period, so a new duty cycle never cuts a period short.
+ *
+ * Motors on TIM1 can instead run centre-aligned PWM, counting up and down at
+ * twice the carrier frequency. The direction then depends on the dir pin:
+ * - the complementary output of the PWM channel: locked antiphase, the two
+ *   outputs drive opposite sides of the bridge with hardware dead-time between
+ *   them, and 50% duty cycle is stopped
+ * - another TIM1 channel: sign-magnitude, the direction is that channel held
+ *   fully on or off, loaded on the same update event as the duty cycle
+ * - any other pin: sign-magnitude with a DigitalOut direction, as in edge
+ *   aligned mode
+ * TIM1 is shared, so every motor on it must use the same mode and frequency.
+ *
+ * Every duty cycle is scaled by an output scale before it is written, which a
+ * command watchdog ramps down from an interrupt to stop a motor whatever its
+ * controller keeps asking for.
  */
 class Motor {
 
 public:
 
+    typedef enum {
+        edgeAligned,
+        centreAligned
+
+    } t_pwmMode;
+
     typedef struct {
         PinName pwmPin;
         PinName dirPin;
         bool inverted;
-        int freqInHz;
+        int freqInHz;           // 0 for the default of the PWM mode
         float limit;
 
+        t_pwmMode pwmMode;
+        int deadTimeNs = MOTOR_DEFAULT_DEAD_TIME_NS; // Locked antiphase only
+
     } t_motorConfig;
  
     /** Create a motor control interface    
      *
      * @param pwm       A PwmOut pin, driving the H-bridge enable line to control the speed
      * @param dir       A DigitalOut, set high when the motor should go forward, low when backwards
-     * @param freqInHz  Output PWM frequency, default 1kHz
+     * @param freqInHz  Output PWM frequency, 0 for 1kHz edge aligned or 20kHz centre-aligned
      * @param inverted  If true, then forward speed will set dir to 0 instead of 1, otherwise inverse
      * @param limit     Maximum speed magnitude
+     * @param pwmMode   Edge aligned, or centre-aligned on TIM1
+     * @param deadTimeNs Delay between one side of a locked antiphase bridge turning off and the other turning on
      */
-    Motor(PinName pwm, PinName dir, bool inverted = false, int freqInHz = MOTOR_DEFAULT_FREQUENCY_HZ, float limit = 1.0);
+    Motor(PinName pwm, PinName dir, bool inverted = false, int freqInHz = 0, float limit = 1.0,
+          t_pwmMode pwmMode = edgeAligned, int deadTimeNs = MOTOR_DEFAULT_DEAD_TIME_NS);
 
-    Motor(t_motorConfig motorConfig);
+    Motor(const t_motorConfig &motorConfig);
 
     /** Set the speed of the motor
      * 
@@ -65,17 +101,51 @@ public:
     void setDutyCycle(float dutyCycle);
     Motor& operator=(int dutyCycle);
 
+    /** Set the speed of the motor without floating point
+     *
+     * @param dutyCycle The speed of the motor between -MOTOR_DUTY_CYCLE_FULL_SCALE and MOTOR_DUTY_CYCLE_FULL_SCALE
+     */
+    void setDutyCycleRaw(int32_t dutyCycle);
+
+    /** Scale every duty cycle, now and until the scale is changed, safe to call from an interrupt
+     *
+     * @param scale Between 0 (stopped) and MOTOR_DUTY_CYCLE_FULL_SCALE (as commanded)
+     */
+    void setOutputScale(int32_t scale);
+
     /** Read the current speed of the motor
      * 
-     * @return Current speed of motor
+     * @return Current speed of motor, after the output scale
      */
     float getDutyCycle();
  
 protected:
+    void initCentreAligned(PinName pwm, PinName dir, int freqInHz, int deadTimeNs);
+    void writeDutyCycle(int32_t dutyCycle);
+
     PwmOut _pwm;
     DigitalOut _dir;
     bool _inverted;
     float _limit;
+
+    t_pwmMode _pwmMode;
+    bool _isLockedAntiphase;
+
+    // Compare register of the PWM channel and its full scale
+    volatile uint32_t *_p_ccr;
+    volatile uint32_t *_p_ccmr;
+    uint32_t _ccmrPreloadBit;
+    uint32_t _periodTicks;
+
+    // TIM1 and the compare register of a direction on one of its channels, NULL for a DigitalOut
+    TIM_TypeDef *_p_tim;
+    volatile uint32_t *_p_dirCcr;
+
+    int32_t _rawLimit;
+
+    // As commanded and as written, the difference is the output scale
+    int32_t _requestedDutyCycle, _outputDutyCycle;
+    int32_t _outputScale;
 };
  
 #endif
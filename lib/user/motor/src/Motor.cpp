@@ -22,28 +22,178 @@
  
 #include "Motor.h"
 #include "mbed.h"
+#include "pinmap.h"
+#include "PeripheralPins.h"
 #include <algorithm>
 
-Motor::Motor(PinName pwm, PinName dir, bool inverted, int freqInHz, float limit) :
-	_pwm(pwm), _dir(dir), _inverted(inverted), _limit(limit) {
+Motor::Motor(PinName pwm, PinName dir, bool inverted, int freqInHz, float limit, t_pwmMode pwmMode, int deadTimeNs) :
+	_pwm(pwm), _dir(dir), _inverted(inverted), _limit(limit), _pwmMode(pwmMode), _isLockedAntiphase(false), _p_tim(NULL), _p_dirCcr(NULL) {
+
+    if (freqInHz <= 0) {
+        freqInHz = _pwmMode == centreAligned ? MOTOR_CENTRE_ALIGNED_FREQUENCY_HZ : MOTOR_DEFAULT_FREQUENCY_HZ;
+    }
 
 #ifndef DISABLE_SETTING_MOTOR_PWM_FREQ
     // Set initial condition of PWM
     _pwm.period(1.0 / freqInHz);
 #endif
 
+    // Configures and starts the channel, with the compare register preloaded
     _pwm = 0.0;
  
     // Initial condition of output enables
     _dir = 0.0;
+
+    TIM_TypeDef *p_tim = (TIM_TypeDef *)pinmap_peripheral(pwm, PinMap_PWM);
+    uint32_t channel   = STM_PIN_CHANNEL(pinmap_function(pwm, PinMap_PWM));
+
+    // CCR1 to CCR4 follow each other, CCMR1 holds channels 1 and 2, CCMR2 channels 3 and 4
+    _p_ccr          = &p_tim->CCR1 + (channel - 1);
+    _p_ccmr         = channel <= 2 ? &p_tim->CCMR1 : &p_tim->CCMR2;
+    _ccmrPreloadBit = (channel % 2) ? TIM_CCMR1_OC1PE : TIM_CCMR1_OC2PE;
+    _periodTicks    = p_tim->ARR + 1;
+
+    *_p_ccmr |= _ccmrPreloadBit;
+
+    _rawLimit           = (int32_t)(min(max(limit, 0.0f), 1.0f) * MOTOR_DUTY_CYCLE_FULL_SCALE);
+    _requestedDutyCycle = 0;
+    _outputDutyCycle    = 0;
+    _outputScale        = MOTOR_DUTY_CYCLE_FULL_SCALE;
+
+    if (_pwmMode == centreAligned) {
+        initCentreAligned(pwm, dir, freqInHz, deadTimeNs);
+        setDutyCycleRaw(0);
+    }
 }
 
-Motor::Motor(t_motorConfig motorConfig) : Motor(motorConfig.pwmPin, motorConfig.dirPin, motorConfig.inverted,
-        motorConfig.freqInHz, motorConfig.limit) {}
+Motor::Motor(const t_motorConfig &motorConfig) : Motor(motorConfig.pwmPin, motorConfig.dirPin, motorConfig.inverted,
+        motorConfig.freqInHz, motorConfig.limit, motorConfig.pwmMode, motorConfig.deadTimeNs) {}
+
+void Motor::initCentreAligned(PinName pwm, PinName dir, int freqInHz, int deadTimeNs) {
+    TIM_TypeDef *p_tim = (TIM_TypeDef *)pinmap_peripheral(pwm, PinMap_PWM);
+    uint32_t function  = pinmap_function(pwm, PinMap_PWM);
+    uint32_t channel   = STM_PIN_CHANNEL(function);
+
+    MBED_ASSERT(p_tim == TIM1);
+
+    // Counting up then down, the carrier is half the counter's overflow rate
+    uint32_t arr = SystemCoreClock / (2 * freqInHz);
+    MBED_ASSERT_WARN(arr >= 1024);
+
+    // Up to 127 clock periods in steps of one, then up to 254 in steps of two
+    uint32_t deadTimeTicks = (uint32_t)deadTimeNs * (SystemCoreClock / 1000000) / 1000;
+    uint32_t dtg = deadTimeTicks < 128 ? deadTimeTicks : 0x80 | (min(deadTimeTicks, (uint32_t)254) / 2 - 64);
+
+    p_tim->CR1 &= ~TIM_CR1_CEN;
+    p_tim->CR1  = (p_tim->CR1 & ~TIM_CR1_CMS) | TIM_CR1_CMS_0 | TIM_CR1_ARPE;
+    p_tim->PSC  = 0;
+    p_tim->ARR  = arr;
+    p_tim->BDTR = (p_tim->BDTR & ~TIM_BDTR_DTG) | dtg | TIM_BDTR_MOE;
+
+    _p_tim       = p_tim;
+    _periodTicks = arr;
+
+    uint32_t dirFunction = pinmap_find_function(dir, PinMap_PWM);
+    bool isDirOnTim1 = dirFunction != (uint32_t)NC && (TIM_TypeDef *)pinmap_find_peripheral(dir, PinMap_PWM) == TIM1;
+
+    if (isDirOnTim1 && STM_PIN_CHANNEL(dirFunction) == channel) {
+        // Both outputs of the channel, the complementary one with dead-time inserted. Forward
+        // is the PWM pin high for longer, which is the complementary output's low side
+        _isLockedAntiphase = true;
+        _inverted = _inverted != (STM_PIN_INVERTED(function) != 0);
+        p_tim->CCER |= (TIM_CCER_CC1E | TIM_CCER_CC1NE) << (4 * (channel - 1));
+    }
+    else if (isDirOnTim1) {
+        uint32_t dirChannel = STM_PIN_CHANNEL(dirFunction);
+        uint32_t shift      = (dirChannel % 2) ? 0 : 8;
+        volatile uint32_t *p_dirCcmr = dirChannel <= 2 ? &p_tim->CCMR1 : &p_tim->CCMR2;
+
+        // PWM mode 1 with preload, held at 0% or 100%
+        *p_dirCcmr = (*p_dirCcmr & ~((TIM_CCMR1_CC1S | TIM_CCMR1_OC1M) << shift)) |
+                     ((TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE) << shift);
+
+        _p_dirCcr  = &p_tim->CCR1 + (dirChannel - 1);
+        *_p_dirCcr = 0;
+
+        p_tim->CCER |= (STM_PIN_INVERTED(dirFunction) ? TIM_CCER_CC1NE : TIM_CCER_CC1E) << (4 * (dirChannel - 1));
+    }
+
+    if (isDirOnTim1) {
+        pinmap_pinout(dir, PinMap_PWM);
+    }
+
+    // Load the preloaded registers and restart
+    p_tim->EGR = TIM_EGR_UG;
+    p_tim->CR1 |= TIM_CR1_CEN;
+}
 
 void Motor::setDutyCycle(float dutyCycle) {
-    _dir = (dutyCycle > 0.0) != _inverted;
-    _pwm = min( (float) fabs(dutyCycle), _limit);
+    dutyCycle = max(min(dutyCycle, 1.0f), -1.0f);
+    setDutyCycleRaw((int32_t)(dutyCycle * MOTOR_DUTY_CYCLE_FULL_SCALE));
+}
+
+void Motor::setDutyCycleRaw(int32_t dutyCycle) {
+    if (dutyCycle > _rawLimit) {
+        dutyCycle = _rawLimit;
+    }
+    else if (dutyCycle < -_rawLimit) {
+        dutyCycle = -_rawLimit;
+    }
+
+    // The output scale can change from an interrupt in between
+    core_util_critical_section_enter();
+
+    _requestedDutyCycle = dutyCycle;
+    writeDutyCycle((dutyCycle * _outputScale) / MOTOR_DUTY_CYCLE_FULL_SCALE);
+
+    core_util_critical_section_exit();
+}
+
+void Motor::setOutputScale(int32_t scale) {
+    scale = max(min(scale, (int32_t)MOTOR_DUTY_CYCLE_FULL_SCALE), (int32_t)0);
+
+    core_util_critical_section_enter();
+
+    if (scale != _outputScale) {
+        _outputScale = scale;
+        writeDutyCycle((_requestedDutyCycle * scale) / MOTOR_DUTY_CYCLE_FULL_SCALE);
+    }
+
+    core_util_critical_section_exit();
+}
+
+void Motor::writeDutyCycle(int32_t dutyCycle) {
+    _outputDutyCycle = dutyCycle;
+
+    if (_isLockedAntiphase) {
+        // 50% is stopped, the sides of the bridge swap roles around it
+        int32_t signedDutyCycle = _inverted ? -dutyCycle : dutyCycle;
+        *_p_ccr = ((uint32_t)(MOTOR_DUTY_CYCLE_FULL_SCALE + signedDutyCycle) * _periodTicks) / (2 * MOTOR_DUTY_CYCLE_FULL_SCALE);
+        return;
+    }
+
+    bool isForward = dutyCycle > 0;
+    uint32_t ccr = ((uint32_t)(isForward ? dutyCycle : -dutyCycle) * _periodTicks) / MOTOR_DUTY_CYCLE_FULL_SCALE;
+
+    if (_p_dirCcr != NULL) {
+        // Above the top of the count the direction channel never turns off. Updates are held
+        // off while writing so both registers load on the same update event
+        _p_tim->CR1 |= TIM_CR1_UDIS;
+        *_p_dirCcr = (isForward != _inverted) ? _periodTicks + 1 : 0;
+        *_p_ccr    = ccr;
+        _p_tim->CR1 &= ~TIM_CR1_UDIS;
+        return;
+    }
+
+    if ((_dir.read() != 0) != (isForward != _inverted)) {
+        // Turn the bridge off right away rather than finish the period in the new direction
+        *_p_ccmr &= ~_ccmrPreloadBit;
+        *_p_ccr = 0;
+        _dir = isForward != _inverted;
+        *_p_ccmr |= _ccmrPreloadBit;
+    }
+
+    *_p_ccr = ccr;
 }
 
 Motor& Motor::operator=(int dutyCycle) {
@@ -52,10 +202,5 @@ Motor& Motor::operator=(int dutyCycle) {
 }
 
 float Motor::getDutyCycle() {
-    if (_dir) {
-        return _pwm.read();
-    }
-    else {
-        return -_pwm.read();
-    }
+    return (float)_outputDutyCycle / MOTOR_DUTY_CYCLE_FULL_SCALE;
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+Non-blocking animations for a neopixel strip.
+
+The app calls tick() at a fixed rate (every ANIMATION_TICK_MS of its main
+loop, say) and every call draws one frame of the current animation. The
+frame is only sent when a pixel changed and the strip is free, so a solid
+color costs no SPI traffic and an animation never waits for the strip. If
+the strip is still busy, the frame goes out on a later tick.
+
+Durations are in ticks.
+*/
+
+#ifndef PIXEL_ANIMATOR_H
+#define PIXEL_ANIMATOR_H
+
+#include "neopixel.h"
+
+class PixelAnimator
+{
+public:
+	PixelAnimator(neopixel &strip);
+
+	/**every pixel off**/
+	void off();
+	/**every pixel one color**/
+	void solid(unsigned char r, unsigned char g, unsigned char b);
+	/**whole strip on for on_ticks then off for off_ticks**/
+	void blink(unsigned char r, unsigned char g, unsigned char b, unsigned int on_ticks, unsigned int off_ticks);
+	/**whole strip fades in then out over period_ticks**/
+	void fade(unsigned char r, unsigned char g, unsigned char b, unsigned int period_ticks);
+	/**a lit segment with a fading tail moving one pixel every step_ticks**/
+	void chase(unsigned char r, unsigned char g, unsigned char b, unsigned int length, unsigned int step_ticks);
+	/**strip filled up to value / max, the last pixel partially**/
+	void progress(unsigned char r, unsigned char g, unsigned char b, unsigned int value, unsigned int max);
+
+	/**draw the next frame and send it if it changed**/
+	void tick();
+
+private:
+	typedef enum {
+		Off,
+		Solid,
+		Blink,
+		Fade,
+		Chase,
+		Progress
+	} t_animation;
+
+	void start(t_animation animation, unsigned char r, unsigned char g, unsigned char b);
+	void fill(unsigned int level);
+	void setPixelLevel(int index, unsigned int level);
+
+	neopixel &m_strip;
+
+	t_animation m_animation;
+	unsigned char m_r, m_g, m_b;
+	unsigned int m_period_ticks;    // Blink and fade period, chase step
+	unsigned int m_on_ticks;        // Blink on time, chase length
+	unsigned int m_value, m_max;
+	unsigned int m_ticks;
+};
+
+#endif
@@ -1,7 +1,17 @@
 /*
-The idea behind this implementation is adopted from: 
-https://github.com/bigjosh/SimpleNeoPixelDemo/blob/master/SimpleNeopixelDemo/SimpleNeopixelDemo.ino
-and https://wp.josh.com/2014/05/13/ws2812-neopixels-are-not-so-finicky-once-you-get-to-know-them/
+WS2812 (NeoPixel) strip driven by SPI TX DMA.
+
+Each WS2812 bit is sent as 3 SPI bits at 3 MHz (48 MHz / 16): 100 for a 0
+(333 ns high) and 110 for a 1 (667 ns high), so the pixel buffer is encoded
+into 9 SPI bytes per pixel and streamed by the DMA. Interrupts stay enabled
+and the CPU is free while a frame goes out, only the signal pin's SPI
+peripheral and its TX DMA channel (DMA1 channel 3 for SPI1, 5 for SPI2) are
+used. The signal pin must be an SPI MOSI pin (PB_5 on the science board, PA_7
+on the Nucleo).
+
+Pixels are drawn into an RGB frame, the encoded SPI buffer is only rewritten
+by show() once the previous frame is out, so drawing never waits for the
+strip. Colors go through a gamma and brightness table when encoded.
 
 Hardware: https://cdn-shop.adafruit.com/datasheets/WS2812.pdf
 */
@@ -16,22 +26,42 @@ class neopixel
 public:
 	/**iniates the class with the specified signal pin and number of neopixels in the strip**/
 	neopixel(PinName signalPin, int pixel_num);
-	/**send one bit of data**/
-	inline void sendBit(int val);
-	/**send one byte of data**/
-	inline void sendByte(unsigned char byte);
-	/**send one pixel of data (RGB)**/
-	inline void sendPixel(unsigned char r, unsigned char g, unsigned char b);
-	/**signals to the neopixel that the complete signal has been send, start displaying**/
+	~neopixel();
+	/**set the color of one pixel in the frame, sent on the next show() or update()**/
+	void setPixel(int index, unsigned char r, unsigned char g, unsigned char b);
+	/**scale every color, 255 for full brightness**/
+	void setBrightness(unsigned char brightness);
+	/**start sending the frame to the strip, waits for the previous frame but returns while this one is going out**/
 	void show();
+	/**show() the frame if it changed and the strip is ready, never waits, true if a frame was started**/
+	bool update();
 	/**display a single color on the whole strip**/
 	void showColor(unsigned char r, unsigned char g, unsigned char b);
-	/**flashes get faster and faster until *boom* and fade to black**/
+	/**flashes get faster and faster until *boom* and fade to black, blocks for seconds (see PixelAnimator)**/
 	void detonate(unsigned char r, unsigned char g, unsigned char b, unsigned int startdelayms);
-	
+	/**true while a frame is being sent or latched by the strip**/
+	bool isBusy();
+	int getPixelNum();
+
 private:
-	DigitalOut led_signal;
+	typedef struct {
+		uint8_t r, g, b;
+	} t_pixel;
+
+	void waitUntilReady();
+	static uint32_t readTimeUs();
+	static void encodeByte(uint8_t *p_encoded, unsigned char byte);
+
+	SPI m_spi;
+	SPI_TypeDef *m_p_spi;
+	DMA_Channel_TypeDef *m_p_dma;
+	t_pixel *m_p_frame;
+	uint8_t *m_p_buffer;
+	uint8_t m_lut[256];
 	int m_pixel_num;
+	int m_buffer_size;
+	bool m_is_dirty;
+	uint32_t m_ready_at_us;
 };
 
 #endif
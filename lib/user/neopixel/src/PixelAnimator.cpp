@@ -0,0 +1,112 @@
+#include "PixelAnimator.h"
+
+#define LEVEL_MAX   256     // Full color, levels are scaled by a shift instead of a divide
+
+PixelAnimator::PixelAnimator(neopixel &strip) :
+		m_strip(strip), m_animation(Off), m_r(0), m_g(0), m_b(0), m_period_ticks(1), m_on_ticks(0),
+		m_value(0), m_max(1), m_ticks(0) {}
+
+void PixelAnimator::off() {
+	start(Off, 0, 0, 0);
+}
+
+void PixelAnimator::solid(unsigned char r, unsigned char g, unsigned char b) {
+	start(Solid, r, g, b);
+}
+
+void PixelAnimator::blink(unsigned char r, unsigned char g, unsigned char b, unsigned int on_ticks, unsigned int off_ticks) {
+	start(Blink, r, g, b);
+	m_on_ticks = on_ticks;
+	m_period_ticks = on_ticks + off_ticks > 0 ? on_ticks + off_ticks : 1;
+}
+
+void PixelAnimator::fade(unsigned char r, unsigned char g, unsigned char b, unsigned int period_ticks) {
+	start(Fade, r, g, b);
+	m_period_ticks = period_ticks >= 2 ? period_ticks : 2;
+}
+
+void PixelAnimator::chase(unsigned char r, unsigned char g, unsigned char b, unsigned int length, unsigned int step_ticks) {
+	start(Chase, r, g, b);
+	m_on_ticks = length > 0 ? length : 1;
+	m_period_ticks = step_ticks > 0 ? step_ticks : 1;
+}
+
+void PixelAnimator::progress(unsigned char r, unsigned char g, unsigned char b, unsigned int value, unsigned int max) {
+	// Keeps its place so a progress bar can be updated every tick without restarting anything
+	if (m_animation != Progress || m_r != r || m_g != g || m_b != b) {
+		start(Progress, r, g, b);
+	}
+	m_max = max > 0 ? max : 1;
+	m_value = value < m_max ? value : m_max;
+}
+
+void PixelAnimator::tick() {
+	int pixel_num = m_strip.getPixelNum();
+
+	switch (m_animation) {
+	case Off:
+		fill(0);
+		break;
+
+	case Solid:
+		fill(LEVEL_MAX);
+		break;
+
+	case Blink:
+		fill(m_ticks % m_period_ticks < m_on_ticks ? LEVEL_MAX : 0);
+		break;
+
+	case Fade: {
+		// Triangle wave, up over the first half of the period and down over the second
+		unsigned int half = m_period_ticks / 2;
+		unsigned int phase = m_ticks % m_period_ticks;
+		unsigned int rising = phase < half ? phase : m_period_ticks - phase;
+
+		fill(rising * LEVEL_MAX / half);
+		break;
+	}
+
+	case Chase: {
+		int head = (m_ticks / m_period_ticks) % pixel_num;
+
+		for (int p = 0; p < pixel_num; p++) {
+			unsigned int behind = (head - p + pixel_num) % pixel_num;
+			setPixelLevel(p, behind < m_on_ticks ? LEVEL_MAX - behind * LEVEL_MAX / m_on_ticks : 0);
+		}
+		break;
+	}
+
+	case Progress: {
+		// Filled length in 1/LEVEL_MAX of a pixel
+		unsigned int filled = m_value * pixel_num * LEVEL_MAX / m_max;
+
+		for (int p = 0; p < pixel_num; p++) {
+			unsigned int pixel_start = p * LEVEL_MAX;
+			setPixelLevel(p, filled <= pixel_start ? 0 :
+			                 (filled - pixel_start < LEVEL_MAX ? filled - pixel_start : LEVEL_MAX));
+		}
+		break;
+	}
+	}
+
+	m_ticks++;
+	m_strip.update();
+}
+
+void PixelAnimator::start(t_animation animation, unsigned char r, unsigned char g, unsigned char b) {
+	m_animation = animation;
+	m_r = r;
+	m_g = g;
+	m_b = b;
+	m_ticks = 0;
+}
+
+void PixelAnimator::fill(unsigned int level) {
+	for (int p = 0; p < m_strip.getPixelNum(); p++) {
+		setPixelLevel(p, level);
+	}
+}
+
+void PixelAnimator::setPixelLevel(int index, unsigned int level) {
+	m_strip.setPixel(index, (m_r * level) >> 8, (m_g * level) >> 8, (m_b * level) >> 8);
+}
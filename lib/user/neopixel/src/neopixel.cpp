@@ -1,82 +1,127 @@
 #include "neopixel.h"
+#include "pinmap.h"
+#include "PeripheralPins.h"
+#include "us_ticker_api.h"
+#include <math.h>
 
-#define REPEAT_FIVE(a)     a;a;a;a;a
-#define REPEAT_TEN(a)      REPEAT_FIVE(a); REPEAT_FIVE(a)
+#define SPI_FREQUENCY_HZ    3000000
+#define BYTES_PER_COLOR     3       // 8 WS2812 bits of 3 SPI bits each
+#define BYTES_PER_PIXEL     (3 * BYTES_PER_COLOR)
+#define LEADING_ZEROS       1       // Holds the line low before the first bit
 
-// CPU cycle timing
-#define NS_PER_SEC (1000000000L)
-#define CYCLES_PER_SEC (48000000.0)
-#define NS_PER_CYCLE ( NS_PER_SEC / CYCLES_PER_SEC )
+#define SPI_BIT_0           0x4     // 100
+#define SPI_BIT_1           0x6     // 110
 
-#define NS_TO_CYCLES(n) ( int((n) / NS_PER_CYCLE / 6.0 ))
+#define RES_US              300     // Low time for the strip to latch, WS2812B needs more than the 50 us of the WS2812
 
-// Timings for 0 and 1 bit
-#define T1H  900    // Width of a 1 bit in ns
-#define T1L  600    // Width of a 1 bit in ns
+#define GAMMA               2.2f    // Perceived brightness is far from linear in the PWM duty of the LEDs
 
-#define T0H  400    // Width of a 0 bit in ns
-#define T0L  900    // Width of a 0 bit in ns
+#define DMA_CSELR_SPI       0x3     // SPI TX request on DMA1 channels 3 (SPI1) and 5 (SPI2)
 
-#define RES 6000    // Width of the low gap between bits to cause a frame to latch
 
+neopixel::neopixel(PinName signalPin, int pixel_num) :
+		m_spi(signalPin, NC, NC), m_pixel_num(pixel_num), m_is_dirty(false), m_ready_at_us(readTimeUs()) {
 
-neopixel::neopixel(PinName signalPin, int pixel_num):led_signal(signalPin) {
-	m_pixel_num = pixel_num;
-}
+	m_p_frame = new t_pixel[m_pixel_num];
+	memset(m_p_frame, 0, m_pixel_num * sizeof(t_pixel));
+
+	m_buffer_size = LEADING_ZEROS + m_pixel_num * BYTES_PER_PIXEL;
+	m_p_buffer = new uint8_t[m_buffer_size];
+	memset(m_p_buffer, 0, m_buffer_size);
+
+	setBrightness(255);
+
+	m_spi.format(8, 0);
+	m_spi.frequency(SPI_FREQUENCY_HZ);
+
+	m_p_spi = (SPI_TypeDef *)pinmap_peripheral(signalPin, PinMap_SPI_MOSI);
 
-inline void neopixel::sendBit(int val) {
-	if (val) {
-		led_signal = 1;
-		REPEAT_TEN(__NOP());
-		REPEAT_TEN(__NOP());
-		REPEAT_TEN(__NOP());
-		REPEAT_TEN(__NOP());
-
-		led_signal = 0;
-		REPEAT_TEN(__NOP());
-		REPEAT_TEN(__NOP());
-		REPEAT_FIVE(__NOP());
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+	if (m_p_spi == SPI1) {
+		m_p_dma = DMA1_Channel3;
+		DMA1->CSELR = (DMA1->CSELR & ~DMA_CSELR_C3S) | (DMA_CSELR_SPI << DMA_CSELR_C3S_Pos);
 	}
 	else {
-		led_signal = 1;
-		REPEAT_TEN(__NOP());
-		__NOP();
-		__NOP();
-
-		led_signal = 0;
-		REPEAT_TEN(__NOP());
-		REPEAT_TEN(__NOP());
-		REPEAT_TEN(__NOP());
-		REPEAT_TEN(__NOP());
+		m_p_dma = DMA1_Channel5;
+		DMA1->CSELR = (DMA1->CSELR & ~DMA_CSELR_C5S) | (DMA_CSELR_SPI << DMA_CSELR_C5S_Pos);
 	}
+
+	// Byte wide memory to data register copies, started by show()
+	m_p_dma->CCR   = DMA_CCR_MINC | DMA_CCR_DIR;
+	m_p_dma->CPAR  = (uint32_t)&m_p_spi->DR;
+
+	// The SPI is set up as transmit only, one line, and fed by the DMA
+	m_p_spi->CR1 &= ~SPI_CR1_SPE;
+	m_p_spi->CR1 |= SPI_CR1_BIDIOE;
+	m_p_spi->CR2 |= SPI_CR2_TXDMAEN;
+	m_p_spi->CR1 |= SPI_CR1_SPE;
 }
 
-inline void neopixel::sendByte(unsigned char byte) {
-	for (unsigned char bit = 0; bit < 8; bit++) {
+neopixel::~neopixel() {
+	waitUntilReady();
+	m_p_dma->CCR &= ~DMA_CCR_EN;
+	delete[] m_p_buffer;
+	delete[] m_p_frame;
+}
 
-		sendBit((byte >> bit) & 1);  // Neopixel needs bit in highest-to-lowest order
-									// so send highest bit (bit #7 in an 8-bit byte since they start at 0)
-		byte <<= 1;                // and then shift left so bit 6 moves into 7, 5 moves into 6, etc
+void neopixel::setPixel(int index, unsigned char r, unsigned char g, unsigned char b) {
+	if (index < 0 || index >= m_pixel_num) {
+		return;
+	}
+
+	t_pixel &pixel = m_p_frame[index];
+
+	if (pixel.r != r || pixel.g != g || pixel.b != b) {
+		pixel.r = r;
+		pixel.g = g;
+		pixel.b = b;
+		m_is_dirty = true;
 	}
 }
 
-inline void neopixel::sendPixel(unsigned char r, unsigned char g, unsigned char b) {
-	sendByte(g);          // Neopixel needs colors in green then red then blue order
-	sendByte(r);
-	sendByte(b);
+void neopixel::setBrightness(unsigned char brightness) {
+	for (int i = 0; i < 256; i++) {
+		m_lut[i] = (uint8_t)(powf(i / 255.0f, GAMMA) * brightness + 0.5f);
+	}
+	m_is_dirty = true;
 }
 
 void neopixel::show() {
-	wait_us((RES / 1000UL) + 1);  // Round up since the delay must be _at_least_ this long (too short might not work, too long not a problem)
+	// The encoded buffer may still be going out
+	waitUntilReady();
+
+	for (int p = 0; p < m_pixel_num; p++) {
+		uint8_t *p_pixel = &m_p_buffer[LEADING_ZEROS + p * BYTES_PER_PIXEL];
+
+		encodeByte(p_pixel, m_lut[m_p_frame[p].g]);          // Neopixel needs colors in green then red then blue order
+		encodeByte(p_pixel + BYTES_PER_COLOR, m_lut[m_p_frame[p].r]);
+		encodeByte(p_pixel + 2 * BYTES_PER_COLOR, m_lut[m_p_frame[p].b]);
+	}
+	m_is_dirty = false;
+
+	m_p_dma->CCR  &= ~DMA_CCR_EN;
+	m_p_dma->CMAR  = (uint32_t)m_p_buffer;
+	m_p_dma->CNDTR = m_buffer_size;
+	m_p_dma->CCR  |= DMA_CCR_EN;
+
+	m_ready_at_us = readTimeUs() + (m_buffer_size * 8 * 1000000UL) / SPI_FREQUENCY_HZ + RES_US;
+}
+
+bool neopixel::update() {
+	if (!m_is_dirty || isBusy()) {
+		return false;
+	}
+
+	show();
+	return true;
 }
 
 void neopixel::showColor(unsigned char r, unsigned char g, unsigned char b) {
-	__disable_irq();
 	for (int p = 0; p < m_pixel_num; p++) {
-		sendPixel(r, g, b);
+		setPixel(p, r, g, b);
 	}
 	show();
-	__enable_irq();
 }
 
 void neopixel::detonate(unsigned char r, unsigned char g, unsigned char b, unsigned int startdelayms) {
@@ -95,4 +140,35 @@ void neopixel::detonate(unsigned char r, unsigned char g, unsigned char b, unsig
 	}
 
 	showColor(0, 0, 0);
-}
\ No newline at end of file
+}
+
+int neopixel::getPixelNum() {
+	return m_pixel_num;
+}
+
+bool neopixel::isBusy() {
+	return m_p_dma->CNDTR != 0 || (m_p_spi->SR & (SPI_SR_FTLVL | SPI_SR_BSY)) ||
+	       (int32_t)(readTimeUs() - m_ready_at_us) < 0;
+}
+
+void neopixel::waitUntilReady() {
+	while (isBusy()) {}
+}
+
+// Strips are constructed before main, possibly before anything has started the microsecond ticker
+uint32_t neopixel::readTimeUs() {
+	return ticker_read(get_us_ticker_data());
+}
+
+void neopixel::encodeByte(uint8_t *p_encoded, unsigned char byte) {
+	uint32_t bits = 0;
+
+	// Most significant bit first
+	for (int bit = 7; bit >= 0; bit--) {
+		bits = (bits << 3) | (((byte >> bit) & 1) ? SPI_BIT_1 : SPI_BIT_0);
+	}
+
+	p_encoded[0] = bits >> 16;
+	p_encoded[1] = bits >> 8;
+	p_encoded[2] = bits;
+}
@@ -131,6 +131,15 @@ public:
      * @param interval PID calculation peformed every interval seconds.
      */
     void setInterval(float interval);
+
+    /**
+     * Set the time since the last calculation.
+     *
+     * Cheaper than setInterval for a loop timed on every update.
+     *
+     * @param intervalUs Microseconds since the last calculation.
+     */
+    void setIntervalUs(uint32_t intervalUs);
     
     /**
      * Set the set point.
@@ -172,10 +181,13 @@ public:
     float getOutMin();
     float getOutMax();
     float getInterval();
+    uint32_t getIntervalUs();
     float getPParam();
     float getIParam();
     float getDParam();
     float getSetPoint();
+    float getBias();
+    float getDeadZoneError();
 
 private:
 
@@ -184,7 +196,7 @@ private:
 
     //Actual tuning parameters used in PID calculation.
     float Kc_;
-    float tauR_;
+    float tauRUs_;
     float tauD_;
     
     //Raw tuning parameters.
@@ -206,19 +218,20 @@ private:
     float inMin_;
     float inMax_;
     float inSpan_;
+    float inSpanInverse_;
     float outMin_;
     float outMax_;
     float outSpan_;
 
-    //The accumulated error, i.e. integral.
-    float accError_;
+    //The accumulated error, i.e. integral, in error microseconds.
+    float accErrorUs_;
     //The allowed error range for error to be rounded to 0.0
     float deadZoneError_;
     //The controller output bias.
     float bias_;
 
     //The interval between samples.
-    float tSample_;          
+    uint32_t tSampleUs_;
 
     //Controller output as a real world value.
     volatile float realOutput_;
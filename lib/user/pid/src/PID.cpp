@@ -50,6 +50,8 @@
 
 #include "PID.h"
 
+#define US_PER_SECOND   1000000.0f
+
 PID::PID(float Kc, float tauI, float tauD, float interval) {
 
     usingFeedForward = false;
@@ -61,7 +63,8 @@ PID::PID(float Kc, float tauI, float tauD, float interval) {
     setInputLimits(0.0, 3.3);
     setOutputLimits(0.0, 3.3);
 
-    tSample_ = interval;
+    tSampleUs_ = 0;
+    setInterval(interval);
 
     setTunings(Kc, tauI, tauD);
 
@@ -71,7 +74,7 @@ PID::PID(float Kc, float tauI, float tauD, float interval) {
     controllerOutput_     = 0.0;
     prevControllerOutput_ = 0.0;
 
-    accError_       = 0.0;
+    accErrorUs_     = 0.0;
     deadZoneError_  = 0.0;
     bias_           = 0.0;
     
@@ -88,7 +91,7 @@ void PID::setInputLimits(float inMin, float inMax) {
 
     //Rescale the working variables to reflect the changes.
     prevProcessVariable_ *= (inMax - inMin) / inSpan_;
-    accError_            *= (inMax - inMin) / inSpan_;
+    accErrorUs_          *= (inMax - inMin) / inSpan_;
 
     //Make sure the working variables are within the new limits.
     if (prevProcessVariable_ > 1) {
@@ -100,6 +103,7 @@ void PID::setInputLimits(float inMin, float inMax) {
     inMin_  = inMin;
     inMax_  = inMax;
     inSpan_ = inMax - inMin;
+    inSpanInverse_ = 1.0 / inSpan_;
 
 }
 
@@ -138,26 +142,33 @@ void PID::setTunings(float Kc, float tauI, float tauD) {
     iParam_ = tauI;
     dParam_ = tauD;
 
-    float tempTauR;
+    //The integral gain is per microsecond so that it doesn't depend on
+    //the interval, which changes on every update.
+    float tempTauRUs;
 
     if (tauI == 0.0) {
-        tempTauR = 0.0;
+        tempTauRUs = 0.0;
     } else {
-        tempTauR = (1.0 / tauI) * tSample_;
+        tempTauRUs = 1.0 / (tauI * US_PER_SECOND);
     }
 
     //For "bumpless transfer" we need to rescale the accumulated error.
     if (inAuto) {
-        if (tempTauR == 0.0) {
-            accError_ = 0.0;
+        if (tempTauRUs == 0.0) {
+            accErrorUs_ = 0.0;
         } else {
-            accError_ *= (Kc_ * tauR_) / (Kc * tempTauR);
+            accErrorUs_ *= (Kc_ * tauRUs_) / (Kc * tempTauRUs);
         }
     }
 
-    Kc_   = Kc;
-    tauR_ = tempTauR;
-    tauD_ = tauD / tSample_;
+    //The derivative acts on the change per update, scaled by the interval
+    //the tunings were set at (rescaling it with every new interval used to
+    //cancel out to this).
+    float interval = tSampleUs_ / US_PER_SECOND;
+
+    Kc_     = Kc;
+    tauRUs_ = tempTauRUs;
+    tauD_   = tauD / (interval * interval);
 
 }
 
@@ -172,10 +183,10 @@ void PID::reset(void) {
     }
 
     prevControllerOutput_ = scaledBias;
-    prevProcessVariable_  = (processVariable_ - inMin_) / inSpan_;
+    prevProcessVariable_  = (processVariable_ - inMin_) * inSpanInverse_;
 
     //Clear any error in the integral.
-    accError_ = 0;
+    accErrorUs_ = 0;
 
 }
 
@@ -194,11 +205,16 @@ void PID::setMode(int mode) {
 void PID::setInterval(float interval) {
 
     if (interval > 0) {
-        //Convert the time-based tunings to reflect this change.
-        tauR_     *= (interval / tSample_);
-        accError_ *= (tSample_ / interval);
-        tauD_     *= (interval / tSample_);
-        tSample_   = interval;
+        setIntervalUs((uint32_t)(interval * US_PER_SECOND + 0.5f));
+    }
+
+}
+
+void PID::setIntervalUs(uint32_t intervalUs) {
+
+    //None of the tunings depend on the interval, see setTunings.
+    if (intervalUs > 0) {
+        tSampleUs_ = intervalUs;
     }
 
 }
@@ -231,7 +247,7 @@ void PID::setDeadZoneError(float error) {
 float PID::compute() {
 
     //Pull in the input and setpoint, and scale them into percent span.
-    float scaledPV = (processVariable_ - inMin_) / inSpan_;
+    float scaledPV = (processVariable_ - inMin_) * inSpanInverse_;
 
     if (scaledPV > 1.0) {
         scaledPV = 1.0;
@@ -239,7 +255,7 @@ float PID::compute() {
         scaledPV = 0.0;
     }
 
-    float scaledSP = (setPoint_ - inMin_) / inSpan_;
+    float scaledSP = (setPoint_ - inMin_) * inSpanInverse_;
     if (scaledSP > 1.0) {
         scaledSP = 1;
     } else if (scaledSP < 0.0) {
@@ -255,11 +271,11 @@ float PID::compute() {
     //Check and see if the output is pegged at a limit and only
     //integrate if it is not. This is to prevent reset-windup.
     if (!(prevControllerOutput_ >= 1 && error > 0) && !(prevControllerOutput_ <= 0 && error < 0)) {
-        accError_ += error;
+        accErrorUs_ += error * (float)tSampleUs_;
     }
 
-    //Compute the current slope of the input signal.
-    float dMeas = (scaledPV - prevProcessVariable_) / tSample_;
+    //Compute the current change of the input signal.
+    float dMeas = scaledPV - prevProcessVariable_;
 
     float scaledBias = 0.0;
 
@@ -268,7 +284,7 @@ float PID::compute() {
     }
 
     //Perform the PID calculation.
-    controllerOutput_ = scaledBias + Kc_ * (error + (tauR_ * accError_) - (tauD_ * dMeas));
+    controllerOutput_ = scaledBias + Kc_ * (error + (tauRUs_ * accErrorUs_) - (tauD_ * dMeas));
 
     //Make sure the computed output is within output constraints.
     if (controllerOutput_ < 0.0) {
@@ -313,7 +329,13 @@ float PID::getOutMax() {
 
 float PID::getInterval() {
 
-    return tSample_;
+    return tSampleUs_ / US_PER_SECOND;
+
+}
+
+uint32_t PID::getIntervalUs() {
+
+    return tSampleUs_;
 
 }
 
@@ -338,3 +360,11 @@ float PID::getDParam() {
 float PID::getSetPoint() {
     return setPoint_;
 }
+
+float PID::getBias() {
+    return bias_;
+}
+
+float PID::getDeadZoneError() {
+    return deadZoneError_;
+}
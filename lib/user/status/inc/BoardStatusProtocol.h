@@ -0,0 +1,50 @@
+#ifndef BOARD_STATUS_PROTOCOL_H
+#define BOARD_STATUS_PROTOCOL_H
+
+/* CAN frames reporting the health of a board (see BoardStatusService.h).
+ *
+ * Every board sends a status frame on its reply base + ROVER_SYS_REPLY_STATUS
+ * once a second, all sizes in bytes:
+ *
+ *   Status   [stackPeak(u16), headroom(u16), heap(u16), heapPeak(u16)]
+ *
+ * Headroom is the RAM neither the stack nor the heap has ever reached. While
+ * something is wrong a warning goes out on ROVER_SYS_REPLY_WARNING right after
+ * each status:
+ *
+ *   Warning  [flags, headroom(u16), heapAllocFailures(u16)]
+ *
+ * Multi byte fields are little endian, saturated at 0xFFFF.
+ */
+
+#include <stdint.h>
+
+class BoardStatusProtocol {
+
+public:
+
+    typedef enum t_warning {
+        warningLowHeadroom      = 0x01,     // Below the board's threshold
+        warningHeapAllocFailed  = 0x02      // An allocation has failed since boot
+
+    } t_warning;
+
+    static const uint8_t statusSize  = 8;
+    static const uint8_t warningSize = 5;
+
+    static void packU16(uint8_t *p_data, uint32_t value) {
+        if (value > 0xFFFF) {
+            value = 0xFFFF;
+        }
+
+        p_data[0] = value & 0xFF;
+        p_data[1] = value >> 8;
+    }
+
+    static uint16_t unpackU16(const uint8_t *p_data) {
+        return p_data[0] | (p_data[1] << 8);
+    }
+
+};
+
+#endif // BOARD_STATUS_PROTOCOL_H
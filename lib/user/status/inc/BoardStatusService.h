@@ -0,0 +1,47 @@
+#ifndef BOARD_STATUS_SERVICE_H
+#define BOARD_STATUS_SERVICE_H
+
+/* Reports the memory usage of a board over CAN (see BoardStatusProtocol.h).
+ *
+ * The service paints the free RAM when it is constructed, so it is best
+ * declared before the other globals of the app. Measuring scans the free RAM,
+ * which is why it only happens once per status period.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "MemoryMonitor.h"
+#include "BoardStatusProtocol.h"
+
+#define BOARD_STATUS_PERIOD_US                  1000000
+#define BOARD_STATUS_HEADROOM_WARNING_BYTES     1024
+
+class BoardStatusService {
+
+public:
+
+    BoardStatusService(CAN &can, uint32_t boardCanId,
+                       uint32_t headroomWarningBytes = BOARD_STATUS_HEADROOM_WARNING_BYTES);
+
+    /** Send the status, and any warning, once per period, call every main loop iteration
+     */
+    void poll(void);
+
+    /** @return Usage at the last status
+     */
+    const MemoryMonitor::t_usage &getUsage(void);
+
+private:
+
+    void sendStatus(void);
+
+    CAN &m_can;
+    uint32_t m_boardCanId;
+    uint32_t m_headroomWarningBytes;
+
+    uint32_t m_lastStatusUs;
+    MemoryMonitor::t_usage m_usage;
+
+};
+
+#endif // BOARD_STATUS_SERVICE_H
@@ -0,0 +1,47 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+/* Stack and heap usage of the board.
+ *
+ * Without an RTOS the heap grows up from the end of .bss and the stack (shared
+ * by main and every interrupt) grows down from the top of RAM, whatever is
+ * between them is free. paint() fills that gap with a pattern once at boot, and
+ * the deepest the stack has ever been is the lowest word above the heap that
+ * no longer holds it. Heap usage comes from mbed_stats (MBED_HEAP_STATS_ENABLED),
+ * so it counts what is allocated rather than how far the heap has grown.
+ */
+
+#include "mbed.h"
+
+#define MEMORY_MONITOR_PAINT            0xC0FFEE55
+#define MEMORY_MONITOR_PAINT_MARGIN     64      // Bytes left alone under the stack pointer while painting
+
+class MemoryMonitor {
+
+public:
+
+    typedef struct {
+        uint32_t stackPeakBytes;        // Main loop and interrupts together
+        uint32_t headroomBytes;         // Never used by either the stack or the heap
+        uint32_t heapBytes, heapPeakBytes;
+        uint32_t heapAllocFailures;
+
+    } t_usage;
+
+    /** Paint the free RAM, as early as possible, only the first call paints
+     */
+    static void paint(void);
+
+    /** Measure the usage, scans the free RAM so it takes up to a few hundred microseconds
+     *
+     * @return false if the RAM was never painted, the stack figures are then 0
+     */
+    static bool getUsage(t_usage &usage);
+
+private:
+
+    static bool s_isPainted;
+
+};
+
+#endif // MEMORY_MONITOR_H
@@ -0,0 +1,64 @@
+/* Reports the memory usage of a board over CAN.
+ */
+
+#include "BoardStatusService.h"
+#include "MicrosecondClock.h"
+
+BoardStatusService::BoardStatusService(CAN &can, uint32_t boardCanId, uint32_t headroomWarningBytes) :
+        m_can(can), m_boardCanId(boardCanId), m_headroomWarningBytes(headroomWarningBytes) {
+    MemoryMonitor::paint();
+    memset(&m_usage, 0, sizeof(m_usage));
+
+    MicrosecondClock::init();
+    m_lastStatusUs = MicrosecondClock::read();
+}
+
+void BoardStatusService::poll(void) {
+    if (MicrosecondClock::elapsedSince(m_lastStatusUs) < BOARD_STATUS_PERIOD_US) {
+        return;
+    }
+
+    m_lastStatusUs = MicrosecondClock::read();
+    sendStatus();
+}
+
+const MemoryMonitor::t_usage &BoardStatusService::getUsage(void) {
+    return m_usage;
+}
+
+void BoardStatusService::sendStatus(void) {
+    bool isPainted = MemoryMonitor::getUsage(m_usage);
+
+    CANMessage status;
+    status.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_STATUS;
+    status.len = BoardStatusProtocol::statusSize;
+    BoardStatusProtocol::packU16(&status.data[0], m_usage.stackPeakBytes);
+    BoardStatusProtocol::packU16(&status.data[2], m_usage.headroomBytes);
+    BoardStatusProtocol::packU16(&status.data[4], m_usage.heapBytes);
+    BoardStatusProtocol::packU16(&status.data[6], m_usage.heapPeakBytes);
+
+    MBED_ASSERT_WARN(m_can.write(status));
+
+    uint8_t warnings = 0;
+
+    if (isPainted && m_usage.headroomBytes < m_headroomWarningBytes) {
+        warnings |= BoardStatusProtocol::warningLowHeadroom;
+    }
+
+    if (m_usage.heapAllocFailures > 0) {
+        warnings |= BoardStatusProtocol::warningHeapAllocFailed;
+    }
+
+    if (warnings == 0) {
+        return;
+    }
+
+    CANMessage warning;
+    warning.id      = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_WARNING;
+    warning.len     = BoardStatusProtocol::warningSize;
+    warning.data[0] = warnings;
+    BoardStatusProtocol::packU16(&warning.data[1], m_usage.headroomBytes);
+    BoardStatusProtocol::packU16(&warning.data[3], m_usage.heapAllocFailures);
+
+    MBED_ASSERT_WARN(m_can.write(warning));
+}
@@ -0,0 +1,61 @@
+/* Stack and heap usage of the board.
+ */
+
+#include "MemoryMonitor.h"
+#include "mbed_stats.h"
+
+// Linker script symbols
+extern "C" uint32_t __StackTop;
+extern "C" char *_sbrk(int incr);
+
+bool MemoryMonitor::s_isPainted = false;
+
+static uint32_t *getHeapTop(void) {
+    // Rounded up to the next word, the heap can end on any byte
+    return (uint32_t *)(((uint32_t)_sbrk(0) + 3) & ~3);
+}
+
+void MemoryMonitor::paint(void) {
+    if (s_isPainted) {
+        return;
+    }
+
+    uint32_t *p_word = getHeapTop();
+    uint32_t *p_end  = (uint32_t *)((__get_MSP() - MEMORY_MONITOR_PAINT_MARGIN) & ~3);
+
+    // An interrupt only ever uses the stack below here until it returns, so painting over it is harmless
+    while (p_word < p_end) {
+        *p_word++ = MEMORY_MONITOR_PAINT;
+    }
+
+    s_isPainted = true;
+}
+
+bool MemoryMonitor::getUsage(MemoryMonitor::t_usage &usage) {
+    mbed_stats_heap_t heapStats;
+    mbed_stats_heap_get(&heapStats);
+
+    usage.heapBytes         = heapStats.current_size;
+    usage.heapPeakBytes     = heapStats.max_size;
+    usage.heapAllocFailures = heapStats.alloc_fail_cnt;
+    usage.stackPeakBytes    = 0;
+    usage.headroomBytes     = 0;
+
+    if (!s_isPainted) {
+        return false;
+    }
+
+    uint32_t *p_heapTop = getHeapTop();
+    uint32_t *p_word    = p_heapTop;
+    uint32_t *p_end     = (uint32_t *)__get_MSP();
+
+    // A frame can leave some of its words untouched, the lowest word that lost the pattern is the deepest point
+    while (p_word < p_end && *p_word == MEMORY_MONITOR_PAINT) {
+        p_word++;
+    }
+
+    usage.stackPeakBytes = (uint32_t)&__StackTop - (uint32_t)p_word;
+    usage.headroomBytes  = (uint32_t)p_word - (uint32_t)p_heapTop;
+
+    return true;
+}
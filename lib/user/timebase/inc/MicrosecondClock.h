@@ -0,0 +1,55 @@
+#ifndef MICROSECOND_CLOCK_H
+#define MICROSECOND_CLOCK_H
+
+/* Monotonic microsecond clock shared by the controllers.
+ *
+ * Reads the 32 bit timer behind the mbed microsecond ticker (TIM2) directly, so
+ * a read is a single register load instead of Timer::read()'s 64 bit count and
+ * soft-float divide. The count wraps every 71 minutes; only differences between
+ * two reads are meaningful, taken as uint32_t so they survive the wrap. It is
+ * not the same count as ticker_read(), which is kept by the mbed ticker layer.
+ */
+
+#include "mbed.h"
+#include "us_ticker_data.h"
+
+#if TIM_MST_BIT_WIDTH != 32
+#error "MicrosecondClock needs a 32 bit microsecond ticker timer"
+#endif
+
+class MicrosecondClock {
+
+public:
+
+    /** Start the microsecond ticker if nothing has yet, safe to call any number of times
+     */
+    static void init(void);
+
+    /** @return Current time in microseconds
+     */
+    static inline uint32_t read(void) {
+        return TIM_MST->CNT;
+    }
+
+    /** Time since a previous read, which is moved on to now
+     *
+     * @param lastUs Time of the previous read, updated to the current time
+     * @return Microseconds elapsed since lastUs
+     */
+    static inline uint32_t lap(uint32_t &lastUs) {
+        uint32_t nowUs = read();
+        uint32_t elapsedUs = nowUs - lastUs;
+
+        lastUs = nowUs;
+        return elapsedUs;
+    }
+
+    /** @return Microseconds elapsed since an earlier read
+     */
+    static inline uint32_t elapsedSince(uint32_t startUs) {
+        return read() - startUs;
+    }
+
+};
+
+#endif // MICROSECOND_CLOCK_H
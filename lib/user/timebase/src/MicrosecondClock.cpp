@@ -0,0 +1,10 @@
+/* Monotonic microsecond clock shared by the controllers.
+ */
+
+#include "MicrosecondClock.h"
+#include "us_ticker_api.h"
+
+void MicrosecondClock::init(void) {
+    // The ticker layer initialises the timer on its first read, and only then
+    ticker_read(get_us_ticker_data());
+}
@@ -0,0 +1,73 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+/* Estimates the offset and drift of a local microsecond timer against a remote clock.
+ *
+ * Each sample pairs a remote time with the local time it was received at. The
+ * delay between the two (queueing on the Jetson, the main loop picking the
+ * frame up) is never negative, so the smallest offset of every window of
+ * samples is the closest to the true one. The drift comes from the change of
+ * that minimum over the last few windows, which keeps the estimate within a few
+ * tens of microseconds between SYNCs even on the RC oscillator. A jump in the
+ * remote clock (eg. the Jetson rebooting) restarts the estimation.
+ *
+ * Times are 32 bit microseconds and may wrap. No mbed dependencies, so the
+ * estimator can be exercised on the host.
+ */
+
+#include <stdint.h>
+
+#define CLOCK_SYNC_WINDOW           8       // Samples per minimum
+#define CLOCK_SYNC_HISTORY          8       // Minimums the drift is measured across
+#define CLOCK_SYNC_STEP_US          10000   // Larger errors are clock jumps, not delays
+#define CLOCK_SYNC_MAX_OUTLIERS     3
+#define CLOCK_SYNC_TIMEOUT_US       2000000 // Synchronisation is lost without samples for this long
+#define CLOCK_SYNC_MAX_DRIFT        0.02f   // HSI worst case over temperature
+
+class ClockSync {
+
+public:
+
+    ClockSync();
+
+    /** Add a remote time and the local time it arrived at
+     */
+    void addSample(uint32_t localUs, uint32_t remoteUs);
+
+    /** Forget every sample
+     */
+    void reset(void);
+
+    /** @return true if the offset and drift are known and recent
+     */
+    bool isSynchronised(uint32_t localUs);
+
+    /** @return Remote time at a local time, the local time itself until a first window is complete
+     */
+    uint32_t toRemote(uint32_t localUs);
+
+    /** @return Local clock rate error, in parts per million
+     */
+    float getDriftPpm(void);
+
+private:
+
+    uint32_t predictOffset(uint32_t localUs);
+
+    // Offset (local - remote) at m_baseUs, and its rate of change
+    uint32_t m_baseUs, m_baseOffset;
+    float m_drift;
+    uint32_t m_windows;
+    uint32_t m_historyUs[CLOCK_SYNC_HISTORY], m_historyOffset[CLOCK_SYNC_HISTORY];
+
+    // Window in progress, the minimum is relative to the current prediction
+    uint32_t m_windowSamples;
+    int32_t m_windowMinError;
+    uint32_t m_windowMinUs, m_windowMinOffset;
+
+    uint32_t m_lastSampleUs;
+    uint32_t m_outliers;
+
+};
+
+#endif // CLOCK_SYNC_H
@@ -0,0 +1,63 @@
+#ifndef TIME_SYNC_PROTOCOL_H
+#define TIME_SYNC_PROTOCOL_H
+
+/* CAN protocol for aligning the clocks of the boards with the Jetson (see ClockSync.h).
+ *
+ * Jetson time is its CLOCK_MONOTONIC in microseconds, truncated to 32 bits.
+ * The Jetson broadcasts a SYNC frame on ROVER_CANID_SYNC every 100 ms or so,
+ * stamped just before it is queued. Each board estimates the offset and drift
+ * of its own microsecond timer from them and stamps its frames in Jetson time:
+ *
+ *   SYNC         [sequence, jetsonTimeUs(u32)]
+ *   Feedback     [value (up to 4 bytes, zero padded), timestamp]
+ *   Command ack  [command, flags, receivedTime(u24), appliedTime(u24)]
+ *
+ * A timestamp is the low 24 bits of the time (16.7 s range, unwrapped against
+ * the receiver's clock) followed by a flags byte. Until a board has synchronised
+ * its timestamps are in its own time, so only differences between them mean
+ * anything. Command acks go to the board's reply base + ROVER_SYS_REPLY_COMMAND_ACK
+ * once the command has gone through a controller update, command is the low
+ * byte of its CAN ID. Multi byte fields are little endian.
+ */
+
+#include <stdint.h>
+
+class TimeSyncProtocol {
+
+public:
+
+    typedef enum t_flags {
+        flagSynchronised = 0x01     // Time is in Jetson time, otherwise in board time
+
+    } t_flags;
+
+    static const uint8_t timestampOffset = 4;           // Feedback value bytes before the timestamp
+    static const uint8_t timestampSize   = 4;
+    static const uint32_t timeMask       = 0xFFFFFF;
+
+    // From the Jetson's stamp to the end of the SYNC frame on the board at 500 kbps
+    static const uint32_t syncWireTimeUs = 180;
+
+    static void packTime(uint8_t *p_data, uint32_t timeUs) {
+        p_data[0] = timeUs & 0xFF;
+        p_data[1] = (timeUs >> 8) & 0xFF;
+        p_data[2] = (timeUs >> 16) & 0xFF;
+    }
+
+    static void packTimestamp(uint8_t *p_data, uint32_t timeUs, uint8_t flags) {
+        packTime(p_data, timeUs);
+        p_data[3] = flags;
+    }
+
+    /** Recover the full 32 bit time of a 24 bit stamp taken less than 8 s from referenceUs
+     */
+    static uint32_t unpackTime(const uint8_t *p_data, uint32_t referenceUs) {
+        uint32_t time = p_data[0] | (p_data[1] << 8) | ((uint32_t)p_data[2] << 16);
+        int32_t delta = (int32_t)((time - referenceUs) << 8) >> 8;
+
+        return referenceUs + delta;
+    }
+
+};
+
+#endif // TIME_SYNC_PROTOCOL_H
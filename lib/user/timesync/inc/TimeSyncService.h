@@ -0,0 +1,77 @@
+#ifndef TIME_SYNC_SERVICE_H
+#define TIME_SYNC_SERVICE_H
+
+/* Keeps a board's clock aligned with the Jetson and timestamps its frames
+ * (see TimeSyncProtocol.h).
+ *
+ * The app takes the receive time of every message right after can.read(), so
+ * SYNCs and commands are stamped with the same clock the feedback is. Command
+ * acks are sent from sendCommandAcks() at the end of the main loop, after the
+ * controllers have run with the new command.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "ClockSync.h"
+#include "TimeSyncProtocol.h"
+
+#define TIME_SYNC_MAX_PENDING_ACKS 4
+
+class TimeSyncService {
+
+public:
+
+    TimeSyncService(CAN &can, uint32_t boardCanId);
+
+    /** Handle a message if it is a SYNC
+     *
+     * @param rxTimeUs Board time the message was read at
+     * @return true if the message was consumed
+     */
+    bool handleCANMsg(CANMessage &msg, uint32_t rxTimeUs);
+
+    /** @return Board time in microseconds
+     */
+    uint32_t getTimeUs(void);
+
+    /** @return Jetson time at a board time, or the board time until synchronised
+     */
+    uint32_t getJetsonTimeUs(uint32_t boardTimeUs);
+
+    bool isSynchronised(void);
+
+    /** Pad a feedback message's value to 4 bytes and append the current timestamp
+     */
+    void stamp(CANMessage &msg);
+
+    /** Acknowledge a command once it has been applied
+     */
+    void commandReceived(const CANMessage &msg, uint32_t rxTimeUs);
+
+    /** Send the acks of commands received since the last call, call after the controller updates
+     */
+    void sendCommandAcks(void);
+
+private:
+
+    typedef struct {
+        uint8_t command;
+        uint32_t receivedUs;
+        uint32_t appliedUs;
+        bool isApplied;
+
+    } t_pendingAck;
+
+    uint8_t getFlags(uint32_t boardTimeUs);
+
+    CAN &m_can;
+    uint32_t m_boardCanId;
+
+    ClockSync m_clockSync;
+
+    t_pendingAck m_pendingAcks[TIME_SYNC_MAX_PENDING_ACKS];
+    uint8_t m_pendingAckCount;
+
+};
+
+#endif // TIME_SYNC_SERVICE_H
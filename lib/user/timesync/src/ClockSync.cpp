@@ -0,0 +1,100 @@
+/* Estimates the offset and drift of a local microsecond timer against a remote clock.
+ */
+
+#include "ClockSync.h"
+
+#define SYNCHRONISED_WINDOWS    3
+
+ClockSync::ClockSync() {
+    reset();
+}
+
+void ClockSync::addSample(uint32_t localUs, uint32_t remoteUs) {
+    uint32_t offset = localUs - remoteUs;
+
+    if (m_windows == 0 && m_windowSamples == 0) {
+        m_baseUs     = localUs;
+        m_baseOffset = offset;
+    }
+
+    int32_t error = (int32_t)(offset - predictOffset(localUs));
+
+    // Until the drift is known the prediction can be far off, so nothing is an outlier
+    if (m_windows >= 2 && (error > CLOCK_SYNC_STEP_US || error < -CLOCK_SYNC_STEP_US)) {
+        if (++m_outliers >= CLOCK_SYNC_MAX_OUTLIERS) {
+            reset();
+            addSample(localUs, remoteUs);
+        }
+        return;
+    }
+
+    m_outliers     = 0;
+    m_lastSampleUs = localUs;
+
+    if (m_windowSamples == 0 || error < m_windowMinError) {
+        m_windowMinError  = error;
+        m_windowMinUs     = localUs;
+        m_windowMinOffset = offset;
+    }
+
+    if (++m_windowSamples < CLOCK_SYNC_WINDOW) {
+        return;
+    }
+
+    m_historyUs[m_windows % CLOCK_SYNC_HISTORY]     = m_windowMinUs;
+    m_historyOffset[m_windows % CLOCK_SYNC_HISTORY] = m_windowMinOffset;
+    m_windows++;
+
+    // The drift is the slope from the oldest minimum kept, the longer the baseline the less the delays matter
+    if (m_windows > 1) {
+        uint32_t oldest = m_windows > CLOCK_SYNC_HISTORY ? m_windows % CLOCK_SYNC_HISTORY : 0;
+        float slope = (float)(int32_t)(m_windowMinOffset - m_historyOffset[oldest]) /
+                      (float)(int32_t)(m_windowMinUs - m_historyUs[oldest]);
+
+        if (slope > CLOCK_SYNC_MAX_DRIFT) {
+            slope = CLOCK_SYNC_MAX_DRIFT;
+        }
+        else if (slope < -CLOCK_SYNC_MAX_DRIFT) {
+            slope = -CLOCK_SYNC_MAX_DRIFT;
+        }
+
+        m_drift = slope;
+    }
+
+    m_baseUs        = m_windowMinUs;
+    m_baseOffset    = m_windowMinOffset;
+    m_windowSamples = 0;
+}
+
+void ClockSync::reset(void) {
+    m_baseUs          = 0;
+    m_baseOffset      = 0;
+    m_drift           = 0.0f;
+    m_windows         = 0;
+    m_windowSamples   = 0;
+    m_windowMinError  = 0;
+    m_windowMinUs     = 0;
+    m_windowMinOffset = 0;
+    m_lastSampleUs    = 0;
+    m_outliers        = 0;
+}
+
+bool ClockSync::isSynchronised(uint32_t localUs) {
+    return m_windows >= SYNCHRONISED_WINDOWS && (int32_t)(localUs - m_lastSampleUs) < CLOCK_SYNC_TIMEOUT_US;
+}
+
+uint32_t ClockSync::toRemote(uint32_t localUs) {
+    if (m_windows == 0) {
+        return localUs;
+    }
+
+    return localUs - predictOffset(localUs);
+}
+
+float ClockSync::getDriftPpm(void) {
+    return m_drift * 1e6f;
+}
+
+uint32_t ClockSync::predictOffset(uint32_t localUs) {
+    return m_baseOffset + (int32_t)(m_drift * (float)(int32_t)(localUs - m_baseUs));
+}
@@ -0,0 +1,103 @@
+/* Keeps a board's clock aligned with the Jetson and timestamps its frames.
+ */
+
+#include "TimeSyncService.h"
+
+#define SYNC_FRAME_SIZE 5
+#define ACK_FRAME_SIZE  8
+
+TimeSyncService::TimeSyncService(CAN &can, uint32_t boardCanId) :
+        m_can(can), m_boardCanId(boardCanId), m_pendingAckCount(0) {}
+
+bool TimeSyncService::handleCANMsg(CANMessage &msg, uint32_t rxTimeUs) {
+    if (msg.id != ROVER_CANID_SYNC) {
+        return false;
+    }
+
+    if (msg.len >= SYNC_FRAME_SIZE) {
+        uint32_t jetsonTimeUs;
+        memcpy(&jetsonTimeUs, &msg.data[1], sizeof(jetsonTimeUs));
+
+        m_clockSync.addSample(rxTimeUs, jetsonTimeUs + TimeSyncProtocol::syncWireTimeUs);
+    }
+
+    return true;
+}
+
+uint32_t TimeSyncService::getTimeUs(void) {
+    return us_ticker_read();
+}
+
+uint32_t TimeSyncService::getJetsonTimeUs(uint32_t boardTimeUs) {
+    return m_clockSync.toRemote(boardTimeUs);
+}
+
+bool TimeSyncService::isSynchronised(void) {
+    return m_clockSync.isSynchronised(getTimeUs());
+}
+
+void TimeSyncService::stamp(CANMessage &msg) {
+    MBED_ASSERT_WARN(msg.len <= TimeSyncProtocol::timestampOffset);
+
+    if (msg.len < TimeSyncProtocol::timestampOffset) {
+        memset(&msg.data[msg.len], 0, TimeSyncProtocol::timestampOffset - msg.len);
+    }
+
+    uint32_t timeUs = getTimeUs();
+
+    TimeSyncProtocol::packTimestamp(&msg.data[TimeSyncProtocol::timestampOffset], getJetsonTimeUs(timeUs), getFlags(timeUs));
+    msg.len = TimeSyncProtocol::timestampOffset + TimeSyncProtocol::timestampSize;
+}
+
+void TimeSyncService::commandReceived(const CANMessage &msg, uint32_t rxTimeUs) {
+    if (m_pendingAckCount >= TIME_SYNC_MAX_PENDING_ACKS) {
+        return;
+    }
+
+    t_pendingAck &ack = m_pendingAcks[m_pendingAckCount++];
+    ack.command    = msg.id & 0xFF;
+    ack.receivedUs = rxTimeUs;
+    ack.appliedUs  = 0;
+    ack.isApplied  = false;
+}
+
+void TimeSyncService::sendCommandAcks(void) {
+    uint32_t timeUs = getTimeUs();
+    uint8_t sent = 0;
+
+    CANMessage reply;
+    reply.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_COMMAND_ACK;
+    reply.len = ACK_FRAME_SIZE;
+
+    for (uint8_t i = 0; i < m_pendingAckCount; i++) {
+        t_pendingAck &ack = m_pendingAcks[i];
+
+        if (!ack.isApplied) {
+            ack.appliedUs = timeUs;
+            ack.isApplied = true;
+        }
+    }
+
+    // Acks that find the mailboxes full go out on the next iterations
+    while (sent < m_pendingAckCount) {
+        t_pendingAck &ack = m_pendingAcks[sent];
+
+        reply.data[0] = ack.command;
+        reply.data[1] = getFlags(timeUs);
+        TimeSyncProtocol::packTime(&reply.data[2], getJetsonTimeUs(ack.receivedUs));
+        TimeSyncProtocol::packTime(&reply.data[5], getJetsonTimeUs(ack.appliedUs));
+
+        if (!m_can.write(reply)) {
+            break;
+        }
+
+        sent++;
+    }
+
+    m_pendingAckCount -= sent;
+    memmove(m_pendingAcks, &m_pendingAcks[sent], m_pendingAckCount * sizeof(t_pendingAck));
+}
+
+uint8_t TimeSyncService::getFlags(uint32_t boardTimeUs) {
+    return m_clockSync.isSynchronised(boardTimeUs) ? TimeSyncProtocol::flagSynchronised : 0;
+}
@@ -0,0 +1,75 @@
+#ifndef PID_PARAM_STORE_H
+#define PID_PARAM_STORE_H
+
+/* PID tunings kept in flash across resets and firmware updates.
+ *
+ * Like the boot record, the store uses two pages that are written alternately
+ * with an increasing sequence number, so a power loss while saving leaves the
+ * previously saved tunings in place. The entries are written first and the
+ * header, which checksums them, last.
+ */
+
+#include <stdint.h>
+#include "rover_config.h"
+#include "FirmwareStorage.h"
+#include "PIDTuningProtocol.h"
+
+#define PID_PARAM_STORE_MAGIC       0x50494454 // "PIDT"
+#define PID_PARAM_STORE_MAX_ENTRIES 16
+
+class PIDParamStore {
+
+public:
+
+    typedef struct {
+        uint32_t target;
+        PIDTuningProtocol::t_tuning tuning;
+
+    } t_entry;
+
+    explicit PIDParamStore(FirmwareStorage &storage, uint32_t boardCanId,
+                           uint32_t startAddress = ROVER_FLASH_PARAM_STORE_START);
+
+    /** Find the newest valid set of entries saved by this board
+     *
+     * @param p_entries Set to the entries in flash
+     * @return Number of entries, 0 if nothing is stored
+     */
+    uint32_t load(const t_entry *&p_entries);
+
+    /** Write entries to the page not holding the newest set
+     *
+     * @return 0 on success
+     */
+    int store(const t_entry *p_entries, uint32_t count);
+
+    /** Invalidate both pages
+     *
+     * @return 0 on success
+     */
+    int erase(void);
+
+private:
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t boardCanId;
+        uint32_t count;
+        uint32_t entriesCrc;
+        uint32_t headerCrc;
+
+    } t_header;
+
+    const t_header *findNewest();
+    const t_header *pageHeader(uint32_t page);
+    const t_entry *pageEntries(const t_header *p_header);
+    bool isValid(const t_header *p_header);
+
+    FirmwareStorage &m_storage;
+    uint32_t m_boardCanId;
+    uint32_t m_startAddress;
+
+};
+
+#endif // PID_PARAM_STORE_H
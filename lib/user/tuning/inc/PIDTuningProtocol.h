@@ -0,0 +1,80 @@
+#ifndef PID_TUNING_PROTOCOL_H
+#define PID_TUNING_PROTOCOL_H
+
+/* CAN protocol for tuning the PID loops of a board while its app is running.
+ *
+ * Every loop a board exposes is a numbered target (see the app mains). A Set
+ * only stages a value; Apply hands all staged values of a target to its PID in
+ * one go, between two control ticks, so gains changed together never run as a
+ * half updated set. Values that were not staged keep their current setting.
+ *
+ * Command frames (board ID + ROVER_CANID_SYS_PARAM_CMD), byte 0 is the opcode.
+ * Every command is answered on the board's reply base + ROVER_SYS_REPLY_PARAM
+ * with [op, status, target, param, value(float)]:
+ *   Set     [op, target, param, 0, value(float)]   Stage a value
+ *   Apply   [op, target]                           Apply the staged values
+ *   Get     [op, target, param]                    Read back the value in use
+ *   Discard [op, target]                           Drop the staged values
+ *   Save    [op]                                   Store the values in use of every target in flash
+ *   Erase   [op]                                   Drop the stored values, the configs in the app apply after a reset
+ *   Info    [op]                                   Value holds the number of targets
+ *
+ * Floats are IEEE 754 single precision, little endian as on the board.
+ */
+
+#include <stdint.h>
+
+class PIDTuningProtocol {
+
+public:
+
+    typedef enum t_opcode {
+        opSet     = 0x01,
+        opApply   = 0x02,
+        opGet     = 0x03,
+        opDiscard = 0x04,
+        opSave    = 0x05,
+        opErase   = 0x06,
+        opInfo    = 0x07
+
+    } t_opcode;
+
+    typedef enum t_param {
+        paramP             = 0x00,
+        paramI             = 0x01,
+        paramD             = 0x02,
+        paramBias          = 0x03,
+        paramDeadZoneError = 0x04,
+        paramOutMin        = 0x05,
+        paramOutMax        = 0x06,
+
+        paramCount
+
+    } t_param;
+
+    typedef enum t_status {
+        statusOk          = 0x00,
+        statusBadState    = 0x01,   // Nothing staged to apply
+        statusBadArgument = 0x02,   // Unknown opcode, target or parameter
+        statusBadValue    = 0x03,   // Staged set rejected, eg. P of 0 or outMin >= outMax
+        statusFlashError  = 0x04
+
+    } t_status;
+
+    // Indexed by t_param
+    typedef struct {
+        float values[paramCount];
+
+    } t_tuning;
+
+    /** Check a set of values can be handed to PID::setTunings and PID::setOutputLimits,
+     * which silently ignore values they cannot use
+     */
+    static bool isValid(const t_tuning &tuning) {
+        return tuning.values[paramP] != 0.0f && tuning.values[paramI] >= 0.0f && tuning.values[paramD] >= 0.0f &&
+               tuning.values[paramDeadZoneError] >= 0.0f && tuning.values[paramOutMin] < tuning.values[paramOutMax];
+    }
+
+};
+
+#endif // PID_TUNING_PROTOCOL_H
@@ -0,0 +1,74 @@
+#ifndef PID_TUNING_SERVICE_H
+#define PID_TUNING_SERVICE_H
+
+/* Tunes the PID loops of a board over CAN while its app is running
+ * (see PIDTuningProtocol.h).
+ *
+ * handleCANMsg is called from the main loop between controller updates, so a
+ * staged set is always applied as a whole between two control ticks. Gains go
+ * through PID::setTunings, which rescales the integral so the output does not
+ * bump. Saved tunings replace the configs built into the app on every reset
+ * until they are erased, and survive firmware updates.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "PID.h"
+#include "FlashIAPStorage.h"
+#include "PIDParamStore.h"
+#include "PIDTuningProtocol.h"
+
+#define PID_TUNING_MAX_TARGETS 8
+
+class PIDTuningService {
+
+public:
+
+    PIDTuningService(CAN &can, uint32_t boardCanId);
+
+    /** Expose a PID loop as a tuning target, target numbers must stay the same
+     * between firmware versions for saved tunings to stay with their loop
+     */
+    mbed_error_status_t registerPID(uint8_t target, PID &pid);
+
+    /** Apply the tunings saved in flash to the registered targets
+     *
+     * @return Number of targets tuned from flash
+     */
+    unsigned int loadStoredTunings(void);
+
+    /** Handle a message if it belongs to the tuning service
+     *
+     * Saving erases a flash page, which stalls the main loop for up to 40 ms.
+     *
+     * @return true if the message was consumed
+     */
+    bool handleCANMsg(CANMessage &msg);
+
+private:
+
+    typedef struct {
+        PID *p_pid;
+        PIDTuningProtocol::t_tuning staged;
+        bool isStaged;
+
+    } t_target;
+
+    PIDTuningProtocol::t_status handleCommand(const CANMessage &msg, float &value);
+    PIDTuningProtocol::t_status saveTunings(void);
+
+    static void readTuning(PID &pid, PIDTuningProtocol::t_tuning &tuning);
+    static void applyTuning(PID &pid, const PIDTuningProtocol::t_tuning &tuning);
+
+    CAN &m_can;
+    uint32_t m_boardCanId;
+
+    FlashIAPStorage m_storage;
+    PIDParamStore m_store;
+
+    t_target m_targets[PID_TUNING_MAX_TARGETS];
+    uint8_t m_targetCount;
+
+};
+
+#endif // PID_TUNING_SERVICE_H
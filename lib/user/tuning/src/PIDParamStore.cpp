@@ -0,0 +1,100 @@
+/* PID tunings kept in flash across resets and firmware updates.
+ */
+
+#include <stddef.h>
+#include "PIDParamStore.h"
+#include "IndependentWatchdog.h"
+
+PIDParamStore::PIDParamStore(FirmwareStorage &storage, uint32_t boardCanId, uint32_t startAddress) :
+        m_storage(storage), m_boardCanId(boardCanId), m_startAddress(startAddress) {}
+
+uint32_t PIDParamStore::load(const t_entry *&p_entries) {
+    const t_header *p_newest = findNewest();
+
+    if (p_newest == NULL) {
+        p_entries = NULL;
+        return 0;
+    }
+
+    p_entries = pageEntries(p_newest);
+    return p_newest->count;
+}
+
+int PIDParamStore::store(const t_entry *p_entries, uint32_t count) {
+    if (count > PID_PARAM_STORE_MAX_ENTRIES) {
+        return -1;
+    }
+
+    const t_header *p_newest = findNewest();
+    uint32_t address = m_startAddress;
+
+    t_header header;
+    header.sequence = 1;
+
+    if (p_newest != NULL) {
+        header.sequence = p_newest->sequence + 1;
+
+        // Never overwrite the page holding the current tunings
+        if (p_newest == pageHeader(0)) {
+            address = m_startAddress + m_storage.getPageSize();
+        }
+    }
+
+    if (m_storage.erasePage(address) != 0) {
+        return -1;
+    }
+
+    if (count > 0 && m_storage.program(address + sizeof(t_header), p_entries, count * sizeof(t_entry)) != 0) {
+        return -1;
+    }
+
+    header.magic      = PID_PARAM_STORE_MAGIC;
+    header.boardCanId = m_boardCanId;
+    header.count      = count;
+    header.entriesCrc = m_storage.crc32(m_storage.data(address + sizeof(t_header)), count * sizeof(t_entry));
+    header.headerCrc  = m_storage.crc32(&header, offsetof(t_header, headerCrc));
+
+    return m_storage.program(address, &header, sizeof(t_header));
+}
+
+int PIDParamStore::erase(void) {
+    for (uint32_t page = 0; page < 2; page++) {
+        IndependentWatchdog::kick();
+
+        if (m_storage.erasePage(m_startAddress + page * m_storage.getPageSize()) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+const PIDParamStore::t_header *PIDParamStore::findNewest() {
+    const t_header *p_first  = pageHeader(0);
+    const t_header *p_second = pageHeader(1);
+
+    bool firstValid  = isValid(p_first);
+    bool secondValid = isValid(p_second);
+
+    if (firstValid && (!secondValid || (int32_t)(p_first->sequence - p_second->sequence) > 0)) {
+        return p_first;
+    }
+
+    return secondValid ? p_second : NULL;
+}
+
+const PIDParamStore::t_header *PIDParamStore::pageHeader(uint32_t page) {
+    return reinterpret_cast<const t_header *>(m_storage.data(m_startAddress + page * m_storage.getPageSize()));
+}
+
+const PIDParamStore::t_entry *PIDParamStore::pageEntries(const t_header *p_header) {
+    return reinterpret_cast<const t_entry *>(p_header + 1);
+}
+
+bool PIDParamStore::isValid(const t_header *p_header) {
+    return p_header->magic == PID_PARAM_STORE_MAGIC &&
+           p_header->boardCanId == m_boardCanId &&
+           p_header->count <= PID_PARAM_STORE_MAX_ENTRIES &&
+           p_header->headerCrc == m_storage.crc32(p_header, offsetof(t_header, headerCrc)) &&
+           p_header->entriesCrc == m_storage.crc32(pageEntries(p_header), p_header->count * sizeof(t_entry));
+}
@@ -0,0 +1,181 @@
+/* Tunes the PID loops of a board over CAN while its app is running.
+ */
+
+#include "PIDTuningService.h"
+
+PIDTuningService::PIDTuningService(CAN &can, uint32_t boardCanId) :
+        m_can(can), m_boardCanId(boardCanId), m_store(m_storage, boardCanId), m_targetCount(0) {
+    memset(m_targets, 0, sizeof(m_targets));
+}
+
+mbed_error_status_t PIDTuningService::registerPID(uint8_t target, PID &pid) {
+    if (target >= PID_TUNING_MAX_TARGETS || m_targets[target].p_pid != NULL) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    m_targets[target].p_pid = &pid;
+
+    if (target >= m_targetCount) {
+        m_targetCount = target + 1;
+    }
+
+    return MBED_SUCCESS;
+}
+
+unsigned int PIDTuningService::loadStoredTunings(void) {
+    const PIDParamStore::t_entry *p_entries;
+    uint32_t count = m_store.load(p_entries);
+    unsigned int loaded = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t target = p_entries[i].target;
+
+        if (target < m_targetCount && m_targets[target].p_pid != NULL &&
+            PIDTuningProtocol::isValid(p_entries[i].tuning)) {
+            applyTuning(*m_targets[target].p_pid, p_entries[i].tuning);
+            loaded++;
+        }
+    }
+
+    PRINT_INFO("Loaded %u stored PID tunings\r\n", loaded);
+
+    return loaded;
+}
+
+bool PIDTuningService::handleCANMsg(CANMessage &msg) {
+    if (msg.id != m_boardCanId + ROVER_CANID_SYS_PARAM_CMD || msg.len == 0) {
+        return false;
+    }
+
+    CANMessage reply;
+    float value = 0.0f;
+
+    reply.data[1] = handleCommand(msg, value);
+    reply.data[0] = msg.data[0];
+    reply.data[2] = msg.len > 1 ? msg.data[1] : 0;
+    reply.data[3] = msg.len > 2 ? msg.data[2] : 0;
+    memcpy(&reply.data[4], &value, sizeof(value));
+
+    reply.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_PARAM;
+    reply.len = 8;
+    MBED_ASSERT_WARN(m_can.write(reply) == true);
+
+    return true;
+}
+
+PIDTuningProtocol::t_status PIDTuningService::handleCommand(const CANMessage &msg, float &value) {
+    uint8_t opcode = msg.data[0];
+
+    switch (opcode) {
+        case PIDTuningProtocol::opSave:
+            return saveTunings();
+
+        case PIDTuningProtocol::opErase:
+            return m_store.erase() == 0 ? PIDTuningProtocol::statusOk : PIDTuningProtocol::statusFlashError;
+
+        case PIDTuningProtocol::opInfo:
+            value = m_targetCount;
+            return PIDTuningProtocol::statusOk;
+
+        default:
+            break;
+    }
+
+    // Everything else addresses a target
+    if (msg.len < 2 || msg.data[1] >= m_targetCount || m_targets[msg.data[1]].p_pid == NULL) {
+        return PIDTuningProtocol::statusBadArgument;
+    }
+
+    t_target &target = m_targets[msg.data[1]];
+    uint8_t param = msg.len > 2 ? msg.data[2] : (uint8_t)PIDTuningProtocol::paramCount;
+
+    switch (opcode) {
+        case PIDTuningProtocol::opSet:
+            if (param >= PIDTuningProtocol::paramCount || msg.len < 8) {
+                return PIDTuningProtocol::statusBadArgument;
+            }
+
+            // Values not staged keep their current setting
+            if (!target.isStaged) {
+                readTuning(*target.p_pid, target.staged);
+                target.isStaged = true;
+            }
+
+            memcpy(&value, &msg.data[4], sizeof(value));
+            target.staged.values[param] = value;
+            return PIDTuningProtocol::statusOk;
+
+        case PIDTuningProtocol::opApply:
+            if (!target.isStaged) {
+                return PIDTuningProtocol::statusBadState;
+            }
+
+            // Keep the staged set so a rejected value can be corrected and applied again
+            if (!PIDTuningProtocol::isValid(target.staged)) {
+                return PIDTuningProtocol::statusBadValue;
+            }
+
+            applyTuning(*target.p_pid, target.staged);
+            target.isStaged = false;
+            return PIDTuningProtocol::statusOk;
+
+        case PIDTuningProtocol::opGet: {
+            if (param >= PIDTuningProtocol::paramCount) {
+                return PIDTuningProtocol::statusBadArgument;
+            }
+
+            PIDTuningProtocol::t_tuning tuning;
+            readTuning(*target.p_pid, tuning);
+            value = tuning.values[param];
+            return PIDTuningProtocol::statusOk;
+        }
+
+        case PIDTuningProtocol::opDiscard:
+            target.isStaged = false;
+            return PIDTuningProtocol::statusOk;
+
+        default:
+            return PIDTuningProtocol::statusBadArgument;
+    }
+}
+
+PIDTuningProtocol::t_status PIDTuningService::saveTunings(void) {
+    PIDParamStore::t_entry entries[PID_TUNING_MAX_TARGETS];
+    uint32_t count = 0;
+
+    for (uint8_t target = 0; target < m_targetCount; target++) {
+        if (m_targets[target].p_pid != NULL) {
+            entries[count].target = target;
+            readTuning(*m_targets[target].p_pid, entries[count].tuning);
+            count++;
+        }
+    }
+
+    return m_store.store(entries, count) == 0 ? PIDTuningProtocol::statusOk : PIDTuningProtocol::statusFlashError;
+}
+
+void PIDTuningService::readTuning(PID &pid, PIDTuningProtocol::t_tuning &tuning) {
+    tuning.values[PIDTuningProtocol::paramP]             = pid.getPParam();
+    tuning.values[PIDTuningProtocol::paramI]             = pid.getIParam();
+    tuning.values[PIDTuningProtocol::paramD]             = pid.getDParam();
+    tuning.values[PIDTuningProtocol::paramBias]          = pid.getBias();
+    tuning.values[PIDTuningProtocol::paramDeadZoneError] = pid.getDeadZoneError();
+    tuning.values[PIDTuningProtocol::paramOutMin]        = pid.getOutMin();
+    tuning.values[PIDTuningProtocol::paramOutMax]        = pid.getOutMax();
+}
+
+void PIDTuningService::applyTuning(PID &pid, const PIDTuningProtocol::t_tuning &tuning) {
+    float outMin = tuning.values[PIDTuningProtocol::paramOutMin];
+    float outMax = tuning.values[PIDTuningProtocol::paramOutMax];
+
+    // setOutputLimits rescales the last output, only call it for an actual change
+    if (outMin != pid.getOutMin() || outMax != pid.getOutMax()) {
+        pid.setOutputLimits(outMin, outMax);
+    }
+
+    pid.setTunings(tuning.values[PIDTuningProtocol::paramP],
+                   tuning.values[PIDTuningProtocol::paramI],
+                   tuning.values[PIDTuningProtocol::paramD]);
+    pid.setBias(tuning.values[PIDTuningProtocol::paramBias]);
+    pid.setDeadZoneError(tuning.values[PIDTuningProtocol::paramDeadZoneError]);
+}
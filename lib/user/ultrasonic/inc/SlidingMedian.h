@@ -0,0 +1,43 @@
+#ifndef SLIDING_MEDIAN_H
+#define SLIDING_MEDIAN_H
+
+/* Median of the last few samples.
+ *
+ * The samples are kept both in arrival order and sorted, a new sample replaces
+ * the oldest one in the sorted array with a single shift, so an update costs
+ * at most SLIDING_MEDIAN_WINDOW moves and the median is read directly. No mbed
+ * dependencies.
+ */
+
+#include <stdint.h>
+
+#define SLIDING_MEDIAN_WINDOW 5
+
+class SlidingMedian {
+
+public:
+
+    SlidingMedian();
+
+    void addSample(uint16_t sample);
+
+    /** Forget every sample
+     */
+    void reset(void);
+
+    /** @return Median of the samples kept, 0 without any
+     */
+    uint16_t getMedian(void);
+
+    uint8_t getSampleCount(void);
+
+private:
+
+    uint16_t m_samples[SLIDING_MEDIAN_WINDOW];  // Arrival order
+    uint16_t m_sorted[SLIDING_MEDIAN_WINDOW];
+    uint8_t m_count;
+    uint8_t m_oldest;
+
+};
+
+#endif // SLIDING_MEDIAN_H
@@ -0,0 +1,88 @@
+#ifndef SONAR_MANAGER_H
+#define SONAR_MANAGER_H
+
+/* Triggers a set of ultrasonic sensors so they never hear each other's pings.
+ *
+ * Every sensor belongs to a group, the sensors of a group are triggered
+ * together and the groups take turns, one per slot. A slot lasts as long as
+ * the echo of the farthest range kept can take to come back plus a guard
+ * time for the ping to die out, so the next group only fires once the
+ * previous one can no longer be heard. Sensors that face away from each other
+ * can share a group to be sampled more often, giving every sensor its own
+ * group is plain round-robin.
+ *
+ * Readings outside SONAR_MIN_RANGE_CM - SONAR_MAX_RANGE_CM are dropped, the
+ * others go through a sliding median. A sensor that gets no valid reading for
+ * a whole median window reports 0 (nothing in range).
+ *
+ * All ranges fit in one frame, see packRanges().
+ */
+
+#include "mbed.h"
+#include "ultrasonic.h"
+#include "SlidingMedian.h"
+#include "DeferredEventQueue.h"
+
+#define SONAR_MAX_SENSORS       4
+#define SONAR_MIN_RANGE_CM      25      // Closer echoes are garbage on the weatherproof sensors
+#define SONAR_MAX_RANGE_CM      300
+#define SONAR_US_PER_CM         58      // Round trip
+#define SONAR_GUARD_US          5000
+#define SONAR_SLOT_US           (SONAR_MAX_RANGE_CM * SONAR_US_PER_CM + SONAR_GUARD_US)
+
+class SonarManager {
+
+public:
+
+    SonarManager();
+
+    /** Add a sensor, before start()
+     *
+     * @param group Sensors of the same group are triggered together
+     * @return Index of the sensor's range in the packed frame
+     */
+    int addSensor(ultrasonic *p_sensor, uint8_t group);
+
+    /** Start triggering the sensors, one group every SONAR_SLOT_US
+     */
+    void start(void);
+
+    void stop(void);
+
+    /** @return Filtered range of a sensor in cm, 0 if nothing is in range
+     */
+    uint16_t getRangeCm(int index);
+
+    /** Fill a frame's data with the filtered range of every sensor
+     *
+     * 16 bit little endian cm per sensor, in the order they were added
+     */
+    void packRanges(CANMessage &msg);
+
+private:
+
+    typedef struct {
+        ultrasonic *p_sensor;
+        uint8_t group;
+        uint8_t misses;
+        volatile int32_t sampleUs;      // Echo of the last slot, converted and filtered by the event queue
+        SlidingMedian median;
+        volatile uint16_t rangeCm;
+
+    } t_sonar;
+
+    void slot(void);
+    static void filter(void *p_sonarManager, uint32_t group);
+
+    t_sonar m_sonars[SONAR_MAX_SENSORS];
+    uint8_t m_sonarCount;
+    uint8_t m_groupCount;
+    uint8_t m_group;
+    bool m_isRunning;
+    bool m_isFirstSlot;
+
+    Ticker m_ticker;
+
+};
+
+#endif // SONAR_MANAGER_H
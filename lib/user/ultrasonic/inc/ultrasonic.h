@@ -1,6 +1,30 @@
 #ifndef MBED_ULTRASONIC_H
 #define MBED_ULTRASONIC_H
 
+/* The trigger pulse and the echo width are timed by a hardware timer, the
+ * trigger and echo pins must be two channels of the same timer:
+ *
+ *   science board   ULTRA_TRIG_1/ULTRA_ECHO_1 (PB_10/PB_11, TIM2 channels 3/4)
+ *                   ULTRA_TRIG_2/ULTRA_ECHO_2 (PA_2/PA_3, TIM15 channels 1/2)
+ *   Nucleo          D7/D8 (PA_8/PA_9, TIM1 channels 1/2)
+ *                   D5/D4 (PB_4/PB_5, TIM3 channels 1/2)
+ *
+ * The trigger channel is driven high and the timer brings it low on a compare
+ * match 10 us later; should the match already be past when it is set up, the
+ * trigger is forced low at once, so the pulse is never shorter than 10 us nor
+ * left high. The echo channel captures the counter on both edges into the one
+ * register, and the rise and fall interrupts only read it. The width is exact
+ * to the microsecond as long as each interrupt runs before the next edge, ie.
+ * within the echo, at least about 120 us for an object 2 cm away. A rise
+ * interrupt held off past the falling edge reads the fall's capture instead,
+ * and that echo comes out too short. TIM2 is the mbed
+ * microsecond ticker and is shared as is, the other timers are started as
+ * free running 1 MHz counters.
+ *
+ * Sensors that must not hear each other are best left to a SonarManager,
+ * which triggers them with measureOnce().
+ */
+
 #include "mbed.h"
 
 class ultrasonic
@@ -12,6 +36,8 @@ class ultrasonic
         ultrasonic(PinName trigPin, PinName echoPin, float updateSpeed, float timeout, void onUpdate(int));
         /** returns the last measured distance**/
         int getCurrentDistance(void);
+        /** returns the last echo width in microseconds, no divide so it can be read in an interrupt**/
+        uint32_t getEchoUs(void);
         /**pauses measuring the distance**/
         void pauseUpdates(void);
         /**starts mesuring the distance**/
@@ -27,17 +53,25 @@ class ultrasonic
         /**call this as often as possible in your code, eg. at the end of a while(1) loop,
         and it will check whether the method you have attached needs to be called**/
         void checkDistance(void);
+        /**single measurement, nothing is retriggered, isUpdated() is true once the echo is back**/
+        void measureOnce(void);
     private:
-        DigitalOut _trig;
         InterruptIn _echo;
-        Timer _t;
         Timeout _tout;
-        volatile int _distance;
+        TIM_TypeDef *_timer;
+        volatile uint32_t *_trigCcmr;
+        volatile uint32_t *_trigCcr;
+        volatile uint32_t *_echoCcr;
+        uint32_t _trigShift;
+        uint32_t _counterMask;
+        volatile uint32_t _echoUs;
         float _updateSpeed;
-        int start;
-        int end;
+        uint32_t start;
         volatile int done;
+        volatile bool _hasRisen;
+        bool _isSingleShot;
         void (*_onUpdateMethod)(int);
+        void _initTimer(PinName trigPin, PinName echoPin);
         void _startT(void);
         void _updateDist(void);
         void _startTrig(void);
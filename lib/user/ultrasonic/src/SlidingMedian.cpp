@@ -0,0 +1,53 @@
+/* Median of the last few samples.
+ */
+
+#include "SlidingMedian.h"
+
+SlidingMedian::SlidingMedian() {
+    reset();
+}
+
+void SlidingMedian::addSample(uint16_t sample) {
+    uint8_t position;
+
+    if (m_count < SLIDING_MEDIAN_WINDOW) {
+        // Room at the end of the sorted array
+        position = m_count;
+        m_samples[m_count++] = sample;
+    }
+    else {
+        uint16_t removed = m_samples[m_oldest];
+        m_samples[m_oldest] = sample;
+        m_oldest = (m_oldest + 1) % SLIDING_MEDIAN_WINDOW;
+
+        position = 0;
+        while (m_sorted[position] != removed) {
+            position++;
+        }
+    }
+
+    // Move the free slot to where the sample belongs
+    while (position > 0 && m_sorted[position - 1] > sample) {
+        m_sorted[position] = m_sorted[position - 1];
+        position--;
+    }
+    while (position < m_count - 1 && m_sorted[position + 1] < sample) {
+        m_sorted[position] = m_sorted[position + 1];
+        position++;
+    }
+
+    m_sorted[position] = sample;
+}
+
+void SlidingMedian::reset(void) {
+    m_count  = 0;
+    m_oldest = 0;
+}
+
+uint16_t SlidingMedian::getMedian(void) {
+    return m_count > 0 ? m_sorted[m_count / 2] : 0;
+}
+
+uint8_t SlidingMedian::getSampleCount(void) {
+    return m_count;
+}
@@ -0,0 +1,127 @@
+/* Triggers a set of ultrasonic sensors so they never hear each other's pings.
+ */
+
+#include "SonarManager.h"
+
+#define NO_SAMPLE   -1
+
+SonarManager::SonarManager() :
+        m_sonarCount(0), m_groupCount(0), m_group(0), m_isRunning(false), m_isFirstSlot(true) {}
+
+int SonarManager::addSensor(ultrasonic *p_sensor, uint8_t group) {
+    MBED_ASSERT_WARN(!m_isRunning);
+
+    if (m_sonarCount >= SONAR_MAX_SENSORS || m_isRunning) {
+        return -1;
+    }
+
+    t_sonar &sonar = m_sonars[m_sonarCount];
+    sonar.p_sensor = p_sensor;
+    sonar.group    = group;
+    sonar.misses   = 0;
+    sonar.sampleUs = NO_SAMPLE;
+    sonar.rangeCm  = 0;
+    sonar.median.reset();
+
+    if (group >= m_groupCount) {
+        m_groupCount = group + 1;
+    }
+
+    return m_sonarCount++;
+}
+
+void SonarManager::start(void) {
+    if (m_isRunning || m_sonarCount == 0) {
+        return;
+    }
+
+    // The sensors are only ever triggered from here
+    for (uint8_t i = 0; i < m_sonarCount; i++) {
+        m_sonars[i].p_sensor->pauseUpdates();
+    }
+
+    m_group       = m_groupCount - 1;
+    m_isRunning   = true;
+    m_isFirstSlot = true;
+    m_ticker.attach_us(callback(this, &SonarManager::slot), SONAR_SLOT_US);
+}
+
+void SonarManager::stop(void) {
+    m_ticker.detach();
+    m_isRunning = false;
+
+    for (uint8_t i = 0; i < m_sonarCount; i++) {
+        m_sonars[i].p_sensor->pauseUpdates();
+    }
+}
+
+uint16_t SonarManager::getRangeCm(int index) {
+    if (index < 0 || index >= m_sonarCount) {
+        return 0;
+    }
+
+    return m_sonars[index].rangeCm;
+}
+
+void SonarManager::packRanges(CANMessage &msg) {
+    for (uint8_t i = 0; i < m_sonarCount; i++) {
+        uint16_t rangeCm = m_sonars[i].rangeCm;
+
+        msg.data[2 * i]     = rangeCm & 0xFF;
+        msg.data[2 * i + 1] = rangeCm >> 8;
+    }
+
+    msg.len = 2 * m_sonarCount;
+}
+
+void SonarManager::slot(void) {
+    // Collect the group whose slot just ended, the readings are converted and filtered outside of the interrupt
+    for (uint8_t i = 0; i < m_sonarCount && !m_isFirstSlot; i++) {
+        t_sonar &sonar = m_sonars[i];
+
+        if (sonar.group == m_group) {
+            sonar.sampleUs = sonar.p_sensor->isUpdated() ? (int32_t)sonar.p_sensor->getEchoUs() : NO_SAMPLE;
+        }
+    }
+
+    if (!m_isFirstSlot) {
+        DeferredEventQueue::getShared().post(&SonarManager::filter, this, m_group);
+    }
+
+    // Fire the next one, a group without sensors still gets its slot
+    m_isFirstSlot = false;
+    m_group = (m_group + 1) % m_groupCount;
+
+    for (uint8_t i = 0; i < m_sonarCount; i++) {
+        if (m_sonars[i].group == m_group) {
+            m_sonars[i].p_sensor->measureOnce();
+        }
+    }
+}
+
+void SonarManager::filter(void *p_sonarManager, uint32_t group) {
+    SonarManager *p_this = static_cast<SonarManager *>(p_sonarManager);
+
+    for (uint8_t i = 0; i < p_this->m_sonarCount; i++) {
+        t_sonar &sonar = p_this->m_sonars[i];
+
+        if (sonar.group != group) {
+            continue;
+        }
+
+        int32_t sampleUs = sonar.sampleUs;
+        int distanceCm   = sampleUs == NO_SAMPLE ? NO_SAMPLE : sampleUs / SONAR_US_PER_CM;
+        bool isValid   = distanceCm >= SONAR_MIN_RANGE_CM && distanceCm <= SONAR_MAX_RANGE_CM;
+
+        if (isValid) {
+            sonar.misses = 0;
+            sonar.median.addSample(distanceCm);
+        }
+        else if (++sonar.misses >= SLIDING_MEDIAN_WINDOW) {
+            sonar.misses = SLIDING_MEDIAN_WINDOW;
+            sonar.median.reset();
+        }
+
+        sonar.rangeCm = sonar.median.getMedian();
+    }
+}
@@ -1,55 +1,200 @@
 #include "ultrasonic.h"
+#include "pinmap.h"
+#include "us_ticker_api.h"
 
-   ultrasonic::ultrasonic(PinName trigPin, PinName echoPin, float updateSpeed, float timeout):_trig(trigPin), _echo(echoPin)
+#define TRIG_US             10
+#define COUNTER_HZ          1000000
+
+#define OCM_INACTIVE_MATCH  0x2     // Output compare modes
+#define OCM_FORCED_LOW      0x4
+#define OCM_FORCED_HIGH     0x5
+
+#define CCS_INPUT           0x1     // Capture on the channel's own input
+#define IC_FILTER           0x3     // 8 samples at the timer clock, rejects glitches shorter than 170 ns
+
+   typedef struct {
+       PinName pin;
+       uint32_t timerBase;
+       uint32_t channel;
+       uint32_t function;
+   } t_timerPin;
+
+   static const t_timerPin timerPins[] = {
+       {PA_2,  TIM15_BASE, 1, GPIO_AF0_TIM15},
+       {PA_3,  TIM15_BASE, 2, GPIO_AF0_TIM15},
+       {PA_8,  TIM1_BASE,  1, GPIO_AF2_TIM1},
+       {PA_9,  TIM1_BASE,  2, GPIO_AF2_TIM1},
+       {PB_4,  TIM3_BASE,  1, GPIO_AF1_TIM3},
+       {PB_5,  TIM3_BASE,  2, GPIO_AF1_TIM3},
+       {PB_10, TIM2_BASE,  3, GPIO_AF2_TIM2},
+       {PB_11, TIM2_BASE,  4, GPIO_AF2_TIM2},
+   };
+
+   static const t_timerPin *findTimerPin(PinName pin)
+   {
+       for (unsigned int i = 0; i < sizeof(timerPins) / sizeof(timerPins[0]); i++)
+       {
+           if (timerPins[i].pin == pin)
+           {
+               return &timerPins[i];
+           }
+       }
+       return NULL;
+   }
+
+   ultrasonic::ultrasonic(PinName trigPin, PinName echoPin, float updateSpeed, float timeout):_echo(echoPin)
    {
        _updateSpeed = updateSpeed;
        _timeout = timeout;
+       _hasRisen = false;
+       _isSingleShot = false;
+       _echoUs = 0;
+       _initTimer(trigPin, echoPin);
    }
 
    ultrasonic::ultrasonic(PinName trigPin, PinName echoPin, float updateSpeed, float timeout, void onUpdate(int))
-   :_trig(trigPin), _echo(echoPin)
+   :_echo(echoPin)
    {
        _onUpdateMethod=onUpdate;
        _updateSpeed = updateSpeed;
        _timeout = timeout;
-       _t.start ();
+       _hasRisen = false;
+       _isSingleShot = false;
+       _echoUs = 0;
+       _initTimer(trigPin, echoPin);
    }
-   void ultrasonic::_startT()
+   void ultrasonic::_initTimer(PinName trigPin, PinName echoPin)
    {
-       if(_t.read()>600)
+       const t_timerPin *trig = findTimerPin(trigPin);
+       const t_timerPin *echo = findTimerPin(echoPin);
+
+       MBED_ASSERT(trig != NULL && echo != NULL && trig->timerBase == echo->timerBase && trig->channel != echo->channel);
+
+       _timer = (TIM_TypeDef *)trig->timerBase;
+       _trigCcr = &_timer->CCR1 + (trig->channel - 1);
+       _echoCcr = &_timer->CCR1 + (echo->channel - 1);
+       _trigCcmr = trig->channel <= 2 ? &_timer->CCMR1 : &_timer->CCMR2;
+       _trigShift = ((trig->channel - 1) & 1) * 8;
+
+       if (_timer == TIM2)
        {
-           _t.reset ();
+           // The ticker resets its timer when it starts, it must be running before the channels are set up
+           ticker_read(get_us_ticker_data());
+           _counterMask = 0xFFFFFFFF;
        }
-       start = _t.read_us ();
+       else
+       {
+           _counterMask = 0xFFFF;
+
+           if (_timer == TIM1)
+           {
+               RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+           }
+           else if (_timer == TIM15)
+           {
+               RCC->APB2ENR |= RCC_APB2ENR_TIM15EN;
+           }
+           else
+           {
+               RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+           }
+
+           // Shared by the two sensors if they are on the same timer
+           if (!(_timer->CR1 & TIM_CR1_CEN))
+           {
+               _timer->PSC = SystemCoreClock / COUNTER_HZ - 1;
+               _timer->ARR = 0xFFFF;
+               _timer->EGR = TIM_EGR_UG;
+               _timer->CR1 |= TIM_CR1_CEN;
+           }
+
+           // Outputs of the timers with a break input stay off until enabled
+           if (_timer == TIM1 || _timer == TIM15)
+           {
+               _timer->BDTR |= TIM_BDTR_MOE;
+           }
+       }
+
+       // Trigger channel held low until a measurement starts
+       *_trigCcmr = (*_trigCcmr & ~(0xFF << _trigShift)) | (OCM_FORCED_LOW << (_trigShift + 4));
+       _timer->CCER |= TIM_CCER_CC1E << ((trig->channel - 1) * 4);
+
+       // Echo channel captures the counter on both edges
+       volatile uint32_t *echoCcmr = echo->channel <= 2 ? &_timer->CCMR1 : &_timer->CCMR2;
+       uint32_t echoShift = ((echo->channel - 1) & 1) * 8;
+
+       *echoCcmr = (*echoCcmr & ~(0xFF << echoShift)) | ((CCS_INPUT | (IC_FILTER << 4)) << echoShift);
+       _timer->CCER |= (TIM_CCER_CC1E | TIM_CCER_CC1P | TIM_CCER_CC1NP) << ((echo->channel - 1) * 4);
+
+       // The echo pin still raises the edge interrupts in alternate function mode
+       pin_function(trigPin, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, trig->function));
+       pin_function(echoPin, STM_PIN_DATA(STM_MODE_AF_PP, GPIO_NOPULL, echo->function));
+   }
+   void ultrasonic::_startT()
+   {
+       start = *_echoCcr;
+       _hasRisen = true;
    }
 
    void ultrasonic::_updateDist()
    {
-       end = _t.read_us ();
+       uint32_t end = *_echoCcr;
+
+       // The end of an echo that started before the trigger
+       if (!_hasRisen)
+       {
+           return;
+       }
+       _hasRisen = false;
+
        done = 1;
-       // Divide by 58 (cm) or 6 (mm) or 5.8 (mm)
-       _distance = (end - start)/58;
-       _tout.detach();
-       _tout.attach(this,&ultrasonic::_startTrig, _updateSpeed);
+       // Converted when read, there is no divide in the interrupt
+       _echoUs = (end - start) & _counterMask;
+
+       if (!_isSingleShot)
+       {
+           _tout.detach();
+           _tout.attach(this,&ultrasonic::_startTrig, _updateSpeed);
+       }
    }
    void ultrasonic::_startTrig(void)
    {
            _tout.detach();
-           _trig=0; // Insertion
-           wait_us(2); // Insertion
-           _trig=1;
-           wait_us(10);
            done = 0;
+           _hasRisen = false;
            _echo.rise(this,&ultrasonic::_startT);
            _echo.fall(this,&ultrasonic::_updateDist);
            _echo.enable_irq ();
-           _tout.attach(this,&ultrasonic::_startTrig,_timeout);
-           _trig=0;
+           if (!_isSingleShot)
+           {
+               _tout.attach(this,&ultrasonic::_startTrig,_timeout);
+           }
+
+           // High now, brought low by the timer TRIG_US later. An interrupt between reading the
+           // counter and switching the mode could let the match go by unseen and leave it high
+           core_util_critical_section_enter();
+
+           *_trigCcmr = (*_trigCcmr & ~(0x7 << (_trigShift + 4))) | (OCM_FORCED_HIGH << (_trigShift + 4));
+           *_trigCcr = (_timer->CNT + TRIG_US) & _counterMask;
+           *_trigCcmr = (*_trigCcmr & ~(0x7 << (_trigShift + 4))) | (OCM_INACTIVE_MATCH << (_trigShift + 4));
+
+           if (((_timer->CNT - *_trigCcr) & _counterMask) < TRIG_US)
+           {
+               // Already past the match, the pulse has been long enough
+               *_trigCcmr = (*_trigCcmr & ~(0x7 << (_trigShift + 4))) | (OCM_FORCED_LOW << (_trigShift + 4));
+           }
+
+           core_util_critical_section_exit();
    }
 
    int ultrasonic::getCurrentDistance(void)
    {
-       return _distance;
+       // Divide by 58 (cm) or 6 (mm) or 5.8 (mm)
+       return _echoUs/58;
+   }
+   uint32_t ultrasonic::getEchoUs(void)
+   {
+       return _echoUs;
    }
    void ultrasonic::pauseUpdates(void)
    {
@@ -59,6 +204,12 @@
    }
    void ultrasonic::startUpdates(void)
    {
+       _isSingleShot = false;
+       _startTrig();
+   }
+   void ultrasonic::measureOnce(void)
+   {
+       _isSingleShot = true;
        _startTrig();
    }
    void ultrasonic::attachOnUpdate(void method(int))
@@ -84,6 +235,6 @@
    {
        if(isUpdated())
        {
-           (*_onUpdateMethod)(_distance);
+           (*_onUpdateMethod)(getCurrentDistance());
        }
    }
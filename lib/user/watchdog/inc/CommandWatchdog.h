@@ -0,0 +1,98 @@
+#ifndef COMMAND_WATCHDOG_H
+#define COMMAND_WATCHDOG_H
+
+/* Stops the motors of an axis when its commands stop arriving.
+ *
+ * Each axis (a joint, the wrist, the auger...) has the motors it drives and
+ * the time of its last command. An axis without a command for the timeout is
+ * stale: its motors are ramped from whatever they were doing to a stop over
+ * the ramp time, then held there until the next command for it. The Jetson
+ * must therefore repeat the command of every axis that should keep moving at
+ * least once per timeout.
+ *
+ * The check runs from a ticker and ramps the motors through their output scale
+ * (Motor::setOutputScale), so the stop does not depend on the main loop
+ * running, and is done at most one tick after the ramp time. The time from
+ * going stale to a stop is measured and reported. Whenever an axis stops or
+ * restarts a report goes out on the board's reply base + ROVER_SYS_REPLY_WATCHDOG:
+ *
+ *   Report   [stoppedMask, staleMask, stops(u16), maxStopLatencyUs(u32)]
+ *
+ * Masks have a bit per axis. Multi byte fields are little endian.
+ */
+
+#include "mbed.h"
+#include "rover_config.h"
+#include "Motor.h"
+
+#define COMMAND_WATCHDOG_MAX_AXES           4
+#define COMMAND_WATCHDOG_MOTORS_PER_AXIS    2
+#define COMMAND_WATCHDOG_TIMEOUT_US         500000  // Without a command for this long an axis is stale
+#define COMMAND_WATCHDOG_RAMP_US            200000  // From stale to stopped
+#define COMMAND_WATCHDOG_TICK_US            5000    // Worst case added to the ramp
+
+class CommandWatchdog {
+
+public:
+
+    CommandWatchdog(CAN &can, uint32_t boardCanId, uint32_t timeoutUs = COMMAND_WATCHDOG_TIMEOUT_US,
+                    uint32_t rampUs = COMMAND_WATCHDOG_RAMP_US);
+
+    /** Add a motor to an axis, before start()
+     */
+    mbed_error_status_t registerMotor(uint8_t axis, Motor &motor);
+
+    /** Start checking, every axis counts as just commanded
+     */
+    void start(void);
+
+    /** Mark an axis as commanded, and let its motors run again if they were stopped
+     */
+    void commandReceived(uint8_t axis);
+
+    /** Send a report when an axis has stopped or restarted, call every main loop iteration
+     *
+     * @return Mask of the axes stopped since the last call, their controllers should be
+     *         set to hold still so they do not jump back to the stale command
+     */
+    uint8_t poll(void);
+
+    uint8_t getStoppedMask(void);
+
+    /** @return Longest time from an axis going stale to its motors being stopped
+     */
+    uint32_t getMaxStopLatencyUs(void);
+
+private:
+
+    typedef struct {
+        Motor *p_motors[COMMAND_WATCHDOG_MOTORS_PER_AXIS];
+        uint8_t motorCount;
+
+        volatile uint32_t lastCommandUs;
+
+    } t_axis;
+
+    void tick(void);
+    void setOutputScale(t_axis &axis, int32_t scale);
+
+    CAN &m_can;
+    uint32_t m_boardCanId;
+
+    uint32_t m_timeoutUs, m_rampUs;
+    uint32_t m_rampStepQ16;     // Output scale lost per microsecond of the ramp, Q16
+
+    t_axis m_axes[COMMAND_WATCHDOG_MAX_AXES];
+    Ticker m_ticker;
+
+    // Written by the ticker
+    volatile uint8_t m_staleMask, m_stoppedMask;
+    volatile uint16_t m_stops;
+    volatile uint32_t m_maxStopLatencyUs;
+    volatile bool m_isReportPending;
+
+    uint8_t m_reportedStoppedMask;
+
+};
+
+#endif // COMMAND_WATCHDOG_H
@@ -0,0 +1,37 @@
+#ifndef INDEPENDENT_WATCHDOG_H
+#define INDEPENDENT_WATCHDOG_H
+
+/* The STM32 independent watchdog (IWDG), resets the board when the main loop stops kicking it.
+ *
+ * The IWDG counts the LSI oscillator, 40 kHz nominal but anywhere from 30 to
+ * 50 kHz between parts and over temperature, so the actual timeout is between
+ * 0.8 and 1.33 times the one asked for. Once started it is only stopped by a
+ * power on reset: it keeps counting through a software reset, into the
+ * bootloader and the next app, and is only frozen while a debugger halts the
+ * core. Start it after any blocking setup (endpoint calibrations) and kick it
+ * once per main loop iteration. Anything that can outlast it, like erasing or
+ * copying several flash pages, kicks it as it goes; the bootloader does too.
+ * The reset it causes is latched as a crash record (CrashLog.h).
+ */
+
+#include "mbed.h"
+
+class IndependentWatchdog {
+
+public:
+
+    /** Start the watchdog, it can only be stopped by a reset
+     *
+     * @param timeoutMs Nominal time without a kick before the reset, up to 26 s
+     */
+    static void start(uint32_t timeoutMs);
+
+    /** Restart the countdown, does nothing if the watchdog was never started
+     */
+    static inline void kick(void) {
+        IWDG->KR = IWDG_KEY_RELOAD;
+    }
+
+};
+
+#endif // INDEPENDENT_WATCHDOG_H
@@ -0,0 +1,166 @@
+/* Stops the motors of an axis when its commands stop arriving.
+ */
+
+#include "CommandWatchdog.h"
+#include "MicrosecondClock.h"
+#include <algorithm>
+
+CommandWatchdog::CommandWatchdog(CAN &can, uint32_t boardCanId, uint32_t timeoutUs, uint32_t rampUs) :
+        m_can(can), m_boardCanId(boardCanId), m_timeoutUs(timeoutUs), m_rampUs(max(rampUs, (uint32_t)1)),
+        m_staleMask(0), m_stoppedMask(0), m_stops(0), m_maxStopLatencyUs(0), m_isReportPending(false),
+        m_reportedStoppedMask(0) {
+
+    // Scale lost over the whole ramp is FULL << 16, so rampedUs * step never passes 32 bits
+    m_rampStepQ16 = ((uint32_t)MOTOR_DUTY_CYCLE_FULL_SCALE << 16) / m_rampUs;
+
+    memset(m_axes, 0, sizeof(m_axes));
+}
+
+mbed_error_status_t CommandWatchdog::registerMotor(uint8_t axis, Motor &motor) {
+    if (axis >= COMMAND_WATCHDOG_MAX_AXES) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    t_axis &entry = m_axes[axis];
+
+    if (entry.motorCount >= COMMAND_WATCHDOG_MOTORS_PER_AXIS) {
+        return MBED_ERROR_OUT_OF_RESOURCES;
+    }
+
+    entry.p_motors[entry.motorCount++] = &motor;
+
+    return MBED_SUCCESS;
+}
+
+void CommandWatchdog::start(void) {
+    MicrosecondClock::init();
+
+    uint32_t nowUs = MicrosecondClock::read();
+
+    for (uint8_t i = 0; i < COMMAND_WATCHDOG_MAX_AXES; i++) {
+        m_axes[i].lastCommandUs = nowUs;
+    }
+
+    m_ticker.attach_us(callback(this, &CommandWatchdog::tick), COMMAND_WATCHDOG_TICK_US);
+}
+
+void CommandWatchdog::commandReceived(uint8_t axis) {
+    if (axis >= COMMAND_WATCHDOG_MAX_AXES) {
+        return;
+    }
+
+    uint8_t bit = 1 << axis;
+
+    // The ticker must not see the new time with the old masks
+    core_util_critical_section_enter();
+
+    m_axes[axis].lastCommandUs = MicrosecondClock::read();
+
+    if (m_staleMask & bit) {
+        m_staleMask   &= ~bit;
+        m_stoppedMask &= ~bit;
+        m_isReportPending = true;
+
+        setOutputScale(m_axes[axis], MOTOR_DUTY_CYCLE_FULL_SCALE);
+    }
+
+    core_util_critical_section_exit();
+}
+
+uint8_t CommandWatchdog::poll(void) {
+    uint8_t stoppedMask   = m_stoppedMask;
+    uint8_t newlyStopped  = stoppedMask & ~m_reportedStoppedMask;
+
+    m_reportedStoppedMask = stoppedMask;
+
+    if (newlyStopped != 0) {
+        MBED_ASSERT_WARN(m_maxStopLatencyUs <= m_rampUs + COMMAND_WATCHDOG_TICK_US);
+    }
+
+    if (m_isReportPending) {
+        CANMessage report;
+
+        core_util_critical_section_enter();
+
+        uint16_t stops          = m_stops;
+        uint32_t maxLatencyUs   = m_maxStopLatencyUs;
+
+        report.data[0] = m_stoppedMask;
+        report.data[1] = m_staleMask;
+        m_isReportPending = false;
+
+        core_util_critical_section_exit();
+
+        report.id  = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_WATCHDOG;
+        report.len = 8;
+        memcpy(&report.data[2], &stops, sizeof(stops));
+        memcpy(&report.data[4], &maxLatencyUs, sizeof(maxLatencyUs));
+
+        // Retried until the bus takes it
+        if (!m_can.write(report)) {
+            m_isReportPending = true;
+        }
+    }
+
+    return newlyStopped;
+}
+
+uint8_t CommandWatchdog::getStoppedMask(void) {
+    return m_stoppedMask;
+}
+
+uint32_t CommandWatchdog::getMaxStopLatencyUs(void) {
+    return m_maxStopLatencyUs;
+}
+
+void CommandWatchdog::tick(void) {
+    uint32_t nowUs = MicrosecondClock::read();
+
+    for (uint8_t i = 0; i < COMMAND_WATCHDOG_MAX_AXES; i++) {
+        t_axis &axis = m_axes[i];
+        uint8_t bit  = 1 << i;
+
+        if (axis.motorCount == 0 || (m_stoppedMask & bit)) {
+            continue;
+        }
+
+        uint32_t sinceCommandUs = nowUs - axis.lastCommandUs;
+
+        if (sinceCommandUs < m_timeoutUs) {
+            continue;
+        }
+
+        if (!(m_staleMask & bit)) {
+            m_staleMask |= bit;
+            m_isReportPending = true;
+        }
+
+        // Measured from when the axis went stale, not from when this tick noticed it
+        uint32_t rampedUs = sinceCommandUs - m_timeoutUs;
+        int32_t scale = 0;
+
+        if (rampedUs < m_rampUs) {
+            scale = MOTOR_DUTY_CYCLE_FULL_SCALE - (int32_t)((rampedUs * m_rampStepQ16) >> 16);
+        }
+
+        if (scale <= 0) {
+            scale = 0;
+
+            m_stoppedMask |= bit;
+            m_stops++;
+            m_isReportPending = true;
+
+            if (rampedUs > m_maxStopLatencyUs) {
+                m_maxStopLatencyUs = rampedUs;
+            }
+        }
+
+        setOutputScale(axis, scale);
+    }
+}
+
+void CommandWatchdog::setOutputScale(t_axis &axis, int32_t scale) {
+    for (uint8_t i = 0; i < axis.motorCount; i++) {
+        axis.p_motors[i]->setOutputScale(scale);
+    }
+}
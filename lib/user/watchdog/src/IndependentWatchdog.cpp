@@ -0,0 +1,38 @@
+/* The STM32 independent watchdog (IWDG), resets the board when the main loop stops kicking it.
+ */
+
+#include "IndependentWatchdog.h"
+#include <algorithm>
+
+#define IWDG_MAX_PRESCALER_SHIFT    6       // Divides by 4 << shift
+#define IWDG_MAX_RELOAD             0xFFF
+
+void IndependentWatchdog::start(uint32_t timeoutMs) {
+    uint32_t lsiTicks = timeoutMs * (LSI_VALUE / 1000);
+    uint32_t prescalerShift = 0;
+
+    // Smallest prescaler the reload fits with, for the finest resolution
+    while (prescalerShift < IWDG_MAX_PRESCALER_SHIFT && lsiTicks / (4 << prescalerShift) > IWDG_MAX_RELOAD) {
+        prescalerShift++;
+    }
+
+    uint32_t reload = lsiTicks / (4 << prescalerShift);
+    MBED_ASSERT_WARN(reload <= IWDG_MAX_RELOAD);
+
+    reload = max(min(reload, (uint32_t)IWDG_MAX_RELOAD), (uint32_t)1);
+
+    // Hold the countdown while a debugger has the core halted
+    __HAL_RCC_DBGMCU_CLK_ENABLE();
+    DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP;
+
+    // Starting it also starts the LSI
+    IWDG->KR  = IWDG_KEY_ENABLE;
+    IWDG->KR  = IWDG_KEY_WRITE_ACCESS_ENABLE;
+    IWDG->PR  = prescalerShift;
+    IWDG->RLR = reload;
+
+    // The registers cross into the LSI domain, a few LSI periods
+    while (IWDG->SR != 0) {}
+
+    kick();
+}
@@ -0,0 +1,100 @@
+/* Board memory status monitor
+ *
+ * Build on the Jetson (or any Linux host with SocketCAN) from the repository root:
+ *
+ *   g++ -O2 -Iconfig -Ilib/user/status/inc -o board_status tools/board_status/main.cpp
+ *
+ * Usage:
+ *
+ *   board_status <can interface>
+ *       Print the status frame of every board as it arrives (once a second per
+ *       board), any warning that follows it, and every change to the axes its
+ *       command watchdog has stopped.
+ */
+
+#include <stdio.h>
+
+#include "rover_config.h"
+#include "BoardStatusProtocol.h"
+#include "../common/SocketCanTransport.h"
+
+static const uint32_t boards[]    = {ROVER_SAFETY_CANID, ROVER_SCIENCE_CANID, ROVER_ARM_LOWER_CANID, ROVER_ARM_UPPER_CANID};
+static const char *boardNames[]   = {"safety", "science", "arm lower", "arm upper"};
+
+static void printStatus(const char *boardName, const SimCanFrame &frame) {
+    if (frame.len < BoardStatusProtocol::statusSize) {
+        return;
+    }
+
+    printf("%-10s stack peak %5u B  headroom %5u B  heap %5u B (peak %5u B)\n", boardName,
+           BoardStatusProtocol::unpackU16(&frame.data[0]), BoardStatusProtocol::unpackU16(&frame.data[2]),
+           BoardStatusProtocol::unpackU16(&frame.data[4]), BoardStatusProtocol::unpackU16(&frame.data[6]));
+}
+
+static void printWarning(const char *boardName, const SimCanFrame &frame) {
+    if (frame.len < BoardStatusProtocol::warningSize) {
+        return;
+    }
+
+    printf("%-10s WARNING%s%s\n", boardName,
+           (frame.data[0] & BoardStatusProtocol::warningLowHeadroom) ? "  low headroom" : "",
+           (frame.data[0] & BoardStatusProtocol::warningHeapAllocFailed) ? "  allocations failed" : "");
+
+    if (frame.data[0] & BoardStatusProtocol::warningHeapAllocFailed) {
+        printf("%-10s %u failed allocations\n", boardName, BoardStatusProtocol::unpackU16(&frame.data[3]));
+    }
+}
+
+static uint32_t unpackU32(const uint8_t *p_data) {
+    return BoardStatusProtocol::unpackU16(&p_data[0]) | ((uint32_t)BoardStatusProtocol::unpackU16(&p_data[2]) << 16);
+}
+
+// CommandWatchdog.h report: [stoppedMask, staleMask, stops(u16), maxStopLatencyUs(u32)]
+static void printWatchdog(const char *boardName, const SimCanFrame &frame) {
+    if (frame.len < 8) {
+        return;
+    }
+
+    printf("%-10s watchdog stopped 0x%02x  stale 0x%02x  %u stops, slowest %u us\n", boardName, frame.data[0],
+           frame.data[1], BoardStatusProtocol::unpackU16(&frame.data[2]), unpackU32(&frame.data[4]));
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <can interface>\n", argv[0]);
+        return 1;
+    }
+
+    SocketCanTransport transport;
+    if (!transport.open(argv[1])) {
+        fprintf(stderr, "Cannot open CAN interface %s\n", argv[1]);
+        return 1;
+    }
+
+    while (true) {
+        SimCanFrame frame;
+
+        if (!transport.receiveAny(frame, 1000)) {
+            continue;
+        }
+
+        for (size_t i = 0; i < sizeof(boards) / sizeof(boards[0]); i++) {
+            uint32_t replyBase = ROVER_JETSON_SYS_REPLY_CANID(boards[i]);
+
+            if (frame.id == replyBase + ROVER_SYS_REPLY_STATUS) {
+                printStatus(boardNames[i], frame);
+            }
+            else if (frame.id == replyBase + ROVER_SYS_REPLY_WARNING) {
+                printWarning(boardNames[i], frame);
+            }
+            else if (frame.id == replyBase + ROVER_SYS_REPLY_WATCHDOG) {
+                printWatchdog(boardNames[i], frame);
+            }
+        }
+
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+/* Host side of the CAN firmware update protocol.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rover_config.h"
+#include "FirmwareUpdater.h"
+#include "HostUploader.h"
+
+#define COMMAND_RETRIES         3
+#define PAGE_RETRIES            3
+#define FINISH_TIMEOUT_MS       10000   // Delta installs copy every unchanged page into staging
+
+static void writeU16(uint8_t *p_data, uint16_t value) {
+    p_data[0] = (uint8_t)value;
+    p_data[1] = (uint8_t)(value >> 8);
+}
+
+static void writeU32(uint8_t *p_data, uint32_t value) {
+    writeU16(p_data, (uint16_t)value);
+    writeU16(p_data + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t readU16(const uint8_t *p_data) {
+    return (uint16_t)(p_data[0] | (p_data[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t *p_data) {
+    return (uint32_t)readU16(p_data) | ((uint32_t)readU16(p_data + 2) << 16);
+}
+
+HostUploader::HostUploader(CanTransport &transport, uint32_t boardCanId, uint16_t windowFrames) :
+        m_transport(transport), m_boardCanId(boardCanId), m_windowFrames(windowFrames),
+        m_pageSize(ROVER_FLASH_PAGE_SIZE) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool HostUploader::upload(const std::vector<uint8_t> &image, bool delta) {
+    uint8_t request[8] = {0};
+    uint8_t reply[8];
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    double startSeconds = m_transport.getTimeSeconds();
+
+    m_stats.pagesTotal = (image.size() + m_pageSize - 1) / m_pageSize;
+
+    request[0] = FirmwareUpdater::opBegin;
+    request[1] = delta ? FirmwareUpdater::modeDelta : FirmwareUpdater::modeFull;
+    writeU16(&request[2], m_windowFrames);
+    writeU32(&request[4], image.size());
+
+    if (!command(request, 8, reply) || reply[1] != FirmwareUpdater::statusOk) {
+        fprintf(stderr, "Begin rejected\n");
+        return false;
+    }
+
+    for (uint32_t page = 0; page < m_stats.pagesTotal; page++) {
+
+        if (delta) {
+            memset(request, 0, sizeof(request));
+            request[0] = FirmwareUpdater::opPageDigest;
+            request[1] = page;
+
+            if (!command(request, 2, reply) || reply[1] != FirmwareUpdater::statusOk) {
+                fprintf(stderr, "Page %u digest failed\n", page);
+                return false;
+            }
+
+            if (readU32(&reply[4]) == pageCrc(image, page)) {
+                continue;
+            }
+        }
+
+        if (!sendPage(image, page)) {
+            fprintf(stderr, "Page %u failed\n", page);
+            return false;
+        }
+
+        m_stats.pagesSent++;
+    }
+
+    memset(request, 0, sizeof(request));
+    request[0] = FirmwareUpdater::opFinish;
+    writeU32(&request[4], crc32(&image[0], image.size()));
+
+    bool finished = command(request, 8, reply, FINISH_TIMEOUT_MS) && reply[1] == FirmwareUpdater::statusOk;
+
+    // A retried Finish is rejected if the reply to the first one was lost
+    if (!finished) {
+        request[0] = FirmwareUpdater::opStatus;
+        finished = command(request, 1, reply) && reply[2] == FirmwareUpdater::stateComplete;
+    }
+
+    m_stats.seconds = m_transport.getTimeSeconds() - startSeconds;
+
+    if (!finished) {
+        fprintf(stderr, "Finish failed\n");
+    }
+
+    return finished;
+}
+
+bool HostUploader::reboot(void) {
+    uint8_t request[1] = {FirmwareUpdater::opReboot};
+    uint8_t reply[8];
+
+    return command(request, 1, reply) && reply[1] == FirmwareUpdater::statusOk;
+}
+
+uint32_t HostUploader::crc32(const uint8_t *data, uint32_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+bool HostUploader::command(const uint8_t *request, uint8_t len, uint8_t *reply, unsigned int timeoutMs) {
+    uint32_t replyId = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_FIRMWARE;
+    SimCanFrame frame;
+
+    for (int attempt = 0; attempt < COMMAND_RETRIES; attempt++) {
+
+        if (attempt > 0) {
+            m_stats.retries++;
+        }
+
+        m_transport.send(SimCanFrame(m_boardCanId + ROVER_CANID_SYS_FIRMWARE_CMD, request, len));
+
+        // Skip late window acknowledgements and replies to earlier attempts
+        while (m_transport.receive(replyId, frame, timeoutMs)) {
+            if (frame.data[0] == request[0]) {
+                memcpy(reply, frame.data, 8);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool HostUploader::sendPage(const std::vector<uint8_t> &image, uint32_t page) {
+    uint8_t request[8] = {0};
+    uint8_t reply[8];
+
+    uint32_t pageStart = page * m_pageSize;
+    uint32_t pageLen   = image.size() - pageStart < m_pageSize ? image.size() - pageStart : m_pageSize;
+
+    for (int attempt = 0; attempt < PAGE_RETRIES; attempt++) {
+
+        if (attempt > 0) {
+            m_stats.retries++;
+        }
+
+        memset(request, 0, sizeof(request));
+        request[0] = FirmwareUpdater::opPageStart;
+        request[1] = page;
+
+        if (!command(request, 2, reply) || reply[1] != FirmwareUpdater::statusOk) {
+            continue;
+        }
+
+        if (!streamPage(&image[pageStart], pageLen)) {
+            continue;
+        }
+
+        memset(request, 0, sizeof(request));
+        request[0] = FirmwareUpdater::opPageEnd;
+        request[1] = page;
+        writeU32(&request[4], pageCrc(image, page));
+
+        if (command(request, 8, reply) && reply[1] == FirmwareUpdater::statusOk) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool HostUploader::streamPage(const uint8_t *pageData, uint32_t pageLen) {
+    uint32_t replyId     = ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_FIRMWARE;
+    uint32_t frameCount  = (pageLen + FIRMWARE_UPDATER_FRAME_PAYLOAD - 1) / FIRMWARE_UPDATER_FRAME_PAYLOAD;
+    uint32_t frame       = 0;
+    uint32_t windowStart = 0;
+    SimCanFrame ack;
+
+    // Drop acknowledgements left over from an earlier attempt
+    while (m_transport.receive(replyId, ack, 0)) {}
+
+    while (frame < frameCount) {
+        uint8_t data[8];
+        uint32_t offset = frame * FIRMWARE_UPDATER_FRAME_PAYLOAD;
+        uint32_t len    = pageLen - offset < FIRMWARE_UPDATER_FRAME_PAYLOAD ? pageLen - offset : FIRMWARE_UPDATER_FRAME_PAYLOAD;
+
+        data[0] = (uint8_t)frame;
+        memcpy(&data[1], &pageData[offset], len);
+
+        m_transport.send(SimCanFrame(m_boardCanId + ROVER_CANID_SYS_FIRMWARE_DATA, data, len + 1));
+        m_stats.dataFrames++;
+        frame++;
+
+        // The last partial window is flushed by PageEnd
+        if (frame - windowStart < m_windowFrames) {
+            continue;
+        }
+
+        // If the last frame of the window was lost the board is still waiting for it
+        bool acked = false;
+
+        for (int attempt = 0; attempt < COMMAND_RETRIES && !acked; attempt++) {
+            if (attempt > 0) {
+                m_transport.send(SimCanFrame(m_boardCanId + ROVER_CANID_SYS_FIRMWARE_DATA, data, len + 1));
+                m_stats.dataFrames++;
+                m_stats.retries++;
+            }
+
+            acked = m_transport.receive(replyId, ack, 20) && ack.data[0] == FirmwareUpdater::opDataAck;
+        }
+
+        if (!acked) {
+            return false;
+        }
+
+        if (ack.data[1] == FirmwareUpdater::statusSequenceError) {
+            m_stats.retries++;
+        }
+        else if (ack.data[1] != FirmwareUpdater::statusOk) {
+            return false;
+        }
+
+        // Resume from whatever the board has actually accepted
+        frame = windowStart = readU16(&ack.data[2]);
+    }
+
+    return true;
+}
+
+uint32_t HostUploader::pageCrc(const std::vector<uint8_t> &image, uint32_t page) {
+    std::vector<uint8_t> padded(m_pageSize, 0xFF);
+    uint32_t pageStart = page * m_pageSize;
+    uint32_t pageLen   = image.size() - pageStart < m_pageSize ? image.size() - pageStart : m_pageSize;
+
+    memcpy(&padded[0], &image[pageStart], pageLen);
+
+    return crc32(&padded[0], m_pageSize);
+}
@@ -0,0 +1,64 @@
+#ifndef HOST_UPLOADER_H
+#define HOST_UPLOADER_H
+
+/* Host side of the CAN firmware update protocol (see lib/user/firmware/inc/FirmwareUpdater.h).
+ *
+ * A full upload sends every page of the image. A delta upload first reads the
+ * CRC of every page of the image the board is running and only sends pages
+ * whose CRC differs, which turns a gain change into a few pages on the bus.
+ */
+
+#include <stdint.h>
+#include <vector>
+
+#include "../common/CanTransport.h"
+
+class HostUploader {
+
+public:
+
+    typedef struct {
+        unsigned int pagesTotal;
+        unsigned int pagesSent;
+        unsigned int dataFrames;
+        unsigned int retries;
+        double seconds;
+
+    } t_uploadStats;
+
+    HostUploader(CanTransport &transport, uint32_t boardCanId, uint16_t windowFrames = 16);
+
+    /** Upload an image into the board's staging slot and commit it for install
+     *
+     * @param delta Only send pages that differ from the running image
+     * @return true once the board has verified the image and recorded it for install
+     */
+    bool upload(const std::vector<uint8_t> &image, bool delta);
+
+    /** Ask the board to reset into the bootloader, which installs the image
+     */
+    bool reboot(void);
+
+    const t_uploadStats &getStats(void) const { return m_stats; }
+
+    /** IEEE CRC-32 as computed by the hardware CRC unit of the board
+     */
+    static uint32_t crc32(const uint8_t *data, uint32_t size);
+
+private:
+
+    bool command(const uint8_t *request, uint8_t len, uint8_t *reply, unsigned int timeoutMs = 100);
+    bool sendPage(const std::vector<uint8_t> &image, uint32_t page);
+    bool streamPage(const uint8_t *pageData, uint32_t pageLen);
+    uint32_t pageCrc(const std::vector<uint8_t> &image, uint32_t page);
+
+    CanTransport &m_transport;
+    uint32_t m_boardCanId;
+    uint16_t m_windowFrames;
+    uint32_t m_pageSize;
+
+    t_uploadStats m_stats;
+
+};
+
+#endif // HOST_UPLOADER_H
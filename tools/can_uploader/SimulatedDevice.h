@@ -0,0 +1,172 @@
+#ifndef SIMULATED_DEVICE_H
+#define SIMULATED_DEVICE_H
+
+/* A rover board on the simulated CAN bus running the firmware update code
+ * from lib/user/firmware against a RAM copy of the STM32F091 flash. Flash and
+ * CPU time are charged to the node so the bus clock reflects the real board.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "rover_config.h"
+#include "FirmwareStorage.h"
+#include "FirmwareUpdater.h"
+#include "FirmwareInstaller.h"
+#include "BootRecord.h"
+#include "../common/SimulatedCanBus.h"
+
+// STM32F091 datasheet typical values
+#define SIM_FLASH_PAGE_ERASE_SECONDS    0.030
+#define SIM_FLASH_HALFWORD_SECONDS      0.0000535
+#define SIM_CRC_SECONDS_PER_BYTE        (1.0 / 48e6)
+#define SIM_FRAME_HANDLING_SECONDS      0.000020
+
+class RamFirmwareStorage : public FirmwareStorage {
+
+public:
+
+    explicit RamFirmwareStorage(SimulatedCanNode *p_node = NULL) :
+        m_flash(256 * 1024, 0xFF), m_node(p_node), m_erases(0), m_programs(0), m_failAfterPrograms(-1) {}
+
+    virtual int erasePage(uint32_t address) {
+        uint32_t offset = (address - ROVER_FLASH_BASE) & ~(ROVER_FLASH_PAGE_SIZE - 1);
+        memset(&m_flash[offset], 0xFF, ROVER_FLASH_PAGE_SIZE);
+        m_erases++;
+        charge(SIM_FLASH_PAGE_ERASE_SECONDS);
+        return 0;
+    }
+
+    virtual int program(uint32_t address, const void *data, uint32_t size) {
+        if ((address & 3) || (size & 3)) {
+            return -1;
+        }
+
+        if (m_failAfterPrograms == 0) {
+            return -1;
+        }
+        if (m_failAfterPrograms > 0) {
+            m_failAfterPrograms--;
+        }
+
+        uint32_t offset = address - ROVER_FLASH_BASE;
+        const uint8_t *p_data = static_cast<const uint8_t *>(data);
+
+        // NOR flash can only clear bits, which catches writes to pages that were not erased
+        for (uint32_t i = 0; i < size; i++) {
+            if ((m_flash[offset + i] & p_data[i]) != p_data[i]) {
+                return -1;
+            }
+        }
+
+        memmove(&m_flash[offset], p_data, size);
+        m_programs++;
+        charge(SIM_FLASH_HALFWORD_SECONDS * size / 2);
+        return 0;
+    }
+
+    virtual const uint8_t *data(uint32_t address) {
+        return &m_flash[address - ROVER_FLASH_BASE];
+    }
+
+    virtual uint32_t crc32(const void *buffer, uint32_t size) {
+        const uint8_t *p_data = static_cast<const uint8_t *>(buffer);
+        uint32_t crc = 0xFFFFFFFF;
+
+        for (uint32_t i = 0; i < size; i++) {
+            crc ^= p_data[i];
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+
+        charge(SIM_CRC_SECONDS_PER_BYTE * size);
+        return ~crc;
+    }
+
+    virtual uint32_t getPageSize() {
+        return ROVER_FLASH_PAGE_SIZE;
+    }
+
+    /** Simulate a power loss by failing every program after the next n
+     */
+    void failAfterPrograms(int n) { m_failAfterPrograms = n; }
+
+    unsigned int getEraseCount(void) const { return m_erases; }
+
+    std::vector<uint8_t> m_flash;
+
+private:
+
+    void charge(double seconds) {
+        if (m_node != NULL) {
+            m_node->addBusyTime(seconds);
+        }
+    }
+
+    SimulatedCanNode *m_node;
+    unsigned int m_erases;
+    unsigned int m_programs;
+    int m_failAfterPrograms;
+
+};
+
+class SimulatedDevice : public SimulatedCanNode {
+
+public:
+
+    explicit SimulatedDevice(uint32_t boardCanId) :
+        m_boardCanId(boardCanId), m_storage(this), m_updater(new FirmwareUpdater(m_storage, boardCanId)) {}
+
+    ~SimulatedDevice() { delete m_updater; }
+
+    virtual bool acceptsFrame(const SimCanFrame &frame) {
+        return (frame.id & ROVER_CANID_FILTER_MASK) == m_boardCanId;
+    }
+
+    virtual void receive(const SimCanFrame &frame) {
+        uint8_t reply[8] = {0};
+        uint8_t replyLen = 0;
+
+        addBusyTime(SIM_FRAME_HANDLING_SECONDS);
+
+        if (frame.id == m_boardCanId + ROVER_CANID_SYS_FIRMWARE_CMD) {
+            m_updater->handleCommand(frame.data, frame.len, reply, replyLen);
+        }
+        else if (frame.id == m_boardCanId + ROVER_CANID_SYS_FIRMWARE_DATA) {
+            m_updater->handleData(frame.data, frame.len, reply, replyLen);
+        }
+
+        if (replyLen > 0) {
+            getBus()->send(SimCanFrame(ROVER_JETSON_SYS_REPLY_CANID(m_boardCanId) + ROVER_SYS_REPLY_FIRMWARE, reply, replyLen), this);
+        }
+    }
+
+    /** Run the bootloader's reset path, the updater restarts as it would after a reset
+     *
+     * @return true if the active image is valid and would be started
+     */
+    bool reset(BootRecord::t_record &record) {
+        BootRecord bootRecord(m_storage);
+        FirmwareInstaller installer(m_storage, bootRecord);
+
+        delete m_updater;
+        m_updater = new FirmwareUpdater(m_storage, m_boardCanId);
+
+        return installer.prepareBoot(record);
+    }
+
+    bool isRebootRequested(void) { return m_updater->isRebootRequested(); }
+
+    RamFirmwareStorage &getStorage(void) { return m_storage; }
+
+private:
+
+    uint32_t m_boardCanId;
+    RamFirmwareStorage m_storage;
+    FirmwareUpdater *m_updater;
+
+};
+
+#endif // SIMULATED_DEVICE_H
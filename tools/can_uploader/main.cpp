@@ -0,0 +1,186 @@
+/* CAN firmware uploader
+ *
+ * Build on the host (Linux or the Jetson) from the repository root:
+ *
+ *   g++ -O2 -Iconfig -Ilib/user/firmware/inc -o can_uploader \
+ *       tools/can_uploader/main.cpp tools/can_uploader/HostUploader.cpp \
+ *       lib/user/firmware/src/BootRecord.cpp lib/user/firmware/src/FirmwareInstaller.cpp \
+ *       lib/user/firmware/src/FirmwareUpdater.cpp
+ *
+ * Usage:
+ *
+ *   can_uploader <can interface> <board CAN ID> <image.bin> [--full]
+ *       Update a board, eg. can_uploader can0 0x300 build/arm_lower/arm_lower_arm.bin
+ *       The image must be built with BOOTLOADER=1. Only changed pages are sent
+ *       unless --full is given.
+ *
+ *   can_uploader --simulate
+ *       Run the update code of the boards against a simulated 500 kbps bus,
+ *       including lost frames and a power loss during install.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "rover_config.h"
+#include "HostUploader.h"
+#include "SimulatedDevice.h"
+
+#ifdef __linux__
+#include "../common/SocketCanTransport.h"
+#endif
+
+static std::vector<uint8_t> makeImage(uint32_t size, uint32_t seed) {
+    std::vector<uint8_t> image(size);
+
+    for (uint32_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        image[i] = (uint8_t)(seed >> 16);
+    }
+
+    // Plausible vector table: initial stack pointer and reset handler
+    const uint32_t vectors[2] = {0x20008000, ROVER_FLASH_APP_START + 0x101};
+    memcpy(&image[0], vectors, sizeof(vectors));
+
+    return image;
+}
+
+static void printStats(const char *name, const HostUploader::t_uploadStats &stats) {
+    printf("%-36s %2u/%2u pages  %5u data frames  %3u retries  upload %5.2f s",
+           name, stats.pagesSent, stats.pagesTotal, stats.dataFrames, stats.retries, stats.seconds);
+}
+
+// Reset the board and let the bootloader install, returns the install time
+static bool installAndCheck(SimulatedCanBus &bus, SimulatedDevice &device, const std::vector<uint8_t> &image,
+                            double &installSeconds) {
+    BootRecord::t_record record;
+
+    bool installed = device.reset(record);
+
+    installSeconds = device.getBusyUntil() - bus.getTimeSeconds();
+    if (installSeconds > 0) {
+        bus.advance(installSeconds);
+    }
+
+    return installed && record.imageSize == image.size() &&
+           memcmp(device.getStorage().data(ROVER_FLASH_APP_START), &image[0], image.size()) == 0;
+}
+
+static bool runScenario(const char *name, SimulatedCanBus &bus, SimulatedDevice &device,
+                        HostUploader &uploader, const std::vector<uint8_t> &image, bool delta) {
+
+    bool passed = uploader.upload(image, delta) && uploader.reboot() && device.isRebootRequested();
+
+    double installSeconds = 0;
+
+    bus.idle();
+    passed = passed && installAndCheck(bus, device, image, installSeconds);
+
+    printStats(name, uploader.getStats());
+    printf("  install %4.2f s\n", installSeconds);
+
+    if (!passed) {
+        printf("FAILED: %s\n", name);
+    }
+
+    return passed;
+}
+
+static int simulate(void) {
+    SimulatedCanBus bus(ROVER_CANBUS_FREQUENCY);
+    SimulatedDevice device(ROVER_ARM_LOWER_CANID);
+    SimulatedCanTransport transport(bus);
+    HostUploader uploader(transport, ROVER_ARM_LOWER_CANID);
+    bool passed = true;
+
+    bus.attach(device);
+
+    std::vector<uint8_t> image = makeImage(60 * 1024 + 100, 1);
+    passed &= runScenario("Full upload, 60 KB", bus, device, uploader, image, false);
+
+    // A control gain change touches one constant in .rodata
+    image[31 * 1024 + 17] ^= 0x40;
+    passed &= runScenario("Delta upload, gain change", bus, device, uploader, image, true);
+
+    // Code growth shifts everything after the change
+    image.insert(image.begin() + 40 * 1024, 24, 0xA5);
+    passed &= runScenario("Delta upload, code shifted at 40 KB", bus, device, uploader, image, true);
+
+    bus.setDropEvery(89);
+    image[2 * 1024 + 5] ^= 0x01;
+    passed &= runScenario("Full upload, 1 in 89 frames lost", bus, device, uploader, image, false);
+    bus.setDropEvery(0);
+
+    // Lose power part way through the copy into the active slot, then power up again
+    std::vector<uint8_t> update = image;
+    update[10 * 1024] ^= 0xFF;
+    update[50 * 1024] ^= 0xFF;
+
+    BootRecord::t_record record;
+    double installSeconds = 0;
+
+    bool recovered = uploader.upload(update, true);
+    device.getStorage().failAfterPrograms(1);
+    recovered = recovered && !device.reset(record);
+    device.getStorage().failAfterPrograms(-1);
+    recovered = recovered && installAndCheck(bus, device, update, installSeconds);
+
+    printf("%-36s %s\n", "Power loss during install", recovered ? "recovered" : "FAILED");
+    passed &= recovered;
+
+    printf("Lost frames at the board FIFO: %u\n", device.getDroppedFrames());
+
+    return passed ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 2 && strcmp(argv[1], "--simulate") == 0) {
+        return simulate();
+    }
+
+#ifdef __linux__
+    if (argc >= 4) {
+        FILE *p_file = fopen(argv[3], "rb");
+        if (p_file == NULL) {
+            fprintf(stderr, "Cannot open %s\n", argv[3]);
+            return 1;
+        }
+
+        std::vector<uint8_t> image;
+        uint8_t buffer[1024];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof(buffer), p_file)) > 0) {
+            image.insert(image.end(), buffer, buffer + len);
+        }
+        fclose(p_file);
+
+        if (image.empty() || image.size() > ROVER_FLASH_APP_SIZE) {
+            fprintf(stderr, "Image must be between 1 and %u bytes\n", ROVER_FLASH_APP_SIZE);
+            return 1;
+        }
+
+        SocketCanTransport transport;
+        if (!transport.open(argv[1])) {
+            fprintf(stderr, "Cannot open CAN interface %s\n", argv[1]);
+            return 1;
+        }
+
+        HostUploader uploader(transport, strtoul(argv[2], NULL, 0));
+        bool delta = !(argc >= 5 && strcmp(argv[4], "--full") == 0);
+
+        if (!uploader.upload(image, delta) || !uploader.reboot()) {
+            return 1;
+        }
+
+        printStats(argv[3], uploader.getStats());
+        return 0;
+    }
+#endif
+
+    fprintf(stderr, "Usage: %s <can interface> <board CAN ID> <image.bin> [--full]\n"
+                    "       %s --simulate\n", argv[0], argv[0]);
+    return 1;
+}
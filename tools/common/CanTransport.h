@@ -0,0 +1,75 @@
+#ifndef CAN_TRANSPORT_H
+#define CAN_TRANSPORT_H
+
+/* Host side CAN access used by the rover tools, implemented by the simulated
+ * bus for testing and by SocketCAN on the Jetson.
+ */
+
+#include "SimulatedCanBus.h"
+
+class CanTransport {
+
+public:
+
+    virtual ~CanTransport() {}
+
+    virtual bool send(const SimCanFrame &frame) = 0;
+
+    /** Wait for a frame with the given ID
+     *
+     * @return false on timeout
+     */
+    virtual bool receive(uint32_t id, SimCanFrame &frame, unsigned int timeoutMs) = 0;
+
+    /** Seconds since the transport was opened, simulated time on the simulated bus
+     */
+    virtual double getTimeSeconds(void) = 0;
+
+};
+
+/* Transport endpoint attached to a simulated bus
+ */
+class SimulatedCanTransport : public CanTransport, public SimulatedCanNode {
+
+public:
+
+    explicit SimulatedCanTransport(SimulatedCanBus &bus) {
+        bus.attach(*this);
+    }
+
+    virtual bool send(const SimCanFrame &frame) {
+        getBus()->send(frame, this);
+        return true;
+    }
+
+    virtual bool receive(uint32_t id, SimCanFrame &frame, unsigned int timeoutMs) {
+        getBus()->idle();
+
+        for (size_t i = 0; i < m_received.size(); i++) {
+            if (m_received[i].id == id) {
+                frame = m_received[i];
+                m_received.erase(m_received.begin() + i);
+                return true;
+            }
+        }
+
+        // Nothing else can arrive on an idle simulated bus
+        getBus()->advance(timeoutMs / 1000.0);
+        return false;
+    }
+
+    virtual double getTimeSeconds(void) {
+        return getBus()->getTimeSeconds();
+    }
+
+    virtual void receive(const SimCanFrame &frame) {
+        m_received.push_back(frame);
+    }
+
+private:
+
+    std::deque<SimCanFrame> m_received;
+
+};
+
+#endif // CAN_TRANSPORT_H
@@ -0,0 +1,103 @@
+#ifndef ISO_TP_TRANSPORT_H
+#define ISO_TP_TRANSPORT_H
+
+/* Blocking ISO-TP transfers for the Jetson tools, on top of a CanTransport.
+ *
+ * Runs the same IsoTpLink as the boards (lib/user/can/src/IsoTpLink.cpp has to
+ * be compiled into the tool). Separation times are waited out in whole
+ * milliseconds, the timeout granularity of CanTransport.
+ */
+
+#include "CanTransport.h"
+#include "IsoTpLink.h"
+
+class IsoTpTransport : public IsoTpLink::FrameSink {
+
+public:
+
+    IsoTpTransport(CanTransport &transport, uint32_t txId, uint32_t rxId,
+                   uint8_t blockSize = 0, uint32_t separationTimeUs = 0) :
+        m_transport(transport), m_link(*this, txId, rxId, blockSize, separationTimeUs) {}
+
+    /** Send a payload and wait for the transfer to finish
+     *
+     * @return false if the board did not accept it, see getLink().getSendResult()
+     */
+    bool send(const uint8_t *payload, uint16_t size) {
+        if (!m_link.send(payload, size, nowUs())) {
+            return false;
+        }
+
+        while (true) {
+            uint32_t now = nowUs();
+            m_link.poll(now);
+
+            if (!m_link.isSending()) {
+                break;
+            }
+
+            // Waiting for a flow control, or for the separation time to pass
+            int32_t untilNextUs = (int32_t)(m_link.getNextSendUs() - now);
+            waitForFrame(untilNextUs > 0 ? (untilNextUs + 999) / 1000 : 1);
+        }
+
+        return m_link.getSendResult() == IsoTpLink::resultComplete;
+    }
+
+    /** Wait for a payload and receive it straight into buffer
+     *
+     * @return false on timeout or if the transfer failed, see getLink().getReceiveResult()
+     */
+    bool receive(uint8_t *buffer, uint16_t capacity, uint16_t &size, unsigned int timeoutMs) {
+        double deadline = m_transport.getTimeSeconds() + timeoutMs / 1000.0;
+
+        m_link.setReceiveBuffer(buffer, capacity);
+
+        while (!m_link.hasReceived()) {
+            IsoTpLink::t_result result = m_link.getReceiveResult();
+
+            if (result != IsoTpLink::resultIdle && result != IsoTpLink::resultInProgress) {
+                return false;
+            }
+
+            // A transfer that has started is given the link's own timeout
+            if (result == IsoTpLink::resultIdle && m_transport.getTimeSeconds() >= deadline) {
+                return false;
+            }
+
+            waitForFrame(1);
+            m_link.poll(nowUs());
+        }
+
+        size = m_link.getReceivedSize();
+        m_link.releaseReceived();
+
+        return true;
+    }
+
+    IsoTpLink &getLink(void) { return m_link; }
+
+    virtual bool sendFrame(uint32_t id, const uint8_t *data, uint8_t len) {
+        return m_transport.send(SimCanFrame(id, data, len));
+    }
+
+private:
+
+    void waitForFrame(unsigned int timeoutMs) {
+        SimCanFrame frame;
+
+        if (m_transport.receive(m_link.getRxId(), frame, timeoutMs)) {
+            m_link.handleFrame(frame.id, frame.data, frame.len, nowUs());
+        }
+    }
+
+    uint32_t nowUs(void) {
+        return (uint32_t)(uint64_t)(m_transport.getTimeSeconds() * 1e6);
+    }
+
+    CanTransport &m_transport;
+    IsoTpLink m_link;
+
+};
+
+#endif // ISO_TP_TRANSPORT_H
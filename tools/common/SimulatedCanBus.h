@@ -0,0 +1,273 @@
+#ifndef SIMULATED_CAN_BUS_H
+#define SIMULATED_CAN_BUS_H
+
+/* In-process CAN bus for exercising rover CAN protocols on a PC.
+ *
+ * Frames are delivered to every other attached node in order. The bus keeps a
+ * clock that advances by the exact on-wire length of each frame (including
+ * stuff bits and interframe space) at the configured bit rate, so protocols
+ * can be benchmarked against the real 500 kbps bus. Nodes that model slow
+ * work (eg. flash writes) report when they are ready to transmit again and the
+ * receive FIFO of the bxCAN peripheral is modelled so lost frames show up.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+struct SimCanFrame {
+    uint32_t id;
+    uint8_t  len;
+    uint8_t  data[8];
+
+    SimCanFrame() : id(0), len(0) { memset(data, 0, sizeof(data)); }
+
+    SimCanFrame(uint32_t frameId, const uint8_t *frameData, uint8_t frameLen) : id(frameId), len(frameLen) {
+        memset(data, 0, sizeof(data));
+        memcpy(data, frameData, frameLen);
+    }
+};
+
+class SimulatedCanBus;
+
+class SimulatedCanNode {
+
+public:
+
+    SimulatedCanNode() : m_bus(NULL), m_busyUntil(0.0), m_droppedFrames(0) {}
+    virtual ~SimulatedCanNode() {}
+
+    /** Only frames accepted here are put in the node's receive FIFO
+     */
+    virtual bool acceptsFrame(const SimCanFrame &frame) { return true; }
+
+    /** Process a received frame, the node may transmit through getBus()
+     */
+    virtual void receive(const SimCanFrame &frame) = 0;
+
+    /** Simulated time spent by the node's CPU, frames arriving meanwhile wait in the FIFO
+     */
+    void addBusyTime(double seconds);
+
+    double getBusyUntil(void) const { return m_busyUntil; }
+    unsigned int getDroppedFrames(void) const { return m_droppedFrames; }
+
+    SimulatedCanBus *getBus(void) { return m_bus; }
+
+protected:
+
+    friend class SimulatedCanBus;
+
+    SimulatedCanBus *m_bus;
+    double m_busyUntil;
+    unsigned int m_droppedFrames;
+    std::deque<SimCanFrame> m_fifo;
+
+};
+
+class SimulatedCanBus {
+
+public:
+
+    static const unsigned int kFifoDepth = 3;   // bxCAN receive FIFO
+
+    explicit SimulatedCanBus(uint32_t bitRate = 500000) :
+        m_bitRate(bitRate), m_now(0.0), m_frames(0), m_bits(0), m_dropEvery(0), m_delivering(false) {}
+
+    void attach(SimulatedCanNode &node) {
+        node.m_bus = this;
+        m_nodes.push_back(&node);
+    }
+
+    /** Queue a frame for transmission by sender, it is sent once the bus and the sender are free
+     */
+    void send(const SimCanFrame &frame, SimulatedCanNode *p_sender) {
+        m_pending.push_back(t_pendingFrame(frame, p_sender));
+        run();
+    }
+
+    /** Let every node finish the work waiting in its FIFO
+     */
+    void idle(void) {
+        bool progressed = true;
+
+        while (progressed) {
+            progressed = false;
+
+            for (size_t i = 0; i < m_nodes.size(); i++) {
+                SimulatedCanNode *p_node = m_nodes[i];
+
+                if (!p_node->m_fifo.empty()) {
+                    SimCanFrame frame = p_node->m_fifo.front();
+                    p_node->m_fifo.pop_front();
+                    p_node->receive(frame);
+                    run();
+                    progressed = true;
+                }
+            }
+        }
+    }
+
+    /** Drop every nth frame on the wire to exercise error handling, 0 disables
+     */
+    void setDropEvery(unsigned int n) { m_dropEvery = n; }
+
+    double getTimeSeconds(void) const { return m_now; }
+    unsigned long getFrameCount(void) const { return m_frames; }
+    unsigned long getBitCount(void) const { return m_bits; }
+
+    void advance(double seconds) { m_now += seconds; }
+
+    /** On-wire length of a standard data frame in bits, including stuff bits and interframe space
+     */
+    static unsigned int frameBits(const SimCanFrame &frame) {
+        std::vector<uint8_t> bits;
+
+        // SOF, 11 bit ID, RTR, IDE, r0, DLC
+        bits.push_back(0);
+        pushBits(bits, frame.id, 11);
+        bits.push_back(0);
+        bits.push_back(0);
+        bits.push_back(0);
+        pushBits(bits, frame.len, 4);
+
+        for (unsigned int i = 0; i < frame.len; i++) {
+            pushBits(bits, frame.data[i], 8);
+        }
+
+        pushBits(bits, crc15(bits), 15);
+
+        // A complement bit is stuffed after every 5 equal bits up to the end of the CRC
+        unsigned int stuffBits = 0;
+        unsigned int run = 1;
+        uint8_t level = bits[0];
+
+        for (size_t i = 1; i < bits.size(); i++) {
+            if (bits[i] == level) {
+                run++;
+            }
+            else {
+                level = bits[i];
+                run = 1;
+            }
+
+            if (run == 5) {
+                stuffBits++;
+                level = !level;
+                run = 1;
+            }
+        }
+
+        // CRC delimiter, ACK slot, ACK delimiter, 7 bit EOF, 3 bit interframe space
+        return (unsigned int)bits.size() + stuffBits + 1 + 2 + 7 + 3;
+    }
+
+private:
+
+    struct t_pendingFrame {
+        SimCanFrame frame;
+        SimulatedCanNode *p_sender;
+
+        t_pendingFrame(const SimCanFrame &pendingFrame, SimulatedCanNode *p_pendingSender) :
+            frame(pendingFrame), p_sender(p_pendingSender) {}
+    };
+
+    void run(void) {
+        if (m_delivering) {
+            return;
+        }
+
+        m_delivering = true;
+
+        while (!m_pending.empty()) {
+            t_pendingFrame pending = m_pending.front();
+            m_pending.pop_front();
+
+            if (pending.p_sender != NULL && pending.p_sender->m_busyUntil > m_now) {
+                m_now = pending.p_sender->m_busyUntil;
+            }
+
+            unsigned int bits = frameBits(pending.frame);
+            m_now  += (double)bits / m_bitRate;
+            m_bits += bits;
+            m_frames++;
+
+            if (m_dropEvery != 0 && m_frames % m_dropEvery == 0) {
+                continue;
+            }
+
+            for (size_t i = 0; i < m_nodes.size(); i++) {
+                SimulatedCanNode *p_node = m_nodes[i];
+
+                if (p_node == pending.p_sender || !p_node->acceptsFrame(pending.frame)) {
+                    continue;
+                }
+
+                deliver(p_node, pending.frame);
+            }
+        }
+
+        m_delivering = false;
+    }
+
+    void deliver(SimulatedCanNode *p_node, const SimCanFrame &frame) {
+
+        // Frames that arrived while the node was busy are served first
+        while (!p_node->m_fifo.empty() && p_node->m_busyUntil <= m_now) {
+            SimCanFrame queued = p_node->m_fifo.front();
+            p_node->m_fifo.pop_front();
+            p_node->receive(queued);
+        }
+
+        if (p_node->m_busyUntil > m_now || !p_node->m_fifo.empty()) {
+            if (p_node->m_fifo.size() < kFifoDepth) {
+                p_node->m_fifo.push_back(frame);
+            }
+            else {
+                p_node->m_droppedFrames++;
+            }
+            return;
+        }
+
+        p_node->receive(frame);
+    }
+
+    static void pushBits(std::vector<uint8_t> &bits, uint32_t value, unsigned int count) {
+        for (int i = (int)count - 1; i >= 0; i--) {
+            bits.push_back((value >> i) & 1);
+        }
+    }
+
+    static uint16_t crc15(const std::vector<uint8_t> &bits) {
+        uint16_t crc = 0;
+
+        for (size_t i = 0; i < bits.size(); i++) {
+            bool crcNext = bits[i] ^ ((crc >> 14) & 1);
+            crc = (crc << 1) & 0x7FFF;
+            if (crcNext) {
+                crc ^= 0x4599;
+            }
+        }
+
+        return crc;
+    }
+
+    uint32_t m_bitRate;
+    double m_now;
+    unsigned long m_frames;
+    unsigned long m_bits;
+    unsigned int m_dropEvery;
+    bool m_delivering;
+
+    std::vector<SimulatedCanNode *> m_nodes;
+    std::deque<t_pendingFrame> m_pending;
+
+};
+
+inline void SimulatedCanNode::addBusyTime(double seconds) {
+    double start = (m_bus != NULL && m_bus->getTimeSeconds() > m_busyUntil) ? m_bus->getTimeSeconds() : m_busyUntil;
+    m_busyUntil = start + seconds;
+}
+
+#endif // SIMULATED_CAN_BUS_H
@@ -0,0 +1,126 @@
+#ifndef SOCKET_CAN_TRANSPORT_H
+#define SOCKET_CAN_TRANSPORT_H
+
+/* Linux SocketCAN transport for running the rover tools on the Jetson
+ */
+
+#include <errno.h>
+#include <net/if.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "CanTransport.h"
+
+class SocketCanTransport : public CanTransport {
+
+public:
+
+    SocketCanTransport() : m_socket(-1), m_startSeconds(monotonicSeconds()) {}
+
+    ~SocketCanTransport() {
+        if (m_socket >= 0) {
+            close(m_socket);
+        }
+    }
+
+    bool open(const char *interfaceName) {
+        struct ifreq ifr;
+        struct sockaddr_can addr;
+
+        m_socket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+        if (m_socket < 0) {
+            return false;
+        }
+
+        memset(&ifr, 0, sizeof(ifr));
+        strncpy(ifr.ifr_name, interfaceName, IFNAMSIZ - 1);
+        if (ioctl(m_socket, SIOCGIFINDEX, &ifr) < 0) {
+            return false;
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        addr.can_family  = AF_CAN;
+        addr.can_ifindex = ifr.ifr_ifindex;
+
+        return bind(m_socket, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    }
+
+    virtual bool send(const SimCanFrame &frame) {
+        struct can_frame canFrame;
+
+        memset(&canFrame, 0, sizeof(canFrame));
+        canFrame.can_id  = frame.id;
+        canFrame.can_dlc = frame.len;
+        memcpy(canFrame.data, frame.data, frame.len);
+
+        // The socket queue may be full for a moment at 500 kbps, wait for it to drain
+        while (write(m_socket, &canFrame, sizeof(canFrame)) != sizeof(canFrame)) {
+            if (errno != ENOBUFS) {
+                return false;
+            }
+            usleep(100);
+        }
+
+        return true;
+    }
+
+    virtual bool receive(uint32_t id, SimCanFrame &frame, unsigned int timeoutMs) {
+        double deadline = monotonicSeconds() + timeoutMs / 1000.0;
+
+        while (true) {
+            int remainingMs = (int)((deadline - monotonicSeconds()) * 1000.0);
+
+            if (!receiveAny(frame, remainingMs > 0 ? remainingMs : 0)) {
+                return false;
+            }
+
+            if (frame.id == id) {
+                return true;
+            }
+        }
+    }
+
+    /** Wait for a frame with any ID
+     *
+     * @return false on timeout
+     */
+    bool receiveAny(SimCanFrame &frame, unsigned int timeoutMs) {
+        struct pollfd fd = {m_socket, POLLIN, 0};
+
+        if (poll(&fd, 1, timeoutMs) <= 0) {
+            return false;
+        }
+
+        struct can_frame canFrame;
+        if (read(m_socket, &canFrame, sizeof(canFrame)) != sizeof(canFrame)) {
+            return false;
+        }
+
+        frame = SimCanFrame(canFrame.can_id & CAN_SFF_MASK, canFrame.data, canFrame.can_dlc);
+        return true;
+    }
+
+    virtual double getTimeSeconds(void) {
+        return monotonicSeconds() - m_startSeconds;
+    }
+
+private:
+
+    static double monotonicSeconds(void) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec / 1e9;
+    }
+
+    int m_socket;
+    double m_startSeconds;
+
+};
+
+#endif // SOCKET_CAN_TRANSPORT_H
@@ -0,0 +1,149 @@
+/* Crash record reader
+ *
+ * Build on the Jetson (or any Linux host with SocketCAN) from the repository root:
+ *
+ *   g++ -O2 -Iconfig -Ilib/user/crashlog/inc -o crash_log tools/crash_log/main.cpp
+ *
+ * Usage:
+ *
+ *   crash_log <can interface> <board CAN ID> [--clear]
+ *       Print how the board last reset and the crash record it holds, if any.
+ *       With --clear the record is forgotten once read. Addresses resolve to
+ *       source lines with arm-none-eabi-addr2line -e <app elf> <address>, using
+ *       the elf of the firmware that crashed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rover_config.h"
+#include "CrashLogProtocol.h"
+#include "../common/SocketCanTransport.h"
+
+#define COMMAND_RETRIES     3
+#define COMMAND_TIMEOUT_MS  100
+#define READ_TIMEOUT_MS     200
+
+static const char *causeNames[] = {"none", "HardFault", "mbed_error()", "error() or MBED_ASSERT", "watchdog"};
+
+static const char *resetFlagNames[] = {"option byte load", "pin", "power on", "software", "independent watchdog",
+                                       "window watchdog", "low power"};
+
+static bool command(CanTransport &transport, uint32_t boardCanId, uint8_t opcode, uint8_t *reply) {
+    uint32_t replyId = ROVER_JETSON_SYS_REPLY_CANID(boardCanId) + ROVER_SYS_REPLY_CRASH;
+    SimCanFrame frame;
+
+    for (int attempt = 0; attempt < COMMAND_RETRIES; attempt++) {
+        transport.send(SimCanFrame(boardCanId + ROVER_CANID_SYS_CRASH_CMD, &opcode, 1));
+
+        while (transport.receive(replyId, frame, COMMAND_TIMEOUT_MS)) {
+            if (frame.data[0] == opcode) {
+                memcpy(reply, frame.data, 8);
+                return true;
+            }
+        }
+    }
+
+    fprintf(stderr, "No reply from board 0x%03x\n", boardCanId);
+    return false;
+}
+
+static bool readRecord(CanTransport &transport, uint32_t boardCanId, CrashLogProtocol::t_record &record) {
+    uint32_t dataId = ROVER_JETSON_SYS_REPLY_CANID(boardCanId) + ROVER_SYS_REPLY_CRASH_DATA;
+    uint8_t *p_data = reinterpret_cast<uint8_t *>(&record);
+    uint8_t reply[8];
+    SimCanFrame frame;
+
+    while (transport.receive(dataId, frame, 0)) {}
+
+    if (!command(transport, boardCanId, CrashLogProtocol::opRead, reply) || reply[1] != CrashLogProtocol::statusOk) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < CrashLogProtocol::frameCount; i++) {
+        if (!transport.receive(dataId, frame, READ_TIMEOUT_MS)) {
+            fprintf(stderr, "Read incomplete, %u of %u frames\n", i, CrashLogProtocol::frameCount);
+            return false;
+        }
+
+        memcpy(&p_data[i * CrashLogProtocol::frameSize], frame.data, CrashLogProtocol::frameSize);
+    }
+
+    return true;
+}
+
+static void printRecord(const CrashLogProtocol::t_record &record) {
+    const char *cause = record.cause < sizeof(causeNames) / sizeof(causeNames[0]) ? causeNames[record.cause] : "unknown";
+
+    printf("Crash %u since power on: %s at %u us\n", record.crashCount, cause, record.timeUs);
+
+    if (record.cause != CrashLogProtocol::causeWatchdog) {
+        printf("  pc   0x%08x  lr 0x%08x\n", record.pc, record.lr);
+        printf("  xpsr 0x%08x  sp 0x%08x  (exception %u)\n", record.xpsr, record.sp, record.xpsr & 0x3F);
+    }
+
+    if (record.cause == CrashLogProtocol::causeFatalError) {
+        printf("  error 0x%08x  value 0x%08x\n", (uint32_t)record.errorStatus, record.errorValue);
+    }
+
+    printf("Last %u events, oldest first:\n", record.eventCount);
+
+    for (uint8_t i = 0; i < record.eventCount && i < CRASH_LOG_EVENTS; i++) {
+        const CrashLogProtocol::t_event &event = record.events[i];
+
+        printf("  %10u us  0x%08x  status %d  value 0x%08x\n", event.timeUs, event.address, event.status, event.value);
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3 || (argc == 4 && strcmp(argv[3], "--clear") != 0) || argc > 4) {
+        fprintf(stderr, "Usage: %s <can interface> <board CAN ID> [--clear]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t boardCanId = strtoul(argv[2], NULL, 0);
+    bool isClearing     = argc == 4;
+
+    SocketCanTransport transport;
+    if (!transport.open(argv[1])) {
+        fprintf(stderr, "Cannot open CAN interface %s\n", argv[1]);
+        return 1;
+    }
+
+    uint8_t reply[8];
+
+    if (!command(transport, boardCanId, CrashLogProtocol::opSummary, reply)) {
+        return 1;
+    }
+
+    printf("Last reset:");
+    for (uint8_t bit = 0; bit < sizeof(resetFlagNames) / sizeof(resetFlagNames[0]); bit++) {
+        if (reply[2] & (1 << bit)) {
+            printf(" %s", resetFlagNames[bit]);
+        }
+    }
+    printf("\n");
+
+    if (reply[1] == CrashLogProtocol::statusNoRecord) {
+        printf("No crash recorded\n");
+        return 0;
+    }
+
+    CrashLogProtocol::t_record record;
+
+    if (!readRecord(transport, boardCanId, record)) {
+        return 1;
+    }
+
+    printRecord(record);
+
+    if (isClearing && (!command(transport, boardCanId, CrashLogProtocol::opClear, reply) ||
+                       reply[1] != CrashLogProtocol::statusOk)) {
+        fprintf(stderr, "Clear failed\n");
+        return 1;
+    }
+
+    return 0;
+}
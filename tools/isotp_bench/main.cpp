@@ -0,0 +1,212 @@
+/* ISO-TP throughput benchmark
+ *
+ * Build on the host from the repository root:
+ *
+ *   g++ -O2 -Iconfig -Ilib/user/can/inc -o isotp_bench \
+ *       tools/isotp_bench/main.cpp lib/user/can/src/IsoTpLink.cpp
+ *
+ * Usage:
+ *
+ *   isotp_bench
+ *       Run segmented transfers between the Jetson and a board over a simulated
+ *       500 kbps bus for a range of payload sizes, block sizes and separation
+ *       times, and check every payload arrives intact.
+ *
+ * No board app runs an IsoTpCANLink yet, so there is no real bus mode.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "rover_config.h"
+#include "IsoTpLink.h"
+#include "../common/CanTransport.h"
+#include "../common/IsoTpTransport.h"
+
+#define SIM_FRAME_HANDLING_SECONDS  20e-6   // Board time to read a frame and copy it out
+#define SIM_SLOW_HANDLING_SECONDS   900e-6  // Board main loop busy with a 1 kHz control tick
+#define RECEIVE_TIMEOUT_MS          2000
+
+// Any pair of IDs will do on the simulated bus
+#define SIM_BOARD_RX_CANID          0x4F4
+#define SIM_BOARD_TX_CANID          0x5E4
+
+/* Board end of the link, receiving into a static buffer like the firmware does
+ */
+class SimulatedIsoTpBoard : public SimulatedCanNode, public IsoTpLink::FrameSink {
+
+public:
+
+    SimulatedIsoTpBoard(uint8_t blockSize, uint32_t separationTimeUs, double frameHandlingSeconds) :
+        m_link(*this, SIM_BOARD_TX_CANID, SIM_BOARD_RX_CANID, blockSize, separationTimeUs),
+        m_frameHandlingSeconds(frameHandlingSeconds) {
+        m_link.setReceiveBuffer(m_buffer, sizeof(m_buffer));
+    }
+
+    virtual bool acceptsFrame(const SimCanFrame &frame) {
+        return frame.id == m_link.getRxId();
+    }
+
+    virtual void receive(const SimCanFrame &frame) {
+        addBusyTime(m_frameHandlingSeconds);
+
+        m_link.handleFrame(frame.id, frame.data, frame.len, nowUs());
+        m_link.poll(nowUs());
+    }
+
+    virtual bool sendFrame(uint32_t id, const uint8_t *data, uint8_t len) {
+        getBus()->send(SimCanFrame(id, data, len), this);
+        return true;
+    }
+
+    bool start(const uint8_t *payload, uint16_t size) {
+        return m_link.send(payload, size, nowUs());
+    }
+
+    IsoTpLink &getLink(void) { return m_link; }
+    const uint8_t *getBuffer(void) const { return m_buffer; }
+
+private:
+
+    uint32_t nowUs(void) {
+        return (uint32_t)(getBus()->getTimeSeconds() * 1e6);
+    }
+
+    IsoTpLink m_link;
+    double m_frameHandlingSeconds;
+    uint8_t m_buffer[ISO_TP_MAX_PAYLOAD];
+
+};
+
+typedef enum {
+    jetsonToBoard,
+    boardToJetson
+
+} t_direction;
+
+typedef struct {
+    const char *name;
+    t_direction direction;
+    uint16_t size;
+    uint8_t blockSize;
+    uint32_t separationTimeUs;
+    double frameHandlingSeconds;
+    bool expectDelivered;
+
+} t_scenario;
+
+static std::vector<uint8_t> makePayload(uint16_t size, uint32_t seed) {
+    std::vector<uint8_t> payload(size);
+
+    for (uint16_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        payload[i] = (uint8_t)(seed >> 16);
+    }
+
+    return payload;
+}
+
+static const char *resultName(IsoTpLink::t_result result) {
+    switch (result) {
+        case IsoTpLink::resultComplete:      return "complete";
+        case IsoTpLink::resultTimeout:       return "timeout";
+        case IsoTpLink::resultOverflow:      return "overflow";
+        case IsoTpLink::resultSequenceError: return "frame lost";
+        default:                             return "incomplete";
+    }
+}
+
+static bool runScenario(const t_scenario &scenario) {
+    SimulatedCanBus bus(ROVER_CANBUS_FREQUENCY);
+    SimulatedCanTransport transport(bus);
+
+    // The end receiving the payload sets the block size and separation time
+    bool isUpload = scenario.direction == jetsonToBoard;
+    SimulatedIsoTpBoard board(isUpload ? scenario.blockSize : 0, isUpload ? scenario.separationTimeUs : 0,
+                              scenario.frameHandlingSeconds);
+    IsoTpTransport jetson(transport, board.getLink().getRxId(), board.getLink().getTxId(),
+                          isUpload ? 0 : scenario.blockSize, isUpload ? 0 : scenario.separationTimeUs);
+
+    bus.attach(board);
+
+    std::vector<uint8_t> payload = makePayload(scenario.size, scenario.size);
+    std::vector<uint8_t> received(ISO_TP_MAX_PAYLOAD);
+    uint16_t receivedSize = 0;
+    IsoTpLink::t_result result;
+    double start = bus.getTimeSeconds();
+    unsigned long startBits = bus.getBitCount();
+
+    if (isUpload) {
+        jetson.send(&payload[0], scenario.size);
+        bus.idle();
+
+        result = board.getLink().getReceiveResult();
+        receivedSize = board.getLink().getReceivedSize();
+        memcpy(&received[0], board.getBuffer(), receivedSize);
+    }
+    else {
+        board.start(&payload[0], scenario.size);
+        bool isReceived = jetson.receive(&received[0], received.size(), receivedSize, RECEIVE_TIMEOUT_MS);
+
+        result = isReceived ? IsoTpLink::resultComplete : jetson.getLink().getReceiveResult();
+    }
+
+    bool delivered = result == IsoTpLink::resultComplete && receivedSize == scenario.size &&
+                     memcmp(&received[0], &payload[0], scenario.size) == 0;
+    double seconds = bus.getTimeSeconds() - start;
+    unsigned long bits = bus.getBitCount() - startBits;
+
+    if (delivered) {
+        printf("%-40s %4u B  %7.2f ms  %6.1f kB/s  %3.0f %% of bus bits  %4lu frames\n",
+               scenario.name, scenario.size, seconds * 1e3, scenario.size / seconds / 1e3,
+               100.0 * scenario.size * 8 / bits, bus.getFrameCount());
+    }
+    else {
+        printf("%-40s %4u B  not delivered (%s, %u frames lost at the board)\n",
+               scenario.name, scenario.size, resultName(result), board.getDroppedFrames());
+    }
+
+    return delivered == scenario.expectDelivered;
+}
+
+static int benchmark(void) {
+    static const t_scenario scenarios[] = {
+        {"Jetson to board",                          jetsonToBoard, 7,    0,  0,    SIM_FRAME_HANDLING_SECONDS, true},
+        {"Jetson to board",                          jetsonToBoard, 64,   0,  0,    SIM_FRAME_HANDLING_SECONDS, true},
+        {"Jetson to board",                          jetsonToBoard, 512,  0,  0,    SIM_FRAME_HANDLING_SECONDS, true},
+        {"Jetson to board",                          jetsonToBoard, 4095, 0,  0,    SIM_FRAME_HANDLING_SECONDS, true},
+        {"Jetson to board, BS 8",                    jetsonToBoard, 4095, 8,  0,    SIM_FRAME_HANDLING_SECONDS, true},
+        {"Jetson to board, BS 32",                   jetsonToBoard, 4095, 32, 0,    SIM_FRAME_HANDLING_SECONDS, true},
+        {"Jetson to board, STmin 1 ms",              jetsonToBoard, 4095, 0,  1000, SIM_FRAME_HANDLING_SECONDS, true},
+        {"Jetson to busy board",                     jetsonToBoard, 512,  0,  0,    SIM_SLOW_HANDLING_SECONDS,  false},
+        {"Jetson to busy board, STmin 1 ms",         jetsonToBoard, 512,  0,  1000, SIM_SLOW_HANDLING_SECONDS,  true},
+        {"Board to Jetson, capture dump",            boardToJetson, 2048, 0,  0,    SIM_FRAME_HANDLING_SECONDS, true},
+        {"Board to Jetson, BS 16",                   boardToJetson, 4095, 16, 0,    SIM_FRAME_HANDLING_SECONDS, true},
+    };
+
+    bool passed = true;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        passed &= runScenario(scenarios[i]);
+    }
+
+    // Upper bound: every bit of 8 byte frames carrying payload, with no protocol at all
+    std::vector<uint8_t> payload = makePayload(8, 8);
+    SimCanFrame frame(SIM_BOARD_RX_CANID, &payload[0], 8);
+    double frameSeconds = (double)SimulatedCanBus::frameBits(frame) / ROVER_CANBUS_FREQUENCY;
+
+    printf("%-40s         %6.1f kB/s\n", "Raw 8 byte frames back to back", 8 / frameSeconds / 1e3);
+
+    return passed ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1) {
+        return benchmark();
+    }
+
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+}
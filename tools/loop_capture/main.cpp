@@ -0,0 +1,186 @@
+/* CAN control loop capture
+ *
+ * Build on the Jetson (or any Linux host with SocketCAN) from the repository root:
+ *
+ *   g++ -O2 -Iconfig -Ilib/user/capture/inc -o loop_capture tools/loop_capture/main.cpp
+ *
+ * Usage:
+ *
+ *   loop_capture <can interface> <board CAN ID> <target> [--on-change] [--pre <samples>]
+ *                [--decimation <n>] [--timeout <seconds>] > trace.csv
+ *
+ *   Records a target's loop at its full update rate and writes it as CSV with
+ *   the time relative to the trigger. With --on-change the capture waits for
+ *   the next set point command, otherwise it starts right away. Targets are
+ *   listed in the t_captureTarget enum (t_joint on the lower arm) of each app main.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "rover_config.h"
+#include "LoopCaptureProtocol.h"
+#include "../common/SocketCanTransport.h"
+
+#define COMMAND_RETRIES     3
+#define COMMAND_TIMEOUT_MS  100
+#define DUMP_TIMEOUT_MS     200
+#define DUMP_RETRIES        3
+#define STATUS_PERIOD_US    50000
+
+static bool command(CanTransport &transport, uint32_t boardCanId, const uint8_t *request, uint8_t len, uint8_t *reply) {
+    uint32_t replyId = ROVER_JETSON_SYS_REPLY_CANID(boardCanId) + ROVER_SYS_REPLY_CAPTURE;
+    SimCanFrame frame;
+
+    for (int attempt = 0; attempt < COMMAND_RETRIES; attempt++) {
+        transport.send(SimCanFrame(boardCanId + ROVER_CANID_SYS_CAPTURE_CMD, request, len));
+
+        while (transport.receive(replyId, frame, COMMAND_TIMEOUT_MS)) {
+            if (frame.data[0] == request[0]) {
+                memcpy(reply, frame.data, 8);
+                return reply[1] == LoopCaptureProtocol::statusOk;
+            }
+        }
+    }
+
+    fprintf(stderr, "No reply from board 0x%03x\n", boardCanId);
+    return false;
+}
+
+static bool dump(CanTransport &transport, uint32_t boardCanId, uint16_t count,
+                 std::vector<LoopCaptureProtocol::t_sample> &samples) {
+    uint32_t dataId = ROVER_JETSON_SYS_REPLY_CANID(boardCanId) + ROVER_SYS_REPLY_CAPTURE_DATA;
+    uint8_t reply[8];
+    SimCanFrame frame;
+
+    // Samples arrive in order, a short dump is requested again
+    for (int attempt = 0; attempt < DUMP_RETRIES; attempt++) {
+        uint8_t request[6] = {LoopCaptureProtocol::opDump, 0, 0, 0, (uint8_t)count, (uint8_t)(count >> 8)};
+
+        while (transport.receive(dataId, frame, 0)) {}
+
+        if (!command(transport, boardCanId, request, sizeof(request), reply)) {
+            return false;
+        }
+
+        samples.clear();
+        while (samples.size() < count && transport.receive(dataId, frame, DUMP_TIMEOUT_MS)) {
+            LoopCaptureProtocol::t_sample sample;
+            memcpy(&sample, frame.data, sizeof(sample));
+            samples.push_back(sample);
+        }
+
+        if (samples.size() == count) {
+            return true;
+        }
+    }
+
+    fprintf(stderr, "Dump incomplete, %u of %u samples\n", (unsigned int)samples.size(), count);
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <can interface> <board CAN ID> <target> [--on-change] [--pre <samples>] "
+                        "[--decimation <n>] [--timeout <seconds>]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t boardCanId = strtoul(argv[2], NULL, 0);
+    uint8_t target      = strtoul(argv[3], NULL, 0);
+    uint8_t trigger     = LoopCaptureProtocol::triggerNow;
+    uint16_t pre        = 0;
+    uint8_t decimation  = 1;
+    double timeout      = 10.0;
+
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--on-change") == 0) {
+            trigger = LoopCaptureProtocol::triggerOnSetPointChange;
+        }
+        else if (strcmp(argv[i], "--pre") == 0 && i + 1 < argc) {
+            pre = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--decimation") == 0 && i + 1 < argc) {
+            decimation = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeout = strtod(argv[++i], NULL);
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    SocketCanTransport transport;
+    if (!transport.open(argv[1])) {
+        fprintf(stderr, "Cannot open CAN interface %s\n", argv[1]);
+        return 1;
+    }
+
+    uint8_t reply[8];
+    uint8_t arm[6] = {LoopCaptureProtocol::opArm, target, trigger, decimation, (uint8_t)pre, (uint8_t)(pre >> 8)};
+
+    if (!command(transport, boardCanId, arm, sizeof(arm), reply)) {
+        fprintf(stderr, "Arm rejected\n");
+        return 1;
+    }
+
+    uint8_t status[1] = {LoopCaptureProtocol::opStatus};
+    double deadline = transport.getTimeSeconds() + timeout;
+
+    do {
+        usleep(STATUS_PERIOD_US);
+
+        if (!command(transport, boardCanId, status, sizeof(status), reply) || transport.getTimeSeconds() > deadline) {
+            fprintf(stderr, "Capture did not complete\n");
+            return 1;
+        }
+    } while (reply[3] != LoopCaptureProtocol::stateComplete);
+
+    uint16_t count, triggerIndex;
+    memcpy(&count, &reply[4], sizeof(count));
+    memcpy(&triggerIndex, &reply[6], sizeof(triggerIndex));
+
+    uint8_t describe[1] = {LoopCaptureProtocol::opDescribe};
+    float valueScale;
+
+    if (!command(transport, boardCanId, describe, sizeof(describe), reply)) {
+        return 1;
+    }
+
+    bool isOpenLoop = reply[3] & LoopCaptureProtocol::flagOpenLoop;
+    memcpy(&valueScale, &reply[4], sizeof(valueScale));
+
+    std::vector<LoopCaptureProtocol::t_sample> samples;
+
+    if (!dump(transport, boardCanId, count, samples)) {
+        return 1;
+    }
+
+    // Time 0 is the start of the first update after the trigger
+    std::vector<double> times(count, 0.0);
+    for (int i = (int)triggerIndex - 1; i >= 0; i--) {
+        times[i] = times[i + 1] - samples[i + 1].intervalUs / 1e6;
+    }
+    for (int i = triggerIndex + 1; i < count; i++) {
+        times[i] = times[i - 1] + samples[i].intervalUs / 1e6;
+    }
+
+    printf("time_s,%s,process_value,output\n", isOpenLoop ? "commanded_output" : "set_point");
+
+    for (int i = 0; i < count; i++) {
+        double setPoint = isOpenLoop ? samples[i].setPoint / 32767.0 : samples[i].setPoint * valueScale;
+
+        printf("%.6f,%g,%g,%.4f\n", times[i], setPoint, samples[i].processValue * valueScale,
+               samples[i].output / 32767.0);
+    }
+
+    uint8_t release[1] = {LoopCaptureProtocol::opRelease};
+    command(transport, boardCanId, release, sizeof(release), reply);
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/* CAN PID tuner
+ *
+ * Build on the Jetson (or any Linux host with SocketCAN) from the repository root:
+ *
+ *   g++ -O2 -Iconfig -Ilib/user/tuning/inc -o pid_tuner tools/pid_tuner/main.cpp
+ *
+ * Usage:
+ *
+ *   pid_tuner <can interface> <board CAN ID> info
+ *   pid_tuner <can interface> <board CAN ID> get <target>
+ *   pid_tuner <can interface> <board CAN ID> set <target> <param>=<value> [<param>=<value> ...]
+ *   pid_tuner <can interface> <board CAN ID> save | erase
+ *
+ *   Parameters are P, I, D, bias, deadzone, outmin and outmax. All values given
+ *   to set are applied together, eg. pid_tuner can0 0x300 set 1 P=4.2 I=0.9
+ *   Targets are listed in the t_pidTuningTarget enum of each app main.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rover_config.h"
+#include "PIDTuningProtocol.h"
+#include "../common/SocketCanTransport.h"
+
+#define COMMAND_RETRIES     3
+#define COMMAND_TIMEOUT_MS  100
+#define SAVE_TIMEOUT_MS     500 // Save and erase wait for flash page erases of up to 40 ms each
+
+static const char *paramNames[PIDTuningProtocol::paramCount] = {"P", "I", "D", "bias", "deadzone", "outmin", "outmax"};
+
+static const char *statusNames[] = {"ok", "nothing staged", "bad argument", "bad value", "flash error"};
+
+static bool command(CanTransport &transport, uint32_t boardCanId, const uint8_t *request, uint8_t len,
+                    float &value, unsigned int timeoutMs = COMMAND_TIMEOUT_MS) {
+    uint32_t replyId = ROVER_JETSON_SYS_REPLY_CANID(boardCanId) + ROVER_SYS_REPLY_PARAM;
+    SimCanFrame reply;
+
+    for (int attempt = 0; attempt < COMMAND_RETRIES; attempt++) {
+        transport.send(SimCanFrame(boardCanId + ROVER_CANID_SYS_PARAM_CMD, request, len));
+
+        while (transport.receive(replyId, reply, timeoutMs)) {
+            if (reply.data[0] != request[0]) {
+                continue;
+            }
+
+            if (reply.data[1] != PIDTuningProtocol::statusOk) {
+                fprintf(stderr, "Board replied: %s\n",
+                        reply.data[1] <= PIDTuningProtocol::statusFlashError ? statusNames[reply.data[1]] : "unknown status");
+                return false;
+            }
+
+            memcpy(&value, &reply.data[4], sizeof(value));
+            return true;
+        }
+    }
+
+    fprintf(stderr, "No reply from board 0x%03x\n", boardCanId);
+    return false;
+}
+
+static int findParam(const char *name, size_t len) {
+    for (int param = 0; param < PIDTuningProtocol::paramCount; param++) {
+        if (strlen(paramNames[param]) == len && strncasecmp(paramNames[param], name, len) == 0) {
+            return param;
+        }
+    }
+
+    return -1;
+}
+
+static bool get(CanTransport &transport, uint32_t boardCanId, uint8_t target) {
+    for (int param = 0; param < PIDTuningProtocol::paramCount; param++) {
+        uint8_t request[3] = {PIDTuningProtocol::opGet, target, (uint8_t)param};
+        float value;
+
+        if (!command(transport, boardCanId, request, sizeof(request), value)) {
+            return false;
+        }
+
+        printf("%-9s %g\n", paramNames[param], value);
+    }
+
+    return true;
+}
+
+static bool set(CanTransport &transport, uint32_t boardCanId, uint8_t target, int argc, char *argv[]) {
+    float value;
+
+    for (int i = 0; i < argc; i++) {
+        const char *p_equals = strchr(argv[i], '=');
+        int param = p_equals != NULL ? findParam(argv[i], p_equals - argv[i]) : -1;
+
+        if (param < 0) {
+            fprintf(stderr, "Expected <param>=<value>, got %s\n", argv[i]);
+            return false;
+        }
+
+        uint8_t request[8] = {PIDTuningProtocol::opSet, target, (uint8_t)param, 0};
+        value = strtof(p_equals + 1, NULL);
+        memcpy(&request[4], &value, sizeof(value));
+
+        if (!command(transport, boardCanId, request, sizeof(request), value)) {
+            uint8_t discard[2] = {PIDTuningProtocol::opDiscard, target};
+            command(transport, boardCanId, discard, sizeof(discard), value);
+            return false;
+        }
+    }
+
+    uint8_t apply[2] = {PIDTuningProtocol::opApply, target};
+
+    if (!command(transport, boardCanId, apply, sizeof(apply), value)) {
+        uint8_t discard[2] = {PIDTuningProtocol::opDiscard, target};
+        command(transport, boardCanId, discard, sizeof(discard), value);
+        return false;
+    }
+
+    return get(transport, boardCanId, target);
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <can interface> <board CAN ID> info | get <target> | "
+                        "set <target> <param>=<value> ... | save | erase\n", argv[0]);
+        return 1;
+    }
+
+    SocketCanTransport transport;
+    if (!transport.open(argv[1])) {
+        fprintf(stderr, "Cannot open CAN interface %s\n", argv[1]);
+        return 1;
+    }
+
+    uint32_t boardCanId = strtoul(argv[2], NULL, 0);
+    const char *action  = argv[3];
+    float value;
+    bool ok = false;
+
+    if (strcmp(action, "info") == 0) {
+        uint8_t request[1] = {PIDTuningProtocol::opInfo};
+        ok = command(transport, boardCanId, request, sizeof(request), value);
+        if (ok) {
+            printf("%d targets\n", (int)value);
+        }
+    }
+    else if (strcmp(action, "get") == 0 && argc == 5) {
+        ok = get(transport, boardCanId, (uint8_t)strtoul(argv[4], NULL, 0));
+    }
+    else if (strcmp(action, "set") == 0 && argc >= 6) {
+        ok = set(transport, boardCanId, (uint8_t)strtoul(argv[4], NULL, 0), argc - 5, &argv[5]);
+    }
+    else if (strcmp(action, "save") == 0 || strcmp(action, "erase") == 0) {
+        uint8_t request[1] = {(uint8_t)(action[0] == 's' ? PIDTuningProtocol::opSave : PIDTuningProtocol::opErase)};
+        ok = command(transport, boardCanId, request, sizeof(request), value, SAVE_TIMEOUT_MS);
+    }
+    else {
+        fprintf(stderr, "Unknown action %s\n", action);
+    }
+
+    return ok ? 0 : 1;
+}
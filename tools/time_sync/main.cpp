@@ -0,0 +1,240 @@
+/* CAN time synchronisation master and latency monitor
+ *
+ * Build on the Jetson (or any Linux host with SocketCAN) from the repository root:
+ *
+ *   g++ -O2 -Iconfig -Ilib/user/timesync/inc -o time_sync \
+ *       tools/time_sync/main.cpp lib/user/timesync/src/ClockSync.cpp
+ *
+ * Usage:
+ *
+ *   time_sync <can interface> [--period <ms>]
+ *       Broadcast SYNC frames (every 100 ms by default) and print, once a second,
+ *       the age of the timestamped feedback of every board and the command acks
+ *       received. Only one SYNC master may run on the bus.
+ *
+ *   time_sync --simulate
+ *       Run the board clock estimator against simulated SYNCs with queueing
+ *       and main loop delays, for a crystal and for the RC oscillator.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+#include "rover_config.h"
+#include "ClockSync.h"
+#include "TimeSyncProtocol.h"
+
+#ifdef __linux__
+#include "../common/SocketCanTransport.h"
+#endif
+
+#define SYNC_PERIOD_MS          100
+#define SIM_DURATION_S          60.0
+#define SIM_SETTLE_S            10.0
+#define SIM_EVALUATIONS         8       // Error checks between two SYNCs
+
+typedef struct {
+    const char *name;
+    double driftPpm;
+    double jetsonJumpAtS;               // Jetson reboot, 0 for none
+    double slowLoopProbability;         // Board busy for a few ms when the SYNC arrives
+
+} t_simScenario;
+
+static uint32_t s_seed = 1;
+
+static double uniform(void) {
+    s_seed = s_seed * 1103515245 + 12345;
+    return ((s_seed >> 8) & 0xFFFFFF) / 16777216.0;
+}
+
+static double exponential(double mean) {
+    return -mean * log(1.0 - uniform());
+}
+
+static bool simulate(const t_simScenario &scenario) {
+    const double jumpUs = 3.7e9;
+    const double boardStartUs = 123456789.0;
+
+    ClockSync clockSync;
+    double maxErrorUs = 0.0, sumSquares = 0.0, synchronisedAtS = -1.0;
+    unsigned int evaluations = 0;
+
+    for (double syncS = 0.0; syncS < SIM_DURATION_S; syncS += SYNC_PERIOD_MS / 1000.0) {
+        bool isJumped = scenario.jetsonJumpAtS > 0 && syncS >= scenario.jetsonJumpAtS;
+        double jetsonOffsetUs = isJumped ? jumpUs : 0.0;
+
+        // Jetson queueing, the frame on the wire, then the board's main loop picking it up
+        double sentS     = syncS + exponential(100e-6) + (uniform() < 0.05 ? 2e-3 : 0.0);
+        double receivedS = sentS + TimeSyncProtocol::syncWireTimeUs * 1e-6;
+        double readS     = receivedS + uniform() * 250e-6 + (uniform() < scenario.slowLoopProbability ? 3e-3 : 0.0);
+
+        uint32_t boardUs  = (uint32_t)fmod(boardStartUs + readS * 1e6 * (1.0 + scenario.driftPpm * 1e-6), 4294967296.0);
+        uint32_t jetsonUs = (uint32_t)fmod(syncS * 1e6 + jetsonOffsetUs, 4294967296.0);
+
+        clockSync.addSample(boardUs, jetsonUs + TimeSyncProtocol::syncWireTimeUs);
+
+        if (synchronisedAtS < 0 && clockSync.isSynchronised(boardUs)) {
+            synchronisedAtS = syncS;
+        }
+
+        bool isSettling = syncS < SIM_SETTLE_S ||
+                          (isJumped && syncS < scenario.jetsonJumpAtS + SIM_SETTLE_S);
+
+        if (isSettling) {
+            continue;
+        }
+
+        // Compare the board's idea of Jetson time with the truth until the next SYNC
+        for (unsigned int i = 0; i < SIM_EVALUATIONS; i++) {
+            double evaluateS = readS + uniform() * SYNC_PERIOD_MS / 1000.0;
+            uint32_t evaluateBoardUs = (uint32_t)fmod(boardStartUs + evaluateS * 1e6 * (1.0 + scenario.driftPpm * 1e-6),
+                                                      4294967296.0);
+            uint32_t trueJetsonUs = (uint32_t)fmod(evaluateS * 1e6 + jetsonOffsetUs, 4294967296.0);
+
+            double errorUs = (int32_t)(clockSync.toRemote(evaluateBoardUs) - trueJetsonUs);
+
+            maxErrorUs = fabs(errorUs) > maxErrorUs ? fabs(errorUs) : maxErrorUs;
+            sumSquares += errorUs * errorUs;
+            evaluations++;
+        }
+    }
+
+    double rmsErrorUs = sqrt(sumSquares / evaluations);
+
+    printf("%-40s sync after %4.1f s  error rms %5.1f us  max %6.1f us  drift %8.1f ppm (true %8.1f)\n",
+           scenario.name, synchronisedAtS, rmsErrorUs, maxErrorUs, clockSync.getDriftPpm(), scenario.driftPpm);
+
+    return synchronisedAtS >= 0 && maxErrorUs < 1000.0;
+}
+
+static int simulateAll(void) {
+    static const t_simScenario scenarios[] = {
+        {"Crystal, 30 ppm",                          30.0,     0.0,  0.0},
+        {"HSI, +0.8 %",                              8000.0,   0.0,  0.0},
+        {"HSI, -0.5 %, busy main loop",              -5000.0,  0.0,  0.2},
+        {"Crystal, Jetson reboots at 30 s",          -20.0,    30.0, 0.0},
+    };
+
+    bool passed = true;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        passed &= simulate(scenarios[i]);
+    }
+
+    return passed ? 0 : 1;
+}
+
+#ifdef __linux__
+
+typedef struct {
+    unsigned int frames, synchronised;
+    int32_t minAgeUs, maxAgeUs;
+
+} t_feedbackStats;
+
+static uint32_t jetsonTimeUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+static int runMaster(const char *interfaceName, unsigned int periodMs) {
+    SocketCanTransport transport;
+    if (!transport.open(interfaceName)) {
+        fprintf(stderr, "Cannot open CAN interface %s\n", interfaceName);
+        return 1;
+    }
+
+    static const uint32_t boards[] = {ROVER_SCIENCE_CANID, ROVER_ARM_LOWER_CANID, ROVER_ARM_UPPER_CANID};
+    std::map<uint32_t, t_feedbackStats> feedback;
+    uint8_t sequence = 0;
+    double nextSyncS = 0.0, nextReportS = 1.0;
+
+    while (true) {
+        double nowS = transport.getTimeSeconds();
+
+        if (nowS >= nextSyncS) {
+            uint8_t data[5] = {sequence++};
+            uint32_t timeUs = jetsonTimeUs();
+            memcpy(&data[1], &timeUs, sizeof(timeUs));
+
+            transport.send(SimCanFrame(ROVER_CANID_SYNC, data, sizeof(data)));
+            nextSyncS += periodMs / 1000.0;
+        }
+
+        if (nowS >= nextReportS) {
+            for (std::map<uint32_t, t_feedbackStats>::iterator it = feedback.begin(); it != feedback.end(); ++it) {
+                printf("0x%03x  %3u frames  %3u synchronised  age %6d .. %6d us\n", it->first, it->second.frames,
+                       it->second.synchronised, it->second.minAgeUs, it->second.maxAgeUs);
+            }
+
+            feedback.clear();
+            nextReportS += 1.0;
+        }
+
+        SimCanFrame frame;
+        int waitMs = (int)((nextSyncS - transport.getTimeSeconds()) * 1000.0);
+
+        if (!transport.receiveAny(frame, waitMs > 0 ? waitMs : 0)) {
+            continue;
+        }
+
+        uint32_t receivedUs = jetsonTimeUs();
+
+        // Timestamped feedback of the arm and science boards
+        if (frame.id >= ROVER_JETSON_START_CANID_MSG_ARM_LOWER && frame.id < ROVER_JETSON_START_CANID_MSG_SAFETY &&
+            frame.len == TimeSyncProtocol::timestampOffset + TimeSyncProtocol::timestampSize) {
+            const uint8_t *p_timestamp = &frame.data[TimeSyncProtocol::timestampOffset];
+            int32_t ageUs = (int32_t)(receivedUs - TimeSyncProtocol::unpackTime(p_timestamp, receivedUs));
+
+            t_feedbackStats &stats = feedback[frame.id];
+            if (stats.frames == 0 || ageUs < stats.minAgeUs) {
+                stats.minAgeUs = ageUs;
+            }
+            if (stats.frames == 0 || ageUs > stats.maxAgeUs) {
+                stats.maxAgeUs = ageUs;
+            }
+            stats.frames++;
+            stats.synchronised += (p_timestamp[3] & TimeSyncProtocol::flagSynchronised) ? 1 : 0;
+            continue;
+        }
+
+        for (size_t i = 0; i < sizeof(boards) / sizeof(boards[0]); i++) {
+            if (frame.id != ROVER_JETSON_SYS_REPLY_CANID(boards[i]) + ROVER_SYS_REPLY_COMMAND_ACK) {
+                continue;
+            }
+
+            uint32_t commandReceivedUs = TimeSyncProtocol::unpackTime(&frame.data[2], receivedUs);
+            uint32_t appliedUs         = TimeSyncProtocol::unpackTime(&frame.data[5], receivedUs);
+
+            printf("0x%03x  ack 0x%03x  applied %5d us after reception, ack seen %5d us later%s\n", boards[i],
+                   boards[i] + frame.data[0], (int32_t)(appliedUs - commandReceivedUs),
+                   (int32_t)(receivedUs - appliedUs),
+                   (frame.data[1] & TimeSyncProtocol::flagSynchronised) ? "" : " (not synchronised)");
+        }
+    }
+
+    return 0;
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 2 && strcmp(argv[1], "--simulate") == 0) {
+        return simulateAll();
+    }
+
+#ifdef __linux__
+    if (argc == 2 || (argc == 4 && strcmp(argv[2], "--period") == 0)) {
+        return runMaster(argv[1], argc == 4 ? strtoul(argv[3], NULL, 0) : SYNC_PERIOD_MS);
+    }
+#endif
+
+    fprintf(stderr, "Usage: %s <can interface> [--period <ms>] | --simulate\n", argv[0]);
+    return 1;
+}